@@ -51,9 +51,21 @@ namespace Biips
                         const NumArray::Array & paramValues,
                         const NumArray::Pair & boundValues,
                         Rng & rng) const;
+    virtual void sampleUniform(ValArray & values,
+                               const NumArray::Array & paramValues,
+                               const NumArray::Pair & boundValues,
+                               const Scalar * uniforms) const;
     virtual Scalar logDensity(const NumArray & x,
                               const NumArray::Array & paramValues,
                               const NumArray::Pair & boundValues) const;
+    virtual Scalar partialLogDensity(const NumArray & x,
+                                     const NumArray::Array & paramValues,
+                                     const NumArray::Pair & boundValues,
+                                     PDFType type) const;
+    Scalar boundedLogDensity(const NumArray & x,
+                             const NumArray::Array & paramValues,
+                             const NumArray::Pair & boundValues,
+                             PDFType type) const;
     virtual Scalar fixedUnboundedLower(const NumArray::Array & paramValues) const;
     virtual Scalar fixedUnboundedUpper(const NumArray::Array & paramValues) const;
     virtual void
@@ -79,6 +91,19 @@ namespace Biips
     virtual Scalar d(Scalar x,
                      const NumArray::Array & paramValues,
                      Bool give_log) const = 0;
+    /**
+     * Log density function, ignoring bounds, where the terms not
+     * required by type may be dropped. Defaults to the full log density.
+     * @param x value at which to evaluate the density
+     * @param paramValues Array of paramValues
+     * @param type terms required
+     */
+    virtual Scalar partialLogD(Scalar x,
+                               const NumArray::Array & paramValues,
+                               PDFType type) const
+    {
+      return d(x, paramValues, true);
+    }
     /**
      * Distribution function, ignoring bounds
      * @param x quantile at which to evaluate the distribution function
@@ -114,6 +139,10 @@ namespace Biips
     {
       return true;
     }
+    virtual Bool CanSampleUniform() const
+    {
+      return true;
+    }
     virtual Bool IsDiscreteValued(const Flags & mask) const
     {
       return discrete_;
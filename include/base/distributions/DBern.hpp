@@ -23,6 +23,10 @@ namespace Biips
                         const NumArray::Array & paramValues,
                         const NumArray::Pair & boundValues,
                         Rng & rng) const;
+    virtual void sampleUniform(ValArray & values,
+                               const NumArray::Array & paramValues,
+                               const NumArray::Pair & boundValues,
+                               const Scalar * uniforms) const;
     virtual Scalar logDensity(const NumArray & x,
                               const NumArray::Array & paramValues,
                               const NumArray::Pair & boundValues) const;
@@ -40,6 +44,10 @@ namespace Biips
     {
       return true;
     }
+    virtual Bool CanSampleUniform() const
+    {
+      return true;
+    }
     static Distribution::Ptr Instance()
     {
       static Distribution::Ptr p_instance(new SelfType());
@@ -1,42 +1,25 @@
 #ifndef BIIPS_DMNORM_HPP_
 #define BIIPS_DMNORM_HPP_
 
-#include "distribution/Distribution.hpp"
+#include "distributions/MNormalDistribution.hpp"
 
 namespace Biips
 {
-  class DMNorm: public Distribution
+  class DMNorm: public MNormalDistribution
   {
   protected:
     typedef DMNorm SelfType;
 
     DMNorm() :
-      Distribution("dmnorm", 2)
+      MNormalDistribution("dmnorm")
     {
     }
 
-    virtual Bool
-    checkParamDims(const Types<DimArray::Ptr>::Array & paramDims) const;
-    virtual DimArray dim(const Types<DimArray::Ptr>::Array & paramDims) const;
-    virtual void sample(ValArray & values,
-                        const NumArray::Array & paramValues,
-                        const NumArray::Pair & boundValues,
-                        Rng & rng) const;
-    virtual Scalar logDensity(const NumArray & x,
-                              const NumArray::Array & paramValues,
-                              const NumArray::Pair & boundValues) const;
-    virtual void
-    fixedUnboundedSupport(ValArray & lower,
-                     ValArray & upper,
-                     const NumArray::Array & paramValues) const;
+    virtual void scaleStdNormal(Vector & values, const Matrix & matChol) const;
+    virtual void whiten(Vector & diff, const Matrix & matChol) const;
+    virtual Scalar logDetPrec(const Matrix & matChol) const;
 
   public:
-    virtual Bool CheckParamValues(const NumArray::Array & paramValues) const;
-    virtual Bool IsSupportFixed(const Flags & fixmask) const
-    {
-      return true;
-    }
-
     static Distribution::Ptr Instance()
     {
       static Distribution::Ptr p_instance(new SelfType());
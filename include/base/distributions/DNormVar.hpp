@@ -36,6 +36,9 @@ namespace Biips
     virtual Scalar d(Scalar x,
                      const NumArray::Array & paramValues,
                      Bool give_log) const;
+    virtual Scalar partialLogD(Scalar x,
+                               const NumArray::Array & paramValues,
+                               PDFType type) const;
     static Distribution::Ptr Instance()
     {
       static Distribution::Ptr p_instance(new SelfType());
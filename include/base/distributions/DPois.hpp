@@ -33,6 +33,8 @@ namespace Biips
   public:
     virtual Bool CheckParamValues(const NumArray::Array & paramValues) const;
     Scalar d(Scalar x, const NumArray::Array & paramValues, Bool give_log) const;
+    Scalar partialLogD(Scalar x, const NumArray::Array & paramValues,
+                       PDFType type) const;
 
     static Distribution::Ptr Instance()
     {
@@ -23,6 +23,10 @@ namespace Biips
                         const NumArray::Array & paramValues,
                         const NumArray::Pair & boundValues,
                         Rng & rng) const;
+    virtual void sampleUniform(ValArray & values,
+                               const NumArray::Array & paramValues,
+                               const NumArray::Pair & boundValues,
+                               const Scalar * uniforms) const;
     virtual Scalar logDensity(const NumArray & x,
                               const NumArray::Array & paramValues,
                               const NumArray::Pair & boundValues) const;
@@ -34,6 +38,10 @@ namespace Biips
   public:
     virtual Bool CheckParamValues(const NumArray::Array & paramValues) const;
     virtual Bool IsSupportFixed(const Flags & fixmask) const;
+    virtual Bool CanSampleUniform() const
+    {
+      return true;
+    }
     static Distribution::Ptr Instance()
     {
       static Distribution::Ptr p_instance(new SelfType());
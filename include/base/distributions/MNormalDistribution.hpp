@@ -0,0 +1,95 @@
+#ifndef BIIPS_MNORMALDISTRIBUTION_HPP_
+#define BIIPS_MNORMALDISTRIBUTION_HPP_
+
+#include "distribution/Distribution.hpp"
+
+namespace Biips
+{
+
+  //! Multivariate normal distribution with a mean vector and a matrix
+  /*!
+   * Checks, sampling and densities shared by DMNorm and DMNormVar, whose
+   * matrix is the precision or the covariance. They only differ by the
+   * use of the Cholesky factor of the matrix.
+   */
+  class MNormalDistribution: public Distribution
+  {
+  public:
+    typedef Distribution BaseType;
+    typedef MNormalDistribution SelfType;
+
+  protected:
+    MNormalDistribution(const String & name) :
+      Distribution(name, 2)
+    {
+    }
+
+    static Bool checkMean(const NumArray & mean);
+    static Bool checkSymmetric(const NumArray & mat, Size n);
+
+    //! Lower Cholesky factor of the matrix parameter
+    /*!
+     * Throws RuntimeError if the matrix is not positive-definite.
+     */
+    Matrix choleskyFactor(const NumArray & mat) const;
+    //! Transforms standard normal values into values of the distribution
+    void transformStdNormal(ValArray & values,
+                            const NumArray::Array & paramValues) const;
+    //! Multiplies standard normal values by a square root of the covariance
+    virtual void scaleStdNormal(Vector & values, const Matrix & matChol) const = 0;
+    //! Multiplies x - mean by a square root of the precision
+    virtual void whiten(Vector & diff, const Matrix & matChol) const = 0;
+    //! Log-determinant of the precision matrix
+    virtual Scalar logDetPrec(const Matrix & matChol) const = 0;
+
+    virtual Bool
+    checkParamDims(const Types<DimArray::Ptr>::Array & paramDims) const;
+    virtual DimArray dim(const Types<DimArray::Ptr>::Array & paramDims) const;
+    virtual void sample(ValArray & values,
+                        const NumArray::Array & paramValues,
+                        const NumArray::Pair & boundValues,
+                        Rng & rng) const;
+    virtual void sampleUniform(ValArray & values,
+                               const NumArray::Array & paramValues,
+                               const NumArray::Pair & boundValues,
+                               const Scalar * uniforms) const;
+    virtual Scalar logDensity(const NumArray & x,
+                              const NumArray::Array & paramValues,
+                              const NumArray::Pair & boundValues) const
+    {
+      return partialLogDensity(x, paramValues, boundValues, PDF_FULL);
+    }
+    virtual Scalar partialLogDensity(const NumArray & x,
+                                     const NumArray::Array & paramValues,
+                                     const NumArray::Pair & boundValues,
+                                     PDFType type) const;
+    virtual void
+    fixedUnboundedSupport(ValArray & lower,
+                          ValArray & upper,
+                          const NumArray::Array & paramValues) const;
+
+  public:
+    virtual Bool CheckParamValues(const NumArray::Array & paramValues) const;
+    virtual Bool CheckVaryingParamValues(const NumArray::Array & paramValues,
+                                         const Flags & varyingMask) const;
+    virtual Bool CheckDensityVaryingParamValues(const NumArray & x,
+                                                const NumArray::Array & paramValues,
+                                                const Flags & varyingMask,
+                                                Bool varyingX) const
+    {
+      // x is not checked
+      return CheckVaryingParamValues(paramValues, varyingMask);
+    }
+    virtual Bool IsSupportFixed(const Flags & fixmask) const
+    {
+      return true;
+    }
+    virtual Bool CanSampleUniform() const
+    {
+      return true;
+    }
+  };
+
+} /* namespace Biips */
+
+#endif /* BIIPS_MNORMALDISTRIBUTION_HPP_ */
@@ -30,6 +30,9 @@ namespace Biips
     friend class ConjugateSamplerFactory<SelfType> ;
     friend class LikeFormVisitor<SelfType> ;
 
+    //! Likelihood contributions workspace, reused by each call to sample
+    MultiArray::Array likeParamContrib_;
+
     explicit ConjugateSampler(const Graph & graph) :
         NodeSampler(graph)
     {
@@ -115,10 +118,16 @@ namespace Biips
                                                                                         const NumArray::Array & postParamValues,
                                                                                         const MultiArray::Array & likeParamContrib)
   {
+    // the terms of the prior and posterior densities that only depend on
+    // the sampled value are the same: they cancel when the likelihood
+    // terms are dropped
+    PDFType type = LikePDFType();
+
     // Prior
     Scalar log_prior = PriorDist::Instance()->LogDensity(sampledData,
                                                          priorParamValues,
-                                                         NULL_NUMARRAYPAIR); // FIXME Boundaries
+                                                         NULL_NUMARRAYPAIR,
+                                                         true, type); // FIXME Boundaries
     if (isNan(log_prior))
       throw NodeError(nodeId_, "Failure to calculate log prior density.");
 
@@ -128,7 +137,8 @@ namespace Biips
     // Posterior
     Scalar log_post = PriorDist::Instance()->LogDensity(sampledData,
                                                         postParamValues,
-                                                        NULL_NUMARRAYPAIR); // FIXME Boundaries
+                                                        NULL_NUMARRAYPAIR,
+                                                        true, type); // FIXME Boundaries
     if (isNan(log_post))
       throw NodeError(nodeId_, "Failure to calculate log posterior density.");
 
@@ -153,7 +163,6 @@ namespace Biips
       throw RuntimeError("Failure to calculate log incremental weight.");
     }
 
-    // TODO optimize computation removing constant terms
     return log_incr_weight;
   }
 
@@ -192,7 +201,17 @@ namespace Biips
     boost::tie(it_offspring, it_offspring_end) =
         graph_.GetLikelihoodChildren(nodeId_);
 
-    MultiArray::Array like_param_contrib = initLikeParamContrib();
+    if (likeParamContrib_.empty())
+      likeParamContrib_ = initLikeParamContrib();
+    else
+    {
+      for (Size i = 0; i < likeParamContrib_.size(); ++i)
+      {
+        ValArray & values = likeParamContrib_[i].Values();
+        std::fill(values.begin(), values.end(), 0.0);
+      }
+    }
+    MultiArray::Array & like_param_contrib = likeParamContrib_;
     LikeFormVisitor<SelfType> like_form_vis(graph_, *this, like_param_contrib);
     for (; it_offspring != it_offspring_end; ++it_offspring)
     {
@@ -203,7 +222,7 @@ namespace Biips
                                                     like_param_contrib);
 
     // allocate memory
-    nodeValuesMap()[nodeId_].reset(new ValArray(node.Dim().Length()));
+    allocValue(node.Dim().Length());
 
     // sample
     PriorDist::Instance()->Sample(*nodeValuesMap()[nodeId_],
@@ -226,7 +245,7 @@ namespace Biips
                                                                       const Graph & graph)
   {
     Bool conjugate = false;
-    const Types<NodeId>::Array & params = node.Parents();
+    const ParentIds & params = node.Parents();
     if ((node.PriorName() == LikeDist::Instance()->Name())
         && (params[paramIndex] == priorId))
     {
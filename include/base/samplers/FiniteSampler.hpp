@@ -16,10 +16,17 @@ namespace Biips
     static const String NAME_;
     int lower_, upper_;
 
+    // workspace reused by each call to sample
+    NodeValues workValues_;
+    Flags workFlags_;
+    ValArray::Ptr pKValue_;
+    ValArray probas_;
+
     friend class FiniteSamplerFactory;
 
     explicit FiniteSampler(const Graph & graph, int lower, int upper) :
-      NodeSampler(graph), lower_(lower), upper_(upper)
+      NodeSampler(graph), lower_(lower), upper_(upper),
+          pKValue_(new ValArray(1)), probas_(upper - lower + 1)
     {
     }
 
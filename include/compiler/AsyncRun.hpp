@@ -0,0 +1,69 @@
+#ifndef BIIPS_ASYNCRUN_HPP_
+#define BIIPS_ASYNCRUN_HPP_
+
+#include "common/Types.hpp"
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace Biips
+{
+
+  class Console;
+
+  //! Handle of a Console run executed by a background worker
+  /*!
+   * Returned by Console::RunForwardSamplerAsync and
+   * Console::RunBackwardSmootherAsync. The worker is joined by Wait
+   * or when the handle is destroyed, which must happen before the
+   * console is destroyed.
+   *
+   * While the run is not finished, the console must only be accessed
+   * through the handle, by its callbacks and by the methods documented
+   * as safe during an asynchronous run.
+   */
+  class AsyncRun
+  {
+  public:
+    typedef AsyncRun SelfType;
+    typedef Types<SelfType>::Ptr Ptr;
+    typedef std::function<Bool ()> TaskType;
+
+  protected:
+    Console & console_;
+    mutable std::mutex mutex_;
+    std::condition_variable finishedCond_;
+    Bool finished_;
+    Bool succeeded_;
+    std::thread worker_;
+
+    void run(const TaskType & task);
+    //! Joins the worker and releases it from the console
+    void join();
+
+    // Forbid copying
+    AsyncRun(const AsyncRun & from);
+    AsyncRun & operator=(const AsyncRun & rhs);
+
+  public:
+    //! Starts the task in the background worker
+    AsyncRun(Console & console, const TaskType & task);
+    //! Waits for the end of the task
+    ~AsyncRun();
+
+    Bool Finished() const;
+    //! Waits for the end of the task, returns its success
+    Bool Wait();
+    //! Waits for the end of the task at most seconds, returns Finished()
+    Bool WaitFor(Scalar seconds);
+    //! Requests the interruption of the forward sampler
+    /*!
+     * See Console::CancelForwardSampler.
+     */
+    void Cancel();
+  };
+
+}
+
+#endif /* BIIPS_ASYNCRUN_HPP_ */
@@ -11,6 +11,14 @@
 #include "common/MultiArray.hpp"
 #include "common/Histogram.hpp"
 #include "model/NodeArrayMonitor.hpp"
+#include "model/DataBatch.hpp"
+#include "sampler/SamplerProfile.hpp"
+#include "common/CancelToken.hpp"
+#include "rng/Rng.hpp"
+#include "AsyncRun.hpp"
+#include <atomic>
+#include <functional>
+#include <mutex>
 
 class ParseTree;
 
@@ -23,8 +31,28 @@ namespace Biips
 
   class BUGSModel;
 
+  //! Progress of the forward sampler after one of its iterations
+  struct SMCIterationInfo
+  {
+    //! Iteration, starting at 0
+    Size iteration;
+    Size nIterations;
+    Scalar ess;
+    //! Whether the particles will be resampled at the next iteration
+    Bool resampled;
+    //! Increment of the log normalizing constant at this iteration
+    Scalar logNormConstIncrement;
+    //! Wall clock time of the iteration, in seconds
+    Scalar time;
+  };
+
   class Console
   {
+    friend class AsyncRun;
+
+  public:
+    typedef std::function<void (const SMCIterationInfo &)> IterationCallback;
+
   protected:
     std::ostream & out_;
     std::ostream & err_;
@@ -33,9 +61,59 @@ namespace Biips
     ParseTree * pRelations_;
     Types<ParseTree*>::Array * pVariables_;
     Types<String>::Array nodeArrayNames_;
-    Bool lockBackward_;
+    //! Read by the caller while an asynchronous run writes it
+    std::atomic<bool> lockBackward_;
+    //! Asynchronous runs whose worker has not been joined
+    std::atomic<Size> nAsyncRuns_;
+    Bool profiling_;
+    Bool lazyEvaluation_;
+    Bool unchecked_;
+    Bool sqmc_;
+    Bool partialLikelihood_;
+    Bool singlePrecisionArchives_;
+    Size fixedLag_;
+    SamplerProfile profile_;
+    //! Generator of the forward sampler, kept to resume the run
+    Rng::Ptr pSmcRng_;
+    CancelToken cancelToken_;
+    String checkpointFileName_;
+    Size checkpointPeriod_;
+    IterationCallback iterationCallback_;
+    //! Held by the forward sampler while it modifies the particles and
+    //! monitors, so that they can be read during an asynchronous run
+    mutable std::mutex samplerMutex_;
 
     void clearParseTrees();
+    //! Compiles the data generating model in pModel_
+    /*!
+     * @return false if the data graph is invalid, in which case the
+     * model is cleared. Throws on compilation errors.
+     */
+    Bool compileDataGraph(std::map<String, MultiArray> & dataMap, Bool clone,
+                          Size verbosity);
+    //! Runs the forward sampler without resetting the cancel token
+    Bool runForwardSampler(Size nParticles, Size smcRngSeed,
+                           const String & rsType, Scalar essThreshold,
+                           Size verbosity, Bool progressBar);
+    Bool iterateForwardSampler(Bool progressBar);
+    //! Releases the monitors after a change of data, samplerMutex_ held
+    void releaseSamplerMonitors();
+    //! Applies the sampler modes of the console to the model
+    void setSamplerModes();
+    // MonitorType is NodeArrayMonitor or NodeArrayMonitorExport
+    template<typename MonitorType>
+    Bool dumpFilterMonitors(std::map<String, MonitorType> & particlesMap);
+    template<typename MonitorType>
+    Bool dumpGenTreeSmoothMonitors(std::map<String, MonitorType> & particlesMap);
+    template<typename MonitorType>
+    Bool dumpBackwardSmoothMonitors(std::map<String, MonitorType> & particlesMap);
+    template<typename MonitorType>
+    Bool dumpFixedLagSmoothMonitors(std::map<String, MonitorType> & particlesMap);
+    //! Summary of the last iteration, samplerMutex_ held
+    SMCIterationInfo iterationInfo(Scalar logNormConstBefore,
+                                   Scalar time) const;
+    //! Calls the iteration callback, samplerMutex_ released
+    void notifyIteration(const SMCIterationInfo & info);
 
   public:
     /*!
@@ -83,6 +161,30 @@ namespace Biips
                  Size verbosity = 1, Bool clone = false);
 
     Bool PrintGraphviz(std::ostream & os);
+
+    //! Freezes the graph of the compiled model
+    /*!
+     * The graph can then be shared by concurrent samplers, but the data
+     * can not be changed anymore.
+     */
+    Bool FreezeGraph();
+
+    //! Runs this console on the model compiled by another console
+    /*!
+     * The model is shared: its graph must be frozen and the other console
+     * must keep it until this one is cleared. This console has its own
+     * monitors, sampler and smoother, and can run in another thread.
+     *
+     * @param dataMap Values of observed variables replacing those of the
+     * compiled model, for this console only. The observed nodes can not
+     * change. The filter and smoother statistics of observed components
+     * are still read in the compiled model.
+     *
+     * @return true on success or false on error.
+     */
+    Bool OpenSession(const Console & compiled,
+                     const std::map<String, MultiArray> & dataMap,
+                     Size verbosity = 1);
     /*!
      * Returns a vector of variable names used by the model. This vector
      * excludes any counters used by the model within a for loop.
@@ -103,6 +205,8 @@ namespace Biips
                                   NULL_RANGE);
     Bool SetBackwardSmoothMonitor(const String & name, const IndexRange & range =
                               NULL_RANGE);
+    Bool SetFixedLagSmoothMonitor(const String & name, const IndexRange & range =
+                                      NULL_RANGE);
 
     Bool IsFilterMonitored(const String & name, const IndexRange & range =
                                NULL_RANGE, Bool check_released = true);
@@ -110,10 +214,13 @@ namespace Biips
                                    NULL_RANGE, Bool check_released = true);
     Bool IsBackwardSmoothMonitored(const String & name, const IndexRange & range =
                                NULL_RANGE, Bool check_released = true);
+    Bool IsFixedLagSmoothMonitored(const String & name, const IndexRange & range =
+                                       NULL_RANGE, Bool check_released = true);
 
     Bool ClearFilterMonitors(Bool release_only = false);
     Bool ClearGenTreeSmoothMonitors(Bool release_only = false);
     Bool ClearBackwardSmoothMonitors(Bool release_only = false);
+    Bool ClearFixedLagSmoothMonitors(Bool release_only = false);
 
     /*!
      * @short Builds the SMC sampler.
@@ -133,23 +240,148 @@ namespace Biips
                            Size verbosity = 1,
                            Bool progressBar = true);
 
+    /*!
+     * Runs the remaining iterations of an interrupted forward sampler,
+     * or of a forward sampler restored by LoadCheckpoint.
+     */
+    Bool ResumeForwardSampler(Size verbosity = 1, Bool progressBar = true);
+
+    /*!
+     * Runs the forward sampler in a background worker.
+     *
+     * Nothing is printed. The progress is reported by the iteration
+     * callback, called by the worker, and the filter statistics of the
+     * sampled nodes can be read with ExtractSampledFilterStat while
+     * the run continues.
+     *
+     * @return the handle of the run
+     */
+    AsyncRun::Ptr RunForwardSamplerAsync(Size nParticles, Size smcRngSeed,
+                                         const String & rsType,
+                                         Scalar essThreshold);
+    /*!
+     * Runs an island particle filter: the particles are split between
+     * nIslands sub-filters run by local worker processes, which
+     * exchange their weights through shared memory and migrate through
+     * pipes. See IslandSampler.
+     *
+     * The filter monitors receive the particles of all the islands,
+     * weighted by their island weights, and the other monitors are
+     * released. The sampler must be built, and no asynchronous run may
+     * be live: the workers are forked from a single-threaded process.
+     *
+     * @param islandEssThreshold threshold of the ESS of the island
+     * weights, a fraction of nIslands if <= 1
+     * @param migrate whether the islands are resampled when their ESS
+     * falls below islandEssThreshold
+     */
+    Bool RunIslandSampler(Size nParticles, Size nIslands, Size smcRngSeed,
+                          const String & rsType, Scalar essThreshold,
+                          Scalar islandEssThreshold, Bool migrate,
+                          Scalar & logNormConst, Size verbosity = 1);
+    /*!
+     * Runs the backward smoother in a background worker.
+     *
+     * @return the handle of the run
+     */
+    AsyncRun::Ptr RunBackwardSmootherAsync();
+
+    /*!
+     * Sets the function called after each iteration of the forward
+     * sampler, by the thread running it. An empty function disables
+     * the calls.
+     */
+    void SetIterationCallback(const IterationCallback & callback)
+    {
+      iterationCallback_ = callback;
+    }
+
     Bool ForwardSamplerAtEnd();
 
+    /*!
+     * Requests the interruption of the running forward sampler.
+     *
+     * Can be called from another thread or from a signal handler.
+     * The sampler stops before its next iteration, writes a checkpoint
+     * if a checkpoint file is set, and RunForwardSampler returns false.
+     * The run can be continued with ResumeForwardSampler.
+     */
+    void CancelForwardSampler()
+    {
+      cancelToken_.Request();
+    }
+
+    /*!
+     * Writes the state of the forward sampler to a file: particles,
+     * weights, generator state, locks and monitors.
+     *
+     * The file is replaced atomically.
+     */
+    Bool SaveCheckpoint(const String & fileName);
+    /*!
+     * Restores the state of the forward sampler from a file written
+     * by SaveCheckpoint.
+     *
+     * The model must be compiled with the same data and its sampler built
+     * with the same monitors as when the checkpoint was written. The
+     * sampler modes and the fixed lag of the checkpoint are restored.
+     */
+    Bool LoadCheckpoint(const String & fileName);
+    /*!
+     * Writes a checkpoint every period iterations of the forward sampler,
+     * and when it is interrupted. A period of 0 only writes a checkpoint
+     * on interruption. An empty file name disables the checkpoints.
+     */
+    void SetCheckpoint(const String & fileName, Size period = 0)
+    {
+      checkpointFileName_ = fileName;
+      checkpointPeriod_ = period;
+    }
+
     Bool GetLogNormConst(Scalar & logNormConst);
 
     Bool SampleGenTreeSmoothParticle(Size rngSeed, std::map<String, MultiArray> & sampledValueMap);
+    //! Samples nTrajectories particles at once, see BUGSModel::SampleGenTreeSmoothParticles
+    Bool SampleGenTreeSmoothParticles(Size nTrajectories, Size rngSeed,
+                                      std::map<String, MultiArray> & sampledValueMap,
+                                      Size nThreads = 1);
 
     Bool RunBackwardSmoother(Size verbosity = 1, Bool progressBar = true);
 
     Bool ExtractFilterStat(const String & name,
                            StatTag statFeature,
                            std::map<IndexRange, MultiArray> & statMap);
+    /*!
+     * Extracts the filter statistics of the components of a variable
+     * that have already been sampled by the forward sampler.
+     *
+     * Safe during an asynchronous run of the forward sampler.
+     */
+    Bool ExtractSampledFilterStat(const String & name,
+                                  StatTag statFeature,
+                                  std::map<IndexRange, MultiArray> & statMap);
     Bool ExtractGenTreeSmoothStat(const String & name,
                                StatTag statFeature,
                                std::map<IndexRange, MultiArray> & statMap);
     Bool ExtractBackwardSmoothStat(const String & name,
                            StatTag statFeature,
                            std::map<IndexRange, MultiArray> & statMap);
+    Bool ExtractFixedLagSmoothStat(const String & name,
+                                   StatTag statFeature,
+                                   std::map<IndexRange, MultiArray> & statMap);
+    /*!
+     * Extracts the fixed-lag smoother statistics of the components of a
+     * variable estimated since the last call, then releases their
+     * monitors. Draining after each iteration, e.g. from the iteration
+     * callback, keeps the memory of the fixed-lag smoother bounded by
+     * the window of lag iterations. The released components can not be
+     * extracted again.
+     *
+     * Safe during an asynchronous run of the forward sampler.
+     */
+    Bool DrainFixedLagSmoothStat(const String & name,
+                                 StatTag statFeature,
+                                 std::map<IndexRange, MultiArray> & statMap);
 
     Bool ExtractFilterPdf(const String & name,
                           std::map<IndexRange, Histogram> & pdfMap,
@@ -163,6 +395,10 @@ namespace Biips
                           std::map<IndexRange, Histogram> & pdfMap,
                           Size numBins = 40,
                           Scalar cacheFraction = 0.25);
+    Bool ExtractFixedLagSmoothPdf(const String & name,
+                                  std::map<IndexRange, Histogram> & pdfMap,
+                                  Size numBins = 40,
+                                  Scalar cacheFraction = 0.25);
 
     Bool DumpData(std::map<String, MultiArray> & dataMap);
     Bool
@@ -177,6 +413,23 @@ namespace Biips
                MultiArray & data,
                Size rngSeed,
                Size verbosity = 1);
+    /*!
+     * Samples nDatasets datasets from the data generating model, in
+     * parallel, given the data in dataMap. The existing model is
+     * cleared, as by Compile.
+     *
+     * @param nThreads Number of threads, 0 for the number of hardware
+     * threads. The datasets do not depend on it.
+     *
+     * @return true on success or false on error.
+     */
+    Bool SampleDataBatch(DataBatch::Ptr & pBatch,
+                         std::map<String, MultiArray> & dataMap,
+                         Size nDatasets,
+                         Size dataRngSeed,
+                         Size nThreads = 0,
+                         Size verbosity = 1,
+                         Bool clone = false);
 
     Bool RemoveData(const String & variable,
                     const IndexRange & range,
@@ -192,6 +445,18 @@ namespace Biips
     Bool
     DumpGenTreeSmoothMonitors(std::map<String, NodeArrayMonitor> & particlesMap);
     Bool DumpBackwardSmoothMonitors(std::map<String, NodeArrayMonitor> & particlesMap);
+    Bool DumpFixedLagSmoothMonitors(std::map<String, NodeArrayMonitor> & particlesMap);
+    /*!
+     * Overloads exporting the monitors into caller-provided buffers.
+     * The values are copied once, by NodeArrayMonitorExport::Export,
+     * which must be called before the monitors are cleared or the
+     * sampler is run again.
+     */
+    Bool DumpFilterMonitors(std::map<String, NodeArrayMonitorExport> & particlesMap);
+    Bool
+    DumpGenTreeSmoothMonitors(std::map<String, NodeArrayMonitorExport> & particlesMap);
+    Bool DumpBackwardSmoothMonitors(std::map<String, NodeArrayMonitorExport> & particlesMap);
+    Bool DumpFixedLagSmoothMonitors(std::map<String, NodeArrayMonitorExport> & particlesMap);
 
     Bool DumpNodeIds(Types<NodeId>::Array & nodeIds);
     Bool DumpNodeNames(Types<String>::Array & nodeNames);
@@ -200,6 +465,116 @@ namespace Biips
     Bool DumpNodeDiscrete(Flags & nodeDiscrete);
     Bool DumpNodeIterations(Types<Size>::Array & nodeIterations);
     Bool DumpNodeSamplers(Types<String>::Array & nodeSamplers);
+
+    /*!
+     * Enables or disables the profiling of the SMC runs.
+     * Each run of the forward sampler clears the previous records.
+     */
+    void SetProfiling(Bool enable)
+    {
+      profiling_ = enable;
+    }
+    Bool Profiling() const
+    {
+      return profiling_;
+    }
+    const SamplerProfile & Profile() const
+    {
+      return profile_;
+    }
+    /*!
+     * Prints the profile records of the last SMC runs.
+     *
+     * @param traceEvents print in the trace event format instead of JSON
+     */
+    Bool DumpProfile(std::ostream & os, Bool traceEvents = false);
+
+    /*!
+     * Enables or disables the lazy evaluation of the logical nodes
+     * in the next runs of the forward sampler: only the logical nodes
+     * needed by a stochastic node or a monitor are evaluated.
+     */
+    void SetLazyEvaluation(Bool lazy)
+    {
+      lazyEvaluation_ = lazy;
+    }
+    Bool LazyEvaluation() const
+    {
+      return lazyEvaluation_;
+    }
+
+    /*!
+     * Enables or disables the unchecked mode in the next runs of the
+     * forward sampler: the parameter values of the nodes are not checked.
+     * Meant for production runs of a model that has passed a checked run.
+     */
+    void SetUnchecked(Bool unchecked)
+    {
+      unchecked_ = unchecked;
+    }
+    Bool Unchecked() const
+    {
+      return unchecked_;
+    }
+
+    /*!
+     * Enables or disables the sequential quasi-Monte Carlo mode in the
+     * next runs of the forward sampler: the particles are moved with
+     * randomized Sobol points and resampled at each iteration. Requires
+     * the prior mutation and distributions that can be sampled from
+     * uniforms.
+     */
+    void SetSqmc(Bool sqmc)
+    {
+      sqmc_ = sqmc;
+    }
+    Bool Sqmc() const
+    {
+      return sqmc_;
+    }
+
+    /*!
+     * Enables or disables the partial log-likelihoods in the next runs of
+     * the forward sampler: the terms that only depend on the observed
+     * values are not computed in the particle weights. The log
+     * normalizing constant is unchanged.
+     */
+    void SetPartialLikelihood(Bool partial)
+    {
+      partialLikelihood_ = partial;
+    }
+    Bool PartialLikelihood() const
+    {
+      return partialLikelihood_;
+    }
+
+    /*!
+     * Archives the node values of the monitors in single precision in the
+     * next runs of the forward sampler, halving their memory. The
+     * particles, weights and normalizing constant stay in double
+     * precision.
+     */
+    void SetSinglePrecisionArchives(Bool single)
+    {
+      singlePrecisionArchives_ = single;
+    }
+    Bool SinglePrecisionArchives() const
+    {
+      return singlePrecisionArchives_;
+    }
+
+    /*!
+     * Sets the lag of the fixed-lag smoother in the next runs of the
+     * forward sampler.
+     */
+    void SetFixedLag(Size lag)
+    {
+      fixedLag_ = lag;
+    }
+    Size FixedLag() const
+    {
+      return fixedLag_;
+    }
   };
 }
 
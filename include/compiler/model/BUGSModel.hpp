@@ -6,6 +6,7 @@
 #include "model/SymbolTable.hpp"
 #include "common/Accumulator.hpp"
 #include "model/NodeArrayMonitor.hpp"
+#include "model/DataBatch.hpp"
 
 #include <map>
 
@@ -20,26 +21,67 @@ namespace Biips
     typedef Types<SelfType>::Ptr Ptr;
 
   protected:
-    SymbolTable symbolTable_;
+    boost::shared_ptr<SymbolTable> pSymbolTable_;
     Types<String>::Array filterMonitorsNames_;
     Types<IndexRange>::Array filterMonitorsRanges_;
     Types<String>::Array genTreeSmoothMonitorsNames_;
     Types<IndexRange>::Array genTreeSmoothMonitorsRanges_;
     Types<String>::Array backwardSmoothMonitorsNames_;
     Types<IndexRange>::Array backwardSmoothMonitorsRanges_;
+    Types<String>::Array fixedLagSmoothMonitorsNames_;
+    Types<IndexRange>::Array fixedLagSmoothMonitorsRanges_;
+
+    // MonitorType is NodeArrayMonitor or NodeArrayMonitorExport
+    template<typename MonitorType>
+    Bool dumpFilterMonitors(std::map<String, MonitorType> & monitorsMap) const;
+    template<typename MonitorType>
+    Bool dumpGenTreeSmoothMonitors(std::map<String, MonitorType> & monitorsMap) const;
+    template<typename MonitorType>
+    Bool dumpBackwardSmoothMonitors(std::map<String, MonitorType> & monitorsMap) const;
+    template<typename MonitorType>
+    Bool dumpFixedLagSmoothMonitors(std::map<String, MonitorType> & monitorsMap) const;
 
   public:
     BUGSModel(Bool dataModel = false)
-        : BaseType(dataModel), symbolTable_(*this)
+        : BaseType(dataModel), pSymbolTable_(new SymbolTable(*pGraph_))
     {
     }
+    //! Model sharing the compiled graph and symbol table of another one
+    /*!
+     * The graph must be frozen: the models only read it and the symbol
+     * table, and can run in different threads. Each one has its own
+     * monitors, sampler and smoother, and its own observed values set
+     * by SetObsData.
+     */
+    BUGSModel(const boost::shared_ptr<Graph> & pGraph,
+              const boost::shared_ptr<SymbolTable> & pSymbolTable);
 
     std::map<String, MultiArray> Sample(Rng * pRng) const;
+    //! Samples nDatasets datasets in parallel
+    /*!
+     * Dataset m is sampled with its own generator, seeded with the
+     * sequence (seed, m), so the datasets do not depend on nThreads.
+     * nThreads = 0 uses the number of hardware threads.
+     */
+    DataBatch::Ptr SampleBatch(Size nDatasets, Size seed,
+                               Size nThreads = 0) const;
 
     SymbolTable & GetSymbolTable()
     {
-      return symbolTable_;
+      return *pSymbolTable_;
     }
+    const boost::shared_ptr<SymbolTable> & SymbolTablePtr() const
+    {
+      return pSymbolTable_;
+    }
+
+    //! Sets the values of observed variables for this model only
+    /*!
+     * Only the values of the observed stochastic nodes are used: the
+     * other components of the variables are ignored. Replaces the values
+     * of a previous call. See Model::SetObsValues.
+     */
+    void SetObsData(const std::map<String, MultiArray> & dataMap);
 
     Bool SetFilterMonitor(const String & name, const IndexRange & range =
         NULL_RANGE);
@@ -47,6 +89,8 @@ namespace Biips
         NULL_RANGE);
     Bool SetBackwardSmoothMonitor(const String & name, const IndexRange & range =
         NULL_RANGE);
+    Bool SetFixedLagSmoothMonitor(const String & name, const IndexRange & range =
+        NULL_RANGE);
 
     Bool
     IsFilterMonitored(const String & name, IndexRange range = NULL_RANGE,
@@ -57,6 +101,9 @@ namespace Biips
     Bool
     IsBackwardSmoothMonitored(const String & name, IndexRange range = NULL_RANGE,
                       Bool check_released = true) const;
+    Bool
+    IsFixedLagSmoothMonitored(const String & name, IndexRange range = NULL_RANGE,
+                              Bool check_released = true) const;
 
 //    void PrintSamplersSequence(std::ostream & out) const;
 
@@ -65,11 +112,19 @@ namespace Biips
     // TODO manage multi statFeature
     Bool ExtractFilterStat(String name, StatTag statFeature,
                            std::map<IndexRange, MultiArray> & statMap) const;
+    // only the components already sampled, while the sampler is running
+    Bool ExtractSampledFilterStat(String name, StatTag statFeature,
+                                  std::map<IndexRange, MultiArray> & statMap) const;
     Bool ExtractGenTreeSmoothStat(
         String name, StatTag statFeature,
         std::map<IndexRange, MultiArray> & statMap) const;
     Bool ExtractBackwardSmoothStat(String name, StatTag statFeature,
                            std::map<IndexRange, MultiArray> & statMap) const;
+    Bool ExtractFixedLagSmoothStat(String name, StatTag statFeature,
+                                   std::map<IndexRange, MultiArray> & statMap) const;
+    //! Extracts then releases the fixed-lag estimates of name not released yet
+    Bool DrainFixedLagSmoothStat(String name, StatTag statFeature,
+                                 std::map<IndexRange, MultiArray> & statMap);
 
     Bool ExtractFilterPdf(String name, std::map<IndexRange, Histogram> & pdfMap,
                           Size numBins = 40, Scalar cacheFraction = 0.25) const;
@@ -79,6 +134,10 @@ namespace Biips
                               Scalar cacheFraction = 0.25) const;
     Bool ExtractBackwardSmoothPdf(String name, std::map<IndexRange, Histogram> & pdfMap,
                           Size numBins = 40, Scalar cacheFraction = 0.25) const;
+    Bool ExtractFixedLagSmoothPdf(String name,
+                                  std::map<IndexRange, Histogram> & pdfMap,
+                                  Size numBins = 40,
+                                  Scalar cacheFraction = 0.25) const;
 
     Bool DumpData(std::map<String, MultiArray> & dataMap) const;
     Bool ChangeData(const String & variable, const IndexRange & range,
@@ -98,14 +157,48 @@ namespace Biips
         std::map<String, NodeArrayMonitor> & monitorsMap) const;
     Bool
     DumpBackwardSmoothMonitors(std::map<String, NodeArrayMonitor> & monitorsMap) const;
+    Bool
+    DumpFixedLagSmoothMonitors(std::map<String, NodeArrayMonitor> & monitorsMap) const;
+    //! Overloads exporting the monitors without copying them
+    /*!
+     * The exports refer to the monitors of the model: they must be
+     * exported before the monitors are cleared or the sampler is run again.
+     */
+    Bool
+    DumpFilterMonitors(std::map<String, NodeArrayMonitorExport> & monitorsMap) const;
+    Bool
+    DumpGenTreeSmoothMonitors(
+        std::map<String, NodeArrayMonitorExport> & monitorsMap) const;
+    Bool
+    DumpBackwardSmoothMonitors(
+        std::map<String, NodeArrayMonitorExport> & monitorsMap) const;
+    Bool
+    DumpFixedLagSmoothMonitors(
+        std::map<String, NodeArrayMonitorExport> & monitorsMap) const;
 
     Bool SampleGenTreeSmoothParticle(
         Rng * pRng,
         std::map<String, MultiArray> & sampledValues) const;
+    //! Samples nTrajectories particles of the genealogical tree at once
+    /*!
+     * The particles are drawn independently according to the weights,
+     * from one categorical distribution built in O(N): the trajectories
+     * are those of nTrajectories successive calls of
+     * SampleGenTreeSmoothParticle with the same rng. The value of each
+     * monitored array has an additional last dimension of size
+     * nTrajectories. The values are gathered by nThreads threads,
+     * 0 meaning the number of hardware threads.
+     */
+    Bool SampleGenTreeSmoothParticles(
+        Rng * pRng,
+        Size nTrajectories,
+        std::map<String, MultiArray> & sampledValues,
+        Size nThreads = 1) const;
 
     void virtual ClearFilterMonitors(Bool release_only = false);
     void virtual ClearGenTreeSmoothMonitors(Bool release_only = false);
     void virtual ClearBackwardSmoothMonitors(Bool release_only = false);
+    void virtual ClearFixedLagSmoothMonitors(Bool release_only = false);
   };
 
 }
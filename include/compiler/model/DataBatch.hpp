@@ -0,0 +1,79 @@
+#ifndef BIIPS_DATABATCH_HPP_
+#define BIIPS_DATABATCH_HPP_
+
+#include "common/Types.hpp"
+#include "common/MultiArray.hpp"
+#include <map>
+
+namespace Biips
+{
+
+  //! Batch of datasets sampled from the same data model
+  /*!
+   * The values of all the datasets are stored in one contiguous buffer,
+   * dataset after dataset. Within a dataset, the variables are stored
+   * one after the other in the order of their names, each one in
+   * column-major order like a MultiArray. Missing values are
+   * BIIPS_REALNA.
+   */
+  class DataBatch
+  {
+  public:
+    typedef DataBatch SelfType;
+    typedef Types<SelfType>::Ptr Ptr;
+
+  protected:
+    Size nDatasets_;
+    Size datasetSize_;
+    std::map<String, DimArray::Ptr> dims_;
+    std::map<String, Size> offsets_;
+    ValArray values_;
+
+  public:
+    //! Allocates nDatasets datasets of the variables with dimensions dims
+    DataBatch(const std::map<String, DimArray::Ptr> & dims, Size nDatasets);
+
+    Size NDatasets() const
+    {
+      return nDatasets_;
+    }
+    //! Number of values in one dataset
+    Size DatasetSize() const
+    {
+      return datasetSize_;
+    }
+    const std::map<String, DimArray::Ptr> & Dims() const
+    {
+      return dims_;
+    }
+    //! Offset of a variable in the datasets
+    Size Offset(const String & variable) const;
+
+    //! Values of the dataset
+    const Scalar * Dataset(Size dataset) const
+    {
+      return values_.data() + dataset * datasetSize_;
+    }
+    Scalar * Dataset(Size dataset)
+    {
+      return values_.data() + dataset * datasetSize_;
+    }
+    //! Values of all the datasets
+    const ValArray & Values() const
+    {
+      return values_;
+    }
+
+    //! Writes the variables of a dataset in dataMap
+    /*!
+     * The existing entries are replaced. As when the data are sampled
+     * by Console::Compile, the variables whose values are all missing
+     * are skipped. The result can be given to Console::Compile or
+     * Console::ChangeData.
+     */
+    void GetDataMap(Size dataset, std::map<String, MultiArray> & dataMap) const;
+  };
+
+}
+
+#endif /* BIIPS_DATABATCH_HPP_ */
@@ -11,6 +11,134 @@ namespace Biips
   class Graph;
   class SymbolTable;
 
+  //! Destination buffers of the export of a monitored node array
+  /*!
+   * The buffers are allocated by the caller, e.g. directly in the arrays
+   * of a binding, with the sizes given by NodeArrayMonitorExport.
+   * They are filled in column-major order and NULL buffers are skipped:
+   * - values: range length x number of particles
+   * - weights: number of particles x number of iterations
+   * - weightIterations: number of iterations
+   * - ess, iterations, nodeIds, discrete: range length
+   */
+  struct NodeArrayMonitorBuffers
+  {
+    Scalar * values;
+    Scalar * weights;
+    Scalar * weightIterations;
+    Scalar * ess;
+    Scalar * iterations;
+    Scalar * nodeIds;
+    Scalar * discrete;
+
+    NodeArrayMonitorBuffers() :
+      values(NULL), weights(NULL), weightIterations(NULL), ess(NULL),
+      iterations(NULL), nodeIds(NULL), discrete(NULL)
+    {
+    }
+  };
+
+  //! Exports a monitored node array into caller-provided buffers
+  /*!
+   * The values are copied once, from the monitors to the destination
+   * buffers. The normalized weights are stored once per sampling
+   * iteration: the weights of an element are the column of its
+   * iteration. Observed elements have a NA iteration and equal weights.
+   *
+   * The export refers to the monitors, which must not be cleared
+   * before Export() is called.
+   */
+  class NodeArrayMonitorExport
+  {
+  protected:
+    String name_;
+    IndexRange range_;
+    Size nParticles_;
+    const Graph * pGraph_;
+    //! Subnodes of the array overlapping the range
+    Types<NodeId>::Array subNodeIds_;
+    Types<IndexRange>::Array subRanges_;
+    //! Monitor of each subnode, NULL if the subnode is observed
+    Types<const Monitor *>::Array subMonitors_;
+    //! Monitors by increasing sampling iteration
+    std::map<Size, const Monitor *> iterationMonitors_;
+    Types<NodeId>::Array conditionalNodeIds_;
+    Types<String>::Array conditionalNodeNames_;
+    Types<Size>::Array conditionalNodeCounts_;
+
+    void addSubNode(NodeId id,
+                    const IndexRange & subRange,
+                    const Monitor * pMonitor);
+    void setSubNodes(const NodeArray & nodeArray,
+                     const std::map<NodeId, Monitor*> & monitorsMap);
+    void setSubNodes(const NodeArray & nodeArray, const Monitor* pMonitor);
+    void setConditionalNodeIds(const NodeArray & nodeArray,
+                               const std::map<NodeId, Monitor*> & monitorsMap);
+    void setConditionalNodeNames(const SymbolTable & symtab);
+
+  public:
+    // constructor for filtering monitors
+    NodeArrayMonitorExport(const NodeArray & nodeArray,
+                           const IndexRange & range,
+                           const std::map<NodeId, Monitor*> & monitorsMap,
+                           Size nParticles,
+                           const Graph & graph,
+                           const SymbolTable & symtab);
+    // constructor for backward smoothing monitors
+    NodeArrayMonitorExport(const NodeArray & nodeArray,
+                           const IndexRange & range,
+                           const std::map<NodeId, Monitor*> & monitorsMap,
+                           Size nParticles,
+                           const Graph & graph,
+                           const SymbolTable & symtab,
+                           const Types<NodeId>::Array & condNodes);
+    // constructor for smoothing monitors
+    NodeArrayMonitorExport(const NodeArray & nodeArray,
+                           const IndexRange & range,
+                           const Monitor* pMonitor,
+                           Size nParticles,
+                           const Graph & graph,
+                           const SymbolTable & symtab);
+
+    const String & GetName() const
+    {
+      return name_;
+    }
+    const IndexRange & GetRange() const
+    {
+      return range_;
+    }
+    Size NParticles() const
+    {
+      return nParticles_;
+    }
+    //! Number of sampling iterations, i.e. of columns of weights
+    Size NIterations() const
+    {
+      return iterationMonitors_.size();
+    }
+    //! Conditional nodes, as in NodeArrayMonitor
+    const Types<NodeId>::Array & GetConditionalNodeIdSequence() const
+    {
+      return conditionalNodeIds_;
+    }
+    const Types<String>::Array & GetConditionalNodeNameSequence() const
+    {
+      return conditionalNodeNames_;
+    }
+    const Types<Size>::Array & GetConditionalNodeCounts() const
+    {
+      return conditionalNodeCounts_;
+    }
+
+    void Export(const NodeArrayMonitorBuffers & buffers) const;
+  };
+
+  //! Copy of a monitored node array
+  /*!
+   * The weights are replicated for each element of the array.
+   * NodeArrayMonitorExport avoids these copies.
+   */
   class NodeArrayMonitor
   {
   protected:
@@ -23,28 +151,11 @@ namespace Biips
     MultiArray iterations_;
     MultiArray nodeIds_;
     MultiArray discrete_;
-    Types<Types<NodeId>::Array>::Array conditionalNodeIds_;
-    Types<Types<String>::Array>::Array conditionalNodeNames_;
-
-    template<typename StorageOrderType>
-    void addObservedNode(NodeId id,
-                         const IndexRange & subRange,
-                         const Graph & graph);
-    template<typename StorageOrderType>
-    void addMonitoredNode(NodeId id,
-                          const IndexRange & subRange,
-                          const Monitor* pMonitor);
+    Types<NodeId>::Array conditionalNodeIds_;
+    Types<String>::Array conditionalNodeNames_;
+    Types<Size>::Array conditionalNodeCounts_;
 
-    void setMembers(const NodeArray & nodeArray,
-                    const std::map<NodeId, Monitor*> & monitorsMap,
-                    const Graph & graph);
-    void setMembers(const NodeArray & nodeArray,
-                    const Monitor* pMonitor,
-                    const Graph & graph);
-    void setConditionalNodeIds(const NodeArray & nodeArray,
-                             const std::map<NodeId, Monitor*> & monitorsMap,
-                             const Graph & graph);
-    void setConditionalNodeNames(const SymbolTable & symtab);
+    void setMembers(const NodeArrayMonitorExport & monitorExport);
 
   public:
     // constructor for filtering monitors
@@ -102,21 +213,48 @@ namespace Biips
     {
       return discrete_;
     }
-    const Types<Types<NodeId>::Array>::Array & GetConditionalNodeIds() const
+    //! Conditional nodes of the monitored elements
+    /*!
+     * The conditional nodes of each element are a prefix of this sequence
+     * whose length is given by GetConditionalNodeCounts().
+     */
+    const Types<NodeId>::Array & GetConditionalNodeIdSequence() const
     {
       return conditionalNodeIds_;
     }
-    const Types<Types<String>::Array>::Array & GetConditionalNodeNames() const
+    const Types<String>::Array & GetConditionalNodeNameSequence() const
     {
       return conditionalNodeNames_;
     }
+    //! Conditional nodes, one list per count of GetConditionalNodeCounts()
+    /*!
+     * Copies the prefixes of GetConditionalNodeIdSequence(), as returned
+     * before the sequence was shared.
+     */
+    Types<Types<NodeId>::Array>::Array GetConditionalNodeIds() const;
+    Types<Types<String>::Array>::Array GetConditionalNodeNames() const;
+    //! Number of conditional nodes of each element
+    /*!
+     * One count per element of the range for filtering monitors,
+     * or one count shared by all the elements for smoothing monitors.
+     */
+    const Types<Size>::Array & GetConditionalNodeCounts() const
+    {
+      return conditionalNodeCounts_;
+    }
   };
 
+  //! Values of a monitored node array for some particles
+  /*!
+   * With several particles, the value has an additional last dimension,
+   * and the values of each particle are contiguous.
+   */
   class NodeArrayValue
   {
   protected:
     IndexRange range_;
     MultiArray value_;
+    Types<Size>::Array particleIndices_;
 
     template<typename StorageOrderType>
     void addObservedNode(NodeId id,
@@ -125,8 +263,12 @@ namespace Biips
     template<typename StorageOrderType>
     void addMonitoredNode(NodeId id,
                           const IndexRange & subRange,
-                          const Monitor* pMonitor,
-                          Size particleIndex);
+                          const Monitor* pMonitor);
+
+    void setValue(const NodeArray & nodeArray,
+                  const Monitor* pMonitor,
+                  const Graph & graph,
+                  Size nThreads);
 
   public:
     NodeArrayValue(const NodeArray & nodeArray,
@@ -134,6 +276,17 @@ namespace Biips
                    const Monitor* pMonitor,
                    Size particleIndex,
                    const Graph & graph);
+    //! Values of the particles of particleIndices
+    /*!
+     * The monitored subnodes are gathered by nThreads threads,
+     * 0 meaning the number of hardware threads.
+     */
+    NodeArrayValue(const NodeArray & nodeArray,
+                   const IndexRange & range,
+                   const Monitor* pMonitor,
+                   const Types<Size>::Array & particleIndices,
+                   const Graph & graph,
+                   Size nThreads = 1);
 
     const MultiArray & GetValue() const
     {
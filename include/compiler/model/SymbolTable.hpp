@@ -13,12 +13,12 @@
 namespace Biips
 {
 
-  class Model;
+  class Graph;
 
   class SymbolTable
   {
   protected:
-    Model & model_;
+    Graph & graph_;
     std::map<String, NodeArray::Ptr> nodeArraysMap_;
 
     NodeArray & getNodeArray(const String & name)
@@ -30,7 +30,7 @@ namespace Biips
                          std::map<Size, NodeId> & stoChildrenByRank,
                          Bool mcmc);
   public:
-    explicit SymbolTable(Model & model);
+    explicit SymbolTable(Graph & graph);
 
     void AddVariable(const String & name, const DimArray & dim);
 
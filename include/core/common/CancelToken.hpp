@@ -0,0 +1,42 @@
+#ifndef BIIPS_CANCELTOKEN_HPP_
+#define BIIPS_CANCELTOKEN_HPP_
+
+#include "common/Types.hpp"
+#include <atomic>
+
+namespace Biips
+{
+
+  //! Cooperative cancellation request of a long computation
+  /*!
+   * The request is made from another thread or from a signal handler,
+   * and checked by the computation between two of its steps.
+   */
+  class CancelToken
+  {
+  protected:
+    std::atomic<Bool> requested_;
+
+  public:
+    CancelToken() :
+      requested_(false)
+    {
+    }
+
+    void Request()
+    {
+      requested_.store(true);
+    }
+    void Reset()
+    {
+      requested_.store(false);
+    }
+    Bool Requested() const
+    {
+      return requested_.load();
+    }
+  };
+
+}
+
+#endif /* BIIPS_CANCELTOKEN_HPP_ */
@@ -0,0 +1,45 @@
+#ifndef BIIPS_DIMFACTORY_HPP_
+#define BIIPS_DIMFACTORY_HPP_
+
+#include "common/DimArray.hpp"
+
+#include <map>
+#include <algorithm>
+
+namespace Biips
+{
+
+  struct ltDimArray
+  {
+    bool operator()(const DimArray & dim1, const DimArray & dim2) const;
+  };
+
+  //! Interning table of DimArray objects
+  /*!
+   * The purpose of a DimFactory is to avoid the duplication of equal
+   * dimensions: all the requests of the same dimensions return the same
+   * shared DimArray, which must not be modified.
+   */
+  class DimFactory
+  {
+  protected:
+    std::map<DimArray, DimArray::Ptr, ltDimArray> dimMap_;
+
+  public:
+    DimFactory();
+
+    //! Returns the shared DimArray equal to dim
+    const DimArray::Ptr & GetDim(const DimArray & dim);
+
+    //! Number of distinct dimensions
+    Size Count() const
+    {
+      return dimMap_.size();
+    }
+    //! Approximate memory used by the table, in bytes
+    std::size_t MemoryUsage() const;
+  };
+
+}
+
+#endif /* BIIPS_DIMFACTORY_HPP_ */
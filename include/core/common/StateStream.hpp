@@ -0,0 +1,132 @@
+#ifndef BIIPS_STATESTREAM_HPP_
+#define BIIPS_STATESTREAM_HPP_
+
+#include "common/Types.hpp"
+#include "common/ValArray.hpp"
+#include <map>
+#include <iosfwd>
+
+namespace Biips
+{
+
+  //! Writes the state of a sampler to a binary stream
+  /*!
+   * Values are written in the native binary representation: a state is
+   * meant to be read back on the same platform, by the same build.
+   *
+   * Storages shared by several particles or monitors are written once,
+   * and shared again when read.
+   */
+  class StateWriter
+  {
+  public:
+    typedef StateWriter SelfType;
+
+  protected:
+    std::ostream & os_;
+    std::map<const ValArray *, Size> storageIndices_;
+
+    void writeBytes(const void * data, Size n);
+
+  public:
+    explicit StateWriter(std::ostream & os) :
+      os_(os)
+    {
+    }
+
+    void Write(Size val)
+    {
+      writeBytes(&val, sizeof(val));
+    }
+    void Write(Int val)
+    {
+      writeBytes(&val, sizeof(val));
+    }
+    void Write(Scalar val)
+    {
+      writeBytes(&val, sizeof(val));
+    }
+    void Write(Bool val)
+    {
+      char c = val;
+      writeBytes(&c, 1);
+    }
+    void Write(const String & str);
+    void Write(const Types<Size>::Array & vec);
+    void Write(const Types<Int>::Array & vec);
+    void Write(const Flags & flags);
+    void Write(const ValArray & vec);
+    void Write(const Types<ShortScalar>::Array & vec);
+    //! Writes a storage, or its index if it has already been written
+    void Write(const ValArray::Ptr & pStorage);
+
+    //! Writes a tag, checked when read
+    void WriteTag(const String & tag)
+    {
+      Write(tag);
+    }
+  };
+
+  //! Reads the state of a sampler written by a StateWriter
+  /*!
+   * Throws RuntimeError if the stream ends or does not match
+   * the expected contents.
+   */
+  class StateReader
+  {
+  public:
+    typedef StateReader SelfType;
+
+  protected:
+    std::istream & is_;
+    Types<ValArray::Ptr>::Array storages_;
+
+    void readBytes(void * data, Size n);
+
+  public:
+    explicit StateReader(std::istream & is) :
+      is_(is)
+    {
+    }
+
+    void Read(Size & val)
+    {
+      readBytes(&val, sizeof(val));
+    }
+    void Read(Int & val)
+    {
+      readBytes(&val, sizeof(val));
+    }
+    void Read(Scalar & val)
+    {
+      readBytes(&val, sizeof(val));
+    }
+    void Read(Bool & val)
+    {
+      char c;
+      readBytes(&c, 1);
+      val = c;
+    }
+    void Read(String & str);
+    void Read(Types<Size>::Array & vec);
+    void Read(Types<Int>::Array & vec);
+    void Read(Flags & flags);
+    void Read(ValArray & vec);
+    void Read(Types<ShortScalar>::Array & vec);
+    void Read(ValArray::Ptr & pStorage);
+
+    template<typename T>
+    T Get()
+    {
+      T val;
+      Read(val);
+      return val;
+    }
+
+    //! Reads a tag, throws RuntimeError if it differs
+    void ReadTag(const String & tag);
+  };
+
+}
+
+#endif /* BIIPS_STATESTREAM_HPP_ */
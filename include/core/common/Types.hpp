@@ -45,6 +45,8 @@ namespace Biips
   //! %Numerical scalar type
   typedef Real Scalar;
   typedef double LongScalar;
+  //! Single precision type of the compact storages of values
+  typedef float ShortScalar;
 
   //! Template structure defining usual derived types from the parameter type T
   template<typename T>
@@ -9,6 +9,20 @@ namespace Biips
 
   const String UNDEF_DIST = "undef";
 
+  /**
+   * Enumerates the terms computed by the log density, cf JAGS
+   *
+   * PDF_FULL for the normalized log density
+   *
+   * PDF_LIKELIHOOD when only the terms that depend on the parameters
+   * are required, i.e. x is fixed. This is the case of the likelihood
+   * of an observed node in the particle weights.
+   */
+  enum PDFType
+  {
+    PDF_FULL, PDF_LIKELIHOOD
+  };
+
   class Distribution
   {
   protected:
@@ -28,9 +42,29 @@ namespace Biips
                         const NumArray::Array & paramValues,
                         const NumArray::Pair & boundValues,
                         Rng & rng) const = 0;
+    //! Draws values by inverse transform of the given uniforms
+    /*!
+     * Consumes one uniform in (0,1) per component of values. Only
+     * called when CanSampleUniform returns true.
+     */
+    virtual void sampleUniform(ValArray & values,
+                               const NumArray::Array & paramValues,
+                               const NumArray::Pair & boundValues,
+                               const Scalar * uniforms) const;
     virtual Scalar logDensity(const NumArray & x,
                               const NumArray::Array & paramValues,
                               const NumArray::Pair & boundValues) const = 0;
+    //! Log density, where the terms not required by type may be dropped
+    /*!
+     * Default implementation computes the full log density.
+     */
+    virtual Scalar partialLogDensity(const NumArray & x,
+                                     const NumArray::Array & paramValues,
+                                     const NumArray::Pair & boundValues,
+                                     PDFType type) const
+    {
+      return logDensity(x, paramValues, boundValues);
+    }
     virtual void fixedUnboundedSupport(ValArray & lower,
                                   ValArray & upper,
                                   const NumArray::Array & fixedParamValues) const = 0;
@@ -65,17 +99,49 @@ namespace Biips
         CheckDensityParamValues(const NumArray & x,
                                 const NumArray::Array & paramValues) const;
 
+    //! Checks the values of the parameters that vary between calls
+    /*!
+     * The parameters not flagged in varyingMask have already been
+     * checked. The default implementation checks all the parameters
+     * if at least one varies.
+     */
+    virtual Bool
+        CheckVaryingParamValues(const NumArray::Array & paramValues,
+                                const Flags & varyingMask) const;
+    //! Same as CheckVaryingParamValues, for the LogDensity method
+    virtual Bool
+        CheckDensityVaryingParamValues(const NumArray & x,
+                                       const NumArray::Array & paramValues,
+                                       const Flags & varyingMask,
+                                       Bool varyingX) const;
+
     DimArray Dim(const Types<DimArray::Ptr>::Array & paramDims) const;
 
+    // the parameter values are not checked if checkParams is false
     void Sample(ValArray & values,
                 const NumArray::Array & paramValues,
                 const NumArray::Pair & boundValues,
-                Rng & rng) const;
-
-    // TODO use PDFType argument to optimize calculations : cf JAGS Distribution.h
+                Rng & rng,
+                Bool checkParams = true) const;
+
+    //! Same as Sample, with the uniforms supplied by the caller
+    /*!
+     * Used by the quasi-Monte Carlo samplers: the value is a
+     * deterministic transform of uniforms, which holds one value in
+     * (0,1) per component.
+     */
+    void SampleUniform(ValArray & values,
+                       const NumArray::Array & paramValues,
+                       const NumArray::Pair & boundValues,
+                       const Scalar * uniforms,
+                       Bool checkParams = true) const;
+
+    // the terms not required by type may be dropped
     Scalar LogDensity(const NumArray & x,
                       const NumArray::Array & paramValues,
-                      const NumArray::Pair & boundValues) const;
+                      const NumArray::Pair & boundValues,
+                      Bool checkParams = true,
+                      PDFType type = PDF_FULL) const;
 
     void FixedUnboundedSupport(ValArray & lower,
                           ValArray & upper,
@@ -88,6 +154,11 @@ namespace Biips
     {
       return false;
     }
+    //! Whether SampleUniform is implemented
+    virtual Bool CanSampleUniform() const
+    {
+      return false;
+    }
     virtual Bool IsDiscreteValued(const Flags & mask) const
     {
       return false;
@@ -76,7 +76,9 @@ namespace Biips
 
     DimArray Dim(const Types<DimArray::Ptr>::Array & paramDims) const;
 
-    void Eval(ValArray & values, const NumArray::Array & paramValues) const;
+    // the parameter values are not checked if checkParams is false
+    void Eval(ValArray & values, const NumArray::Array & paramValues,
+              Bool checkParams = true) const;
 
     virtual ~Function()
     {
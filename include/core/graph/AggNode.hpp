@@ -12,11 +12,30 @@ namespace Biips
     typedef AggNode SelfType;
     typedef Types<SelfType>::Ptr Ptr;
 
+    //! Contiguous run of aggregated values
+    /*!
+     * Values of one source parameter, from offset srcOffset,
+     * copied in the aggregate values from offset dstOffset.
+     */
+    struct GatherRun
+    {
+      Size source;
+      Size srcOffset;
+      Size dstOffset;
+      Size length;
+    };
+
   protected:
     Types<Size>::Array offsets_;
+    //! Distinct parameters the aggregate values are read from
+    Types<NodeId>::Array sources_;
+    //! Gather plan: contiguous runs of values, in aggregate order
+    Types<GatherRun>::Array runs_;
 
     static const String NAME_;
 
+    void buildGatherPlan();
+
   public:
     static const String & Name()
     {
@@ -27,8 +46,23 @@ namespace Biips
     {
       return Name();
     }
+    const Types<NodeId>::Array & Sources() const
+    {
+      return sources_;
+    }
+    const Types<GatherRun>::Array & Runs() const
+    {
+      return runs_;
+    }
+
+    //! Evaluates the aggregate values
+    /*!
+     * paramValues must contain the values of the Sources(),
+     * not of all the Parents().
+     */
     virtual void
-    Eval(ValArray & values, const NumArray::Array & paramValues) const;
+    Eval(ValArray & values, const NumArray::Array & paramValues,
+         Bool checkParams = true) const;
     virtual Bool IsFunction() const
     {
       return false;
@@ -44,7 +78,8 @@ namespace Biips
 
     AggNode(const DimArray::Ptr pDim,
             const Types<NodeId>::Array & parameters,
-            const Types<Size>::Array & offsets);
+            const Types<Size>::Array & offsets,
+            NodeIdPool & parentsPool);
   };
 
 }
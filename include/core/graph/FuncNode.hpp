@@ -25,9 +25,10 @@ namespace Biips
     {
       return pFunc_->Name();
     }
-    virtual void Eval(ValArray & values, const NumArray::Array & paramValues) const
+    virtual void Eval(ValArray & values, const NumArray::Array & paramValues,
+                      Bool checkParams = true) const
     {
-      pFunc_->Eval(values, paramValues);
+      pFunc_->Eval(values, paramValues, checkParams);
     }
     virtual Bool IsScale(const Flags & scaleMask, const Flags & knownMask) const
     {
@@ -40,7 +41,8 @@ namespace Biips
 
     FuncNode(const DimArray::Ptr pDim,
              const Function::Ptr & pFunc,
-             const Types<NodeId>::Array & parameters);
+             const Types<NodeId>::Array & parameters,
+             NodeIdPool & parentsPool);
   };
 
 }
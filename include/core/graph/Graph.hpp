@@ -2,16 +2,49 @@
 #define BIIPS_GRAPH_HPP_
 
 #include "GraphTypes.hpp"
+#include "common/DimFactory.hpp"
 #include "function/Function.hpp"
 #include "distribution/Distribution.hpp"
 
-#include <boost/graph/graphviz.hpp>
-
 namespace Biips
 {
 
   class NodeVisitor;
 
+  //! Approximate memory used by a Graph, in bytes
+  struct GraphMemoryUsage
+  {
+    //! Node objects and the arrays they own
+    std::size_t nodes;
+    //! Interned dimensions
+    std::size_t dims;
+    //! Pool of the parents of the nodes
+    std::size_t parents;
+    //! Lists of the children of the nodes
+    std::size_t children;
+    //! Node pointers, values, observed and discrete flags
+    std::size_t properties;
+    //! Sorted nodes, ranks and lists of stochastic parents and children
+    std::size_t lists;
+
+    std::size_t Total() const
+    {
+      return nodes + dims + parents + children + properties + lists;
+    }
+  };
+
+  //! Directed acyclic graph of the nodes of a model
+  /*!
+   * The vertex properties (node pointers, values, observed and discrete
+   * flags) are stored in contiguous arrays indexed by NodeId. The parents
+   * of the nodes are stored in a NodeIdPool, and the children in one
+   * array per node while the graph is being constructed.
+   *
+   * Once built, the graph can be frozen: the children are then stored in
+   * a compressed sparse row array and the graph can no longer be modified.
+   * A frozen graph is immutable, so it can be read by any number of
+   * samplers concurrently.
+   */
   class Graph
   {
   public:
@@ -21,36 +54,46 @@ namespace Biips
   protected:
     typedef MultiArray::StorageType StorageType;
 
-    typedef GraphTypes::ParentsGraph ParentsGraph;
-    typedef GraphTypes::ChildrenGraph ChildrenGraph;
-
     typedef GraphTypes::ParentIterator ParentIterator;
     typedef GraphTypes::ChildIterator ChildIterator;
     typedef GraphTypes::StochasticParentIterator StochasticParentIterator;
     typedef GraphTypes::StochasticChildIterator StochasticChildIterator;
     typedef GraphTypes::LikelihoodChildIterator LikelihoodChildIterator;
 
-    typedef GraphTypes::ValuesPropertyMap ValuesPropertyMap;
-    typedef GraphTypes::ObservedPropertyMap ObservedPropertyMap;
-    typedef GraphTypes::DiscretePropertyMap DiscretePropertyMap;
-    typedef GraphTypes::ConstValuesPropertyMap ConstValuesPropertyMap;
-    typedef GraphTypes::ConstObservedPropertyMap ConstObservedPropertyMap;
-    typedef GraphTypes::ConstDiscretePropertyMap ConstDiscretePropertyMap;
-
     friend class SetObsValuesVisitor;
 
-    ParentsGraph parentsGraph_;
-    ChildrenGraph childrenGraph_;
+    Types<Node::Ptr>::Array nodes_;
+    NodeValues values_;
+    //! Packed flags indexed by NodeId
+    Flags observed_;
+    Flags discrete_;
 
-    Types<std::set<NodeId> >::Array stochasticParents_;
-    Types<std::set<NodeId> >::Array stochasticChildren_;
-    Types<std::set<NodeId> >::Array likelihoodChildren_;
+    DimFactory dimFactory_;
+    NodeIdPool parentsPool_;
+    //! Children of each node, until the graph is frozen
+    Types<Types<NodeId>::Array>::Array childrenLists_;
+    //! Compressed sparse row children of the frozen graph
+    Types<Size>::Array childrenOffsets_;
+    Types<NodeId>::Array childrenIds_;
+
+    NodeIdLists stochasticParents_;
+    NodeIdLists stochasticChildren_;
+    NodeIdLists likelihoodChildren_;
 
     Types<NodeId>::Array topoSort_;
     Types<Size>::Array ranks_;
+    //! Rank of the latest unobserved stochastic node each node depends on
+    /*!
+     * For an unobserved stochastic node, it is its own rank.
+     * For a logical node, it is the highest rank of its unobserved
+     * stochastic parents. BIIPS_SIZENA if there is none.
+     * Used to answer nodesRelation queries in constant time.
+     */
+    Types<Size>::Array latestUnobsRanks_;
 
     Bool builtFlag_;
     Bool dataGraph_;
+    Bool frozen_;
 
     std::map<NodeType, Size> nodesSummaryMap_;
     std::map<NodeType, Size> unobsNodesSummaryMap_;
@@ -59,8 +102,13 @@ namespace Biips
     void buildStochasticParents();
     void buildStochasticChildren();
     void buildLikelihoodChildren();
+    void buildLatestUnobsRanks();
+    void updateLatestUnobsRank(NodeId nodeId);
+    void updateLatestUnobsRanks(NodeId stochId);
     Types<DimArray::Ptr>::Array
     getParamDims(const Types<NodeId>::Array parameters) const;
+    NodeId addVertex(const Node::Ptr & pNode);
+    void checkNotFrozen() const;
 
   public:
     Graph(Bool dataGraph = false);
@@ -104,17 +152,21 @@ namespace Biips
 
     Size GetSize() const
     {
-      return boost::num_vertices(parentsGraph_);
+      return nodes_.size();
     }
     Bool Empty() const
     {
-      return boost::num_vertices(parentsGraph_) == 0;
+      return nodes_.empty();
     }
     ;
     Bool IsBuilt() const
     {
       return builtFlag_;
     }
+    Bool IsFrozen() const
+    {
+      return frozen_;
+    }
 
     // TODO: delete/improve this
     const std::map<NodeType, Size> & NodesSummary() const
@@ -130,22 +182,29 @@ namespace Biips
 
     Bool HasCycle() const;
     void Build();
+    //! Makes the built graph immutable
+    /*!
+     * Compacts the children lists in a compressed sparse row array and
+     * releases the unused capacity of the other arrays. After this call,
+     * the functions modifying the graph throw a LogicError.
+     */
+    void Freeze();
     void VisitNode(NodeId nodeId, NodeVisitor & vis);
     void VisitNode(NodeId nodeId, ConstNodeVisitor & vis) const;
     void VisitGraph(NodeVisitor & vis);
     void VisitGraph(ConstNodeVisitor & vis) const;
     NodeValues SampleValues(Rng * pRng) const;
-    ConstValuesPropertyMap GetValues() const
+    const NodeValues & GetValues() const
     {
-      return boost::get(boost::vertex_value, parentsGraph_);
+      return values_;
     }
-    ConstObservedPropertyMap GetObserved() const
+    const Flags & GetObserved() const
     {
-      return boost::get(boost::vertex_observed, parentsGraph_);
+      return observed_;
     }
-    ConstDiscretePropertyMap GetDiscrete() const
+    const Flags & GetDiscrete() const
     {
-      return boost::get(boost::vertex_discrete, parentsGraph_);
+      return discrete_;
     }
 
     void SetObserved(NodeId nodeId);
@@ -155,6 +214,13 @@ namespace Biips
     void SetObsValue(NodeId nodeId, const ValArray::Ptr & pObsValue,
                      Bool stochOnly = true);
     void SetObsValues(const NodeValues & nodeValues);
+    //! Values of the nodes with other values of observed stochastic nodes
+    /*!
+     * The graph is not modified: the result shares the unchanged values
+     * and holds the new values of the observed logical nodes that depend
+     * on obsValues. It can be given to the samplers with SetObsValues.
+     */
+    NodeValues OverrideObsValues(const std::map<NodeId, ValArray::Ptr> & obsValues) const;
 
     ValArray::Ptr SampleValue(NodeId nodeId, Rng * pRng = NULL,
                               Bool setObsValue = false);
@@ -167,7 +233,7 @@ namespace Biips
     //Node::Ptr operator[] (NodeId nodeId) { return GetNodePtr(nodeId); };
     Node const & GetNode(NodeId nodeId) const
     {
-      return *boost::get(boost::vertex_node_ptr, parentsGraph_, nodeId);
+      return *nodes_[nodeId];
     }
     Node const & operator[](NodeId nodeId) const
     {
@@ -175,6 +241,9 @@ namespace Biips
     }
 
     const Types<Size>::Array & GetRanks() const;
+    const Types<Size>::Array & GetLatestUnobsRanks() const;
+
+    GraphMemoryUsage MemoryUsage() const;
 
     // TODO remove from the class
     void PrintGraph(std::ostream & os) const;
@@ -187,7 +256,21 @@ namespace Biips
   template<typename VertexWriter>
   void Graph::PrintGraphviz(std::ostream & os, VertexWriter vw) const
   {
-    boost::write_graphviz(os, childrenGraph_, vw);
+    os << "digraph G {" << std::endl;
+    for (NodeId id = 0; id < GetSize(); ++id)
+    {
+      os << id;
+      vw(os, id);
+      os << ";" << std::endl;
+    }
+    // edges from the parents to the children
+    for (NodeId id = 0; id < GetSize(); ++id)
+    {
+      const ParentIds & parents = GetNode(id).Parents();
+      for (Size i = 0; i < parents.size(); ++i)
+        os << parents[i] << "->" << id << " ;" << std::endl;
+    }
+    os << "}" << std::endl;
   }
 
   class VertexPropertyWriter
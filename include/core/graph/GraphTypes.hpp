@@ -1,43 +1,10 @@
 #ifndef BIIPS_GRAPHTYPES_HPP_
 #define BIIPS_GRAPHTYPES_HPP_
 
-#include <boost/graph/adjacency_list.hpp>
-#include <boost/graph/properties.hpp>
-#include <boost/graph/reverse_graph.hpp>
+#include <boost/tuple/tuple.hpp>
 
 #include "Node.hpp"
-
-namespace boost
-{
-  //! Node pointer graph property
-  /*!
-   * The Node::Ptr objects are stored in a vertex property map of the graph.
-   * This property map is stored by the boost graph object.
-   */
-  enum vertex_node_ptr_t
-  {
-    vertex_node_ptr = 101
-  }; // a unique number
-  BOOST_INSTALL_PROPERTY(vertex, node_ptr);
-
-  enum vertex_observed_t
-  {
-    vertex_observed = 103
-  }; // a unique number
-  BOOST_INSTALL_PROPERTY(vertex, observed);
-
-  enum vertex_value_t
-  {
-    vertex_value = 104
-  }; // a unique number
-  BOOST_INSTALL_PROPERTY(vertex, value);
-
-  enum vertex_discrete_t
-  {
-    vertex_discrete = 105
-  }; // a unique number
-  BOOST_INSTALL_PROPERTY(vertex, discrete);
-}
+#include "NodeIdLists.hpp"
 
 namespace Biips
 {
@@ -82,30 +49,6 @@ namespace Biips
    */
   struct GraphTypes
   {
-    //! The boost adjacency list full graph type
-    /*!
-     * FullGraph is the underlying Boost.Graph structure used to represent
-     * the graph vertices and edges.
-     * It is full in that it defines both direct edges and stochastic edges of the DAG.
-     * Direct edges link one node to its direct parents or direct children.
-     * Stochastic edges link a node to its stochastic parents or chiLdren.
-     * The latter are built initially because they are used many times in the algorithm.
-     *
-     * The model used is an adjacency list where the graph edges are represented by a vector
-     * of pointed vertices for each vertex, stored in a vector. The edges are bidirectional,
-     * i.e. one node can access its targets as well as its sources.
-     *
-     * The node pointers properties are internally stored.
-     * Other vertices or edges properties have to be stored in external property maps
-     * \see NodeValuesMap
-     */
-    typedef boost::adjacency_list<boost::vecS, boost::vecS,
-        boost::bidirectionalS, boost::property<boost::vertex_node_ptr_t,
-            Node::Ptr, boost::property<boost::vertex_observed_t, Bool,
-                boost::property<boost::vertex_discrete_t, Bool,
-                    boost::property<boost::vertex_value_t, Types<
-                        MultiArray::StorageType>::Ptr> > > > > ParentsGraph;
-
     //! Node values property map
     /*!
      * Property maps associate properties, here the node values, to the vertices, or the edges
@@ -127,31 +70,16 @@ namespace Biips
      */
     typedef Flags FlagsMap;
 
-    typedef boost::property_map<ParentsGraph, boost::vertex_value_t>::type
-        ValuesPropertyMap;
-    typedef boost::property_map<ParentsGraph, boost::vertex_observed_t>::type
-        ObservedPropertyMap;
-    typedef boost::property_map<ParentsGraph, boost::vertex_discrete_t>::type
-        DiscretePropertyMap;
-
-    typedef boost::property_map<ParentsGraph, boost::vertex_value_t>::const_type
-        ConstValuesPropertyMap;
-    typedef boost::property_map<ParentsGraph, boost::vertex_observed_t>::const_type
-        ConstObservedPropertyMap;
-    typedef boost::property_map<ParentsGraph, boost::vertex_discrete_t>::const_type
-        ConstDiscretePropertyMap;
-
-    typedef boost::graph_traits<ParentsGraph>::adjacency_iterator
-        ParentIterator;
-    typedef boost::reverse_graph<ParentsGraph> ChildrenGraph;
-    typedef boost::graph_traits<ChildrenGraph>::adjacency_iterator
-        ChildIterator;
+    //! Iterator on the direct parents of a node
+    typedef ParentIds::const_iterator ParentIterator;
+    //! Iterator on the direct children of a node
+    typedef Types<NodeId>::ConstIterator ChildIterator;
 
-    typedef std::set<NodeId>::const_iterator StochasticParentIterator;
+    typedef NodeIdLists::ConstIterator StochasticParentIterator;
 
-    typedef std::set<NodeId>::const_iterator StochasticChildIterator;
+    typedef NodeIdLists::ConstIterator StochasticChildIterator;
 
-    typedef std::set<NodeId>::const_iterator LikelihoodChildIterator;
+    typedef NodeIdLists::ConstIterator LikelihoodChildIterator;
   };
 
 }
@@ -16,7 +16,8 @@ namespace Biips
 
     virtual const String & FuncName() const = 0;
     virtual void
-        Eval(ValArray & values, const NumArray::Array & paramValues) const = 0;
+        Eval(ValArray & values, const NumArray::Array & paramValues,
+             Bool checkParams = true) const = 0;
     virtual Bool IsFunction() const
     {
       return true;
@@ -27,8 +28,9 @@ namespace Biips
         IsLinear(const Flags & linearMask, const Flags & knownMask) const = 0;
 
     LogicalNode(const DimArray::Ptr pDim,
-                const Types<NodeId>::Array & parameters) :
-      Node(LOGICAL, pDim, parameters)
+                const Types<NodeId>::Array & parameters,
+                NodeIdPool & parentsPool) :
+      Node(LOGICAL, pDim, parameters, parentsPool)
     {
     }
 
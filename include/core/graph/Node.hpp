@@ -8,13 +8,113 @@ namespace Biips
 
   class NodeVisitor;
   class ConstNodeVisitor;
+  class ParentIds;
 
+  //! Contiguous storage of the parents of all the nodes of a Graph
+  /*!
+   * Each node references its parents by an (offset, count) span in
+   * this pool, instead of holding its own array.
+   */
+  class NodeIdPool
+  {
+  protected:
+    Types<NodeId>::Array ids_;
+
+  public:
+    NodeIdPool()
+    {
+    }
+
+    //! Appends ids at the end of the pool and returns their span
+    ParentIds Append(const Types<NodeId>::Array & ids);
+    //! Removes the span, which must be at the end of the pool
+    void Pop(const ParentIds & span);
+
+    NodeId operator[](Size i) const
+    {
+      return ids_[i];
+    }
+    Size size() const
+    {
+      return ids_.size();
+    }
+    Size Capacity() const
+    {
+      return ids_.capacity();
+    }
+    Types<NodeId>::ConstIterator Begin() const
+    {
+      return ids_.begin();
+    }
+  };
+
+  //! Parents of a node: span in a NodeIdPool
+  /*!
+   * Behaves as a read-only array of NodeId. Its iterators are
+   * invalidated when nodes are added to the graph.
+   */
+  class ParentIds
+  {
+  protected:
+    const NodeIdPool * pPool_;
+    Size offset_;
+    Size count_;
+
+  public:
+    typedef Types<NodeId>::ConstIterator const_iterator;
+
+    ParentIds() :
+      pPool_(NULL), offset_(0), count_(0)
+    {
+    }
+    ParentIds(const NodeIdPool * pPool, Size offset, Size count) :
+      pPool_(pPool), offset_(offset), count_(count)
+    {
+    }
+
+    Size size() const
+    {
+      return count_;
+    }
+    Bool empty() const
+    {
+      return count_ == 0;
+    }
+    Size Offset() const
+    {
+      return offset_;
+    }
+    NodeId operator[](Size i) const
+    {
+      return (*pPool_)[offset_ + i];
+    }
+    const_iterator begin() const
+    {
+      return pPool_ ? pPool_->Begin() + offset_ : const_iterator();
+    }
+    const_iterator end() const
+    {
+      return pPool_ ? pPool_->Begin() + offset_ + count_ : const_iterator();
+    }
+    //! Copy of the parents in an array
+    Types<NodeId>::Array ToArray() const
+    {
+      return Types<NodeId>::Array(begin(), end());
+    }
+  };
+
+  //! Node of a Graph
+  /*!
+   * Nodes are created by the Graph, which owns the pool of their parents
+   * and interns their dimensions: nodes having the same dimensions share
+   * the same read-only DimArray.
+   */
   class Node
   {
   protected:
-    const NodeType nodeType_;
     DimArray::Ptr pDim_;
-    Types<NodeId>::Array parents_;
+    ParentIds parents_;
+    const NodeType nodeType_;
 
   public:
     typedef Node SelfType;
@@ -27,19 +127,11 @@ namespace Biips
     {
       return *pDim_;
     }
-    DimArray & Dim()
-    {
-      return *pDim_;
-    }
     const DimArray::Ptr & DimPtr() const
     {
       return pDim_;
     }
-    DimArray::Ptr & DimPtr()
-    {
-      return pDim_;
-    }
-    const Types<NodeId>::Array & Parents() const
+    const ParentIds & Parents() const
     {
       return parents_;
     }
@@ -51,7 +143,8 @@ namespace Biips
     explicit Node(NodeType type, const DimArray::Ptr & pDim);
     Node(NodeType type,
          const DimArray::Ptr & pDim,
-         const Types<NodeId>::Array & parents);
+         const Types<NodeId>::Array & parents,
+         NodeIdPool & parentsPool);
 
     virtual ~Node()
     {
@@ -0,0 +1,100 @@
+#ifndef BIIPS_NODEIDLISTS_HPP_
+#define BIIPS_NODEIDLISTS_HPP_
+
+#include "common/Types.hpp"
+
+namespace Biips
+{
+
+  //! Compact storage of one sorted NodeId list per node
+  /*!
+   * All the lists are stored in one contiguous array of NodeId and each node
+   * references its list by a [begin, end) span in this array, i.e. a
+   * compressed sparse row layout.
+   * Spans may be shared between nodes: a node whose list is equal to the
+   * list of another node can reference the same span without copying it.
+   * This is typically the case for deep chains of logical nodes.
+   *
+   * Lists are built with Merge in any node order, provided that the lists
+   * of the merged nodes have already been built.
+   */
+  class NodeIdLists
+  {
+  public:
+    typedef NodeIdLists SelfType;
+    typedef Types<NodeId>::ConstIterator ConstIterator;
+
+  protected:
+    Types<NodeId>::Array ids_;
+    Types<Size>::Array begins_;
+    Types<Size>::Array ends_;
+
+    // merging workspace
+    Types<NodeId>::Array scratch_;
+    Types<NodeId>::Array marks_;
+
+  public:
+    NodeIdLists()
+    {
+    }
+
+    //! Resets to nbNodes empty lists
+    void Reset(Size nbNodes);
+
+    //! Sets the list of nodeId
+    /*!
+     * The list is the sorted union of the single ids in singles
+     * and of the lists of the nodes in merged.
+     * When this union is equal to the list of one of the merged nodes,
+     * the span of the latter is shared.
+     * @param nodeId the node whose list is set. Must not have been set before.
+     * @param singles node ids inserted as is.
+     * @param merged node ids whose lists are inserted.
+     */
+    void Merge(NodeId nodeId, const Types<NodeId>::Array & singles,
+               const Types<NodeId>::Array & merged);
+
+    //! Appends one sorted id to the list of nodeId
+    /*!
+     * Only valid when nodeId is the last node that has been set,
+     * so that its span is at the end of the storage.
+     */
+    void PushBack(NodeId nodeId, NodeId id);
+
+    //! Starts an empty list for nodeId at the end of the storage
+    void Open(NodeId nodeId);
+
+    Types<ConstIterator>::Pair Range(NodeId nodeId) const
+    {
+      return std::make_pair(ids_.begin() + begins_[nodeId],
+                            ids_.begin() + ends_[nodeId]);
+    }
+    Size Count(NodeId nodeId) const
+    {
+      return ends_[nodeId] - begins_[nodeId];
+    }
+    Bool Contains(NodeId nodeId, NodeId id) const;
+
+    Size NbNodes() const
+    {
+      return begins_.size();
+    }
+    //! Total number of stored ids, shared spans counted once
+    Size NbStoredIds() const
+    {
+      return ids_.size();
+    }
+    //! Releases the merging workspace
+    void Shrink();
+    //! Approximate memory used, in bytes
+    std::size_t MemoryUsage() const
+    {
+      return (ids_.capacity() + scratch_.capacity() + marks_.capacity())
+             * sizeof(NodeId)
+             + (begins_.capacity() + ends_.capacity()) * sizeof(Size);
+    }
+  };
+
+}
+
+#endif /* BIIPS_NODEIDLISTS_HPP_ */
@@ -34,15 +34,27 @@ namespace Biips
     void Sample(ValArray & values,
                 const NumArray::Array & paramValues,
                 const NumArray::Pair & boundValues,
-                Rng & rng) const
+                Rng & rng,
+                Bool checkParams = true) const
     {
-      pPrior_->Sample(values, paramValues, boundValues, rng);
+      pPrior_->Sample(values, paramValues, boundValues, rng, checkParams);
+    }
+    void SampleUniform(ValArray & values,
+                       const NumArray::Array & paramValues,
+                       const NumArray::Pair & boundValues,
+                       const Scalar * uniforms,
+                       Bool checkParams = true) const
+    {
+      pPrior_->SampleUniform(values, paramValues, boundValues, uniforms,
+                             checkParams);
     }
     Scalar LogPriorDensity(const NumArray & x,
                            const NumArray::Array & paramValues,
-                           const NumArray::Pair & boundValues) const
+                           const NumArray::Pair & boundValues,
+                           Bool checkParams = true,
+                           PDFType type = PDF_FULL) const
     {
-      return pPrior_->LogDensity(x, paramValues, boundValues);
+      return pPrior_->LogDensity(x, paramValues, boundValues, checkParams, type);
     }
     void FixedUnboundedSupport(ValArray & lower,
                           ValArray & upper,
@@ -77,6 +89,7 @@ namespace Biips
     StochasticNode(const DimArray::Ptr pDim,
                    const Distribution::Ptr & pPrior,
                    const Types<NodeId>::Array & parameters,
+                   NodeIdPool & parentsPool,
                    NodeId lower = NULL_NODEID,
                    NodeId upper = NULL_NODEID);
 
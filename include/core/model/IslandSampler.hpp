@@ -0,0 +1,108 @@
+#ifndef BIIPS_ISLANDSAMPLER_HPP_
+#define BIIPS_ISLANDSAMPLER_HPP_
+
+#include "common/Types.hpp"
+#include "common/ValArray.hpp"
+
+namespace Biips
+{
+
+  class Model;
+  class Rng;
+  class IslandSegment;
+  class IslandPipe;
+
+  //! Island particle filter, whose islands run in local worker processes
+  /*!
+   * The particles are split between nIslands sub-filters of the same
+   * model. Each one is run by the forward sampler of a forked worker
+   * process, which owns the particles of its island: they are allocated
+   * by the process, on the memory of the node it runs on.
+   *
+   * After each iteration, the islands exchange through a shared memory
+   * segment the log normalizing constants of their sub-filters. The
+   * weight of an island is the increment of its normalizing constant
+   * since the last interaction. When the ESS of the island weights falls
+   * below the island threshold, and if migration is enabled, the islands
+   * are resampled: each island receives the particles and weights of its
+   * ancestor island through a pipe, and the island weights are reset.
+   *
+   * The normalizing constant of the island filter is the product over
+   * the island resampling steps of the mean island weights. Like that
+   * of a single particle filter, it is an unbiased estimate: its
+   * logarithm, returned by LogNormConst, is biased downwards.
+   *
+   * When the run succeeds, the filter monitors of the model hold the
+   * particles of all the islands, weighted by the island weights of
+   * their iteration. The sampler of the model is not run, and the
+   * smoother monitors of the workers are discarded.
+   *
+   * Workers are only available on Linux, where the process can check
+   * that it has no other thread before forking them: Run throws
+   * LogicError elsewhere, or if other threads are running.
+   */
+  class IslandSampler
+  {
+  public:
+    typedef IslandSampler SelfType;
+
+  protected:
+    Model & model_;
+    Size nIslands_;
+    Scalar logNormConst_;
+    Size nMigrations_;
+    ///Log weights of the islands at the last iteration
+    ValArray islandLogWeights_;
+
+    //! Runs island and writes its filter monitors to resultPipe
+    void runIsland(Size island, Size nParticles, Rng & islandRng,
+                   const Types<Size>::Array & seeds,
+                   const String & rsType, Scalar essThreshold,
+                   Scalar islandThreshold, Bool migrate,
+                   IslandSegment & segment,
+                   Types<IslandPipe>::Array & migrationPipes,
+                   IslandPipe & resultPipe);
+
+    // Forbid copying
+    IslandSampler(const IslandSampler & from);
+    IslandSampler & operator=(const IslandSampler & rhs);
+
+  public:
+    IslandSampler(Model & model, Size nIslands);
+
+    //! Runs the island filter
+    /*!
+     * The islands share the nParticles particles, and island k is
+     * seeded from rngSeed. The resampling of each island is controlled
+     * by rsType and essThreshold, and the island resampling by
+     * islandThreshold: a fraction of the number of islands if <= 1.
+     * To migrate, the islands must have the same number of particles:
+     * nParticles must be a multiple of the number of islands.
+     * Throws RuntimeError if a worker fails.
+     */
+    void Run(Size nParticles, Size rngSeed, const String & rsType,
+             Scalar essThreshold, Scalar islandThreshold = 0.5,
+             Bool migrate = true);
+
+    Size NIslands() const
+    {
+      return nIslands_;
+    }
+    Scalar LogNormConst() const
+    {
+      return logNormConst_;
+    }
+    //! Number of island resampling steps of the last run
+    Size NMigrations() const
+    {
+      return nMigrations_;
+    }
+    const ValArray & IslandLogWeights() const
+    {
+      return islandLogWeights_;
+    }
+  };
+
+}
+
+#endif /* BIIPS_ISLANDSAMPLER_HPP_ */
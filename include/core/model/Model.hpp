@@ -7,13 +7,18 @@
 #include "model/Monitor.hpp"
 #include "common/Accumulator.hpp"
 
+#include <boost/scoped_ptr.hpp>
+#include <set>
+
 namespace Biips
 {
 
   class Model
   {
   protected:
-    boost::scoped_ptr<Graph> pGraph_;
+    boost::shared_ptr<Graph> pGraph_;
+    //! Values of the observed nodes of this model, NULL to use the graph
+    boost::scoped_ptr<NodeValues> pObsValues_;
     boost::scoped_ptr<ForwardSampler> pSampler_;
     boost::scoped_ptr<BackwardSmoother> pSmoother_;
     Types<boost::shared_ptr<Monitor> >::Array filterMonitors_;
@@ -22,7 +27,20 @@ namespace Biips
     std::map<NodeId, Monitor *> backwardSmoothMonitorsMap_;
     boost::scoped_ptr<Monitor> pGenTreeSmoothMonitor_;
     std::set<NodeId> genTreeSmoothMonitoredNodeIds_;
+    Types<boost::shared_ptr<Monitor> >::Array fixedLagSmoothMonitors_;
+    std::map<NodeId, Monitor *> fixedLagSmoothMonitorsMap_;
+    Size fixedLag_;
     Bool defaultMonitorsSet_;
+    SamplerProfile * pProfile_;
+    Bool lazyEvaluation_;
+    Bool unchecked_;
+    Bool sqmc_;
+    PDFType likePDFType_;
+    Bool singlePrecisionArchives_;
+
+    void requireMonitoredNodes();
+    void monitorFixedLagSmoothNodes();
+    void releaseAncestry();
 
     MultiArray extractMonitorStat(
         NodeId nodeId, StatTag statFeature,
@@ -34,7 +52,25 @@ namespace Biips
   public:
 
     Model(Bool dataModel = false)
-        : pGraph_(new Graph(dataModel)), defaultMonitorsSet_(false)
+        : pGraph_(new Graph(dataModel)), fixedLag_(0),
+          defaultMonitorsSet_(false),
+          pProfile_(NULL), lazyEvaluation_(false),
+          unchecked_(false), sqmc_(false), likePDFType_(PDF_FULL),
+          singlePrecisionArchives_(false)
+    {
+    }
+    //! Model sharing the graph of another model
+    /*!
+     * The graph should be frozen, so that models running in different
+     * threads only read it. Each model has its own sampler, smoother
+     * and monitors.
+     */
+    explicit Model(const boost::shared_ptr<Graph> & pGraph)
+        : pGraph_(pGraph), fixedLag_(0),
+          defaultMonitorsSet_(false),
+          pProfile_(NULL), lazyEvaluation_(false),
+          unchecked_(false), sqmc_(false), likePDFType_(PDF_FULL),
+          singlePrecisionArchives_(false)
     {
     }
     virtual ~Model()
@@ -45,12 +81,53 @@ namespace Biips
     {
       return *pGraph_;
     }
+    const boost::shared_ptr<Graph> & GraphPtr() const
+    {
+      return pGraph_;
+    }
+
+    //! Sets values of observed stochastic nodes for this model only
+    /*!
+     * The graph is not modified: the sampler and smoother read these
+     * values instead. The observed nodes are those of the graph. An
+     * empty map restores the values of the graph.
+     */
+    void SetObsValues(const std::map<NodeId, ValArray::Ptr> & obsValues);
+    const NodeValues & ObsValues() const
+    {
+      return pObsValues_ ? *pObsValues_ : pGraph_->GetValues();
+    }
 
     void SetDefaultFilterMonitors();
 
     Bool SetFilterMonitor(NodeId nodeId);
     Bool SetGenTreeSmoothMonitor(NodeId nodeId);
     Bool SetBackwardSmoothMonitor(NodeId nodeId);
+    //! Monitors a node with the fixed-lag smoother
+    /*!
+     * The node sampled at iteration t is monitored at iteration t + lag,
+     * or at the last iteration, with the particles of that iteration.
+     * Its values are released afterwards, so that the particles only
+     * hold a window of lag iterations of the monitored nodes.
+     */
+    Bool SetFixedLagSmoothMonitor(NodeId nodeId);
+    //! Releases the fixed-lag estimate of a node
+    /*!
+     * The values of the node are dropped from its monitor, which is
+     * released with the last of its nodes. Releasing the estimates once
+     * they are extracted bounds the memory of the fixed-lag smoother by
+     * the window of lag iterations.
+     */
+    void ReleaseFixedLagSmoothMonitor(NodeId nodeId);
+    //! Sets the lag of the fixed-lag smoother
+    /*!
+     * Can not be changed while the forward sampler is running.
+     */
+    void SetFixedLag(Size lag);
+    Size FixedLag() const
+    {
+      return fixedLag_;
+    }
 
     Bool SamplerBuilt() const
     {
@@ -70,6 +147,43 @@ namespace Biips
                      const String & rsType, Scalar threshold);
     void IterateSampler();
 
+    //! Writes the state of the forward sampler and of its monitors
+    /*!
+     * Can be called between two iterations. The state also holds the
+     * sampler modes and the fixed lag, which are restored with it.
+     * The backward smoother is not saved.
+     */
+    void SaveSamplerState(std::ostream & os) const;
+    //! Restores a state written by SaveSamplerState
+    /*!
+     * The sampler must be built and the monitors set as when the state
+     * was saved, with the same model and data: throws RuntimeError
+     * otherwise. The following iterations use pRng, whose state is
+     * restored.
+     */
+    void LoadSamplerState(std::istream & is, Rng * pRng);
+    //! Writes the particles of the sampler, see ForwardSampler::SaveParticles
+    void SaveSamplerParticles(std::ostream & os) const;
+    //! Replaces the particles of the sampler, see ForwardSampler::LoadParticles
+    /*!
+     * The monitors are kept.
+     */
+    void LoadSamplerParticles(std::istream & is);
+    //! Writes the filter monitors, to be merged by MergeFilterMonitors
+    void SaveFilterMonitors(std::ostream & os) const;
+    //! Merges the filter monitors of a sub-filter of this model
+    /*!
+     * The monitors have been written by SaveFilterMonitors, from a model
+     * of the same graph and filter monitored nodes. The weights of the
+     * monitor of iteration t are scaled to sum to exp(logWeights[t]),
+     * the weight of the sub-filter in the mixture, and its log
+     * normalizing constant is set to logNormConsts[t], that of the
+     * mixture. The first merge after ClearFilterMonitors sets the
+     * monitors, the following ones append their particles.
+     */
+    void MergeFilterMonitors(std::istream & is, const ValArray & logWeights,
+                             const ValArray & logNormConsts);
+
     Bool SmootherInitialized() const
     {
       return pSmoother_ && pSmoother_->Initialized();
@@ -80,10 +194,69 @@ namespace Biips
 
     void IterateBackwardSmoother();
 
+    //! Attaches profile records to the sampler and the smoother
+    /*!
+     * The profile is also attached to the samplers and smoothers
+     * created afterwards. NULL disables profiling.
+     */
+    void SetProfile(SamplerProfile * pProfile);
+
+    //! Enables or disables the lazy evaluation of the logical nodes
+    /*!
+     * Only the logical nodes needed by a stochastic node or a monitor
+     * are evaluated. See ForwardSampler::SetLazyEvaluation.
+     */
+    void SetLazyEvaluation(Bool lazy);
+    Bool LazyEvaluation() const
+    {
+      return lazyEvaluation_;
+    }
+
+    //! Enables or disables the checks of the parameter values
+    /*!
+     * See ForwardSampler::SetUnchecked.
+     */
+    void SetUnchecked(Bool unchecked);
+    Bool Unchecked() const
+    {
+      return unchecked_;
+    }
+
+    //! Enables or disables the sequential quasi-Monte Carlo mode
+    /*!
+     * See ForwardSampler::SetSqmc.
+     */
+    void SetSqmc(Bool sqmc);
+    Bool Sqmc() const
+    {
+      return sqmc_;
+    }
+
+    //! Sets the terms computed in the log-likelihoods of the particles
+    /*!
+     * See ForwardSampler::SetLikePDFType.
+     */
+    void SetLikePDFType(PDFType type);
+    PDFType LikePDFType() const
+    {
+      return likePDFType_;
+    }
+
+    //! Archives the node values of the monitors in single precision
+    /*!
+     * See ForwardSampler::SetSinglePrecisionArchives.
+     */
+    void SetSinglePrecisionArchives(Bool single);
+    Bool SinglePrecisionArchives() const
+    {
+      return singlePrecisionArchives_;
+    }
+
     // TODO manage multi statFeature
     MultiArray ExtractFilterStat(NodeId nodeId, StatTag statFeature) const;
     MultiArray ExtractGenTreeSmoothStat(NodeId nodeId, StatTag statFeature) const;
     MultiArray ExtractBackwardSmoothStat(NodeId nodeId, StatTag statFeature) const;
+    MultiArray ExtractFixedLagSmoothStat(NodeId nodeId, StatTag statFeature) const;
 
     Histogram ExtractFilterPdf(NodeId nodeId, Size numBins = 40,
                                Scalar cacheFraction = 0.25) const;
@@ -91,11 +264,14 @@ namespace Biips
                                    Scalar cacheFraction = 0.25) const;
     Histogram ExtractBackwardSmoothPdf(NodeId nodeId, Size numBins = 40,
                                Scalar cacheFraction = 0.25) const;
+    Histogram ExtractFixedLagSmoothPdf(NodeId nodeId, Size numBins = 40,
+                                       Scalar cacheFraction = 0.25) const;
 
     // release_only flag: only release monitor objects but keep nodeIds
     void virtual ClearFilterMonitors(Bool release_only = false);
     void virtual ClearGenTreeSmoothMonitors(Bool release_only = false);
     void virtual ClearBackwardSmoothMonitors(Bool release_only = false);
+    void virtual ClearFixedLagSmoothMonitors(Bool release_only = false);
 
     Scalar GetLogPriorDensity(NodeId nodeId) const;
     Types<ValArray>::Pair GetFixedSupport(NodeId nodeId) const;
@@ -4,6 +4,8 @@
 #include "common/Types.hpp"
 #include "common/ValArray.hpp"
 #include "common/DimArray.hpp"
+#include "common/Error.hpp"
+#include "common/StateStream.hpp"
 #include <map>
 
 namespace Biips
@@ -16,6 +18,71 @@ namespace Biips
   class ArrayAccumulator;
   class Particle;
 
+  //! Archive of the values of a monitored node for all the particles
+  /*!
+   * In double precision, the values are the storages of the particles,
+   * shared with them. In single precision, they are copied in one
+   * contiguous array of ShortScalar, particle after particle, which
+   * halves the memory of the monitors and removes the overhead of one
+   * storage per particle.
+   *
+   * Smooth monitors share the values of the filter monitors, see
+   * SmoothMonitor::AddNode.
+   */
+  class MonitorArchive
+  {
+  public:
+    typedef MonitorArchive SelfType;
+    typedef Types<SelfType>::Ptr Ptr;
+
+  protected:
+    Types<ValArray::Ptr>::Array values_;
+    Types<ShortScalar>::Array shortValues_;
+    Size nParticles_;
+    //! Length of the value of a particle
+    Size length_;
+    Bool singlePrecision_;
+
+  public:
+    MonitorArchive() :
+      nParticles_(0), length_(0), singlePrecision_(false)
+    {
+    }
+
+    void Set(const Types<Particle>::Array & particles, NodeId nodeId,
+             Bool singlePrecision);
+
+    Size size() const
+    {
+      return nParticles_;
+    }
+    Bool SinglePrecision() const
+    {
+      return singlePrecision_;
+    }
+    //! Component n of the value of particle i
+    Scalar operator()(Size i, Size n) const
+    {
+      return singlePrecision_ ? Scalar(shortValues_[i * length_ + n])
+                              : (*values_[i])[n];
+    }
+    //! Value of particle i
+    /*!
+     * In double precision, returns the storage of the particle. In single
+     * precision, the value is converted in buffer, which is returned.
+     */
+    const ValArray & Value(Size i, ValArray & buffer) const;
+    //! Appends the values of the particles of other
+    /*!
+     * Throws LogicError if the precision or the length of the values
+     * differ.
+     */
+    void Append(const MonitorArchive & other);
+
+    void SaveState(StateWriter & writer) const;
+    void LoadState(StateReader & reader);
+  };
+
   class Monitor
   {
   public:
@@ -29,11 +96,16 @@ namespace Biips
     Scalar ess_;
     Scalar sumOfWeights_;
     Types<NodeId>::Array sampledNodes_;
-    Types<NodeId>::Array condNodes_;
-    typedef Types<ValArray::Ptr>::Array ParticleValues;
-    std::map<NodeId, ParticleValues> particleValuesMap_;
+    //! Sequence of conditional nodes shared by the monitors of a run
+    Types<Types<NodeId>::Array>::Ptr pCondNodes_;
+    //! Length of the sequence prefix conditioning this monitor
+    Size nCondNodes_;
+    std::map<NodeId, MonitorArchive::Ptr> particleValuesMap_;
     std::map<NodeId, Size> nodeIterationMap_;
     std::map<Size, Scalar> iterationEssMap_;
+    //! Indices of the particles of origin at each sampling iteration,
+    //! empty if each particle is its own origin
+    std::map<Size, Types<Size>::Array> iterationOriginsMap_;
     std::map<NodeId, Bool> nodeDiscreteMap_;
 
     Bool weightsSet_;
@@ -45,10 +117,14 @@ namespace Biips
 
   public:
     Monitor(Size iter, const Types<NodeId>::Array & sampledNodes,
-            const Types<NodeId>::Array & condNodes) :
+            const Types<Types<NodeId>::Array>::Ptr & pCondNodes,
+            Size nCondNodes) :
       iter_(iter), ess_(0), sumOfWeights_(0), sampledNodes_(sampledNodes),
-      condNodes_(condNodes), weightsSet_(false), weightsSwapped_(false)/*, logWeightsSwapped_(false)*/
+      pCondNodes_(pCondNodes), nCondNodes_(nCondNodes), weightsSet_(false),
+      weightsSwapped_(false)/*, logWeightsSwapped_(false)*/
     {
+      if (nCondNodes_ > pCondNodes_->size())
+        throw LogicError("Monitor: conditional nodes prefix is too long.");
     }
     virtual ~Monitor()
     {
@@ -71,9 +147,14 @@ namespace Biips
     {
       return sampledNodes_;
     }
-    const Types<NodeId>::Array & GetConditionalNodes() const
+    Types<Types<NodeId>::ConstIterator>::Pair GetConditionalNodes() const
+    {
+      return std::make_pair(pCondNodes_->begin(),
+                            pCondNodes_->begin() + nCondNodes_);
+    }
+    Size NConditionalNodes() const
     {
-      return condNodes_;
+      return nCondNodes_;
     }
     Scalar GetESS() const
     {
@@ -84,6 +165,9 @@ namespace Biips
     Bool HasIterationESS(Size iter) const;
     void SetIterationESS(Size iter, Scalar ess);
     Scalar GetNodeESS(NodeId id) const;
+    Bool HasIterationOrigins(Size iter) const;
+    void SetIterationOrigins(Size iter, const Types<Size>::Array & origins);
+    const Types<Size>::Array & GetIterationOrigins(Size iter) const;
     Bool GetNodeDiscrete(NodeId id) const;
     Scalar GetSumOfWeights() const
     {
@@ -125,7 +209,11 @@ namespace Biips
       weightsSwapped_ = !weightsSwapped_;
     }
 
-    const ParticleValues & GetNodeValues(NodeId nodeId) const
+    const MonitorArchive & GetNodeValues(NodeId nodeId) const
+    {
+      return *particleValuesMap_.at(nodeId);
+    }
+    const MonitorArchive::Ptr & GetNodeValuesPtr(NodeId nodeId) const
     {
       return particleValuesMap_.at(nodeId);
     }
@@ -146,6 +234,24 @@ namespace Biips
     {
       particleValuesMap_.erase(nodeId);
     }
+
+    //! Scales the weights so that they sum to sumOfWeights
+    void ScaleWeights(Scalar sumOfWeights);
+    //! Appends the particles of a monitor of the same nodes and iteration
+    /*!
+     * The weights are concatenated, and the ESS is computed from the
+     * merged weights. The particles of both monitors must be their own
+     * origins: throws LogicError otherwise.
+     */
+    virtual void Append(const Monitor & other);
+
+    //! Writes the weights and the node values of the monitor
+    /*!
+     * The iteration, the sampled nodes and the conditional nodes
+     * are given to the constructor of the monitor that loads them.
+     */
+    virtual void SaveState(StateWriter & writer) const;
+    virtual void LoadState(StateReader & reader);
   };
 
   class FilterMonitor: public Monitor
@@ -160,8 +266,11 @@ namespace Biips
     Scalar logNormConst_;
 
   public:
-    FilterMonitor(Size iter, const Types<NodeId>::Array & sampledNodes, const Types<NodeId>::Array & condNodes) :
-      BaseType(iter, sampledNodes, condNodes), resampled_(false), logNormConst_(BIIPS_NEGINF)
+    FilterMonitor(Size iter, const Types<NodeId>::Array & sampledNodes,
+                  const Types<Types<NodeId>::Array>::Ptr & pCondNodes,
+                  Size nCondNodes) :
+      BaseType(iter, sampledNodes, pCondNodes, nCondNodes), resampled_(false),
+      logNormConst_(BIIPS_NEGINF)
     {
     }
     virtual ~FilterMonitor()
@@ -173,10 +282,12 @@ namespace Biips
               Scalar sumOfWeights,
               Bool resampled,
               Scalar logNormConst);
+    //! Archives the values of a node, in single precision if singlePrecision
     void AddNode(NodeId nodeId,
                  const Types<Particle>::Array & particles,
                  Size iter,
-                 Bool discrete);
+                 Bool discrete,
+                 Bool singlePrecision = false);
 
     Bool GetResampled() const
     {
@@ -188,6 +299,16 @@ namespace Biips
       checkWeightsSet();
       return logNormConst_;
     }
+    void SetLogNormConst(Scalar logNormConst)
+    {
+      logNormConst_ = logNormConst;
+    }
+
+    //! The merged particles are resampled if one of the monitors is
+    virtual void Append(const Monitor & other);
+
+    virtual void SaveState(StateWriter & writer) const;
+    virtual void LoadState(StateReader & reader);
   };
 
   class SmoothMonitor: public Monitor
@@ -198,7 +319,8 @@ namespace Biips
     typedef Monitor BaseType;
 
     SmoothMonitor(Size iter, const Types<NodeId>::Array & updatedNodes) :
-      BaseType(iter, updatedNodes, Types<NodeId>::Array())
+      BaseType(iter, updatedNodes,
+               Types<Types<NodeId>::Array>::Ptr(new Types<NodeId>::Array()), 0)
     {
     }
     virtual ~SmoothMonitor()
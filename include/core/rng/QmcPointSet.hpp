@@ -0,0 +1,64 @@
+#ifndef BIIPS_QMCPOINTSET_HPP_
+#define BIIPS_QMCPOINTSET_HPP_
+
+#include "common/ValArray.hpp"
+
+namespace Biips
+{
+
+  class Rng;
+
+  //! Randomized quasi-Monte Carlo point set in the unit hypercube
+  /*!
+   * Points of a Sobol sequence, with the direction numbers of Joe and
+   * Kuo, randomized by a hash-based nested uniform (Owen) scrambling
+   * of each coordinate. The coordinates are in (0,1), never 0 or 1.
+   *
+   * The Sobol sequence is defined up to MAX_SOBOL_DIM dimensions: the
+   * following coordinates are pseudo-random uniforms.
+   */
+  class QmcPointSet
+  {
+  public:
+    typedef QmcPointSet SelfType;
+
+    static const Size MAX_SOBOL_DIM = 16;
+
+  protected:
+    Size nPoints_;
+    Size dim_;
+    ///Coordinates of the points, point after point
+    ValArray coords_;
+
+  public:
+    QmcPointSet() :
+      nPoints_(0), dim_(0)
+    {
+    }
+
+    //! Generates the first nPoints points of a new randomization
+    /*!
+     * The scrambling seeds are drawn from rng.
+     */
+    void Generate(Size nPoints, Size dim, Rng & rng);
+    //! Sorts the points by increasing first coordinate
+    void SortByFirstCoordinate();
+
+    Size NPoints() const
+    {
+      return nPoints_;
+    }
+    Size Dim() const
+    {
+      return dim_;
+    }
+    //! Coordinates of the point n
+    const Scalar * Point(Size n) const
+    {
+      return &coords_[n * dim_];
+    }
+  };
+
+}
+
+#endif /* BIIPS_QMCPOINTSET_HPP_ */
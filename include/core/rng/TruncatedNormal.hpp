@@ -12,6 +12,9 @@ namespace Biips
 
   class Rng;
 
+  // The samplers are reentrant: they can be called concurrently, each
+  // thread with its own Rng.
+
   /**
    * Draws a random sample from a left-truncated normal distribution.
    *
@@ -43,6 +46,28 @@ namespace Biips
    */
   Scalar inormal(Scalar left, Scalar right, Rng & rng,
                  Scalar mu = 0.0, Scalar sigma = 1.0);
+
+  /**
+   * Draws n random samples from a left-truncated normal distribution
+   * into values.
+   */
+  void lnormal(Scalar * values, Size n, Scalar left, Rng & rng,
+               Scalar mu = 0.0, Scalar sigma = 1.0);
+
+  /**
+   * Draws n random samples from a right-truncated normal distribution
+   * into values.
+   */
+  void rnormal(Scalar * values, Size n, Scalar right, Rng & rng,
+               Scalar mu = 0.0, Scalar sigma = 1.0);
+
+  /**
+   * Draws n random samples from an interval-truncated normal
+   * distribution into values. The choice of the sampling method is
+   * made once for the batch.
+   */
+  void inormal(Scalar * values, Size n, Scalar left, Scalar right, Rng & rng,
+               Scalar mu = 0.0, Scalar sigma = 1.0);
 }
 
 #endif /* BIIPS_TRUNCATEDNORMAL_HPP_ */
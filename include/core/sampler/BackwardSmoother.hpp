@@ -3,6 +3,7 @@
 
 #include "graph/Graph.hpp"
 #include "model/Monitor.hpp"
+#include "sampler/SamplerProfile.hpp"
 
 namespace Biips
 {
@@ -18,6 +19,8 @@ namespace Biips
   protected:
     const Graph & graph_;
     Types<Monitor*>::Array filterMonitors_;
+    //! Filter monitor of each monitored node, indexed by NodeId
+    Types<Monitor*>::Array nodeFilterMonitors_;
     //    ValArray logWeights_;
     ValArray weights_;
     Scalar sumOfWeights_;
@@ -26,6 +29,8 @@ namespace Biips
     Bool initialized_;
     Types<Size>::Array nodeIterations_;
     Types<NodeId>::Array condNodes_;
+    SamplerProfile * pProfile_;
+    const NodeValues * pObsValues_;
 
     void sumOfWeightsAndEss();
     Monitor * getParentFilterMonitor(NodeId id);
@@ -77,6 +82,28 @@ namespace Biips
 
     void InitMonitor(SmoothMonitor & monitor) const;
     void MonitorNode(NodeId nodeId, SmoothMonitor & monitor) const;
+
+    //! Attaches profile records, or detaches them with NULL
+    void SetProfile(SamplerProfile * pProfile)
+    {
+      pProfile_ = pProfile;
+    }
+    SamplerProfile * ProfilePtr() const
+    {
+      return pProfile_;
+    }
+    //! Sets the values of the observed nodes
+    /*!
+     * When NULL, the values of the graph are used.
+     */
+    void SetObsValues(const NodeValues * pObsValues)
+    {
+      pObsValues_ = pObsValues;
+    }
+    const NodeValues & ObsValues() const
+    {
+      return pObsValues_ ? *pObsValues_ : graph_.GetValues();
+    }
   };
 
 }
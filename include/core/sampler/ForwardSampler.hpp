@@ -8,6 +8,13 @@
 #include "NodeSampler.hpp"
 #include "Particle.hpp"
 #include "Resampler.hpp"
+#include "SamplerProfile.hpp"
+#include "ParamChecker.hpp"
+#include "LikeTerms.hpp"
+#include "common/StateStream.hpp"
+#include "rng/QmcPointSet.hpp"
+
+#include <list>
 
 namespace Biips
 {
@@ -80,22 +87,68 @@ namespace Biips
     Size iter_;
     Rng * pRng_;
     Resampler::Ptr pResampler_;
+    String resampleType_;
 
     ///The ESS threshold under which resampling will be done.
     Scalar resampleThreshold_;
 
     Types<Types<SMCIteration>::Array >::Array smcIterations_;
 
+    ///Conditional nodes of the past iterations, only appended to
+    ///so that monitors can share it
+    Types<Types<NodeId>::Array>::Ptr pConditionalNodes_;
+
     Flags sampledFlagsBefore_;
     Flags sampledFlagsAfter_;
 
     Types<Particle>::Array particles_;
 
+    ///Whether only the logical nodes needed downstream are evaluated
+    Bool lazyEvaluation_;
+    ///Nodes read by monitors
+    Flags requiredNodes_;
+    ///Whether the monitors archive the node values in single precision
+    Bool singlePrecisionArchives_;
+    ///Logical nodes evaluated at their sampling iteration in lazy evaluation
+    Flags eagerNodes_;
+    ///Sampled flags of the ancestors of the lazy node being evaluated,
+    ///and last particle visit of each node, reused by evaluateLazyNode
+    Flags lazyFlags_;
+    Types<Size>::Array lazyVisits_;
+    Size lazyVisitCount_;
+
+    ///Checks of the parameter values of the sampled nodes
+    ParamChecker paramChecker_;
+    ///Terms computed in the log-likelihoods of the particles
+    LikeTerms likeTerms_;
+    ///Values of the observed nodes, NULL to use the values of the graph
+    const NodeValues * pObsValues_;
+    ///Whether the particles are moved with quasi-Monte Carlo points
+    Bool sqmc_;
+    ///Points of the current iteration in SQMC mode
+    QmcPointSet qmcPoints_;
+
     Types<Size>::Array nodeIterations_;
 
     Types<Int>::Array nodeLocks_;
+    ///Nodes whose lock reaches zero after each iteration
+    Types<Types<NodeId>::Array>::Array releaseSchedule_;
+    ///Scheduled nodes that were still locked by a monitor when released
+    Types<NodeId>::Array deferredReleases_;
 
     Bool resampled_;
+    ///For each iteration, indices of the ancestors drawn by the resampling
+    ///at its beginning, empty if the particles were not resampled
+    Types<Types<Size>::Array>::Array ancestors_;
+    ///Iterations before it have released their ancestry
+    Size ancestryBegin_;
+    ///For each past iteration, indices of the particles the current
+    ///particles descend from, empty if each one is its own ancestor.
+    ///Computed on demand, once per iteration, back to originsBegin_.
+    mutable Types<Types<Size>::Array>::Array origins_;
+    mutable Size originsBegin_;
+    ///ESS of the nodes sampled at each past iteration, NaN if not computed
+    mutable ValArray iterationESS_;
 
     Bool built_;
     Bool initialized_;
@@ -103,14 +156,30 @@ namespace Biips
     Scalar ess_;
     Scalar logNormConst_;
 
+    ///Profile records, or NULL when profiling is disabled
+    SamplerProfile * pProfile_;
+
     void initLocks();
     void unlockSampledParents();
+    void buildReleaseSchedule();
+    void appendConditionalNodes();
+    void markEagerNodes();
+    void evaluateLazyNode(NodeId id);
+    void releaseNode(NodeId id);
     void buildNodeIdSequence();
     void buildNodeSamplers();
     void setResampleParams(const String & rsType, Scalar threshold);
-    void mutateParticle(Particle & lastParticle);
+    void mutateParticle(Particle & lastParticle,
+                        const Scalar * uniforms = NULL);
+    void checkSqmcSamplers() const;
+    const NodeValues & obsValues() const;
+    Size uniformDim(Size iter) const;
+    void hilbertOrder(Types<Size>::Array & order) const;
+    void resampleSqmc();
     Scalar rescaleWeights();
     Scalar sumOfWeightsAndEss();
+    void computeOrigins(Size iter) const;
+    void clearOrigins();
 
     // Forbid copying
     ForwardSampler(const ForwardSampler & from);
@@ -155,12 +224,39 @@ namespace Biips
     }
     // last sampled nodes at the current iteration (incremental)
     Types<NodeId>::Array LastSampledNodes();
+    // nodes sampled at a past iteration
+    Types<NodeId>::Array GetSampledNodes(Size iter) const;
     // all past sampled nodes at the current iteration
     Types<NodeId>::Array SampledNodes();
     // all past conditional nodes at the current iteration
-    Types<NodeId>::Array ConditionalNodes();
+    const Types<NodeId>::Array & ConditionalNodes() const
+    {
+      return *pConditionalNodes_;
+    }
+    // shared sequence of the conditional nodes, appended at each iteration
+    const Types<Types<NodeId>::Array>::Ptr & ConditionalNodesPtr() const
+    {
+      return pConditionalNodes_;
+    }
 
+    //! ESS of the particle values of a node
+    /*!
+     * The particles that descend from a same particle at the sampling
+     * iteration of the node share its value: their weights are summed.
+     * The ESS is computed once per sampling iteration.
+     */
     Scalar GetNodeESS(NodeId nodeId) const;
+    //! Indices of the particles the current particles descend from at a past iteration
+    /*!
+     * Empty if each particle is its own ancestor.
+     */
+    const Types<Size>::Array & GetIterationOrigins(Size iter) const;
+    //! Releases the ancestry of the particles before an iteration
+    /*!
+     * The ESS and origins of the nodes sampled before this iteration
+     * are no longer available.
+     */
+    void ReleaseAncestry(Size iter);
 
 
     void Build();
@@ -190,12 +286,146 @@ namespace Biips
     }
     void UnlockAllNodes();
 
+    //! Enables or disables the lazy evaluation of the logical nodes
+    /*!
+     * In lazy evaluation, a sampled logical node is only evaluated
+     * if it has a stochastic child, a child which is evaluated or if it
+     * is required by a monitor. Other logical nodes are left unsampled
+     * in the particles. When such a node is monitored anyway, MonitorNode
+     * evaluates it in each particle from the values held by that
+     * particle, and memoizes it there. It throws NodeError if these
+     * values have already been released.
+     * Takes effect at the next Initialize call.
+     */
+    void SetLazyEvaluation(Bool lazy)
+    {
+      lazyEvaluation_ = lazy;
+    }
+    Bool LazyEvaluation() const
+    {
+      return lazyEvaluation_;
+    }
+    //! Marks a node as read by a monitor, so that it is always evaluated
+    void RequireNode(NodeId id)
+    {
+      requiredNodes_[id] = true;
+    }
+    void ClearRequiredNodes()
+    {
+      requiredNodes_.assign(requiredNodes_.size(), false);
+    }
+    //! Archives the node values of the monitors in single precision
+    /*!
+     * Only the monitor archives are narrowed: the particles, weights and
+     * normalizing constant stay in double precision. See MonitorArchive.
+     */
+    void SetSinglePrecisionArchives(Bool single)
+    {
+      singlePrecisionArchives_ = single;
+    }
+    Bool SinglePrecisionArchives() const
+    {
+      return singlePrecisionArchives_;
+    }
+    //! Enables or disables the unchecked mode
+    /*!
+     * In unchecked mode, the parameter values of the nodes are not
+     * checked. See ParamChecker.
+     */
+    void SetUnchecked(Bool unchecked)
+    {
+      paramChecker_.SetUnchecked(unchecked);
+    }
+    Bool Unchecked() const
+    {
+      return paramChecker_.Unchecked();
+    }
+    //! Sets the terms computed in the log-likelihoods of the particles
+    /*!
+     * With PDF_LIKELIHOOD, the terms that only depend on the observed
+     * values are dropped from the particle weights. They are added once
+     * per iteration to the log normalizing constant, which stays exact.
+     */
+    void SetLikePDFType(PDFType type)
+    {
+      likeTerms_.SetType(type);
+    }
+    PDFType LikePDFType() const
+    {
+      return likeTerms_.Type();
+    }
+    //! Enables or disables the sequential quasi-Monte Carlo mode
+    /*!
+     * In SQMC mode, the uniforms of the samplers are the coordinates of
+     * randomized Sobol points instead of Rng draws, and the particles
+     * are resampled at each iteration, in the Hilbert curve order of
+     * the values sampled at the previous iteration. Each point has one
+     * coordinate for the resampling and one for each component of the
+     * nodes sampled at the iteration.
+     * All the node samplers must be prior samplers, of distributions
+     * that can sample from uniforms: Initialize throws otherwise.
+     * Must not be changed between Initialize and the last iteration.
+     */
+    void SetSqmc(Bool sqmc)
+    {
+      sqmc_ = sqmc;
+    }
+    Bool Sqmc() const
+    {
+      return sqmc_;
+    }
+    //! Sets the values of the observed nodes
+    /*!
+     * They replace the values of the graph, which can then be shared by
+     * samplers with different data. The observed nodes must be the same.
+     * When NULL, the values of the graph are used.
+     */
+    void SetObsValues(const NodeValues * pObsValues);
+    //! Whether a sampled node is evaluated at its sampling iteration
+    Bool Evaluated(NodeId id) const
+    {
+      return !lazyEvaluation_ || eagerNodes_[id];
+    }
+
     void Initialize(Size nbParticles,
                     Rng * pRng,
                     const String & rsType = "stratified",
                     Scalar threshold = 0.5);
     void Iterate();
 
+    //! Writes the state of the particle system between two iterations
+    /*!
+     * The state holds the particles, their weights, the state of the
+     * random number generator, the locks and the ancestry, so that
+     * LoadState followed by Iterate continues the run as if it had
+     * not been interrupted.
+     */
+    void SaveState(StateWriter & writer) const;
+    //! Restores a state written by SaveState
+    /*!
+     * The sampler must be built from the same graph as the sampler that
+     * saved the state: throws RuntimeError otherwise. The state of the
+     * generator is restored into pRng, which is used by the following
+     * iterations.
+     */
+    void LoadState(StateReader & reader, Rng * pRng);
+    //! Writes the particles and their weights
+    /*!
+     * Unlike SaveState, only the particles of the current iteration are
+     * written, with the sums of their weights and the log normalizing
+     * constant, so that LoadParticles gives them to a sampler of the
+     * same model at the same iteration.
+     */
+    void SaveParticles(StateWriter & writer) const;
+    //! Replaces the particles by those written by SaveParticles
+    /*!
+     * Throws RuntimeError if they have been saved at another iteration
+     * or with another number of particles. The generator and the locks
+     * are kept. The ancestry of the previous iterations is released:
+     * the particles descend from those of the other sampler.
+     */
+    void LoadParticles(StateReader & reader);
+
     Bool Initialized() const
     {
       return initialized_;
@@ -215,9 +445,23 @@ namespace Biips
     void Accumulate(NodeId nodeId, ArrayAccumulator & featuresAcc) const;
 
     void InitMonitor(FilterMonitor & monitor) const;
-    void MonitorNode(NodeId nodeId, FilterMonitor & monitor) const;
+    //! Adds the values of a sampled node to the monitor
+    /*!
+     * A node left unsampled by the lazy evaluation is evaluated first.
+     */
+    void MonitorNode(NodeId nodeId, FilterMonitor & monitor);
 
     void ReleaseNodes();
+
+    //! Attaches profile records, or detaches them with NULL
+    void SetProfile(SamplerProfile * pProfile)
+    {
+      pProfile_ = pProfile;
+    }
+    SamplerProfile * ProfilePtr() const
+    {
+      return pProfile_;
+    }
   };
 
 //  void printSamplerState(const ForwardSampler & sampler, std::ostream & os);
@@ -4,6 +4,7 @@
 #include "common/Types.hpp"
 #include "common/NumArray.hpp"
 #include "model/Monitor.hpp"
+#include "graph/GraphTypes.hpp"
 
 namespace Biips
 {
@@ -13,10 +14,14 @@ namespace Biips
   NumArray getNodeValue(NodeId nodeId,
                         const Graph & graph,
                         NodeSampler & nodeSampler);
+  // the values of the observed nodes are read in obsValues, the others
+  // are copied in buffer, which the returned value views
   NumArray getNodeValue(NodeId nodeId,
                         const Graph & graph,
+                        const NodeValues & obsValues,
                         const Monitor & monitor,
-                        Size particleIndex);
+                        Size particleIndex,
+                        ValArray & buffer);
 
   //  Bool isBounded(NodeId nodeId, const Graph & graph);
 
@@ -25,16 +30,20 @@ namespace Biips
                                  NodeSampler & nodeSampler);
   NumArray::Array getParamValues(NodeId nodeId,
                                  const Graph & graph,
+                                 const NodeValues & obsValues,
                                  const Types<Monitor*>::Array & monitors,
-                                 Size particleIndex);
+                                 Size particleIndex,
+                                 Types<ValArray>::Array & buffers);
 
   NumArray::Pair getBoundValues(NodeId nodeId,
                                 const Graph & graph,
                                 NodeSampler & nodeSampler);
   NumArray::Pair getBoundValues(NodeId nodeId,
                                 const Graph & graph,
+                                const NodeValues & obsValues,
                                 const Types<Monitor*>::Pair & monitors,
-                                Size particleIndex);
+                                Size particleIndex,
+                                Types<ValArray>::Pair & buffers);
 
   void getFixedSupportValues(ValArray & lower,
                         ValArray & upper,
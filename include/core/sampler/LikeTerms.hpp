@@ -0,0 +1,60 @@
+#ifndef BIIPS_LIKETERMS_HPP_
+#define BIIPS_LIKETERMS_HPP_
+
+#include "common/Types.hpp"
+#include "common/NumArray.hpp"
+#include "distribution/Distribution.hpp"
+
+namespace Biips
+{
+  class Graph;
+  class StochasticNode;
+
+  //! Terms of the log-likelihoods computed in the particle weights
+  /*!
+   * With PDF_LIKELIHOOD, the log density of an observed node only keeps
+   * the terms that depend on its parameters. The dropped terms only depend
+   * on the observed value: they are the same for all the particles, so that
+   * they cancel in the normalized weights. They are computed once per run,
+   * at the first evaluation of each node, to be added to the log
+   * normalizing constant.
+   */
+  class LikeTerms
+  {
+  public:
+    typedef LikeTerms SelfType;
+    typedef Types<SelfType>::Ptr Ptr;
+
+  protected:
+    const Graph & graph_;
+    PDFType type_;
+    //! Whether the dropped terms of a node have been computed in the run
+    Flags computed_;
+    Types<Scalar>::Array dropped_;
+
+  public:
+    explicit LikeTerms(const Graph & graph);
+
+    //! Sets the terms computed, PDF_FULL or PDF_LIKELIHOOD
+    void SetType(PDFType type);
+    PDFType Type() const
+    {
+      return type_;
+    }
+    //! Starts a new run: the dropped terms will be computed again
+    void Reset();
+
+    //! Log-likelihood of an observed node, of the current type
+    Scalar LogLikelihood(NodeId nodeId, const StochasticNode & node,
+                         const NumArray & x,
+                         const NumArray::Array & paramValues,
+                         const NumArray::Pair & boundValues,
+                         Bool checkParams);
+
+    //! Sum of the terms dropped from the likelihood of a node
+    Scalar DroppedSum(NodeId nodeId) const;
+  };
+
+}
+
+#endif /* BIIPS_LIKETERMS_HPP_ */
@@ -2,6 +2,9 @@
 #define BIIPS_NODESAMPLER_HPP_
 
 #include "graph/NodeVisitor.hpp"
+#include "sampler/ParamChecker.hpp"
+#include "sampler/LikeTerms.hpp"
+#include "sampler/SamplerProfile.hpp"
 
 namespace Biips
 {
@@ -24,6 +27,11 @@ namespace Biips
     NodeValuesMap * pNodeValuesMap_;
     FlagsMap * pSampledFlagsMap_;
     Rng * pRng_;
+    ParamChecker * pParamChecker_;
+    LikeTerms * pLikeTerms_;
+    const NodeValues * pObsValues_;
+    const Scalar * pUniforms_;
+    SamplerProfile::ValueMemory::Ptr pValueMemory_;
     Scalar logIncrementalWeight_;
     Bool membersSet_;
 
@@ -38,6 +46,9 @@ namespace Biips
       return *pSampledFlagsMap_;
     }
 
+    //! Allocates the value of the node nodeId_ in the node values
+    ValArray & allocValue(Size length);
+
     virtual void visit(const ConstantNode & node)
     {
     }
@@ -63,9 +74,70 @@ namespace Biips
                     Rng * pRng);
     void Sample(NodeId nodeId);
 
+    //! Sets the checks of the parameter values
+    /*!
+     * When NULL, all the parameter values are checked at each call.
+     */
+    void SetParamChecker(ParamChecker * pParamChecker)
+    {
+      pParamChecker_ = pParamChecker;
+    }
+    ParamChecker * ParamCheckerPtr() const
+    {
+      return pParamChecker_;
+    }
+    //! Sets the terms computed in the log-likelihoods
+    /*!
+     * When NULL, the full log-likelihoods are computed.
+     */
+    void SetLikeTerms(LikeTerms * pLikeTerms)
+    {
+      pLikeTerms_ = pLikeTerms;
+    }
+    LikeTerms * LikeTermsPtr() const
+    {
+      return pLikeTerms_;
+    }
+    //! Terms computed in the log-likelihoods
+    PDFType LikePDFType() const
+    {
+      return pLikeTerms_ ? pLikeTerms_->Type() : PDF_FULL;
+    }
+    //! Sets the values of the observed nodes
+    /*!
+     * When NULL, the values of the graph are used.
+     */
+    void SetObsValues(const NodeValues * pObsValues)
+    {
+      pObsValues_ = pObsValues;
+    }
+    //! Values of the observed nodes
+    const NodeValues & ObsValues() const;
+    //! Sets the uniforms transformed into the value of the sampled node
+    /*!
+     * One uniform is consumed per component of the node, by the
+     * SampleUniform method of its prior. Only used by this prior
+     * sampler, not by the derived samplers. When NULL, the node is
+     * sampled with the Rng.
+     */
+    void SetUniforms(const Scalar * pUniforms)
+    {
+      pUniforms_ = pUniforms;
+    }
+    //! Sets the counter of the allocated values
+    /*!
+     * When null, the allocations are not counted.
+     */
+    void SetValueMemory(const SamplerProfile::ValueMemory::Ptr & pValueMemory)
+    {
+      pValueMemory_ = pValueMemory;
+    }
+
     explicit NodeSampler(const Graph & graph) :
       graph_(graph), pNodeValuesMap_(NULL), pSampledFlagsMap_(NULL),
-      pRng_(NULL), logIncrementalWeight_(0.0), membersSet_(false)
+      pRng_(NULL), pParamChecker_(NULL), pLikeTerms_(NULL),
+      pObsValues_(NULL), pUniforms_(NULL), logIncrementalWeight_(0.0),
+      membersSet_(false)
     {
     }
 
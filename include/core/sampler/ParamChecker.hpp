@@ -0,0 +1,84 @@
+#ifndef BIIPS_PARAMCHECKER_HPP_
+#define BIIPS_PARAMCHECKER_HPP_
+
+#include "common/Types.hpp"
+#include "common/NumArray.hpp"
+#include "graph/GraphTypes.hpp"
+
+namespace Biips
+{
+  class Graph;
+
+  //! Checks of the parameter values of the nodes sampled by a ForwardSampler
+  /*!
+   * The parameters of a stochastic node are classified when the sampler is
+   * built: those which are observed have the same values for all the
+   * particles, the others vary. The nodes whose parameters are all
+   * observed are checked when the sampler is built and at the start of
+   * each run, the data may have changed in between, and are not checked
+   * by the calls. The first call of another node in a run checks all its
+   * parameters, as the checks of a distribution may involve several of
+   * them, and the following calls only check the varying ones.
+   *
+   * In unchecked mode, no parameters are checked. It is meant for
+   * production runs of a model that has passed a checked run.
+   */
+  class ParamChecker
+  {
+  public:
+    typedef ParamChecker SelfType;
+    typedef Types<SelfType>::Ptr Ptr;
+
+  protected:
+    const Graph & graph_;
+    Bool unchecked_;
+    //! For each stochastic node, flags of its varying parameters
+    Types<Flags>::Array varyingParams_;
+    //! Whether all the parameters of a node have been checked in the run
+    Flags allChecked_;
+
+  public:
+    explicit ParamChecker(const Graph & graph);
+
+    //! Classifies the parameters of the stochastic nodes
+    /*!
+     * Then checks the nodes whose parameters are observed, as Reset.
+     */
+    void Build(const NodeValues & obsValues);
+    //! Starts a new run
+    /*!
+     * Checks the nodes whose parameters are observed, with their values
+     * in obsValues. Throws NodeError if invalid. The parameters of the
+     * other nodes will be checked at their first call.
+     */
+    void Reset(const NodeValues & obsValues);
+
+    void SetUnchecked(Bool unchecked)
+    {
+      unchecked_ = unchecked;
+    }
+    Bool Unchecked() const
+    {
+      return unchecked_;
+    }
+    const Flags & VaryingParams(NodeId nodeId) const
+    {
+      return varyingParams_[nodeId];
+    }
+
+    //! Checks the parameter values of a stochastic node before sampling it
+    /*!
+     * Throws NodeError if invalid.
+     */
+    void CheckSample(NodeId nodeId, const NumArray::Array & paramValues);
+    //! Checks the parameter values of a stochastic node before computing its density
+    /*!
+     * Throws NodeError if invalid.
+     */
+    void CheckDensity(NodeId nodeId, const NumArray & x,
+                      const NumArray::Array & paramValues);
+  };
+
+}
+
+#endif /* BIIPS_PARAMCHECKER_HPP_ */
@@ -37,10 +37,23 @@ namespace Biips
       return "";
     }
 
+    //! New resampler of the same type, with its own buffers
+    /*!
+     * The resamplers of the ResamplerTable are shared: each sampler
+     * resamples with its own clone.
+     */
+    virtual Ptr Clone() const = 0;
+
     void Resample(Types<Particle>::Array & particles,
                   Scalar & sumOfWeights,
                   Rng & rng);
 
+    //! Indices of the ancestors of the particles in the last resampling
+    const Types<Size>::Array & Ancestors() const
+    {
+      return indices_;
+    }
+
     virtual ~Resampler()
     {
     }
@@ -0,0 +1,144 @@
+#ifndef BIIPS_SAMPLERPROFILE_HPP_
+#define BIIPS_SAMPLERPROFILE_HPP_
+
+#include "common/Types.hpp"
+#include <map>
+#include <chrono>
+#include <iosfwd>
+
+namespace Biips
+{
+
+  //! Timing and memory records of an SMC run
+  /*!
+   * A profile is filled by ForwardSampler, BackwardSmoother and Model
+   * when it is attached to them. Profiling is disabled by attaching
+   * no profile, in which case the instrumented code only tests a null pointer.
+   *
+   * Times are wall clock times in seconds.
+   */
+  class SamplerProfile
+  {
+  public:
+    typedef SamplerProfile SelfType;
+    typedef Types<SelfType>::Ptr Ptr;
+    typedef std::chrono::steady_clock ClockType;
+    typedef ClockType::time_point TimePoint;
+
+    //! Records of one forward or backward iteration
+    struct IterationRecord
+    {
+      Size iteration;
+      Bool backward;
+      //! Start time, relative to the start of the profile
+      Scalar start;
+      Scalar mutationTime;
+      Scalar weightingTime;
+      Scalar resamplingTime;
+      Scalar monitoringTime;
+      Scalar ess;
+      //! Whether the particles have been resampled at this iteration
+      Bool resampled;
+      //! Number of node values allocated by the node samplers
+      Size valueAllocations;
+      //! Memory of the node values allocated and not yet freed
+      Size particleBytes;
+    };
+
+    //! Node values allocated by the node samplers
+    /*!
+     * The values are counted when they are allocated and when their
+     * last owner frees them, so that the values shared by resampled
+     * particles are counted once.
+     */
+    struct ValueMemory
+    {
+      typedef Types<ValueMemory>::Ptr Ptr;
+
+      Size allocations;
+      Size bytes;
+
+      ValueMemory() :
+        allocations(0), bytes(0)
+      {
+      }
+    };
+
+    //! Cumulated records of the node samplers of a same name
+    struct NodeSamplerRecord
+    {
+      Scalar time;
+      Size calls;
+    };
+
+  protected:
+    TimePoint origin_;
+    Types<IterationRecord>::Array iterations_;
+    std::map<String, NodeSamplerRecord> nodeSamplers_;
+    Size peakParticleBytes_;
+    //! Replaced when cleared: the values of a previous run are freed
+    //! from the count of that run
+    ValueMemory::Ptr pValueMemory_;
+
+  public:
+    SamplerProfile()
+    {
+      Clear();
+    }
+
+    static TimePoint Now()
+    {
+      return ClockType::now();
+    }
+    //! Seconds elapsed since a time point
+    static Scalar Since(const TimePoint & start)
+    {
+      return std::chrono::duration<Scalar>(Now() - start).count();
+    }
+
+    void Clear();
+
+    //! Starts the records of a new iteration
+    void BeginIteration(Size iter, Bool backward = false);
+    //! Records of the last begun iteration
+    IterationRecord & Current();
+
+    void AddNodeSamplerCall(const String & name, Scalar time)
+    {
+      NodeSamplerRecord & rec = nodeSamplers_[name];
+      rec.time += time;
+      ++rec.calls;
+    }
+    //! Counter of the node values, shared with their deleters
+    const ValueMemory::Ptr & ValueMemoryPtr() const
+    {
+      return pValueMemory_;
+    }
+    //! Records the node values of the current iteration
+    void RecordValueMemory();
+
+    const Types<IterationRecord>::Array & Iterations() const
+    {
+      return iterations_;
+    }
+    const std::map<String, NodeSamplerRecord> & NodeSamplers() const
+    {
+      return nodeSamplers_;
+    }
+    Size PeakParticleBytes() const
+    {
+      return peakParticleBytes_;
+    }
+
+    //! Prints the records in JSON format
+    void PrintJson(std::ostream & os) const;
+    //! Prints the iteration phases in the trace event format
+    /*!
+     * The output can be loaded in trace viewers like chrome://tracing.
+     */
+    void PrintTraceEvents(std::ostream & os) const;
+  };
+
+}
+
+#endif /* BIIPS_SAMPLERPROFILE_HPP_ */
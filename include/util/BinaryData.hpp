@@ -0,0 +1,42 @@
+#ifndef BIIPS_BINARYDATA_HPP_
+#define BIIPS_BINARYDATA_HPP_
+
+#include "common/Types.hpp"
+#include "common/MultiArray.hpp"
+#include <map>
+
+namespace Biips
+{
+
+  //! Binary container of named arrays
+  /*!
+   * The file starts with the "BIIPSDAT" magic, the format version, a
+   * byte order marker and the number of variables. Each variable is
+   * written as its name, its dimensions, a type code (float64 or int32),
+   * an optional NA bitmask and its values in native byte order.
+   *
+   * Reading maps the file and copies the payload of each variable
+   * directly into the storage of its MultiArray, which Console::Compile
+   * and Console::ChangeData can use without cloning.
+   *
+   * Throws RuntimeError on invalid or truncated files.
+   */
+
+  //! Tells whether a file starts with the binary data magic
+  Bool isBinaryDataFile(const String & fileName);
+
+  //! Writes all the variables of dataMap
+  /*!
+   * Variables whose non NA values are all 32-bit integers are written
+   * as int32.
+   */
+  void writeBinaryData(const String & fileName,
+                       const std::map<String, MultiArray> & dataMap);
+
+  //! Reads all the variables of a binary data file
+  void readBinaryData(const String & fileName,
+                      std::map<String, MultiArray> & dataMap);
+
+}
+
+#endif /* BIIPS_BINARYDATA_HPP_ */
@@ -0,0 +1,62 @@
+#ifndef BIIPS_DUMPPARSER_HPP_
+#define BIIPS_DUMPPARSER_HPP_
+
+#include "common/Types.hpp"
+#include "common/MultiArray.hpp"
+#include <map>
+
+namespace Biips
+{
+
+  //! Parses data in the S-plus dump format from a character buffer
+  /*!
+   * Reads the same definitions as DumpReader, directly from memory,
+   * typically a MappedFile, without stream operations. The values of
+   * each variable are parsed into the storage of its MultiArray, as
+   * Scalar values: integers are converted and NA values are
+   * BIIPS_REALNA. Sequences can also contain integer ranges.
+   *
+   * Numbers are parsed exactly: the common ones, with at most 19
+   * significant digits and small exponents, are converted directly,
+   * the others with strtod.
+   *
+   * Throws RuntimeError with the line number on syntax errors.
+   */
+  class DumpParser
+  {
+  protected:
+    const char * begin_;
+    const char * p_;
+    const char * end_;
+
+    void error(const String & msg) const;
+    void skipSpaces();
+    Bool scanChar(char c);
+    Bool scanWord(const String & word);
+    String scanName();
+    //! Scans a number, NA, or an integer range
+    void scanNumbers(ValArray & values);
+    Scalar scanNumber();
+    void scanSeq(ValArray & values);
+    void scanDims(DimArray & dim);
+
+  public:
+    DumpParser(const char * begin, const char * end) :
+      begin_(begin), p_(begin), end_(end)
+    {
+    }
+
+    //! Parses the next definition
+    /*!
+     * @return false at the end of the buffer
+     */
+    Bool Next(String & name, MultiArray & value);
+  };
+
+  //! Reads all the variables of a data file in the S-plus dump format
+  void readDumpFile(const String & fileName,
+                    std::map<String, MultiArray> & dataMap);
+
+}
+
+#endif /* BIIPS_DUMPPARSER_HPP_ */
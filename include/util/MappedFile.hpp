@@ -0,0 +1,50 @@
+#ifndef BIIPS_MAPPEDFILE_HPP_
+#define BIIPS_MAPPEDFILE_HPP_
+
+#include "common/Types.hpp"
+
+namespace Biips
+{
+
+  //! Read-only view of the contents of a file
+  /*!
+   * The file is mapped in memory where mmap is available, so that its
+   * pages are only loaded when they are read. Elsewhere, it is read
+   * in a buffer.
+   *
+   * Throws RuntimeError if the file can not be opened.
+   */
+  class MappedFile
+  {
+  protected:
+    const char * data_;
+    size_t size_;
+    //! Buffer of the contents when the file is not mapped
+    String buffer_;
+    Bool mapped_;
+
+    // Forbid copying
+    MappedFile(const MappedFile & from);
+    MappedFile & operator=(const MappedFile & rhs);
+
+  public:
+    explicit MappedFile(const String & fileName);
+    ~MappedFile();
+
+    const char * begin() const
+    {
+      return data_;
+    }
+    const char * end() const
+    {
+      return data_ + size_;
+    }
+    size_t size() const
+    {
+      return size_;
+    }
+  };
+
+}
+
+#endif /* BIIPS_MAPPEDFILE_HPP_ */
@@ -39,6 +39,22 @@ namespace Biips
   Scalar BoundedScalarDistribution::logDensity(const NumArray & x,
                                                const NumArray::Array & paramValues,
                                                const NumArray::Pair & boundValues) const
+  {
+    return boundedLogDensity(x, paramValues, boundValues, PDF_FULL);
+  }
+
+  Scalar BoundedScalarDistribution::partialLogDensity(const NumArray & x,
+                                                      const NumArray::Array & paramValues,
+                                                      const NumArray::Pair & boundValues,
+                                                      PDFType type) const
+  {
+    return boundedLogDensity(x, paramValues, boundValues, type);
+  }
+
+  Scalar BoundedScalarDistribution::boundedLogDensity(const NumArray & x,
+                                                      const NumArray::Array & paramValues,
+                                                      const NumArray::Pair & boundValues,
+                                                      PDFType type) const
   {
     const NumArray & lower = boundValues.first;
     const NumArray & upper = boundValues.second;
@@ -51,7 +67,8 @@ namespace Biips
         < lower.ScalarView())
       return BIIPS_NEGINF;
 
-    Scalar log_dens = d(x.ScalarView(), paramValues, true);
+    Scalar log_dens = type == PDF_FULL ? d(x.ScalarView(), paramValues, true)
+                                       : partialLogD(x.ScalarView(), paramValues, type);
 
     if (!lower.IsNULL() || !upper.IsNULL())
     {
@@ -127,6 +144,26 @@ namespace Biips
       values[0] = r(paramValues, rng);
   }
 
+  void BoundedScalarDistribution::sampleUniform(ValArray & values,
+                                                const NumArray::Array & paramValues,
+                                                const NumArray::Pair & boundValues,
+                                                const Scalar * uniforms) const
+  {
+    const NumArray & lower = boundValues.first;
+    const NumArray & upper = boundValues.second;
+
+    // inverse transform restricted to [P(X < lower), P(X <= upper)],
+    // as in the bounded case of sample
+    Scalar plower = 0.0, pupper = 1.0;
+    if (!lower.IsNULL())
+      plower = calPlower(lower.ScalarView(), paramValues);
+    if (!upper.IsNULL())
+      pupper = calPupper(upper.ScalarView(), paramValues);
+
+    values[0] = q(plower + uniforms[0] * (pupper - plower), paramValues,
+                  true, false);
+  }
+
   Scalar BoundedScalarDistribution::fixedUnboundedLower(const NumArray::Array & paramValues) const
   {
     switch (support_)
@@ -38,6 +38,17 @@ namespace Biips
     values[0] = gen();
   }
 
+  void DBern::sampleUniform(ValArray & values,
+                            const NumArray::Array & paramValues,
+                            const NumArray::Pair & boundValues,
+                            const Scalar * uniforms) const
+  {
+    Scalar p = paramValues[0].ScalarView();
+
+    // inverse of the distribution function
+    values[0] = uniforms[0] > 1.0 - p ? 1.0 : 0.0;
+  }
+
   Scalar DBern::logDensity(const NumArray & x,
                            const NumArray::Array & paramValues,
                            const NumArray::Pair & boundValues) const
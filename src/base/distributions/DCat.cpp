@@ -52,6 +52,23 @@ namespace Biips
     values[0] = Scalar(gen() + 1);
   }
 
+  void DCat::sampleUniform(ValArray & values,
+                           const NumArray::Array & paramValues,
+                           const NumArray::Pair & boundValues,
+                           const Scalar * uniforms) const
+  {
+    const ValArray & weights = paramValues[0].Values();
+
+    // inverse of the distribution function
+    Scalar u = uniforms[0] * weights.Sum();
+    Scalar cum_weight = weights[0];
+    Size k = 0;
+    while (cum_weight < u && k + 1 < weights.size())
+      cum_weight += weights[++k];
+
+    values[0] = Scalar(k + 1);
+  }
+
   Scalar DCat::logDensity(const NumArray & x,
                           const NumArray::Array & paramValues,
                           const NumArray::Pair & boundValues) const
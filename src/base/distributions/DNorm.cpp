@@ -46,6 +46,22 @@ namespace Biips
     return pdf(dist, x);
   }
 
+  Scalar DNorm::partialLogD(Scalar x, const NumArray::Array & paramValues,
+                            PDFType type) const
+  {
+    Scalar mean = paramValues[0].ScalarView();
+    Scalar prec = paramValues[1].ScalarView();
+    using std::log;
+    using std::pow;
+    switch (type)
+    {
+      case PDF_LIKELIHOOD:
+        return -0.5 * (-log(prec) + pow(x - mean, 2) * prec);
+      default:
+        return d(x, paramValues, true);
+    }
+  }
+
   void DNorm::sample(ValArray & values,
                      const NumArray::Array & paramValues,
                      const NumArray::Pair & boundValues,
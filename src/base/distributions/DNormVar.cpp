@@ -48,6 +48,22 @@ namespace Biips
     return pdf(dist, x);
   }
 
+  Scalar DNormVar::partialLogD(Scalar x, const NumArray::Array & paramValues,
+                               PDFType type) const
+  {
+    Scalar mean = paramValues[0].ScalarView();
+    Scalar var = paramValues[1].ScalarView();
+    using std::log;
+    using std::pow;
+    switch (type)
+    {
+      case PDF_LIKELIHOOD:
+        return -0.5 * (log(var) + pow(x - mean, 2) / var);
+      default:
+        return d(x, paramValues, true);
+    }
+  }
+
   void DNormVar::sample(ValArray & values,
                         const NumArray::Array & paramValues,
                         const NumArray::Pair & boundValues,
@@ -41,4 +41,18 @@ namespace Biips
     return boost::math::pdf(dist, x);
   }
 
+  Scalar DPois::partialLogD(Scalar x, const NumArray::Array & paramValues,
+                            PDFType type) const
+  {
+    using std::log;
+    switch (type)
+    {
+      case PDF_LIKELIHOOD:
+        // the log factorial of x is dropped
+        return -LAMBDA(paramValues) + x * log(LAMBDA(paramValues));
+      default:
+        return d(x, paramValues, true);
+    }
+  }
+
 }
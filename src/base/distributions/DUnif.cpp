@@ -41,6 +41,17 @@ namespace Biips
     values[0] = gen();
   }
 
+  void DUnif::sampleUniform(ValArray & values,
+                            const NumArray::Array & paramValues,
+                            const NumArray::Pair & boundValues,
+                            const Scalar * uniforms) const
+  {
+    Scalar lower = paramValues[0].ScalarView();
+    Scalar upper = paramValues[1].ScalarView();
+
+    values[0] = lower + uniforms[0] * (upper - lower);
+  }
+
   Scalar DUnif::logDensity(const NumArray & x,
                            const NumArray::Array & paramValues,
                            const NumArray::Pair & boundValues) const
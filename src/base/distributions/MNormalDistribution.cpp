@@ -0,0 +1,161 @@
+#define _USE_MATH_DEFINES
+
+#include <boost/random/normal_distribution.hpp>
+#include <boost/random/variate_generator.hpp>
+#include <boost/math/distributions/normal.hpp>
+
+#include "distributions/MNormalDistribution.hpp"
+#include "common/cholesky.hpp"
+
+namespace Biips
+{
+
+  static const Scalar TOL = 1e-7;
+
+  Bool MNormalDistribution::checkMean(const NumArray & mean)
+  {
+    for (Size i = 0; i < mean.Length(); ++i)
+    {
+      if (!isFinite(mean.Values()[i]))
+        return false;
+    }
+    return true;
+  }
+
+  Bool MNormalDistribution::checkSymmetric(const NumArray & mat, Size n)
+  {
+    // FIXME: this is only valid for Column major order
+    for (Size i = 0; i < n; ++i)
+    {
+      Size x_ind = i;
+      Size y_ind = n * i;
+      for (Size j = 0; j < i; ++j)
+      {
+        if (std::fabs(mat.Values()[x_ind] - mat.Values()[y_ind]) > TOL)
+          return false;
+        x_ind += n;
+        y_ind++;
+      }
+    }
+    return true;
+  }
+
+  Bool MNormalDistribution::checkParamDims(
+      const Types<DimArray::Ptr>::Array & paramDims) const
+  {
+    const DimArray & mean_dim = *paramDims[0];
+    const DimArray & mat_dim = *paramDims[1];
+    if (!mean_dim.Drop().IsVector())
+      return false;
+    if (mat_dim.IsSquared())
+      return (mean_dim[0] == mat_dim[0]);
+    else
+      return mean_dim.IsScalar() && mat_dim.IsScalar();
+  }
+
+  DimArray MNormalDistribution::dim(
+      const Types<DimArray::Ptr>::Array & paramDims) const
+  {
+    return paramDims[0]->Drop();
+  }
+
+  Bool MNormalDistribution::CheckParamValues(
+      const NumArray::Array & paramValues) const
+  {
+    const NumArray & mean = paramValues[0];
+    const NumArray & mat = paramValues[1];
+
+    return checkMean(mean) && checkSymmetric(mat, mean.Length());
+  }
+
+  Bool MNormalDistribution::CheckVaryingParamValues(
+      const NumArray::Array & paramValues, const Flags & varyingMask) const
+  {
+    const NumArray & mean = paramValues[0];
+    const NumArray & mat = paramValues[1];
+
+    // the O(n^2) symmetry check is only done when the matrix varies
+    if (varyingMask[0] && !checkMean(mean))
+      return false;
+    if (varyingMask[1] && !checkSymmetric(mat, mean.Length()))
+      return false;
+    return true;
+  }
+
+  Matrix MNormalDistribution::choleskyFactor(const NumArray & mat) const
+  {
+    Matrix mat_chol(mat);
+    if (!ublas::cholesky_factorize(mat_chol))
+      throw RuntimeError(name_ + ": matrix is not positive-semidefinite.");
+    return mat_chol;
+  }
+
+  void MNormalDistribution::transformStdNormal(
+      ValArray & values, const NumArray::Array & paramValues) const
+  {
+    const NumArray & mean = paramValues[0];
+    Matrix mat_chol = choleskyFactor(paramValues[1]);
+
+    Vector sample_vec(values.size(), ValArray());
+    sample_vec.data().swap(values);
+    scaleStdNormal(sample_vec, mat_chol);
+    values.swap(sample_vec.data());
+
+    for (Size i = 0; i < values.size(); ++i)
+      values[i] += mean.Values()[i];
+  }
+
+  void MNormalDistribution::sample(ValArray & values,
+                                   const NumArray::Array & paramValues,
+                                   const NumArray::Pair & boundValues,
+                                   Rng & rng) const
+  {
+    typedef boost::normal_distribution<Scalar> DistType;
+    boost::variate_generator<Rng::GenType&, DistType> gen(rng.GetGen(),
+                                                          DistType());
+
+    std::generate(values.begin(), values.end(), gen);
+
+    transformStdNormal(values, paramValues);
+  }
+
+  void MNormalDistribution::sampleUniform(ValArray & values,
+                                          const NumArray::Array & paramValues,
+                                          const NumArray::Pair & boundValues,
+                                          const Scalar * uniforms) const
+  {
+    boost::math::normal_distribution<Scalar> std_normal;
+    for (Size i = 0; i < values.size(); ++i)
+      values[i] = boost::math::quantile(std_normal, uniforms[i]);
+
+    transformStdNormal(values, paramValues);
+  }
+
+  Scalar MNormalDistribution::partialLogDensity(
+      const NumArray & x, const NumArray::Array & paramValues,
+      const NumArray::Pair & boundValues, PDFType type) const
+  {
+    const NumArray & mean = paramValues[0];
+
+    Vector diff_vec(x.Length(), x.Values() - mean.Values());
+    Matrix mat_chol = choleskyFactor(paramValues[1]);
+    whiten(diff_vec, mat_chol);
+
+    // in the likelihood, the constant term is dropped
+    // and the log-determinant is kept
+    Scalar log_dens = -0.5 * ublas::inner_prod(diff_vec, diff_vec)
+                      + 0.5 * logDetPrec(mat_chol);
+    if (type == PDF_FULL)
+      log_dens -= 0.5 * diff_vec.size() * LOG_2PI;
+    return log_dens;
+  }
+
+  void MNormalDistribution::fixedUnboundedSupport(
+      ValArray & lower, ValArray & upper,
+      const NumArray::Array & paramValues) const
+  {
+    std::fill(lower.begin(), lower.end(), BIIPS_NEGINF);
+    std::fill(upper.begin(), upper.end(), BIIPS_POSINF);
+  }
+
+}
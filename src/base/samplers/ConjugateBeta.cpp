@@ -17,7 +17,7 @@ namespace Biips
                                                            graph_,
                                                            *this).ScalarView();
     likeParamContribValues[1].ScalarView()
-        += graph_.GetValues()[likeId]->ScalarView();
+        += ObsValues()[likeId]->ScalarView();
   }
 
   MultiArray::Array ConjugateBeta::postParam(const NumArray::Array & priorParamValues,
@@ -21,8 +21,8 @@ namespace Biips
     Matrix prec_i_mat(getNodeValue(prec_id, graph_, *this));
 
     NumArray obs_i(graph_.GetNode(likeId).DimPtr().get(),
-                   graph_.GetValues()[likeId].get());
-    VectorRef obs_i_vec(obs_i);
+                   ObsValues()[likeId].get());
+    Vector obs_i_vec(obs_i);
 
     like_mean += ublas::prod(prec_i_mat, obs_i_vec);
     like_prec += prec_i_mat;
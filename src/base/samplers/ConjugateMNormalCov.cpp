@@ -25,8 +25,8 @@ namespace Biips
     ublas::cholesky_invert(prec_i_mat);
 
     NumArray obs_i(graph_.GetNode(likeId).DimPtr().get(),
-                   graph_.GetValues()[likeId].get());
-    VectorRef obs_i_vec(obs_i);
+                   ObsValues()[likeId].get());
+    Vector obs_i_vec(obs_i);
 
     like_mean += ublas::prod(prec_i_mat, obs_i_vec);
     like_prec += prec_i_mat;
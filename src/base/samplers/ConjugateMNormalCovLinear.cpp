@@ -33,18 +33,14 @@ namespace Biips
     Vector b_;
     Matrix cov_;
     Vector obs_;
+    Size offset_;
 
     virtual void visit(const StochasticNode & node) // TODO optimize (using effective uBlas functions)
     {
-      NumArray cov_i_dat(getNodeValue(node.Parents()[1], graph_, nodeSampler_));
-      MatrixRef cov_i(cov_i_dat);
+      Matrix cov_i(getNodeValue(node.Parents()[1], graph_, nodeSampler_));
       Size dim_obs = cov_i.size1();
-      Size cov_old_dim = cov_.size1();
-      cov_.resize(cov_old_dim + dim_obs, cov_old_dim + dim_obs);
-      ublas::project(cov_,
-                     ublas::range(cov_old_dim, cov_.size1()),
-                     ublas::range(cov_old_dim, cov_.size2())) = cov_i;
-      cov_i.Release();
+      ublas::range obs_range(offset_, offset_ + dim_obs);
+      ublas::project(cov_, obs_range, obs_range) = cov_i;
 
       GetMLinearTransformVisitor get_lin_trans_vis(graph_,
                                                    myId_,
@@ -53,25 +49,17 @@ namespace Biips
                                                    dim_obs);
       graph_.VisitNode(node.Parents()[0], get_lin_trans_vis);
 
-      const Matrix & A_i = get_lin_trans_vis.GetA();
-      Size a_old_size1 = A_.size1();
-      A_.resize(a_old_size1 + A_i.size1(), A_.size2());
-      ublas::project(A_,
-                     ublas::range(a_old_size1, A_.size1()),
-                     ublas::range(0, A_.size2())) = A_i; // FIXME
-
-      const Vector & b_i = get_lin_trans_vis.GetB();
-      Size b_old_size = b_.size();
-      b_.resize(b_old_size + b_i.size());
-      ublas::project(b_, ublas::range(b_old_size, b_.size())) = b_i;
+      ublas::project(A_, obs_range, ublas::range(0, A_.size2()))
+          = get_lin_trans_vis.GetA(); // FIXME
+      ublas::project(b_, obs_range) = get_lin_trans_vis.GetB();
 
       NumArray
-          obs_i_dat(node.DimPtr().get(), graph_.GetValues()[nodeId_].get());
+          obs_i_dat(node.DimPtr().get(), nodeSampler_.ObsValues()[nodeId_].get());
+
+      Vector obs_i(obs_i_dat);
+      ublas::project(obs_, obs_range) = obs_i;
 
-      VectorRef obs_i(obs_i_dat);
-      Size obs_old_size = obs_.size();
-      obs_.resize(obs_old_size + obs_i.size());
-      ublas::project(obs_, ublas::range(obs_old_size, obs_.size())) = obs_i;
+      offset_ += dim_obs;
     }
 
   public:
@@ -95,10 +83,12 @@ namespace Biips
     MNormalCovLinearLikeFormVisitor(const Graph & graph,
                                     NodeId myId,
                                     NodeSampler & nodeSampler,
-                                    Size dimNode) // TODO manage dimension
+                                    Size dimNode,
+                                    Size dimObs) // TODO manage dimension
     :
       graph_(graph), myId_(myId), nodeSampler_(nodeSampler), dimNode_(dimNode),
-          A_(0, dimNode), b_(0), cov_(0, 0), obs_(0)
+          A_(dimObs, dimNode, 0.0), b_(dimObs, 0.0),
+          cov_(dimObs, dimObs, 0.0), obs_(dimObs), offset_(0)
     {
     }
   };
@@ -113,10 +103,17 @@ namespace Biips
     boost::tie(it_offspring, it_offspring_end)
         = graph_.GetLikelihoodChildren(nodeId_);
 
+    // size the likelihood matrices once for all the children
+    Size dim_obs = 0;
+    for (GraphTypes::LikelihoodChildIterator it = it_offspring;
+        it != it_offspring_end; ++it)
+      dim_obs += graph_.GetNode(*it).Dim().Length();
+
     MNormalCovLinearLikeFormVisitor like_form_vis(graph_,
                                                   nodeId_,
                                                   *this,
-                                                  dim_node);
+                                                  dim_node,
+                                                  dim_obs);
     while (it_offspring != it_offspring_end)
     {
       graph_.VisitNode(*it_offspring, like_form_vis);
@@ -128,8 +125,7 @@ namespace Biips
     const Matrix & like_cov = like_form_vis.GetCov();
     Vector & obs = like_form_vis.GetObs();
 
-    NumArray prior_var_dat(getNodeValue(prior_var_id, graph_, *this));
-    MatrixRef prior_var(prior_var_dat);
+    Matrix prior_var(getNodeValue(prior_var_id, graph_, *this));
 
     Matrix kalman_gain = ublas::prod(prior_var, ublas::trans(like_A));
     Matrix inn_cov;
@@ -140,20 +136,17 @@ namespace Biips
     ublas::cholesky_invert(inn_cov_inv);
     kalman_gain = ublas::prod(kalman_gain, inn_cov_inv);
 
-    NumArray prior_mean_dat(getNodeValue(prior_mean_id, graph_, *this));
-    VectorRef prior_mean(prior_mean_dat);
+    Vector prior_mean(getNodeValue(prior_mean_id, graph_, *this));
 
     Vector obs_pred;
     obs_pred = ublas::prod(like_A, prior_mean) + like_b;
     Vector post_mean;
     post_mean = prior_mean + ublas::prod(kalman_gain, (obs - obs_pred));
-    prior_mean.Release();
 
     Matrix post_var;
     post_var = ublas::prod(Matrix(ublas::identity_matrix<Scalar>(dim_node,
                                                                  dim_node)
         - Matrix(ublas::prod(kalman_gain, like_A))), prior_var);
-    prior_var.Release();
 
     NumArray::Array post_param_values(2);
     DimArray dim_mean(1);
@@ -165,7 +158,7 @@ namespace Biips
     post_param_values[1] = NumArray(&dim_cov, &post_var.data());
 
     //allocate memory
-    nodeValuesMap()[nodeId_].reset(new ValArray(node.Dim().Length()));
+    allocValue(node.Dim().Length());
     //sample
     DMNormVar::Instance()->Sample(*nodeValuesMap()[nodeId_],
                                   post_param_values,
@@ -26,7 +26,7 @@ namespace Biips
     NodeId prec_id = *(++it_parents);
     Scalar like_prec = getNodeValue(prec_id, graph_, *this).ScalarView();
     likeParamContribValues[0].ScalarView()
-        += graph_.GetValues()[likeId]->ScalarView() * like_prec;
+        += ObsValues()[likeId]->ScalarView() * like_prec;
     likeParamContribValues[1].ScalarView() += like_prec;
   }
 
@@ -39,7 +39,7 @@ namespace Biips
       graph_.VisitNode(mean_id, get_lin_trans_vis);
 
       prec_ = get_lin_trans_vis.GetA() * prec;
-      mean_ = (graph_.GetValues()[nodeId_]->ScalarView()
+      mean_ = (nodeSampler_.ObsValues()[nodeId_]->ScalarView()
           - get_lin_trans_vis.GetB()) * prec_;
       prec_ *= get_lin_trans_vis.GetA();
     }
@@ -100,7 +100,7 @@ namespace Biips
     post_param_values[1].SetPtr(P_SCALAR_DIM.get(), &post_prec);
 
     //allocate memory
-    nodeValuesMap()[nodeId_].reset(new ValArray(1));
+    allocValue(1);
     //sample
     DNorm::Instance()->Sample(*nodeValuesMap()[nodeId_],
                               post_param_values,
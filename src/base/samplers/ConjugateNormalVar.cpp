@@ -26,7 +26,7 @@ namespace Biips
     NodeId var_id = *(++it_parents);
     Scalar like_var = getNodeValue(var_id, graph_, *this).ScalarView();
     likeParamContribValues[0].ScalarView()
-        += graph_.GetValues()[likeId]->ScalarView() / like_var;
+        += ObsValues()[likeId]->ScalarView() / like_var;
     likeParamContribValues[1].ScalarView() += 1.0 / like_var;
   }
 
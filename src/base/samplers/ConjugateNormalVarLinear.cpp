@@ -39,7 +39,7 @@ namespace Biips
       graph_.VisitNode(mean_id, get_lin_trans_vis);
 
       varInv_ = get_lin_trans_vis.GetA() / var;
-      mean_ = (graph_.GetValues()[nodeId_]->ScalarView()
+      mean_ = (nodeSampler_.ObsValues()[nodeId_]->ScalarView()
           - get_lin_trans_vis.GetB()) * varInv_;
       varInv_ *= get_lin_trans_vis.GetA();
     }
@@ -100,7 +100,7 @@ namespace Biips
     post_param_values[1].SetPtr(P_SCALAR_DIM.get(), &post_var);
 
     //allocate memory
-    nodeValuesMap()[nodeId_].reset(new ValArray(1));
+    allocValue(1);
     //sample
     DNormVar::Instance()->Sample(*nodeValuesMap()[nodeId_],
                                  post_param_values,
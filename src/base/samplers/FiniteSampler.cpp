@@ -19,34 +19,32 @@ namespace Biips
     // Size of the support
     Size size = upper_ - lower_ + 1;
 
-    // temporary node_values and sampled_flags that will be used for the calculations
-    NodeValues node_values;
-    Flags sampled_flags;
-
+    // temporary node values and sampled flags that will be used for the calculations
     NodeSampler node_sampler(graph_);
-    node_sampler.SetMembers(node_values, sampled_flags, pRng_);
+    node_sampler.SetMembers(workValues_, workFlags_, pRng_);
+    node_sampler.SetParamChecker(pParamChecker_);
+    node_sampler.SetLikeTerms(pLikeTerms_);
 
     // prior parameters
     NumArray::Array prior_param_values = getParamValues(nodeId_, graph_, *this);
     NumArray::Pair prior_bound_values = getBoundValues(nodeId_, graph_, *this);
 
     // vector of the posterior probabilities for each value of the support
-    ValArray probas(size);
+    ValArray & probas = probas_;
 
-    ValArray::Ptr k_val(new ValArray(1));
-    NumArray k_num(node.DimPtr().get(), k_val.get());
+    NumArray k_num(node.DimPtr().get(), pKValue_.get());
 
     Scalar max_logprobas = BIIPS_NEGINF;
     for (Size k = 1; k <= size; ++k)
     {
-      // reset node_values and sampled_flags
-      node_values.assign(nodeValuesMap().begin(), nodeValuesMap().end());
-      sampled_flags.assign(sampledFlagsMap().begin(), sampledFlagsMap().end());
+      // reset node values and sampled flags, reusing their storage
+      workValues_.assign(nodeValuesMap().begin(), nodeValuesMap().end());
+      workFlags_.assign(sampledFlagsMap().begin(), sampledFlagsMap().end());
 
       // assign k value to current node
-      k_val->ScalarView() = Scalar(k);
-      node_values[nodeId_] = k_val;
-      sampled_flags[nodeId_] = true;
+      pKValue_->ScalarView() = Scalar(k);
+      workValues_[nodeId_] = pKValue_;
+      workFlags_[nodeId_] = true;
 
       // get log_prior
       Scalar log_prior = node.PriorPtr()->LogDensity(k_num,
@@ -63,6 +61,8 @@ namespace Biips
 
       max_logprobas = std::max(max_logprobas, probas[k - 1]);
     }
+    // release the values of the particle, keeping the capacity
+    workValues_.clear();
 
     //Transform log-proba to probas, avoiding overflow
     Scalar sum_probas = 0;
@@ -84,7 +84,7 @@ namespace Biips
     Scalar ivalue = Scalar(lower_ + gen());
 
     //allocate memory
-    nodeValuesMap()[nodeId_].reset(new ValArray(1, ivalue));
+    allocValue(1)[0] = ivalue;
     sampledFlagsMap()[nodeId_] = true;
 
     // compute log incremental weight
@@ -115,7 +115,7 @@ namespace Biips
       if (!node.Dim().IsScalar())
         return;
 
-      Types<NodeId>::Array par = node.Parents();
+      Types<NodeId>::Array par = node.Parents().ToArray();
       if (node.IsUpperBounded())
         par.pop_back();
       if (node.IsLowerBounded())
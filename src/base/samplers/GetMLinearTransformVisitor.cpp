@@ -81,7 +81,7 @@ namespace Biips
               {
                 NumArray op_val =
                     getNodeValue(operand_id, graph_, nodeSampler_);
-                b_ += VectorRef(op_val);
+                b_ += Vector(op_val);
               }
               break;
             }
@@ -143,7 +143,7 @@ namespace Biips
               NumArray l_op_val = getNodeValue(left_operand_id,
                                                graph_,
                                                nodeSampler_);
-              b_ = VectorRef(l_op_val);
+              b_ = Vector(l_op_val);
             }
             break;
           }
@@ -180,7 +180,7 @@ namespace Biips
               NumArray r_op_val = getNodeValue(left_operand_id,
                                                graph_,
                                                nodeSampler_);
-              b_ -= VectorRef(r_op_val);
+              b_ -= Vector(r_op_val);
             }
             break;
           }
@@ -205,10 +205,7 @@ namespace Biips
       case MAT_MULT:
       {
         NodeId left_operand_id = node.Parents()[0];
-        NumArray l_op_val_marray = getNodeValue(left_operand_id,
-                                                graph_,
-                                                nodeSampler_);
-        MatrixRef l_op_val(l_op_val_marray);
+        Matrix l_op_val(getNodeValue(left_operand_id, graph_, nodeSampler_));
 
         NodeId right_operand_id = node.Parents()[1];
         SelfType get_lin_trans_vis(graph_,
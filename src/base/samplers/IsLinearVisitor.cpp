@@ -10,18 +10,23 @@
 namespace Biips
 {
 
+  static std::map<String, LinearFuncType> makeLinearFuncMap()
+  {
+    std::map<String, LinearFuncType> linear_func_map;
+    linear_func_map[Multiply::Instance()->Name()] = MULTIPLY;
+    linear_func_map[Add::Instance()->Name()] = ADD;
+    linear_func_map[MatMult::Instance()->Name()] = MAT_MULT;
+    linear_func_map[Subtract::Instance()->Name()] = SUBSTRACT;
+    linear_func_map[Divide::Instance()->Name()] = DIVIDE;
+    linear_func_map[Neg::Instance()->Name()] = NEG;
+    return linear_func_map;
+  }
+
   const std::map<String, LinearFuncType> & linearFuncMap()
   {
-    static std::map<String, LinearFuncType> linear_func_map;
-    if (linear_func_map.empty())
-    {
-      linear_func_map[Multiply::Instance()->Name()] = MULTIPLY;
-      linear_func_map[Add::Instance()->Name()] = ADD;
-      linear_func_map[MatMult::Instance()->Name()] = MAT_MULT;
-      linear_func_map[Subtract::Instance()->Name()] = SUBSTRACT;
-      linear_func_map[Divide::Instance()->Name()] = DIVIDE;
-      linear_func_map[Neg::Instance()->Name()] = NEG;
-    }
+    // initialized once, even when samplers are built concurrently
+    static const std::map<String, LinearFuncType> linear_func_map =
+        makeLinearFuncMap();
     return linear_func_map;
   }
 
@@ -38,6 +43,8 @@ namespace Biips
   protected:
     const Graph & graph_;
     NodeId myId_;
+    // answers of the already visited logical nodes
+    std::map<NodeId, Bool> & memo_;
     Bool ans_;
 
     virtual void visit(const ConstantNode & node)
@@ -55,8 +62,8 @@ namespace Biips
       return ans_;
     }
 
-    IsLinearVisitor(const Graph & graph, NodeId myId) :
-      graph_(graph), myId_(myId), ans_(false)
+    IsLinearVisitor(const Graph & graph, NodeId myId, std::map<NodeId, Bool> & memo) :
+      graph_(graph), myId_(myId), memo_(memo), ans_(false)
     {
     }
   };
@@ -70,6 +77,13 @@ namespace Biips
   {
     ans_ = false;
 
+    if (memo_.count(nodeId_))
+    {
+      ans_ = memo_[nodeId_];
+      return;
+    }
+    memo_[nodeId_] = false;
+
     GraphTypes::ParentIterator it_parents, it_parents_end;
     boost::tie(it_parents, it_parents_end) = graph_.GetParents(nodeId_);
 
@@ -79,22 +93,24 @@ namespace Biips
 
     for (Size i = 0; it_parents != it_parents_end; ++it_parents, ++i)
     {
-      SelfType is_linear_vis(graph_, myId_);
-      graph_.VisitNode(*it_parents, is_linear_vis);
-      parents_linear[i] = is_linear_vis.IsLinear();
       NodesRelationType parent_rel = nodesRelation(*it_parents, myId_, graph_);
       if (parent_rel == UNKNOWN)
         return;
       parents_known[i] = (parent_rel == KNOWN);
+      SelfType is_linear_vis(graph_, myId_, memo_);
+      graph_.VisitNode(*it_parents, is_linear_vis);
+      parents_linear[i] = is_linear_vis.IsLinear();
     }
 
     ans_ = node.IsLinear(parents_linear, parents_known);
+    memo_[nodeId_] = ans_;
   }
 
   // nodeB is expected to be a StochasticNode from the nodeSequence
   Bool isLinear(NodeId nodeA, NodeId nodeB, const Graph & graph)
   {
-    IsLinearVisitor vis(graph, nodeB);
+    std::map<NodeId, Bool> memo;
+    IsLinearVisitor vis(graph, nodeB, memo);
     graph.VisitNode(nodeA, vis);
     return vis.IsLinear();
   }
@@ -112,6 +128,8 @@ namespace Biips
   protected:
     const Graph & graph_;
     NodeId myId_;
+    // answers of the already visited logical nodes
+    std::map<NodeId, Bool> & memo_;
     Bool ans_;
 
     virtual void visit(const ConstantNode & node)
@@ -129,8 +147,8 @@ namespace Biips
       return ans_;
     }
 
-    IsScaleVisitor(const Graph & graph, NodeId myId) :
-      graph_(graph), myId_(myId), ans_(false)
+    IsScaleVisitor(const Graph & graph, NodeId myId, std::map<NodeId, Bool> & memo) :
+      graph_(graph), myId_(myId), memo_(memo), ans_(false)
     {
     }
   };
@@ -144,6 +162,13 @@ namespace Biips
   {
     ans_ = false;
 
+    if (memo_.count(nodeId_))
+    {
+      ans_ = memo_[nodeId_];
+      return;
+    }
+    memo_[nodeId_] = false;
+
     GraphTypes::ParentIterator it_parents, it_parents_end;
     boost::tie(it_parents, it_parents_end) = graph_.GetParents(nodeId_);
 
@@ -153,22 +178,24 @@ namespace Biips
 
     for (Size i = 0; it_parents != it_parents_end; ++it_parents, ++i)
     {
-      SelfType is_scale_vis(graph_, myId_);
-      graph_.VisitNode(*it_parents, is_scale_vis);
-      parents_scale[i] = is_scale_vis.IsScale();
       NodesRelationType parent_rel = nodesRelation(*it_parents, myId_, graph_);
       if (parent_rel == UNKNOWN)
         return;
       parents_known[i] = (parent_rel == KNOWN);
+      SelfType is_scale_vis(graph_, myId_, memo_);
+      graph_.VisitNode(*it_parents, is_scale_vis);
+      parents_scale[i] = is_scale_vis.IsScale();
     }
 
     ans_ = node.IsScale(parents_scale, parents_known);
+    memo_[nodeId_] = ans_;
   }
 
   // nodeB is expected to be a StochasticNode from the nodeSequence
   Bool isScale(NodeId nodeA, NodeId nodeB, const Graph & graph)
   {
-    IsScaleVisitor vis(graph, nodeB);
+    std::map<NodeId, Bool> memo;
+    IsScaleVisitor vis(graph, nodeB, memo);
     graph.VisitNode(nodeA, vis);
     return vis.IsScale();
   }
@@ -0,0 +1,79 @@
+#include "AsyncRun.hpp"
+#include "Console.hpp"
+
+#include <chrono>
+
+namespace Biips
+{
+
+  AsyncRun::AsyncRun(Console & console, const TaskType & task) :
+    console_(console), finished_(false), succeeded_(false)
+  {
+    // the worker starts once the members are initialized
+    ++console_.nAsyncRuns_;
+    worker_ = std::thread(&AsyncRun::run, this, task);
+  }
+
+  AsyncRun::~AsyncRun()
+  {
+    join();
+  }
+
+  void AsyncRun::join()
+  {
+    if (!worker_.joinable())
+      return;
+    worker_.join();
+    --console_.nAsyncRuns_;
+  }
+
+  void AsyncRun::run(const TaskType & task)
+  {
+    Bool ok = false;
+    try
+    {
+      ok = task();
+    }
+    catch (...)
+    {
+      // the console reports its own errors,
+      // the others are the failure of the task
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    succeeded_ = ok;
+    finished_ = true;
+    finishedCond_.notify_all();
+  }
+
+  Bool AsyncRun::Finished() const
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return finished_;
+  }
+
+  Bool AsyncRun::Wait()
+  {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      while (!finished_)
+        finishedCond_.wait(lock);
+    }
+    join();
+    return succeeded_;
+  }
+
+  Bool AsyncRun::WaitFor(Scalar seconds)
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    finishedCond_.wait_for(lock, std::chrono::duration<Scalar>(seconds),
+                           [this] { return finished_; });
+    return finished_;
+  }
+
+  void AsyncRun::Cancel()
+  {
+    console_.CancelForwardSampler();
+  }
+
+}
@@ -15,6 +15,7 @@ extern "C"
 #include "compiler/Compiler.hpp"
 #include "iostream/ProgressBar.hpp"
 #include "model/BUGSModel.hpp"
+#include "model/IslandSampler.hpp"
 
 // FIXME to be removed. Manage dynamically loaded modules
 #include "BiipsBase.hpp"
@@ -22,6 +23,7 @@ extern "C"
 #include "compiler/parser_extra.h"
 
 #include <cstdio>
+#include <fstream>
 
 #ifdef BIIPS_DEBUG_PARSER
 #include "printParseTree.hpp"
@@ -106,7 +108,11 @@ namespace Biips
 
   Console::Console(std::ostream & out, std::ostream & err)
       : out_(out), err_(err), pModel_(NULL), pData_(NULL), pRelations_(NULL),
-          pVariables_(NULL), lockBackward_(false)
+          pVariables_(NULL), lockBackward_(false), nAsyncRuns_(0),
+          profiling_(false),
+          lazyEvaluation_(false), unchecked_(false), sqmc_(false),
+          partialLikelihood_(false), singlePrecisionArchives_(false),
+          fixedLag_(0), checkpointPeriod_(0)
   {
   }
 
@@ -265,15 +271,96 @@ namespace Biips
 
   void Console::ClearModel(Size verbosity)
   {
-    if (!pModel_)
+    if (pModel_)
     {
       if (verbosity)
         out_ << PROMPT_STRING << "Deleting model" << endl;
 
       delete pModel_;
+      pModel_ = NULL;
     }
   }
 
+  Bool Console::compileDataGraph(std::map<String, MultiArray> & dataMap,
+                                 Bool clone, Size verbosity)
+  {
+    pModel_ = new BUGSModel(true);
+
+    Compiler compiler(*pModel_, dataMap, clone);
+
+    if (verbosity)
+      out_ << PROMPT_STRING << "Compiling data graph" << endl;
+    if (pVariables_)
+    {
+      if (verbosity)
+        out_ << INDENT_STRING << "Declaring variables" << endl;
+      compiler.DeclareVariables(*pVariables_);
+    }
+    if (verbosity)
+      out_ << INDENT_STRING << "Resolving undeclared variables" << endl;
+    compiler.UndeclaredVariables(pData_);
+
+    if (verbosity)
+      out_ << INDENT_STRING << "Allocating nodes" << endl;
+    compiler.WriteRelations(pData_);
+
+    Graph & data_graph = pModel_->graph();
+    data_graph.Build();
+
+    /* Check validity of data generating model */
+    Types<NodeId>::ConstIterator it_node_id, it_node_id_end;
+    boost::tie(it_node_id, it_node_id_end) = data_graph.GetSortedNodes();
+    for (; it_node_id != it_node_id_end; ++it_node_id)
+    {
+      if (data_graph.GetObserved()[*it_node_id])
+      {
+        GraphTypes::ParentIterator it_parents, it_parents_end;
+        boost::tie(it_parents, it_parents_end) = data_graph.GetParents(
+            *it_node_id);
+        for (; it_parents != it_parents_end; ++it_parents)
+        {
+          if (!data_graph.GetObserved()[*it_parents])
+          {
+            err_ << String("Invalid data graph: observed node ")
+            		+ pModel_->GetSymbolTable().GetName(*it_node_id)
+            		+ " has unobserved parent "
+            		+ pModel_->GetSymbolTable().GetName(*it_parents)
+            		+ "\n";
+            ClearModel();
+            return false;
+          }
+        }
+      }
+    }
+
+    if (verbosity)
+    {
+      out_ << INDENT_STRING << "Graph size: " << data_graph.GetSize();
+      if (verbosity > 1)
+      {
+        out_ << " (Constant: " << data_graph.NodesSummary().at(CONSTANT);
+        out_ << ", Logical: " << data_graph.NodesSummary().at(LOGICAL);
+        out_ << ", Stochastic: " << data_graph.NodesSummary().at(STOCHASTIC)
+             << ")";
+      }
+      out_ << endl;
+      if (verbosity > 1)
+      {
+        Size n_data_unobs_nodes = data_graph.UnobsNodesSummary().at(LOGICAL)
+                                  + data_graph.UnobsNodesSummary().at(
+                                      STOCHASTIC);
+        out_ << INDENT_STRING << "Unobserved nodes: " << n_data_unobs_nodes;
+        out_ << " (Logical: " << data_graph.UnobsNodesSummary().at(LOGICAL);
+        out_ << ", Stochastic: "
+             << data_graph.UnobsNodesSummary().at(STOCHASTIC) << ")"
+             << endl;
+      }
+      out_ << INDENT_STRING << "Sampling data" << endl;
+    }
+
+    return true;
+  }
+
   Bool Console::Compile(std::map<String, MultiArray> & dataMap, Bool genData,
                         Size dataRngSeed, Size verbosity, Bool clone)
   {
@@ -289,81 +376,10 @@ namespace Biips
       // FIXME
       boost::scoped_ptr<Rng> p_datagen_rng(new Rng(dataRngSeed));
 
-      pModel_ = new BUGSModel(true);
-
-      Compiler compiler(*pModel_, dataMap, clone);
-
-      if (verbosity)
-        out_ << PROMPT_STRING << "Compiling data graph" << endl;
       try
       {
-        if (pVariables_)
-        {
-          if (verbosity)
-            out_ << INDENT_STRING << "Declaring variables" << endl;
-          compiler.DeclareVariables(*pVariables_);
-        }
-        if (verbosity)
-          out_ << INDENT_STRING << "Resolving undeclared variables" << endl;
-        compiler.UndeclaredVariables(pData_);
-
-        if (verbosity)
-          out_ << INDENT_STRING << "Allocating nodes" << endl;
-        compiler.WriteRelations(pData_);
-
-        Graph & data_graph = pModel_->graph();
-        data_graph.Build();
-
-        /* Check validity of data generating model */
-        Types<NodeId>::ConstIterator it_node_id, it_node_id_end;
-        boost::tie(it_node_id, it_node_id_end) = data_graph.GetSortedNodes();
-        for (; it_node_id != it_node_id_end; ++it_node_id)
-        {
-          if (data_graph.GetObserved()[*it_node_id])
-          {
-            GraphTypes::ParentIterator it_parents, it_parents_end;
-            boost::tie(it_parents, it_parents_end) = data_graph.GetParents(
-                *it_node_id);
-            for (; it_parents != it_parents_end; ++it_parents)
-            {
-              if (!data_graph.GetObserved()[*it_parents])
-              {
-                err_ << String("Invalid data graph: observed node ")
-                		+ pModel_->GetSymbolTable().GetName(*it_node_id)
-                		+ " has unobserved parent "
-                		+ pModel_->GetSymbolTable().GetName(*it_parents)
-                		+ "\n";
-                ClearModel();
-                return false;
-              }
-            }
-          }
-        }
-
-        if (verbosity)
-        {
-          out_ << INDENT_STRING << "Graph size: " << data_graph.GetSize();
-          if (verbosity > 1)
-          {
-            out_ << " (Constant: " << data_graph.NodesSummary().at(CONSTANT);
-            out_ << ", Logical: " << data_graph.NodesSummary().at(LOGICAL);
-            out_ << ", Stochastic: " << data_graph.NodesSummary().at(STOCHASTIC)
-                 << ")";
-          }
-          out_ << endl;
-          if (verbosity > 1)
-          {
-            Size n_data_unobs_nodes = data_graph.UnobsNodesSummary().at(LOGICAL)
-                                      + data_graph.UnobsNodesSummary().at(
-                                          STOCHASTIC);
-            out_ << INDENT_STRING << "Unobserved nodes: " << n_data_unobs_nodes;
-            out_ << " (Logical: " << data_graph.UnobsNodesSummary().at(LOGICAL);
-            out_ << ", Stochastic: "
-                 << data_graph.UnobsNodesSummary().at(STOCHASTIC) << ")"
-                 << endl;
-          }
-          out_ << INDENT_STRING << "Sampling data" << endl;
-        }
+        if (!compileDataGraph(dataMap, clone, verbosity))
+          return false;
 
         std::map<String, MultiArray> sampled_data_map(
             pModel_->Sample(p_datagen_rng.get()));
@@ -462,6 +478,16 @@ namespace Biips
             out_ << ", Stochastic: "
                  << model_graph.UnobsNodesSummary().at(STOCHASTIC) << ")"
                  << endl;
+
+            GraphMemoryUsage usage = model_graph.MemoryUsage();
+            out_ << INDENT_STRING << "Graph memory: " << usage.Total() / 1024
+                 << " kB (" << usage.Total() / std::max(model_graph.GetSize(), Size(1))
+                 << " bytes per node; nodes: " << usage.nodes / 1024
+                 << " kB, dimensions: " << usage.dims / 1024
+                 << " kB, parents: " << usage.parents / 1024
+                 << " kB, children: " << usage.children / 1024
+                 << " kB, properties: " << usage.properties / 1024
+                 << " kB, lists: " << usage.lists / 1024 << " kB)" << endl;
           }
         }
 
@@ -511,6 +537,7 @@ namespace Biips
       if (verbosity)
         out_ << PROMPT_STRING << "Assigning node samplers" << endl;
 
+      std::lock_guard<std::mutex> lock(samplerMutex_);
       pModel_->BuildSampler();
 
       // TODO
@@ -533,6 +560,15 @@ namespace Biips
   Bool Console::RunForwardSampler(Size nParticles, Size smcRngSeed,
                                   const String & rsType, Scalar essThreshold,
                                   Size verbosity, Bool progressBar)
+  {
+    cancelToken_.Reset();
+    return runForwardSampler(nParticles, smcRngSeed, rsType, essThreshold,
+                             verbosity, progressBar);
+  }
+
+  Bool Console::runForwardSampler(Size nParticles, Size smcRngSeed,
+                                  const String & rsType, Scalar essThreshold,
+                                  Size verbosity, Bool progressBar)
   {
     if (!pModel_)
     {
@@ -569,10 +605,23 @@ namespace Biips
 
       // filtering
 
-      // FIXME
-      boost::scoped_ptr<Rng> p_smc_rng(new Rng(smcRngSeed));
-
-      pModel_->InitSampler(nParticles, p_smc_rng.get(), rsType, essThreshold);
+      SMCIterationInfo info;
+      {
+        SamplerProfile::TimePoint start = SamplerProfile::Now();
+        std::lock_guard<std::mutex> lock(samplerMutex_);
+        // the generator outlives the run to resume it
+        pSmcRng_.reset(new Rng(smcRngSeed));
+
+        profile_.Clear();
+        pModel_->SetProfile(profiling_ ? &profile_ : NULL);
+        setSamplerModes();
+
+        lockBackward_ = true;
+        pModel_->InitSampler(nParticles, pSmcRng_.get(), rsType, essThreshold);
+        info = iterationInfo(0.0, SamplerProfile::Since(start));
+      }
+      // the callback may read the sampler
+      notifyIteration(info);
 
       if (p_show_progress)
         ++(*p_show_progress);
@@ -581,9 +630,10 @@ namespace Biips
 //      else if (verbosity > 1)
 //        printSamplerState(pModel_->Sampler(), out_);
 
-      for (Size n = 1; n < n_iter; ++n)
+      while (!pModel_->Sampler().AtEnd())
       {
-        pModel_->IterateSampler();
+        if (!iterateForwardSampler(progressBar))
+          return false;
 
         if (p_show_progress)
           ++(*p_show_progress);
@@ -600,6 +650,260 @@ namespace Biips
     return true;
   }
 
+  void Console::setSamplerModes()
+  {
+    pModel_->SetLazyEvaluation(lazyEvaluation_);
+    pModel_->SetUnchecked(unchecked_);
+    pModel_->SetSqmc(sqmc_);
+    pModel_->SetLikePDFType(partialLikelihood_ ? PDF_LIKELIHOOD : PDF_FULL);
+    pModel_->SetSinglePrecisionArchives(singlePrecisionArchives_);
+    pModel_->SetFixedLag(fixedLag_);
+  }
+
+  Bool Console::RunIslandSampler(Size nParticles, Size nIslands,
+                                 Size smcRngSeed, const String & rsType,
+                                 Scalar essThreshold,
+                                 Scalar islandEssThreshold, Bool migrate,
+                                 Scalar & logNormConst, Size verbosity)
+  {
+    if (!pModel_)
+    {
+      err_ << "Can't run island sampler. No model!\n";
+      return false;
+    }
+    if (!pModel_->SamplerBuilt())
+    {
+      err_ << "Can't run island sampler. Not built!\n";
+      return false;
+    }
+    if (nAsyncRuns_ > 0)
+    {
+      err_ << "Can't run island sampler. An asynchronous run is live!\n";
+      return false;
+    }
+
+    try
+    {
+      if (verbosity)
+        out_ << PROMPT_STRING << "Running island sampler with " << nParticles
+             << " particles in " << nIslands << " islands" << endl;
+
+      {
+        std::lock_guard<std::mutex> lock(samplerMutex_);
+        // the workers do not share the profile of the console
+        pModel_->SetProfile(NULL);
+        setSamplerModes();
+      }
+
+      IslandSampler islands(*pModel_, nIslands);
+      islands.Run(nParticles, smcRngSeed, rsType, essThreshold,
+                  islandEssThreshold, migrate);
+      logNormConst = islands.LogNormConst();
+
+      if (verbosity)
+        out_ << INDENT_STRING << "island resampling steps = "
+             << islands.NMigrations() << endl;
+    }
+    BIIPS_CONSOLE_CATCH_ERRORS
+
+    return true;
+  }
+
+  Bool Console::iterateForwardSampler(Bool progressBar)
+  {
+    Size t = pModel_->Sampler().Iteration();
+    if (!checkpointFileName_.empty() && checkpointPeriod_ > 0 && t > 0
+        && t % checkpointPeriod_ == 0 && !SaveCheckpoint(checkpointFileName_))
+      return false;
+
+    if (cancelToken_.Requested())
+    {
+      if (progressBar)
+        out_ << endl;
+      if (!checkpointFileName_.empty() && !SaveCheckpoint(checkpointFileName_))
+        return false;
+      err_ << "SMC sampler interrupted after iteration " << t + 1 << " of "
+           << pModel_->Sampler().NIterations() << ".\n";
+      return false;
+    }
+
+    SMCIterationInfo info;
+    {
+      SamplerProfile::TimePoint start = SamplerProfile::Now();
+      std::lock_guard<std::mutex> lock(samplerMutex_);
+      Scalar log_norm_const = pModel_->Sampler().LogNormConst();
+      pModel_->IterateSampler();
+      info = iterationInfo(log_norm_const, SamplerProfile::Since(start));
+    }
+    notifyIteration(info);
+    return true;
+  }
+
+  SMCIterationInfo Console::iterationInfo(Scalar logNormConstBefore,
+                                          Scalar time) const
+  {
+    const ForwardSampler & sampler = pModel_->Sampler();
+    SMCIterationInfo info;
+    info.iteration = sampler.Iteration();
+    info.nIterations = sampler.NIterations();
+    info.ess = sampler.ESS();
+    info.resampled = sampler.Resampled();
+    info.logNormConstIncrement = sampler.LogNormConst() - logNormConstBefore;
+    info.time = time;
+    return info;
+  }
+
+  void Console::notifyIteration(const SMCIterationInfo & info)
+  {
+    if (iterationCallback_)
+      iterationCallback_(info);
+  }
+
+  AsyncRun::Ptr Console::RunForwardSamplerAsync(Size nParticles,
+                                                Size smcRngSeed,
+                                                const String & rsType,
+                                                Scalar essThreshold)
+  {
+    // reset before the worker starts, so that a cancellation requested
+    // as soon as this returns is not lost
+    cancelToken_.Reset();
+    return AsyncRun::Ptr(new AsyncRun(*this, [=]
+    {
+      return runForwardSampler(nParticles, smcRngSeed, rsType, essThreshold,
+                               0, false);
+    }));
+  }
+
+  AsyncRun::Ptr Console::RunBackwardSmootherAsync()
+  {
+    return AsyncRun::Ptr(new AsyncRun(*this, [this]
+    {
+      return RunBackwardSmoother(0, false);
+    }));
+  }
+
+  Bool Console::ResumeForwardSampler(Size verbosity, Bool progressBar)
+  {
+    if (!pModel_)
+    {
+      err_ << "Can't resume SMC sampler. No model!\n";
+      return false;
+    }
+    if (!pModel_->SamplerBuilt() || !pModel_->Sampler().Initialized())
+    {
+      err_ << "Can't resume SMC sampler. Not initialized!\n";
+      return false;
+    }
+
+    try
+    {
+      const ForwardSampler & sampler = pModel_->Sampler();
+      if (verbosity)
+        out_ << PROMPT_STRING << "Resuming SMC forward sampler after iteration "
+             << sampler.Iteration() + 1 << " of " << sampler.NIterations()
+             << " with " << sampler.NParticles() << " particles" << endl;
+
+      if (sampler.AtEnd())
+        return true;
+
+      Types<ProgressBar>::Ptr p_show_progress;
+      if (progressBar)
+        p_show_progress = Types<ProgressBar>::Ptr(
+            new ProgressBar(sampler.NIterations() - sampler.Iteration() - 1,
+                            out_, INDENT_STRING));
+
+      cancelToken_.Reset();
+      {
+        std::lock_guard<std::mutex> lock(samplerMutex_);
+        profile_.Clear();
+        pModel_->SetProfile(profiling_ ? &profile_ : NULL);
+        lockBackward_ = true;
+      }
+
+      while (!sampler.AtEnd())
+      {
+        if (!iterateForwardSampler(progressBar))
+          return false;
+
+        if (p_show_progress)
+          ++(*p_show_progress);
+      }
+
+      lockBackward_ = false;
+    }
+    BIIPS_CONSOLE_CATCH_ERRORS
+
+    return true;
+  }
+
+  Bool Console::SaveCheckpoint(const String & fileName)
+  {
+    if (!pModel_)
+    {
+      err_ << "Can't save checkpoint. No model!\n";
+      return false;
+    }
+    if (!pModel_->SamplerBuilt() || !pModel_->Sampler().Initialized())
+    {
+      err_ << "Can't save checkpoint. SMC sampler did not run!\n";
+      return false;
+    }
+
+    try
+    {
+      // write a temporary file, renamed when complete,
+      // so that an interruption does not corrupt the previous checkpoint
+      String tmp_file_name = fileName + ".tmp";
+      {
+        std::ofstream ofs(tmp_file_name.c_str(), std::ios::binary);
+        if (!ofs)
+          throw RuntimeError(String("Can not open file ") + tmp_file_name);
+        pModel_->SaveSamplerState(ofs);
+        ofs.close();
+        if (!ofs)
+          throw RuntimeError(String("Failed to write file ") + tmp_file_name);
+      }
+      if (std::rename(tmp_file_name.c_str(), fileName.c_str()) != 0)
+        throw RuntimeError(String("Can not rename file ") + tmp_file_name
+                           + " to " + fileName);
+    }
+    BIIPS_CONSOLE_CATCH_ERRORS
+
+    return true;
+  }
+
+  Bool Console::LoadCheckpoint(const String & fileName)
+  {
+    if (!pModel_)
+    {
+      err_ << "Can't load checkpoint. No model!\n";
+      return false;
+    }
+    if (!pModel_->SamplerBuilt())
+    {
+      err_ << "Can't load checkpoint. SMC sampler not built!\n";
+      return false;
+    }
+
+    try
+    {
+      std::ifstream ifs(fileName.c_str(), std::ios::binary);
+      if (!ifs)
+        throw RuntimeError(String("Can not open file ") + fileName);
+
+      Rng::Ptr p_rng(new Rng());
+      // the sampler is not usable if the state is only partially loaded
+      lockBackward_ = true;
+      std::lock_guard<std::mutex> lock(samplerMutex_);
+      pModel_->LoadSamplerState(ifs, p_rng.get());
+      pSmcRng_ = p_rng;
+      lockBackward_ = !pModel_->Sampler().AtEnd();
+    }
+    BIIPS_CONSOLE_CATCH_ERRORS
+
+    return true;
+  }
+
   Bool Console::ForwardSamplerAtEnd()
   {
     return (pModel_ && pModel_->SamplerBuilt() && pModel_->Sampler().AtEnd());
@@ -666,7 +970,11 @@ namespace Biips
         return true;
       }
 
-      pModel_->InitBackwardSmoother();
+      {
+        std::lock_guard<std::mutex> lock(samplerMutex_);
+        pModel_->SetProfile(profiling_ ? &profile_ : NULL);
+        pModel_->InitBackwardSmoother();
+      }
 
       Size n_iter = pModel_->Sampler().NIterations() - 1;
 
@@ -810,6 +1118,34 @@ namespace Biips
     return true;
   }
 
+  Bool Console::SetFixedLagSmoothMonitor(const String & name, const IndexRange & range)
+  {
+    if (!pModel_)
+    {
+      err_ << "Can't set fixed-lag smooth monitor. No model!\n";
+      return false;
+    }
+    // TODO: check that sampler did not start
+
+    try
+    {
+      Bool ok = pModel_->SetFixedLagSmoothMonitor(name, range);
+      if (!ok)
+      {
+    	String msg("Failed to set fixed-lag smooth monitor for variable ");
+    	msg += name;
+    	if (!range.IsNull())
+    	  msg += print(range);
+    	msg += "\n";
+    	err_ << msg;
+    	return false;
+      }
+    }
+    BIIPS_CONSOLE_CATCH_ERRORS
+
+    return true;
+  }
+
   Bool Console::IsFilterMonitored(const String & name, const IndexRange & range,
                                   Bool check_released)
   {
@@ -844,6 +1180,17 @@ namespace Biips
     return pModel_->IsBackwardSmoothMonitored(name, range, check_released);
   }
 
+  Bool Console::IsFixedLagSmoothMonitored(const String & name, const IndexRange & range,
+                                  Bool check_released)
+  {
+    if (!pModel_)
+    {
+      err_ << "Can't check fixed-lag smooth monitor. No model!\n";
+      return false;
+    }
+    return pModel_->IsFixedLagSmoothMonitored(name, range, check_released);
+  }
+
   Bool Console::ClearFilterMonitors(Bool release_only)
   {
     if (!pModel_)
@@ -854,6 +1201,7 @@ namespace Biips
 
     try
     {
+      std::lock_guard<std::mutex> lock(samplerMutex_);
       pModel_->ClearFilterMonitors(release_only);
     }
     BIIPS_CONSOLE_CATCH_ERRORS
@@ -871,6 +1219,7 @@ namespace Biips
 
     try
     {
+      std::lock_guard<std::mutex> lock(samplerMutex_);
       pModel_->ClearGenTreeSmoothMonitors(release_only);
     }
     BIIPS_CONSOLE_CATCH_ERRORS
@@ -888,6 +1237,7 @@ namespace Biips
 
     try
     {
+      std::lock_guard<std::mutex> lock(samplerMutex_);
       pModel_->ClearBackwardSmoothMonitors(release_only);
     }
     BIIPS_CONSOLE_CATCH_ERRORS
@@ -895,6 +1245,34 @@ namespace Biips
     return true;
   }
 
+  Bool Console::ClearFixedLagSmoothMonitors(Bool release_only)
+  {
+    if (!pModel_)
+    {
+      err_ << "Can't clear fixed-lag smooth monitors. No model!\n";
+      return false;
+    }
+
+    try
+    {
+      std::lock_guard<std::mutex> lock(samplerMutex_);
+      pModel_->ClearFixedLagSmoothMonitors(release_only);
+    }
+    BIIPS_CONSOLE_CATCH_ERRORS
+
+    return true;
+  }
+
+  void Console::releaseSamplerMonitors()
+  {
+    lockBackward_ = true;
+    pModel_->ClearFilterMonitors(true);
+    pModel_->ClearGenTreeSmoothMonitors(true);
+    pModel_->ClearFixedLagSmoothMonitors(true);
+    if (pModel_->SmootherInitialized())
+      pModel_->ClearBackwardSmoothMonitors(true);
+  }
+
   Bool Console::ExtractFilterStat(const String & name, StatTag statFeature,
                                   std::map<IndexRange, MultiArray> & statMap)
   {
@@ -903,20 +1281,51 @@ namespace Biips
       err_ << "Can't extract filter statistic. No model!\n";
       return false;
     }
-    if (!pModel_->SamplerBuilt())
-    {
-      err_ << "Can't extract filter statistic. SMC sampler not built!\n";
-      return false;
-    }
-    if (!pModel_->Sampler().AtEnd())
-    {
-      err_ << "Can't extract filter statistic. SMC sampler still running!\n";
-      return false;
-    }
+    if (!pModel_->SamplerBuilt())
+    {
+      err_ << "Can't extract filter statistic. SMC sampler not built!\n";
+      return false;
+    }
+    // the island sampler fills the monitors without running the sampler
+    if (pModel_->Sampler().Initialized() && !pModel_->Sampler().AtEnd())
+    {
+      err_ << "Can't extract filter statistic. SMC sampler still running!\n";
+      return false;
+    }
+
+    try
+    {
+      Bool ok = pModel_->ExtractFilterStat(name, statFeature, statMap);
+      if (!ok)
+      {
+        err_ << String("Failed to extract filter statistic for variable ") + name + "\n";
+        return false;
+      }
+    }
+    BIIPS_CONSOLE_CATCH_ERRORS
+
+    return true;
+  }
+
+  Bool Console::ExtractSampledFilterStat(const String & name,
+                                         StatTag statFeature,
+                                         std::map<IndexRange, MultiArray> & statMap)
+  {
+    if (!pModel_)
+    {
+      err_ << "Can't extract filter statistic. No model!\n";
+      return false;
+    }
 
     try
     {
-      Bool ok = pModel_->ExtractFilterStat(name, statFeature, statMap);
+      std::lock_guard<std::mutex> lock(samplerMutex_);
+      if (!pModel_->SamplerBuilt() || !pModel_->Sampler().Initialized())
+      {
+        err_ << "Can't extract filter statistic. SMC sampler did not run!\n";
+        return false;
+      }
+      Bool ok = pModel_->ExtractSampledFilterStat(name, statFeature, statMap);
       if (!ok)
       {
         err_ << String("Failed to extract filter statistic for variable ") + name + "\n";
@@ -997,6 +1406,69 @@ namespace Biips
     return true;
   }
 
+  Bool Console::ExtractFixedLagSmoothStat(const String & name, StatTag statFeature,
+                                  std::map<IndexRange, MultiArray> & statMap)
+  {
+    if (!pModel_)
+    {
+      err_ << "Can't extract fixed-lag smoother statistic. No model!\n";
+      return false;
+    }
+    if (!pModel_->SamplerBuilt())
+    {
+      err_ << "Can't extract fixed-lag smoother statistic. SMC sampler not built!\n";
+      return false;
+    }
+    if (!pModel_->Sampler().AtEnd())
+    {
+      err_ << "Can't extract fixed-lag smoother statistic. SMC sampler still running!\n";
+      return false;
+    }
+
+    try
+    {
+      Bool ok = pModel_->ExtractFixedLagSmoothStat(name, statFeature, statMap);
+      if (!ok)
+      {
+        err_ << String("Failed to extract fixed-lag smoother statistic for variable ") + name + "\n";
+        return false;
+      }
+    }
+    BIIPS_CONSOLE_CATCH_ERRORS
+
+    return true;
+  }
+
+  Bool Console::DrainFixedLagSmoothStat(const String & name,
+                                        StatTag statFeature,
+                                        std::map<IndexRange, MultiArray> & statMap)
+  {
+    if (!pModel_)
+    {
+      err_ << "Can't drain fixed-lag smoother statistic. No model!\n";
+      return false;
+    }
+
+    try
+    {
+      std::lock_guard<std::mutex> lock(samplerMutex_);
+      if (!pModel_->SamplerBuilt() || !pModel_->Sampler().Initialized())
+      {
+        err_ << "Can't drain fixed-lag smoother statistic. SMC sampler did not run!\n";
+        return false;
+      }
+      Bool ok = pModel_->DrainFixedLagSmoothStat(name, statFeature, statMap);
+      if (!ok)
+      {
+        err_ << String("Failed to drain fixed-lag smoother statistic for variable ") + name + "\n";
+        return false;
+      }
+    }
+    BIIPS_CONSOLE_CATCH_ERRORS
+
+    return true;
+  }
+
   Bool Console::ExtractFilterPdf(const String & name,
                                  std::map<IndexRange, Histogram> & pdfMap,
                                  Size numBins, Scalar cacheFraction)
@@ -1101,6 +1573,40 @@ namespace Biips
     return true;
   }
 
+  Bool Console::ExtractFixedLagSmoothPdf(const String & name,
+                                 std::map<IndexRange, Histogram> & pdfMap,
+                                 Size numBins, Scalar cacheFraction)
+  {
+    if (!pModel_)
+    {
+      err_ << "Can't extract fixed-lag smooth pdf. No model!\n";
+      return false;
+    }
+    if (!pModel_->SamplerBuilt())
+    {
+      err_ << "Can't extract fixed-lag smooth pdf. SMC sampler not built!\n";
+      return false;
+    }
+    if (!pModel_->Sampler().AtEnd())
+    {
+      err_ << "Can't extract fixed-lag smooth pdf. SMC sampler still running!\n";
+      return false;
+    }
+
+    try
+    {
+      Bool ok = pModel_->ExtractFixedLagSmoothPdf(name, pdfMap, numBins, cacheFraction);
+      if (!ok)
+      {
+        err_ << String("Failed to extract fixed-lag smooth pdf for variable ") + name + "\n";
+        return false;
+      }
+    }
+    BIIPS_CONSOLE_CATCH_ERRORS
+
+    return true;
+  }
+
   Bool Console::DumpData(std::map<String, MultiArray> & dataMap)
   {
     if (!pModel_)
@@ -1155,6 +1661,7 @@ namespace Biips
       }
       Bool rebuild_sampler;
 
+      std::lock_guard<std::mutex> lock(samplerMutex_);
       if (!pModel_->ChangeData(variable, range, data, rebuild_sampler, mcmc))
       {
         //err_ << "Failed to change data.\n";
@@ -1163,11 +1670,7 @@ namespace Biips
       if (pModel_->SamplerBuilt() && rebuild_sampler)
         pModel_->ClearSampler();
 
-      lockBackward_ = true;
-      ClearFilterMonitors(true);
-      ClearGenTreeSmoothMonitors(true);
-      if (pModel_->SmootherInitialized())
-        ClearBackwardSmoothMonitors(true);
+      releaseSamplerMonitors();
     }
     BIIPS_CONSOLE_CATCH_ERRORS
 
@@ -1209,6 +1712,7 @@ namespace Biips
       // FIXME
       boost::scoped_ptr<Rng> p_rng(new Rng(rngSeed));
 
+      std::lock_guard<std::mutex> lock(samplerMutex_);
       if (!pModel_->SampleData(variable, range, data, p_rng.get()))
       {
         err_ << "Failed to sample data.\n";
@@ -1217,17 +1721,46 @@ namespace Biips
       if (pModel_->SamplerBuilt())
         pModel_->ClearSampler();
 
-      lockBackward_ = true;
-      ClearFilterMonitors(true);
-      ClearGenTreeSmoothMonitors(true);
-      if (pModel_->SmootherInitialized())
-        ClearBackwardSmoothMonitors(true);
+      releaseSamplerMonitors();
     }
     BIIPS_CONSOLE_CATCH_ERRORS
 
     return true;
   }
 
+  Bool Console::SampleDataBatch(DataBatch::Ptr & pBatch,
+                                std::map<String, MultiArray> & dataMap,
+                                Size nDatasets, Size dataRngSeed,
+                                Size nThreads, Size verbosity, Bool clone)
+  {
+    if (!pData_)
+    {
+      err_ << "Can't sample data. No data generating model!\n";
+      return false;
+    }
+    if (pModel_)
+    {
+      if (verbosity)
+        out_ << PROMPT_STRING << "Replacing existing model" << endl;
+      ClearModel();
+    }
+
+    try
+    {
+      if (!compileDataGraph(dataMap, clone, verbosity))
+        return false;
+
+      if (verbosity)
+        out_ << INDENT_STRING << "Datasets: " << nDatasets << endl;
+      pBatch = pModel_->SampleBatch(nDatasets, dataRngSeed, nThreads);
+
+      ClearModel(0);
+    }
+    BIIPS_CONSOLE_CATCH_ERRORS_DELETE_MODEL
+
+    return true;
+  }
+
   Bool Console::RemoveData(const String & variable, const IndexRange & range,
                            Size verbosity)
   {
@@ -1259,6 +1792,7 @@ namespace Biips
       {
         out_ << PROMPT_STRING << "Removing data" << endl;
       }
+      std::lock_guard<std::mutex> lock(samplerMutex_);
       if (!pModel_->RemoveData(variable, range))
       {
         err_ << "Failed to remove data.\n";
@@ -1267,19 +1801,16 @@ namespace Biips
       if (pModel_->SamplerBuilt())
         pModel_->ClearSampler();
 
-      lockBackward_ = true;
-      ClearFilterMonitors(true);
-      ClearGenTreeSmoothMonitors(true);
-      if (pModel_->SmootherInitialized())
-        ClearBackwardSmoothMonitors(true);
+      releaseSamplerMonitors();
     }
     BIIPS_CONSOLE_CATCH_ERRORS
 
     return true;
   }
 
-  Bool Console::DumpFilterMonitors(
-      std::map<String, NodeArrayMonitor> & particlesMap)
+  template<typename MonitorType>
+  Bool Console::dumpFilterMonitors(
+      std::map<String, MonitorType> & particlesMap)
   {
 
     if (!pModel_)
@@ -1312,8 +1843,9 @@ namespace Biips
     return true;
   }
 
-  Bool Console::DumpGenTreeSmoothMonitors(
-      std::map<String, NodeArrayMonitor> & particlesMap)
+  template<typename MonitorType>
+  Bool Console::dumpGenTreeSmoothMonitors(
+      std::map<String, MonitorType> & particlesMap)
   {
     if (!pModel_)
     {
@@ -1345,8 +1877,9 @@ namespace Biips
     return true;
   }
 
-  Bool Console::DumpBackwardSmoothMonitors(
-      std::map<String, NodeArrayMonitor> & particlesMap)
+  template<typename MonitorType>
+  Bool Console::dumpBackwardSmoothMonitors(
+      std::map<String, MonitorType> & particlesMap)
   {
     if (!pModel_)
     {
@@ -1378,6 +1911,89 @@ namespace Biips
     return true;
   }
 
+  template<typename MonitorType>
+  Bool Console::dumpFixedLagSmoothMonitors(
+      std::map<String, MonitorType> & particlesMap)
+  {
+
+    if (!pModel_)
+    {
+      err_ << "Can't dump fixed-lag smooth monitors. No model!\n";
+      return false;
+    }
+    if (!pModel_->SamplerBuilt())
+    {
+      err_ << "Can't dump fixed-lag smooth monitors. SMC sampler not built!\n";
+      return false;
+    }
+    if (!pModel_->Sampler().AtEnd())
+    {
+      err_ << "Can't dump fixed-lag smooth monitors. SMC sampler still running!\n";
+      return false;
+    }
+
+    try
+    {
+      Bool ok = pModel_->DumpFixedLagSmoothMonitors(particlesMap);
+      if (!ok)
+      {
+        err_ << "Failed to dump fixed-lag smooth monitors.\n";
+        return false;
+      }
+    }
+    BIIPS_CONSOLE_CATCH_ERRORS
+
+    return true;
+  }
+  Bool Console::DumpFilterMonitors(
+      std::map<String, NodeArrayMonitor> & particlesMap)
+  {
+    return dumpFilterMonitors(particlesMap);
+  }
+
+  Bool Console::DumpFilterMonitors(
+      std::map<String, NodeArrayMonitorExport> & particlesMap)
+  {
+    return dumpFilterMonitors(particlesMap);
+  }
+
+  Bool Console::DumpGenTreeSmoothMonitors(
+      std::map<String, NodeArrayMonitor> & particlesMap)
+  {
+    return dumpGenTreeSmoothMonitors(particlesMap);
+  }
+
+  Bool Console::DumpGenTreeSmoothMonitors(
+      std::map<String, NodeArrayMonitorExport> & particlesMap)
+  {
+    return dumpGenTreeSmoothMonitors(particlesMap);
+  }
+
+  Bool Console::DumpBackwardSmoothMonitors(
+      std::map<String, NodeArrayMonitor> & particlesMap)
+  {
+    return dumpBackwardSmoothMonitors(particlesMap);
+  }
+
+  Bool Console::DumpBackwardSmoothMonitors(
+      std::map<String, NodeArrayMonitorExport> & particlesMap)
+  {
+    return dumpBackwardSmoothMonitors(particlesMap);
+  }
+
+  Bool Console::DumpFixedLagSmoothMonitors(
+      std::map<String, NodeArrayMonitor> & particlesMap)
+  {
+    return dumpFixedLagSmoothMonitors(particlesMap);
+  }
+
+  Bool Console::DumpFixedLagSmoothMonitors(
+      std::map<String, NodeArrayMonitorExport> & particlesMap)
+  {
+    return dumpFixedLagSmoothMonitors(particlesMap);
+  }
+
+
   Bool Console::SampleGenTreeSmoothParticle(Size rngSeed, std::map<String, MultiArray> & sampledValueMap)
   {
     if (!pModel_)
@@ -1413,6 +2029,48 @@ namespace Biips
     return true;
   }
 
+  Bool Console::SampleGenTreeSmoothParticles(Size nTrajectories, Size rngSeed,
+                                             std::map<String, MultiArray> & sampledValueMap,
+                                             Size nThreads)
+  {
+    if (!pModel_)
+    {
+      err_ << "Can't sample smooth particles. No model!\n";
+      return false;
+    }
+    if (!pModel_->SamplerBuilt())
+    {
+      err_ << "Can't sample smooth particles. SMC sampler not built!\n";
+      return false;
+    }
+    if (!pModel_->Sampler().AtEnd())
+    {
+      err_ << "Can't sample smooth particles. SMC sampler still running!\n";
+      return false;
+    }
+    if (nTrajectories == 0)
+    {
+      err_ << "Can't sample smooth particles. Number of trajectories must be positive!\n";
+      return false;
+    }
+
+    try
+    {
+      Rng rng(rngSeed);
+
+      Bool ok = pModel_->SampleGenTreeSmoothParticles(&rng, nTrajectories,
+                                                      sampledValueMap, nThreads);
+      if (!ok)
+      {
+        err_ << "Failed to sample smooth particles.\n";
+        return false;
+      }
+    }
+    BIIPS_CONSOLE_CATCH_ERRORS
+
+    return true;
+  }
+
 
   Bool Console::PrintGraphviz(std::ostream & os)
   {
@@ -1430,6 +2088,51 @@ namespace Biips
     return true;
   }
 
+  Bool Console::FreezeGraph()
+  {
+    if (!pModel_)
+    {
+      err_ << "Can't freeze graph. No model!\n";
+      return false;
+    }
+    try
+    {
+      pModel_->graph().Freeze();
+    }
+    BIIPS_CONSOLE_CATCH_ERRORS
+
+    return true;
+  }
+
+  Bool Console::OpenSession(const Console & compiled,
+                            const std::map<String, MultiArray> & dataMap,
+                            Size verbosity)
+  {
+    if (!compiled.pModel_)
+    {
+      err_ << "Can't open session. No model!\n";
+      return false;
+    }
+
+    ClearModel(verbosity);
+    try
+    {
+      pModel_ = new BUGSModel(compiled.pModel_->GraphPtr(),
+                              compiled.pModel_->SymbolTablePtr());
+      nodeArrayNames_ = compiled.nodeArrayNames_;
+
+      if (!dataMap.empty())
+      {
+        if (verbosity)
+          out_ << PROMPT_STRING << "Setting session data" << endl;
+        pModel_->SetObsData(dataMap);
+      }
+    }
+    BIIPS_CONSOLE_CATCH_ERRORS_DELETE_MODEL
+
+    return true;
+  }
+
   Bool Console::DumpNodeIds(Types<NodeId>::Array & nodeIds)
   {
     if (!pModel_)
@@ -1607,6 +2310,25 @@ namespace Biips
     return true;
   }
 
+  Bool Console::DumpProfile(std::ostream & os, Bool traceEvents)
+  {
+    if (profile_.Iterations().empty())
+    {
+      err_ << "Can't dump profile. No profiled SMC run!\n";
+      return false;
+    }
+    try
+    {
+      if (traceEvents)
+        profile_.PrintTraceEvents(os);
+      else
+        profile_.PrintJson(os);
+    }
+    BIIPS_CONSOLE_CATCH_ERRORS
+
+    return true;
+  }
+
   Bool Console::GraphSize(Size & s)
   {
     if (!pModel_)
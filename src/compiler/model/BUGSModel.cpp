@@ -2,10 +2,67 @@
 #include "common/IndexRangeIterator.hpp"
 #include <boost/random/discrete_distribution.hpp>
 #include <boost/random/variate_generator.hpp>
+#include <boost/random/seed_seq.hpp>
+#include <thread>
+#include <mutex>
+#include <exception>
+#include <algorithm>
 
 namespace Biips
 {
 
+  BUGSModel::BUGSModel(const boost::shared_ptr<Graph> & pGraph,
+                       const boost::shared_ptr<SymbolTable> & pSymbolTable)
+      : BaseType(pGraph), pSymbolTable_(pSymbolTable)
+  {
+    if (!pGraph_->IsFrozen())
+      throw LogicError("Can not share the model: the graph is not frozen.");
+  }
+
+  void BUGSModel::SetObsData(const std::map<String, MultiArray> & dataMap)
+  {
+    std::map<NodeId, ValArray::Ptr> obs_values;
+
+    std::map<String, MultiArray>::const_iterator it_data = dataMap.begin();
+    for (; it_data != dataMap.end(); ++it_data)
+    {
+      const String & name = it_data->first;
+      const MultiArray & data = it_data->second;
+      if (!pSymbolTable_->Contains(name))
+        throw RuntimeError(String("Can not set data: variable ") + name
+                           + " does not exist.");
+
+      const NodeArray & node_array = pSymbolTable_->GetNodeArray(name);
+      if (data.Dim().Drop() != node_array.Range().Dim(true))
+        throw RuntimeError(String("Dimension mismatch when setting data of variable ")
+                           + name);
+
+      const boost::bimap<NodeId, IndexRange> & node_id_range_bimap =
+          node_array.NodeIdRangeBimap();
+      for (boost::bimap<NodeId, IndexRange>::const_iterator it =
+          node_id_range_bimap.begin(); it != node_id_range_bimap.end(); ++it)
+      {
+        NodeId id = it->left;
+        if (!pGraph_->GetObserved()[id]
+            || pGraph_->GetNode(id).GetType() != STOCHASTIC)
+          continue;
+
+        ValArray::Ptr p_value(new ValArray(it->right.Length()));
+        Size k = 0;
+        for (IndexRangeIterator it_range(it->right); !it_range.AtEnd();
+            it_range.Next(), ++k)
+          (*p_value)[k] = data.Values()[node_array.Range().GetOffset(it_range)];
+
+        // only the changed values are overridden
+        const ValArray & graph_value = *pGraph_->GetValues()[id];
+        if (!std::equal(p_value->begin(), p_value->end(), graph_value.begin()))
+          obs_values[id] = p_value;
+      }
+    }
+
+    SetObsValues(obs_values);
+  }
+
   std::map<String, MultiArray> BUGSModel::Sample(Rng * pRng) const
   {
     // Sample values
@@ -18,7 +75,7 @@ namespace Biips
     for (NodeId node_id = 0; node_id < sampled_values.size(); ++node_id)
     {
       // check if the node is named, i.e. is in the symbol table
-      if (!symbolTable_.Contains(node_id))
+      if (!pSymbolTable_->Contains(node_id))
         continue;
 
       // check if the node is not constant
@@ -27,12 +84,12 @@ namespace Biips
 
       // search the name of the node corresponding to the id
       // in the symbol table
-      const String & var_name = symbolTable_.GetVariableName(node_id);
+      const String & var_name = pSymbolTable_->GetVariableName(node_id);
 
       // if the var_name key does not exist
       // create a MultiArray of the corresponding size
       // initialized with BIIPS_REALNA
-      const NodeArray & node_array = symbolTable_.GetNodeArray(var_name);
+      const NodeArray & node_array = pSymbolTable_->GetNodeArray(var_name);
       if (!data_table.count(var_name))
       {
         DimArray::Ptr p_dim = node_array.Range().DimPtr();
@@ -62,26 +119,123 @@ namespace Biips
     return data_table;
   }
 
+  DataBatch::Ptr BUGSModel::SampleBatch(Size nDatasets, Size seed,
+                                        Size nThreads) const
+  {
+    // same variables as Sample: the named nodes that are not constant
+    std::map<String, DimArray::Ptr> var_dims;
+    Types<NodeId>::Array node_ids;
+    Types<String>::Array node_vars;
+    Types<Types<Size>::Array>::Array node_offsets;
+    for (NodeId node_id = 0; node_id < pGraph_->GetSize(); ++node_id)
+    {
+      if (!pSymbolTable_->Contains(node_id))
+        continue;
+      if (pGraph_->GetNode(node_id).GetType() == CONSTANT)
+        continue;
+
+      const String & var_name = pSymbolTable_->GetVariableName(node_id);
+      const NodeArray & node_array = pSymbolTable_->GetNodeArray(var_name);
+      var_dims[var_name] = node_array.Range().DimPtr();
+
+      IndexRange range = node_array.GetRange(node_id);
+      Types<Size>::Array offsets;
+      for (IndexRangeIterator it_range(range); !it_range.AtEnd();
+          it_range.Next())
+        offsets.push_back(node_array.Range().GetOffset(it_range));
+
+      node_ids.push_back(node_id);
+      node_vars.push_back(var_name);
+      node_offsets.push_back(offsets);
+    }
+
+    DataBatch::Ptr p_batch(new DataBatch(var_dims, nDatasets));
+    for (Size i = 0; i < node_ids.size(); ++i)
+    {
+      Size var_offset = p_batch->Offset(node_vars[i]);
+      for (Size k = 0; k < node_offsets[i].size(); ++k)
+        node_offsets[i][k] += var_offset;
+    }
+
+    if (nThreads == 0)
+      nThreads = std::max(1u, std::thread::hardware_concurrency());
+    nThreads = std::min(nThreads, nDatasets);
+
+    // the first error of the workers is thrown once they are joined
+    std::exception_ptr p_error;
+    std::mutex error_mutex;
+
+    auto sample_datasets = [&](Size first)
+    {
+      try
+      {
+        Rng rng;
+        for (Size m = first; m < nDatasets; m += nThreads)
+        {
+          boost::random::seed_seq seq( { Size(seed), m });
+          rng.GetGen().seed(seq);
+
+          NodeValues sampled_values = pGraph_->SampleValues(&rng);
+
+          Scalar * p_dataset = p_batch->Dataset(m);
+          for (Size i = 0; i < node_ids.size(); ++i)
+          {
+            const ValArray & values = *sampled_values[node_ids[i]];
+            if (values.size() != node_offsets[i].size())
+              throw RuntimeError(String("Dimension of sampled values for Node ")
+                                 + print(node_ids[i]) + " mismatch.");
+            for (Size k = 0; k < values.size(); ++k)
+              p_dataset[node_offsets[i][k]] = values[k];
+          }
+
+          std::lock_guard<std::mutex> lock(error_mutex);
+          if (p_error)
+            break;
+        }
+      }
+      catch (...)
+      {
+        std::lock_guard<std::mutex> lock(error_mutex);
+        if (!p_error)
+          p_error = std::current_exception();
+      }
+    };
+
+    Types<std::thread>::Array workers;
+    for (Size t = 1; t < nThreads; ++t)
+      workers.push_back(std::thread(sample_datasets, t));
+    // the calling thread is one of the workers
+    if (nThreads > 0)
+      sample_datasets(0);
+    for (Size t = 0; t < workers.size(); ++t)
+      workers[t].join();
+
+    if (p_error)
+      std::rethrow_exception(p_error);
+
+    return p_batch;
+  }
+
   Bool BUGSModel::SetFilterMonitor(const String & name,
                                    const IndexRange & range)
   {
     // TODO use Monitor Factory
 
-    if (!symbolTable_.Contains(name))
+    if (!pSymbolTable_->Contains(name))
       return false;
 
     IndexRange range_valid;
     if (range.IsNull())
-      range_valid = symbolTable_.GetNodeArray(name).Range();
+      range_valid = pSymbolTable_->GetNodeArray(name).Range();
     else
     {
-      if (!symbolTable_.GetNodeArray(name).Range().Contains(range))
+      if (!pSymbolTable_->GetNodeArray(name).Range().Contains(range))
         return false;
       range_valid = range;
     }
 
     const boost::bimap<NodeId, IndexRange> & node_id_range_bimap =
-        symbolTable_.GetNodeArray(name).NodeIdRangeBimap();
+        pSymbolTable_->GetNodeArray(name).NodeIdRangeBimap();
 
     for (boost::bimap<NodeId, IndexRange>::const_iterator it =
         node_id_range_bimap.begin(); it != node_id_range_bimap.end(); ++it)
@@ -104,21 +258,21 @@ namespace Biips
   {
     // TODO use Monitor Factory
 
-    if (!symbolTable_.Contains(name))
+    if (!pSymbolTable_->Contains(name))
       return false;
 
     IndexRange range_valid;
     if (range.IsNull())
-      range_valid = symbolTable_.GetNodeArray(name).Range();
+      range_valid = pSymbolTable_->GetNodeArray(name).Range();
     else
     {
-      if (!symbolTable_.GetNodeArray(name).Range().Contains(range))
+      if (!pSymbolTable_->GetNodeArray(name).Range().Contains(range))
         return false;
       range_valid = range;
     }
 
     const boost::bimap<NodeId, IndexRange> & node_id_range_bimap =
-        symbolTable_.GetNodeArray(name).NodeIdRangeBimap();
+        pSymbolTable_->GetNodeArray(name).NodeIdRangeBimap();
 
     for (boost::bimap<NodeId, IndexRange>::const_iterator it =
         node_id_range_bimap.begin(); it != node_id_range_bimap.end(); ++it)
@@ -140,21 +294,21 @@ namespace Biips
   {
     // TODO use Monitor Factory
 
-    if (!symbolTable_.Contains(name))
+    if (!pSymbolTable_->Contains(name))
       return false;
 
     IndexRange range_valid;
     if (range.IsNull())
-      range_valid = symbolTable_.GetNodeArray(name).Range();
+      range_valid = pSymbolTable_->GetNodeArray(name).Range();
     else
     {
-      if (!symbolTable_.GetNodeArray(name).Range().Contains(range))
+      if (!pSymbolTable_->GetNodeArray(name).Range().Contains(range))
         return false;
       range_valid = range;
     }
 
     const boost::bimap<NodeId, IndexRange> & node_id_range_bimap =
-        symbolTable_.GetNodeArray(name).NodeIdRangeBimap();
+        pSymbolTable_->GetNodeArray(name).NodeIdRangeBimap();
 
     for (boost::bimap<NodeId, IndexRange>::const_iterator it =
         node_id_range_bimap.begin(); it != node_id_range_bimap.end(); ++it)
@@ -171,19 +325,55 @@ namespace Biips
     return true;
   }
 
+  Bool BUGSModel::SetFixedLagSmoothMonitor(const String & name,
+                                   const IndexRange & range)
+  {
+    // TODO use Monitor Factory
+
+    if (!pSymbolTable_->Contains(name))
+      return false;
+
+    IndexRange range_valid;
+    if (range.IsNull())
+      range_valid = pSymbolTable_->GetNodeArray(name).Range();
+    else
+    {
+      if (!pSymbolTable_->GetNodeArray(name).Range().Contains(range))
+        return false;
+      range_valid = range;
+    }
+
+    const boost::bimap<NodeId, IndexRange> & node_id_range_bimap =
+        pSymbolTable_->GetNodeArray(name).NodeIdRangeBimap();
+
+    for (boost::bimap<NodeId, IndexRange>::const_iterator it =
+        node_id_range_bimap.begin(); it != node_id_range_bimap.end(); ++it)
+    {
+      if (!range_valid.Overlaps(it->right))
+        continue;
+
+      BaseType::SetFixedLagSmoothMonitor(it->left);
+    }
+
+    fixedLagSmoothMonitorsNames_.push_back(name);
+    fixedLagSmoothMonitorsRanges_.push_back(range);
+
+    return true;
+  }
+
   Bool BUGSModel::IsFilterMonitored(const String & name, IndexRange range, Bool check_released) const
   {
-    if (!symbolTable_.Contains(name))
+    if (!pSymbolTable_->Contains(name))
       return false;
 
     if (range.IsNull())
-      range = symbolTable_.GetNodeArray(name).Range();
-    else if (!symbolTable_.GetNodeArray(name).Range().Contains(range))
+      range = pSymbolTable_->GetNodeArray(name).Range();
+    else if (!pSymbolTable_->GetNodeArray(name).Range().Contains(range))
       throw LogicError(String("IsFilterMonitored: range ") + print(range)
                        + " is not contained in variable " + name);
 
     const boost::bimap<NodeId, IndexRange> & node_id_range_bimap =
-        symbolTable_.GetNodeArray(name).NodeIdRangeBimap();
+        pSymbolTable_->GetNodeArray(name).NodeIdRangeBimap();
 
     for (boost::bimap<NodeId, IndexRange>::const_iterator it =
         node_id_range_bimap.begin(); it != node_id_range_bimap.end(); ++it)
@@ -208,17 +398,17 @@ namespace Biips
   Bool BUGSModel::IsGenTreeSmoothMonitored(const String & name,
                                            IndexRange range, Bool check_released) const
   {
-    if (!symbolTable_.Contains(name))
+    if (!pSymbolTable_->Contains(name))
       return false;
 
     if (range.IsNull())
-      range = symbolTable_.GetNodeArray(name).Range();
-    else if (!symbolTable_.GetNodeArray(name).Range().Contains(range))
+      range = pSymbolTable_->GetNodeArray(name).Range();
+    else if (!pSymbolTable_->GetNodeArray(name).Range().Contains(range))
       throw LogicError(String("IsGenTreeSmoothMonitored: range ") + print(range)
                        + " is not contained in variable " + name);
 
     const boost::bimap<NodeId, IndexRange> & node_id_range_bimap =
-        symbolTable_.GetNodeArray(name).NodeIdRangeBimap();
+        pSymbolTable_->GetNodeArray(name).NodeIdRangeBimap();
 
     for (boost::bimap<NodeId, IndexRange>::const_iterator it =
         node_id_range_bimap.begin(); it != node_id_range_bimap.end(); ++it)
@@ -231,7 +421,7 @@ namespace Biips
       if (!check_released)
         continue;
 
-      if (!pGenTreeSmoothMonitor_ || pGenTreeSmoothMonitor_->Contains(it->left))
+      if (!pGenTreeSmoothMonitor_ || !pGenTreeSmoothMonitor_->Contains(it->left))
         return false;
     }
 
@@ -240,17 +430,17 @@ namespace Biips
 
   Bool BUGSModel::IsBackwardSmoothMonitored(const String & name, IndexRange range, Bool check_released) const
   {
-    if (!symbolTable_.Contains(name))
+    if (!pSymbolTable_->Contains(name))
       return false;
 
     if (range.IsNull())
-      range = symbolTable_.GetNodeArray(name).Range();
-    else if (!symbolTable_.GetNodeArray(name).Range().Contains(range))
+      range = pSymbolTable_->GetNodeArray(name).Range();
+    else if (!pSymbolTable_->GetNodeArray(name).Range().Contains(range))
       throw LogicError(String("IsBackwardSmoothMonitored: range ") + print(range)
                        + " is not contained in variable " + name);
 
     const boost::bimap<NodeId, IndexRange> & node_id_range_bimap =
-        symbolTable_.GetNodeArray(name).NodeIdRangeBimap();
+        pSymbolTable_->GetNodeArray(name).NodeIdRangeBimap();
 
     for (boost::bimap<NodeId, IndexRange>::const_iterator it =
         node_id_range_bimap.begin(); it != node_id_range_bimap.end(); ++it)
@@ -273,6 +463,39 @@ namespace Biips
     return true;
   }
 
+  Bool BUGSModel::IsFixedLagSmoothMonitored(const String & name,
+                                            IndexRange range, Bool check_released) const
+  {
+    if (!pSymbolTable_->Contains(name))
+      return false;
+
+    if (range.IsNull())
+      range = pSymbolTable_->GetNodeArray(name).Range();
+    else if (!pSymbolTable_->GetNodeArray(name).Range().Contains(range))
+      throw LogicError(String("IsFixedLagSmoothMonitored: range ") + print(range)
+                       + " is not contained in variable " + name);
+
+    const boost::bimap<NodeId, IndexRange> & node_id_range_bimap =
+        pSymbolTable_->GetNodeArray(name).NodeIdRangeBimap();
+
+    for (boost::bimap<NodeId, IndexRange>::const_iterator it =
+        node_id_range_bimap.begin(); it != node_id_range_bimap.end(); ++it)
+    {
+      if (!range.Overlaps(it->right))
+        continue;
+      if (!fixedLagSmoothMonitorsMap_.count(it->left))
+        return false;
+
+      if (!check_released)
+        continue;
+
+      if (!fixedLagSmoothMonitorsMap_.at(it->left))
+        return false;
+    }
+
+    return true;
+  }
+
   Bool BUGSModel::ExtractFilterStat(String name,
                                     StatTag statFeature,
                                     std::map<IndexRange, MultiArray> & statMap) const
@@ -284,7 +507,33 @@ namespace Biips
       return false;
 
     const boost::bimap<NodeId, IndexRange> & node_id_range_bimap =
-        symbolTable_.GetNodeArray(name).NodeIdRangeBimap();
+        pSymbolTable_->GetNodeArray(name).NodeIdRangeBimap();
+
+    for (boost::bimap<NodeId, IndexRange>::right_const_iterator it =
+        node_id_range_bimap.right.begin();
+        it != node_id_range_bimap.right.end(); ++it)
+    {
+      const IndexRange & index_range = it->first;
+      NodeId node_id = it->second;
+      MultiArray stat_marray(BaseType::ExtractFilterStat(node_id, statFeature));
+      statMap.insert(std::make_pair(index_range, stat_marray));
+    }
+
+    return true;
+  }
+
+  Bool BUGSModel::ExtractSampledFilterStat(String name,
+                                           StatTag statFeature,
+                                           std::map<IndexRange, MultiArray> & statMap) const
+  {
+    if (!statMap.empty())
+      throw LogicError("Can not extract filter statistic: statistics map is not empty.");
+
+    if (!IsFilterMonitored(name, NULL_RANGE, false))
+      return false;
+
+    const boost::bimap<NodeId, IndexRange> & node_id_range_bimap =
+        pSymbolTable_->GetNodeArray(name).NodeIdRangeBimap();
 
     for (boost::bimap<NodeId, IndexRange>::right_const_iterator it =
         node_id_range_bimap.right.begin();
@@ -292,6 +541,9 @@ namespace Biips
     {
       const IndexRange & index_range = it->first;
       NodeId node_id = it->second;
+      // the monitor of a node is set at its sampling iteration
+      if (!filterMonitorsMap_.at(node_id))
+        continue;
       MultiArray stat_marray(BaseType::ExtractFilterStat(node_id, statFeature));
       statMap.insert(std::make_pair(index_range, stat_marray));
     }
@@ -310,7 +562,7 @@ namespace Biips
       return false;
 
     const boost::bimap<NodeId, IndexRange> & node_id_range_bimap =
-        symbolTable_.GetNodeArray(name).NodeIdRangeBimap();
+        pSymbolTable_->GetNodeArray(name).NodeIdRangeBimap();
 
     for (boost::bimap<NodeId, IndexRange>::right_const_iterator it =
         node_id_range_bimap.right.begin();
@@ -337,7 +589,7 @@ namespace Biips
       return false;
 
     const boost::bimap<NodeId, IndexRange> & node_id_range_bimap =
-        symbolTable_.GetNodeArray(name).NodeIdRangeBimap();
+        pSymbolTable_->GetNodeArray(name).NodeIdRangeBimap();
 
     for (boost::bimap<NodeId, IndexRange>::right_const_iterator it =
         node_id_range_bimap.right.begin();
@@ -352,6 +604,62 @@ namespace Biips
     return true;
   }
 
+  Bool BUGSModel::ExtractFixedLagSmoothStat(String name,
+                                    StatTag statFeature,
+                                    std::map<IndexRange, MultiArray> & statMap) const
+  {
+    if (!statMap.empty())
+      throw LogicError("Can not extract fixed-lag smoother statistic: statistics map is not empty.");
+
+    if (!IsFixedLagSmoothMonitored(name, NULL_RANGE))
+      return false;
+
+    const boost::bimap<NodeId, IndexRange> & node_id_range_bimap =
+        pSymbolTable_->GetNodeArray(name).NodeIdRangeBimap();
+
+    for (boost::bimap<NodeId, IndexRange>::right_const_iterator it =
+        node_id_range_bimap.right.begin();
+        it != node_id_range_bimap.right.end(); ++it)
+    {
+      const IndexRange & index_range = it->first;
+      NodeId node_id = it->second;
+      MultiArray stat_marray(BaseType::ExtractFixedLagSmoothStat(node_id, statFeature));
+      statMap.insert(std::make_pair(index_range, stat_marray));
+    }
+
+    return true;
+  }
+
+  Bool BUGSModel::DrainFixedLagSmoothStat(String name,
+                                          StatTag statFeature,
+                                          std::map<IndexRange, MultiArray> & statMap)
+  {
+    if (!statMap.empty())
+      throw LogicError("Can not drain fixed-lag smoother statistic: statistics map is not empty.");
+
+    if (!IsFixedLagSmoothMonitored(name, NULL_RANGE, false))
+      return false;
+
+    const boost::bimap<NodeId, IndexRange> & node_id_range_bimap =
+        pSymbolTable_->GetNodeArray(name).NodeIdRangeBimap();
+
+    for (boost::bimap<NodeId, IndexRange>::right_const_iterator it =
+        node_id_range_bimap.right.begin();
+        it != node_id_range_bimap.right.end(); ++it)
+    {
+      const IndexRange & index_range = it->first;
+      NodeId node_id = it->second;
+      // not monitored yet, or already released
+      if (!fixedLagSmoothMonitorsMap_.at(node_id))
+        continue;
+      MultiArray stat_marray(BaseType::ExtractFixedLagSmoothStat(node_id, statFeature));
+      statMap.insert(std::make_pair(index_range, stat_marray));
+      BaseType::ReleaseFixedLagSmoothMonitor(node_id);
+    }
+
+    return true;
+  }
+
   Bool BUGSModel::ExtractFilterPdf(String name,
                                    std::map<IndexRange, Histogram> & pdfMap,
                                    Size numBins,
@@ -364,7 +672,7 @@ namespace Biips
       return false;
 
     const boost::bimap<NodeId, IndexRange> & node_id_range_bimap =
-        symbolTable_.GetNodeArray(name).NodeIdRangeBimap();
+        pSymbolTable_->GetNodeArray(name).NodeIdRangeBimap();
 
     // check that all the nodes are scalar
 
@@ -404,7 +712,7 @@ namespace Biips
       return false;
 
     const boost::bimap<NodeId, IndexRange> & node_id_range_bimap =
-        symbolTable_.GetNodeArray(name).NodeIdRangeBimap();
+        pSymbolTable_->GetNodeArray(name).NodeIdRangeBimap();
 
     // check that all the nodes are scalar
 
@@ -444,7 +752,7 @@ namespace Biips
       return false;
 
     const boost::bimap<NodeId, IndexRange> & node_id_range_bimap =
-        symbolTable_.GetNodeArray(name).NodeIdRangeBimap();
+        pSymbolTable_->GetNodeArray(name).NodeIdRangeBimap();
 
     // check that all the nodes are scalar
 
@@ -472,13 +780,53 @@ namespace Biips
     return true;
   }
 
+  Bool BUGSModel::ExtractFixedLagSmoothPdf(String name,
+                                   std::map<IndexRange, Histogram> & pdfMap,
+                                   Size numBins,
+                                   Scalar cacheFraction) const
+  {
+    if (!pdfMap.empty())
+      throw LogicError("Can not extract fixed-lag smooth pdf: pdf map is not empty.");
+
+    if (!IsFixedLagSmoothMonitored(name, NULL_RANGE))
+      return false;
+
+    const boost::bimap<NodeId, IndexRange> & node_id_range_bimap =
+        pSymbolTable_->GetNodeArray(name).NodeIdRangeBimap();
+
+    // check that all the nodes are scalar
+
+    for (boost::bimap<NodeId, IndexRange>::right_const_iterator it =
+        node_id_range_bimap.right.begin();
+        it != node_id_range_bimap.right.end(); ++it)
+    {
+      const IndexRange & index_range = it->first;
+      if (index_range.Length() != 1)
+        return false;
+    }
+
+    for (boost::bimap<NodeId, IndexRange>::right_const_iterator it =
+        node_id_range_bimap.right.begin();
+        it != node_id_range_bimap.right.end(); ++it)
+    {
+      const IndexRange & index_range = it->first;
+      NodeId node_id = it->second;
+      Histogram pdf_hist = BaseType::ExtractFixedLagSmoothPdf(node_id,
+                                                      numBins,
+                                                      cacheFraction);
+      pdfMap.insert(std::make_pair(index_range, pdf_hist));
+    }
+
+    return true;
+  }
+
   Bool BUGSModel::ChangeData(const String & variable,
                              const IndexRange & range,
                              const MultiArray & data,
                              Bool & rebuildSampler,
                              Bool mcmc)
   {
-    Bool ok = symbolTable_.ChangeData(variable, range, data, rebuildSampler, mcmc);
+    Bool ok = pSymbolTable_->ChangeData(variable, range, data, rebuildSampler, mcmc);
 
     return ok;
   }
@@ -488,26 +836,27 @@ namespace Biips
                              MultiArray & data,
                              Rng * pRng)
   {
-    symbolTable_.SampleData(variable, range, data, pRng);
+    pSymbolTable_->SampleData(variable, range, data, pRng);
 
     return true;
   }
 
   Bool BUGSModel::RemoveData(const String & variable, const IndexRange & range)
   {
-    symbolTable_.RemoveData(variable, range);
+    pSymbolTable_->RemoveData(variable, range);
 
     return true;
   }
 
   Bool BUGSModel::DumpData(std::map<String, MultiArray> & dataMap) const
   {
-    symbolTable_.ReadData(dataMap);
+    pSymbolTable_->ReadData(dataMap);
 
     return true;
   }
 
-  Bool BUGSModel::DumpFilterMonitors(std::map<String, NodeArrayMonitor> & monitorsMap) const
+  template<typename MonitorType>
+  Bool BUGSModel::dumpFilterMonitors(std::map<String, MonitorType> & monitorsMap) const
   {
     if (!pSampler_)
       return false;
@@ -517,29 +866,30 @@ namespace Biips
     for (Size i = 0; i < filterMonitorsNames_.size(); ++i)
     {
       const String & var_name = filterMonitorsNames_[i];
-      if (!symbolTable_.Contains(var_name))
+      if (!pSymbolTable_->Contains(var_name))
         throw LogicError(String("Monitored array ") + var_name
                          + " does not exist in the symbol table.");
 
       String name = var_name;
       IndexRange range = filterMonitorsRanges_[i];
       if (range.IsNull())
-        range = symbolTable_.GetNodeArray(name).Range();
+        range = pSymbolTable_->GetNodeArray(name).Range();
       else
         name.append(print(range));
 
       monitorsMap.insert(std::make_pair(name,
-                                        NodeArrayMonitor(symbolTable_.GetNodeArray(var_name),
+                                        MonitorType(pSymbolTable_->GetNodeArray(var_name),
                                                          range,
                                                          filterMonitorsMap_,
                                                          pSampler_->NParticles(),
-                                                         *pGraph_, symbolTable_)));
+                                                         *pGraph_, *pSymbolTable_)));
     }
 
     return true;
   }
 
-  Bool BUGSModel::DumpGenTreeSmoothMonitors(std::map<String, NodeArrayMonitor> & monitorsMap) const
+  template<typename MonitorType>
+  Bool BUGSModel::dumpGenTreeSmoothMonitors(std::map<String, MonitorType> & monitorsMap) const
   {
     if (!pSampler_)
       return false;
@@ -549,24 +899,24 @@ namespace Biips
     for (Size i = 0; i < genTreeSmoothMonitorsNames_.size(); ++i)
     {
       const String & var_name = genTreeSmoothMonitorsNames_[i];
-      if (!symbolTable_.Contains(var_name))
+      if (!pSymbolTable_->Contains(var_name))
         throw LogicError(String("Monitored array ") + var_name
                          + " does not exist in the symbol table.");
 
       String name = var_name;
       IndexRange range = genTreeSmoothMonitorsRanges_[i];
       if (range.IsNull())
-        range = symbolTable_.GetNodeArray(name).Range();
+        range = pSymbolTable_->GetNodeArray(name).Range();
       else
         name.append(print(range));
 
       monitorsMap.insert(std::make_pair(name,
-                                        NodeArrayMonitor(symbolTable_.GetNodeArray(var_name),
+                                        MonitorType(pSymbolTable_->GetNodeArray(var_name),
                                                          range,
                                                          pGenTreeSmoothMonitor_.get(),
                                                          pSampler_->NParticles(),
                                                          *pGraph_,
-                                                         symbolTable_)));
+                                                         *pSymbolTable_)));
     }
 
     return true;
@@ -593,18 +943,18 @@ namespace Biips
     for (Size i = 0; i < genTreeSmoothMonitorsNames_.size(); ++i)
     {
       const String & var_name = genTreeSmoothMonitorsNames_[i];
-      if (!symbolTable_.Contains(var_name))
+      if (!pSymbolTable_->Contains(var_name))
         throw LogicError(String("Monitored array ") + var_name
                          + " does not exist in the symbol table.");
 
       String name = var_name;
       IndexRange range = genTreeSmoothMonitorsRanges_[i];
       if (range.IsNull())
-        range = symbolTable_.GetNodeArray(name).Range();
+        range = pSymbolTable_->GetNodeArray(name).Range();
       else
         name.append(print(range));
 
-      sampledValues[name] = NodeArrayValue(symbolTable_.GetNodeArray(var_name),
+      sampledValues[name] = NodeArrayValue(pSymbolTable_->GetNodeArray(var_name),
                                            range,
                                            pGenTreeSmoothMonitor_.get(),
                                            chosen_particle,
@@ -614,7 +964,58 @@ namespace Biips
     return true;
   }
 
-  Bool BUGSModel::DumpBackwardSmoothMonitors(std::map<String, NodeArrayMonitor> & monitorsMap) const
+  Bool BUGSModel::SampleGenTreeSmoothParticles(Rng * pRng,
+                                               Size nTrajectories,
+                                               std::map<String, MultiArray> & sampledValues,
+                                               Size nThreads) const
+  {
+    if (!pSampler_)
+      return false;
+    if (!pSampler_->AtEnd())
+      return false;
+    if (!pGenTreeSmoothMonitor_)
+      return false;
+
+    // sample the particles according to the weights, as successive
+    // calls of SampleGenTreeSmoothParticle with the same rng would do,
+    // but with one distribution for all the trajectories
+    typedef boost::random::discrete_distribution<Int, Scalar> CategoricalDist;
+    CategoricalDist dist(pGenTreeSmoothMonitor_->GetUnnormWeights().begin(),
+                         pGenTreeSmoothMonitor_->GetUnnormWeights().end());
+    typedef boost::random::variate_generator<Rng::GenType&, CategoricalDist> CategoricalGen;
+    CategoricalGen gen(pRng->GetGen(), dist);
+
+    Types<Size>::Array chosen_particles(nTrajectories);
+    for (Size k = 0; k < nTrajectories; ++k)
+      chosen_particles[k] = gen();
+
+    for (Size j = 0; j < genTreeSmoothMonitorsNames_.size(); ++j)
+    {
+      const String & var_name = genTreeSmoothMonitorsNames_[j];
+      if (!pSymbolTable_->Contains(var_name))
+        throw LogicError(String("Monitored array ") + var_name
+                         + " does not exist in the symbol table.");
+
+      String name = var_name;
+      IndexRange range = genTreeSmoothMonitorsRanges_[j];
+      if (range.IsNull())
+        range = pSymbolTable_->GetNodeArray(name).Range();
+      else
+        name.append(print(range));
+
+      sampledValues[name] = NodeArrayValue(pSymbolTable_->GetNodeArray(var_name),
+                                           range,
+                                           pGenTreeSmoothMonitor_.get(),
+                                           chosen_particles,
+                                           *pGraph_,
+                                           nThreads).GetValue();
+    }
+
+    return true;
+  }
+
+  template<typename MonitorType>
+  Bool BUGSModel::dumpBackwardSmoothMonitors(std::map<String, MonitorType> & monitorsMap) const
   {
     if (!pSampler_)
       return false;
@@ -624,30 +1025,103 @@ namespace Biips
     for (Size i = 0; i < backwardSmoothMonitorsNames_.size(); ++i)
     {
       const String & var_name = backwardSmoothMonitorsNames_[i];
-      if (!symbolTable_.Contains(var_name))
+      if (!pSymbolTable_->Contains(var_name))
         throw LogicError(String("Monitored array ") + var_name
                          + " does not exist in the symbol table.");
 
       String name = var_name;
       IndexRange range = backwardSmoothMonitorsRanges_[i];
       if (range.IsNull())
-        range = symbolTable_.GetNodeArray(name).Range();
+        range = pSymbolTable_->GetNodeArray(name).Range();
       else
         name.append(print(range));
 
       monitorsMap.insert(std::make_pair(name,
-                                        NodeArrayMonitor(symbolTable_.GetNodeArray(var_name),
+                                        MonitorType(pSymbolTable_->GetNodeArray(var_name),
                                                          range,
                                                          backwardSmoothMonitorsMap_,
                                                          pSampler_->NParticles(),
                                                          *pGraph_,
-                                                         symbolTable_,
+                                                         *pSymbolTable_,
                                                          pSmoother_->ConditionalNodes())));
     }
 
     return true;
   }
 
+  template<typename MonitorType>
+  Bool BUGSModel::dumpFixedLagSmoothMonitors(std::map<String, MonitorType> & monitorsMap) const
+  {
+    if (!pSampler_)
+      return false;
+    if (!pSampler_->AtEnd())
+      return false;
+
+    for (Size i = 0; i < fixedLagSmoothMonitorsNames_.size(); ++i)
+    {
+      const String & var_name = fixedLagSmoothMonitorsNames_[i];
+      if (!pSymbolTable_->Contains(var_name))
+        throw LogicError(String("Monitored array ") + var_name
+                         + " does not exist in the symbol table.");
+
+      String name = var_name;
+      IndexRange range = fixedLagSmoothMonitorsRanges_[i];
+      if (range.IsNull())
+        range = pSymbolTable_->GetNodeArray(name).Range();
+      else
+        name.append(print(range));
+
+      monitorsMap.insert(std::make_pair(name,
+                                        MonitorType(pSymbolTable_->GetNodeArray(var_name),
+                                                         range,
+                                                         fixedLagSmoothMonitorsMap_,
+                                                         pSampler_->NParticles(),
+                                                         *pGraph_, *pSymbolTable_)));
+    }
+
+    return true;
+  }
+  Bool BUGSModel::DumpFilterMonitors(std::map<String, NodeArrayMonitor> & monitorsMap) const
+  {
+    return dumpFilterMonitors(monitorsMap);
+  }
+
+  Bool BUGSModel::DumpFilterMonitors(std::map<String, NodeArrayMonitorExport> & monitorsMap) const
+  {
+    return dumpFilterMonitors(monitorsMap);
+  }
+
+  Bool BUGSModel::DumpGenTreeSmoothMonitors(std::map<String, NodeArrayMonitor> & monitorsMap) const
+  {
+    return dumpGenTreeSmoothMonitors(monitorsMap);
+  }
+
+  Bool BUGSModel::DumpGenTreeSmoothMonitors(std::map<String, NodeArrayMonitorExport> & monitorsMap) const
+  {
+    return dumpGenTreeSmoothMonitors(monitorsMap);
+  }
+
+  Bool BUGSModel::DumpBackwardSmoothMonitors(std::map<String, NodeArrayMonitor> & monitorsMap) const
+  {
+    return dumpBackwardSmoothMonitors(monitorsMap);
+  }
+
+  Bool BUGSModel::DumpBackwardSmoothMonitors(std::map<String, NodeArrayMonitorExport> & monitorsMap) const
+  {
+    return dumpBackwardSmoothMonitors(monitorsMap);
+  }
+
+  Bool BUGSModel::DumpFixedLagSmoothMonitors(std::map<String, NodeArrayMonitor> & monitorsMap) const
+  {
+    return dumpFixedLagSmoothMonitors(monitorsMap);
+  }
+
+  Bool BUGSModel::DumpFixedLagSmoothMonitors(std::map<String, NodeArrayMonitorExport> & monitorsMap) const
+  {
+    return dumpFixedLagSmoothMonitors(monitorsMap);
+  }
+
+
   //  void BUGSModel::PrintSamplersSequence(std::ostream & out) const
   //  {
   //    Types<std::pair<NodeId, String> >::Array node_id_samplers_seq =
@@ -656,7 +1130,7 @@ namespace Biips
   //    {
   //      NodeId node_id = node_id_samplers_seq[i].first;
   //      const String & name = node_id_samplers_seq[i].second;
-  //      out << i + 1 << ": " << symbolTable_.GetName(node_id) << " (id="
+  //      out << i + 1 << ": " << pSymbolTable_->GetName(node_id) << " (id="
   //          << node_id << "), " << name << std::endl;
   //    }
   //  }
@@ -697,7 +1171,7 @@ namespace Biips
 
   void BUGSModel::PrintGraphviz(std::ostream & out) const
   {
-    VarNamePropertyWriter vnpw(*pGraph_, symbolTable_);
+    VarNamePropertyWriter vnpw(*pGraph_, *pSymbolTable_);
     pGraph_->PrintGraphviz(out, vnpw);
   }
 
@@ -705,11 +1179,11 @@ namespace Biips
                                      const String & variable,
                                      IndexRange range) const
   {
-    if (!symbolTable_.Contains(variable))
+    if (!pSymbolTable_->Contains(variable))
       throw RuntimeError(String("Can not get prior density: variable ")
                          + variable + " not found.");
 
-    const NodeArray & array = symbolTable_.GetNodeArray(variable);
+    const NodeArray & array = pSymbolTable_->GetNodeArray(variable);
     if (range.IsNull())
       range = array.Range();
     NodeId node_id = array.GetNode(range);
@@ -726,11 +1200,11 @@ namespace Biips
                                   const String & variable,
                                   IndexRange range) const
   {
-    if (!symbolTable_.Contains(variable))
+    if (!pSymbolTable_->Contains(variable))
       throw RuntimeError(String("Can not get fixed support: variable ")
                          + variable + " not found.");
 
-    const NodeArray & array = symbolTable_.GetNodeArray(variable);
+    const NodeArray & array = pSymbolTable_->GetNodeArray(variable);
     if (range.IsNull())
       range = array.Range();
     NodeId node_id = array.GetNode(range);
@@ -771,4 +1245,13 @@ namespace Biips
     backwardSmoothMonitorsNames_.clear();
     backwardSmoothMonitorsRanges_.clear();
   }
+
+  void BUGSModel::ClearFixedLagSmoothMonitors(Bool release_only)
+  {
+    BaseType::ClearFixedLagSmoothMonitors(release_only);
+    if (release_only)
+      return;
+    fixedLagSmoothMonitorsNames_.clear();
+    fixedLagSmoothMonitorsRanges_.clear();
+  }
 }
@@ -0,0 +1,53 @@
+#include "model/DataBatch.hpp"
+#include "common/Error.hpp"
+
+namespace Biips
+{
+
+  DataBatch::DataBatch(const std::map<String, DimArray::Ptr> & dims,
+                       Size nDatasets) :
+    nDatasets_(nDatasets), datasetSize_(0), dims_(dims)
+  {
+    std::map<String, DimArray::Ptr>::const_iterator it_var;
+    for (it_var = dims_.begin(); it_var != dims_.end(); ++it_var)
+    {
+      offsets_[it_var->first] = datasetSize_;
+      datasetSize_ += it_var->second->Length();
+    }
+    values_.assign(nDatasets_ * datasetSize_, BIIPS_REALNA);
+  }
+
+  Size DataBatch::Offset(const String & variable) const
+  {
+    std::map<String, Size>::const_iterator it_offset = offsets_.find(variable);
+    if (it_offset == offsets_.end())
+      throw LogicError(String("Variable ") + variable
+                       + " is not in the data batch.");
+    return it_offset->second;
+  }
+
+  void DataBatch::GetDataMap(Size dataset,
+                             std::map<String, MultiArray> & dataMap) const
+  {
+    if (dataset >= nDatasets_)
+      throw LogicError("Dataset index out of range.");
+
+    const Scalar * p_dataset = Dataset(dataset);
+    std::map<String, DimArray::Ptr>::const_iterator it_var;
+    for (it_var = dims_.begin(); it_var != dims_.end(); ++it_var)
+    {
+      const Scalar * p_begin = p_dataset + offsets_.at(it_var->first);
+      const Scalar * p_end = p_begin + it_var->second->Length();
+
+      Bool all_missing = true;
+      for (const Scalar * p = p_begin; p != p_end && all_missing; ++p)
+        all_missing = isNA(*p);
+      if (all_missing)
+        continue;
+
+      ValArray::Ptr p_values(new ValArray(p_begin, p_end));
+      dataMap[it_var->first] = MultiArray(it_var->second, p_values);
+    }
+  }
+
+}
@@ -3,162 +3,44 @@
 #include "common/IndexRangeIterator.hpp"
 #include "graph/Graph.hpp"
 #include "model/SymbolTable.hpp"
+#include <thread>
+#include <algorithm>
 
 namespace Biips
 {
 
-  class NodeMonitor
+  void NodeArrayMonitorExport::addSubNode(NodeId id,
+                                          const IndexRange & subRange,
+                                          const Monitor * pMonitor)
   {
-  protected:
-    NodeId nodeId_;
-    Size iter_;
-    const Types<NodeId>::Array & conditionalNodes_;
-    Scalar ess_;
-    ValArray weights_;
-    typedef Types<ValArray::Ptr>::Array ParticleValues;
-    const ParticleValues & particleValues_;
-    Bool discrete_;
-
-  public:
-    NodeMonitor(NodeId id, const Monitor* & pMonitor);
-
-    NodeId GetNodeId() const
+    if (pMonitor)
     {
-      return nodeId_;
+      if (!pMonitor->Contains(id))
+        throw LogicError("Node is not monitored, in NodeArrayMonitorExport::addSubNode.");
+      if (pMonitor->NParticles() != nParticles_)
+        throw LogicError("Non conforming number of particles, in NodeArrayMonitorExport::addSubNode");
+
+      Size iter = pMonitor->GetIteration();
+      std::map<Size, const Monitor *>::const_iterator it_iter =
+          iterationMonitors_.find(iter);
+      if (it_iter == iterationMonitors_.end())
+        iterationMonitors_[iter] = pMonitor;
+      else if (it_iter->second != pMonitor)
+        throw LogicError("Several monitors at the same iteration, in NodeArrayMonitorExport::addSubNode");
     }
-    Size GetIteration() const
-    {
-      return iter_;
-    }
-    const Types<NodeId>::Array & GetConditionalNodes() const
-    {
-      return conditionalNodes_;
-    }
-    Scalar GetESS() const
-    {
-      return ess_;
-    }
-    Size NParticles() const
-    {
-      return weights_.size();
-    }
-    const ValArray & GetWeights() const
-    {
-      return weights_;
-    }
-    const ParticleValues & GetNodeValues() const
-    {
-      return particleValues_;
-    }
-    Bool GetDiscrete() const
-    {
-      return discrete_;
-    }
-  };
-
-  NodeMonitor::NodeMonitor(NodeId id, const Monitor* & pMonitor) :
-    nodeId_(id), iter_(pMonitor->GetIteration()),
-        conditionalNodes_(pMonitor->GetConditionalNodes()),
-        ess_(pMonitor->GetNodeESS(id)), weights_(pMonitor->GetWeights()),
-        particleValues_(pMonitor->GetNodeValues(id)),
-        discrete_(pMonitor->GetNodeDiscrete(id))
-  {
-  }
-
-  template<>
-  void NodeArrayMonitor::addObservedNode<ColumnMajorOrder>(NodeId id,
-                                                           const IndexRange & subRange,
-                                                           const Graph & graph)
-  {
-    Size len = range_.Dim().Length();
-
-    // iterate the elements of the subrange
-    for (IndexRangeIterator it_sub_range(subRange); !it_sub_range.AtEnd(); it_sub_range.Next())
-    {
-      if (!range_.Contains(IndexRange(it_sub_range)))
-        continue;
-      // compute the offset of the new larger array
-      Size offset = range_.GetOffset(it_sub_range);
-
-      ess_.Values()[offset] = Scalar(nParticles_);
-      iterations_.Values()[offset] = BIIPS_SIZENA;
-      nodeIds_.Values()[offset] = id;
-      discrete_.Values()[offset] = Scalar(graph.GetDiscrete()[id]);
-
-      // compute the offset of the sub array
-      Size sub_offset = subRange.GetOffset(it_sub_range);
-
-      // iterate all the particles
-      for (Size i = 0; i < nParticles_; ++i)
-      {
-        values_.Values()[i * len + offset]
-            = (*(graph.GetValues()[id]))[sub_offset];
-        weights_.Values()[i * len + offset] = 1.0 / nParticles_;
-      }
-    }
-  }
-
-  template<>
-  void NodeArrayMonitor::addMonitoredNode<ColumnMajorOrder>(NodeId id,
-                                                            const IndexRange & subRange,
-                                                            const Monitor* pMonitor)
-  {
-    if (!pMonitor)
-      throw LogicError("Monitor pointer is null, in NodeArrayMonitor::addMonitoredNode.");
-    if (!pMonitor->Contains(id))
-      throw LogicError("Node is not monitored, in NodeArrayMonitor::addMonitoredNode.");
-    if (pMonitor->NParticles() != nParticles_)
-      throw LogicError("Non conforming number of particles, in NodeArrayMonitor::addMonitoredNode");
-
-    NodeMonitor node_monitor(id, pMonitor);
-    Size len = range_.Dim().Length();
-
-    // iterate the elements of the subrange
-    for (IndexRangeIterator it_sub_range(subRange); !it_sub_range.AtEnd(); it_sub_range.Next())
-    {
-      if (!range_.Contains(IndexRange(it_sub_range)))
-        continue;
-      // compute the offset of the new larger array
-      Size offset = range_.GetOffset(it_sub_range);
-
-      ess_.Values()[offset] = node_monitor.GetESS();
-      iterations_.Values()[offset] = node_monitor.GetIteration();
-      nodeIds_.Values()[offset] = id;
-      discrete_.Values()[offset] = Scalar(node_monitor.GetDiscrete());
 
-      // compute the offset of the sub array
-      Size sub_offset = subRange.GetOffset(it_sub_range);
-
-      // iterate all the particles
-      for (Size i = 0; i < nParticles_; ++i)
-      {
-        values_.Values()[i * len + offset]
-            = (*(node_monitor.GetNodeValues()[i]))[sub_offset];
-        weights_.Values()[i * len + offset] = (node_monitor.GetWeights()[i]);
-      }
-    }
+    subNodeIds_.push_back(id);
+    subRanges_.push_back(subRange);
+    subMonitors_.push_back(pMonitor);
   }
 
-  void NodeArrayMonitor::setMembers(const NodeArray & nodeArray,
-                  const std::map<NodeId, Monitor*> & monitorsMap,
-                  const Graph & graph)
+  void NodeArrayMonitorExport::setSubNodes(const NodeArray & nodeArray,
+                                           const std::map<NodeId, Monitor*> & monitorsMap)
   {
     if (!nodeArray.Range().Contains(range_))
       throw LogicError(String("NodeArrayMonitor: range ") + print(range_)
           + " is not contained in variable " + name_);
 
-    // dimensions
-    DimArray::Ptr p_dim_particles(new DimArray(range_.Dim()));
-    p_dim_particles->push_back(nParticles_);
-
-    // allocate memory
-    ValArray::Ptr p_values_val(new ValArray(p_dim_particles->Length(),
-                                            BIIPS_REALNA));
-    ValArray::Ptr p_weights_val(new ValArray(p_dim_particles->Length(),
-                                             BIIPS_REALNA));
-    values_.SetPtr(p_dim_particles, p_values_val);
-    weights_.SetPtr(p_dim_particles, p_weights_val);
-
     boost::bimap<NodeId, IndexRange>::const_iterator it_bimap =
         nodeArray.NodeIdRangeBimap().begin();
     // iterate over all the subnodes
@@ -169,36 +51,27 @@ namespace Biips
       if (!range_.Overlaps(sub_range))
         continue;
 
-      if (graph.GetObserved()[id])
-        addObservedNode<StorageOrder> (id, sub_range, graph);
+      if (pGraph_->GetObserved()[id])
+        addSubNode(id, sub_range, NULL);
       else
       {
         if (!monitorsMap.count(id))
           throw LogicError("NodeArrayMonitor::NodeArrayMonitor: node is not monitored.");
-        addMonitoredNode<StorageOrder> (id, sub_range, monitorsMap.at(id));
+        if (!monitorsMap.at(id))
+          throw LogicError("Monitor pointer is null, in NodeArrayMonitorExport::setSubNodes.");
+        addSubNode(id, sub_range, monitorsMap.at(id));
       }
     }
   }
 
-  void NodeArrayMonitor::setMembers(const NodeArray & nodeArray,
-                                    const Monitor* pMonitor,
-                                    const Graph & graph)
+  void NodeArrayMonitorExport::setSubNodes(const NodeArray & nodeArray,
+                                           const Monitor* pMonitor)
   {
     if (!nodeArray.Range().Contains(range_))
       throw LogicError(String("NodeArrayMonitor: range ") + print(range_)
           + " is not contained in variable " + name_);
-
-    // dimensions
-    DimArray::Ptr p_dim_particles(new DimArray(range_.Dim()));
-    p_dim_particles->push_back(nParticles_);
-
-    // allocate memory
-    ValArray::Ptr p_values_val(new ValArray(p_dim_particles->Length(),
-                                            BIIPS_REALNA));
-    ValArray::Ptr p_weights_val(new ValArray(p_dim_particles->Length(),
-                                             BIIPS_REALNA));
-    values_.SetPtr(p_dim_particles, p_values_val);
-    weights_.SetPtr(p_dim_particles, p_weights_val);
+    if (!pMonitor)
+      throw LogicError("Monitor pointer is null, in NodeArrayMonitorExport::setSubNodes.");
 
     boost::bimap<NodeId, IndexRange>::const_iterator it_bimap =
         nodeArray.NodeIdRangeBimap().begin();
@@ -211,24 +84,22 @@ namespace Biips
       if (!range_.Overlaps(sub_range))
         continue;
 
-      if (graph.GetObserved()[id])
-        addObservedNode<StorageOrder> (id, sub_range, graph);
-      else
-        addMonitoredNode<StorageOrder> (id, sub_range, pMonitor);
+      addSubNode(id, sub_range, pGraph_->GetObserved()[id] ? NULL : pMonitor);
     }
   }
 
-  void NodeArrayMonitor::setConditionalNodeIds(const NodeArray & nodeArray,
-                                             const std::map<NodeId, Monitor*> & monitorsMap,
-                                             const Graph & graph)
+  void NodeArrayMonitorExport::setConditionalNodeIds(const NodeArray & nodeArray,
+                                                     const std::map<NodeId, Monitor*> & monitorsMap)
   {
-    const Types<NodeId>::Array node_ids = nodeArray.NodeIds();
+    // the conditional nodes of the elements are prefixes of the same
+    // sequence: only the longest one is stored
+    const Monitor * p_longest = NULL;
     IndexRangeIterator it_range(range_);
     for (Size i=0; !it_range.AtEnd(); ++i, it_range.Next())
     {
       Size offset = nodeArray.Range().GetOffset(it_range);
       NodeId id = nodeArray.NodeIds()[offset];
-      if (id == NULL_NODEID || graph.GetObserved()[id])
+      if (id == NULL_NODEID || pGraph_->GetObserved()[id])
         continue;
 
       if (!monitorsMap.count(id))
@@ -236,22 +107,196 @@ namespace Biips
       if (!monitorsMap.at(id))
         throw LogicError("NodeArrayMonitor::NodeArrayMonitor: could not set conditionals. null monitor pointer.");
 
-      const Types<NodeId>::Array cond = monitorsMap.at(id)->GetConditionalNodes();
-      conditionalNodeIds_[i].assign(cond.begin(), cond.end());
+      const Monitor * p_monitor = monitorsMap.at(id);
+      conditionalNodeCounts_[i] = p_monitor->NConditionalNodes();
+      if (!p_longest
+          || p_monitor->NConditionalNodes() > p_longest->NConditionalNodes())
+        p_longest = p_monitor;
     }
+
+    if (!p_longest)
+      return;
+
+    Types<NodeId>::ConstIterator it_cond, it_cond_end;
+    boost::tie(it_cond, it_cond_end) = p_longest->GetConditionalNodes();
+    conditionalNodeIds_.assign(it_cond, it_cond_end);
   }
 
-  void NodeArrayMonitor::setConditionalNodeNames(const SymbolTable & symtab)
+  void NodeArrayMonitorExport::setConditionalNodeNames(const SymbolTable & symtab)
   {
     conditionalNodeNames_.resize(conditionalNodeIds_.size());
     for (Size i=0; i<conditionalNodeIds_.size(); ++i)
+      conditionalNodeNames_[i] = symtab.GetName(conditionalNodeIds_[i]);
+  }
+
+  NodeArrayMonitorExport::NodeArrayMonitorExport(const NodeArray & nodeArray,
+                                                 const IndexRange & range,
+                                                 const std::map<NodeId, Monitor*> & monitorsMap,
+                                                 Size nParticles,
+                                                 const Graph & graph,
+                                                 const SymbolTable & symtab) :
+    name_(nodeArray.Name()), range_(range), nParticles_(nParticles),
+        pGraph_(&graph), conditionalNodeCounts_(range.Length(), 0)
+  {
+    setSubNodes(nodeArray, monitorsMap);
+    setConditionalNodeIds(nodeArray, monitorsMap);
+    setConditionalNodeNames(symtab);
+  }
+
+  NodeArrayMonitorExport::NodeArrayMonitorExport(const NodeArray & nodeArray,
+                                                 const IndexRange & range,
+                                                 const std::map<NodeId, Monitor*> & monitorsMap,
+                                                 Size nParticles,
+                                                 const Graph & graph,
+                                                 const SymbolTable & symtab,
+                                                 const Types<NodeId>::Array & condNodes) :
+    name_(nodeArray.Name()), range_(range), nParticles_(nParticles),
+        pGraph_(&graph), conditionalNodeIds_(condNodes),
+        conditionalNodeCounts_(1, condNodes.size())
+  {
+    setSubNodes(nodeArray, monitorsMap);
+    setConditionalNodeNames(symtab);
+  }
+
+  NodeArrayMonitorExport::NodeArrayMonitorExport(const NodeArray & nodeArray,
+                                                 const IndexRange & range,
+                                                 const Monitor* pMonitor,
+                                                 Size nParticles,
+                                                 const Graph & graph,
+                                                 const SymbolTable & symtab) :
+    name_(nodeArray.Name()), range_(range), nParticles_(nParticles),
+        pGraph_(&graph)
+  {
+    setSubNodes(nodeArray, pMonitor);
+    conditionalNodeIds_.assign(pMonitor->GetConditionalNodes().first,
+                               pMonitor->GetConditionalNodes().second);
+    conditionalNodeCounts_.assign(1, pMonitor->NConditionalNodes());
+    setConditionalNodeNames(symtab);
+  }
+
+  void NodeArrayMonitorExport::Export(const NodeArrayMonitorBuffers & buffers) const
+  {
+    Size len = range_.Length();
+
+    // normalized weights, once per iteration
+    std::map<Size, const Monitor *>::const_iterator it_iter =
+        iterationMonitors_.begin();
+    for (Size k = 0; it_iter != iterationMonitors_.end(); ++k, ++it_iter)
     {
-      conditionalNodeNames_[i].resize(conditionalNodeIds_[i].size());
-      for (Size j=0; j<conditionalNodeIds_[i].size(); ++j)
-        conditionalNodeNames_[i][j] = symtab.GetName(conditionalNodeIds_[i][j]);
+      const Monitor & monitor = *it_iter->second;
+      if (buffers.weightIterations)
+        buffers.weightIterations[k] = it_iter->first;
+      if (!buffers.weights)
+        continue;
+      const ValArray & weights = monitor.GetUnnormWeights();
+      Scalar sum_of_weights = monitor.GetSumOfWeights();
+      for (Size i = 0; i < nParticles_; ++i)
+        buffers.weights[k * nParticles_ + i] = weights[i] / sum_of_weights;
+    }
+
+    for (Size j = 0; j < subNodeIds_.size(); ++j)
+    {
+      NodeId id = subNodeIds_[j];
+      const IndexRange & sub_range = subRanges_[j];
+      const Monitor * p_monitor = subMonitors_[j];
+      const MonitorArchive * p_values = p_monitor ? &p_monitor->GetNodeValues(id)
+                                                  : NULL;
+      const ValArray & obs_value = *pGraph_->GetValues()[id];
+
+      Scalar ess = p_monitor ? p_monitor->GetNodeESS(id) : Scalar(nParticles_);
+      Scalar iter = p_monitor ? Scalar(p_monitor->GetIteration())
+                              : Scalar(BIIPS_SIZENA);
+      Scalar discrete = p_monitor ? Scalar(p_monitor->GetNodeDiscrete(id))
+                                  : Scalar(pGraph_->GetDiscrete()[id]);
+
+      // iterate the elements of the subrange
+      for (IndexRangeIterator it_sub_range(sub_range); !it_sub_range.AtEnd(); it_sub_range.Next())
+      {
+        if (!range_.Contains(IndexRange(it_sub_range)))
+          continue;
+        // compute the offset of the new larger array
+        Size offset = range_.GetOffset(it_sub_range);
+
+        if (buffers.ess)
+          buffers.ess[offset] = ess;
+        if (buffers.iterations)
+          buffers.iterations[offset] = iter;
+        if (buffers.nodeIds)
+          buffers.nodeIds[offset] = id;
+        if (buffers.discrete)
+          buffers.discrete[offset] = discrete;
+
+        if (!buffers.values)
+          continue;
+
+        // compute the offset of the sub array
+        Size sub_offset = sub_range.GetOffset(it_sub_range);
+
+        // iterate all the particles
+        if (p_values)
+          for (Size i = 0; i < nParticles_; ++i)
+            buffers.values[i * len + offset] = (*p_values)(i, sub_offset);
+        else
+          for (Size i = 0; i < nParticles_; ++i)
+            buffers.values[i * len + offset] = obs_value[sub_offset];
+      }
     }
   }
 
+  void NodeArrayMonitor::setMembers(const NodeArrayMonitorExport & monitorExport)
+  {
+    Size len = range_.Length();
+
+    // dimensions
+    DimArray::Ptr p_dim_particles(new DimArray(range_.Dim()));
+    p_dim_particles->push_back(nParticles_);
+
+    // allocate memory
+    ValArray::Ptr p_values_val(new ValArray(p_dim_particles->Length(),
+                                            BIIPS_REALNA));
+    ValArray::Ptr p_weights_val(new ValArray(p_dim_particles->Length(),
+                                             BIIPS_REALNA));
+    values_.SetPtr(p_dim_particles, p_values_val);
+    weights_.SetPtr(p_dim_particles, p_weights_val);
+
+    ValArray iter_weights(nParticles_ * monitorExport.NIterations());
+    ValArray weight_iters(monitorExport.NIterations());
+
+    NodeArrayMonitorBuffers buffers;
+    buffers.values = &values_.Values()[0];
+    if (!weight_iters.empty())
+    {
+      buffers.weights = &iter_weights[0];
+      buffers.weightIterations = &weight_iters[0];
+    }
+    buffers.ess = &ess_.Values()[0];
+    buffers.iterations = &iterations_.Values()[0];
+    buffers.nodeIds = &nodeIds_.Values()[0];
+    buffers.discrete = &discrete_.Values()[0];
+    monitorExport.Export(buffers);
+
+    // replicate the weights of the iteration of each element
+    std::map<Scalar, Size> iter_columns;
+    for (Size k = 0; k < monitorExport.NIterations(); ++k)
+      iter_columns[weight_iters[k]] = k;
+
+    for (Size offset = 0; offset < len; ++offset)
+    {
+      if (isNA(nodeIds_.Values()[offset]))
+        continue;
+      std::map<Scalar, Size>::const_iterator it_col =
+          iter_columns.find(iterations_.Values()[offset]);
+      for (Size i = 0; i < nParticles_; ++i)
+        weights_.Values()[i * len + offset] = it_col == iter_columns.end()
+            ? 1.0 / nParticles_
+            : iter_weights[it_col->second * nParticles_ + i];
+    }
+
+    conditionalNodeIds_ = monitorExport.GetConditionalNodeIdSequence();
+    conditionalNodeNames_ = monitorExport.GetConditionalNodeNameSequence();
+    conditionalNodeCounts_ = monitorExport.GetConditionalNodeCounts();
+  }
+
   NodeArrayMonitor::NodeArrayMonitor(const NodeArray & nodeArray,
                                      const IndexRange & range,
                                      const std::map<NodeId, Monitor*> & monitorsMap,
@@ -266,14 +311,10 @@ namespace Biips
         nodeIds_(range.DimPtr(), ValArray::Ptr(new ValArray(range.Length(),
                                                             BIIPS_REALNA))),
         discrete_(range.DimPtr(), ValArray::Ptr(new ValArray(range.Length(),
-                                                             Scalar(false)))),
-        conditionalNodeIds_(range.Length()), conditionalNodeNames_(range.Length())
+                                                             Scalar(false))))
   {
-    // set members
-    setMembers(nodeArray, monitorsMap, graph);
-    // set conditional nodes
-    setConditionalNodeIds(nodeArray, monitorsMap, graph);
-    setConditionalNodeNames(symtab);
+    setMembers(NodeArrayMonitorExport(nodeArray, range, monitorsMap,
+                                      nParticles, graph, symtab));
   }
 
   NodeArrayMonitor::NodeArrayMonitor(const NodeArray & nodeArray,
@@ -291,13 +332,10 @@ namespace Biips
         nodeIds_(range.DimPtr(), ValArray::Ptr(new ValArray(range.Length(),
                                                             BIIPS_REALNA))),
         discrete_(range.DimPtr(), ValArray::Ptr(new ValArray(range.Length(),
-                                                             Scalar(false)))),
-        conditionalNodeIds_(1, condNodes), conditionalNodeNames_(1)
+                                                             Scalar(false))))
   {
-    // set members
-    setMembers(nodeArray, monitorsMap, graph);
-    // set conditional node names
-    setConditionalNodeNames(symtab);
+    setMembers(NodeArrayMonitorExport(nodeArray, range, monitorsMap,
+                                      nParticles, graph, symtab, condNodes));
   }
 
 
@@ -315,13 +353,35 @@ namespace Biips
         nodeIds_(range.DimPtr(), ValArray::Ptr(new ValArray(range.Length(),
                                                             BIIPS_REALNA))),
         discrete_(range.DimPtr(), ValArray::Ptr(new ValArray(range.Length(),
-                                                             Scalar(false)))),
-        conditionalNodeIds_(1, pMonitor->GetConditionalNodes()), conditionalNodeNames_(1)
+                                                             Scalar(false))))
   {
-    // set members
-    setMembers(nodeArray, pMonitor, graph);
-    // set conditional nodes
-    setConditionalNodeNames(symtab);
+    setMembers(NodeArrayMonitorExport(nodeArray, range, pMonitor,
+                                      nParticles, graph, symtab));
+  }
+
+  template<typename T>
+  static typename Types<typename Types<T>::Array>::Array
+  conditionalNodePrefixes(const typename Types<T>::Array & sequence,
+                          const Types<Size>::Array & counts)
+  {
+    typename Types<typename Types<T>::Array>::Array prefixes;
+    prefixes.reserve(counts.size());
+    for (Size i = 0; i < counts.size(); ++i)
+      prefixes.push_back(typename Types<T>::Array(sequence.begin(),
+                                                  sequence.begin() + counts[i]));
+    return prefixes;
+  }
+
+  Types<Types<NodeId>::Array>::Array NodeArrayMonitor::GetConditionalNodeIds() const
+  {
+    return conditionalNodePrefixes<NodeId>(conditionalNodeIds_,
+                                           conditionalNodeCounts_);
+  }
+
+  Types<Types<String>::Array>::Array NodeArrayMonitor::GetConditionalNodeNames() const
+  {
+    return conditionalNodePrefixes<String>(conditionalNodeNames_,
+                                           conditionalNodeCounts_);
   }
 
   template<>
@@ -329,6 +389,8 @@ namespace Biips
                                                         const IndexRange & subRange,
                                                         const Graph & graph)
   {
+    Size len = range_.Length();
+
     // iterate the elements of the subrange
     for (IndexRangeIterator it_sub_range(subRange); !it_sub_range.AtEnd(); it_sub_range.Next())
     {
@@ -340,22 +402,18 @@ namespace Biips
       // compute the offset of the sub array
       Size sub_offset = subRange.GetOffset(it_sub_range);
 
-      value_.Values()[offset] = (*(graph.GetValues()[id]))[sub_offset];
+      for (Size k = 0; k < particleIndices_.size(); ++k)
+        value_.Values()[k * len + offset] = (*(graph.GetValues()[id]))[sub_offset];
     }
   }
 
   template<>
   void NodeArrayValue::addMonitoredNode<ColumnMajorOrder>(NodeId id,
                                                         const IndexRange & subRange,
-                                                        const Monitor* pMonitor,
-                                                        Size particleIndex)
+                                                        const Monitor* pMonitor)
   {
-    if (!pMonitor)
-      throw LogicError("Monitor::Ptr is null, in NodeArrayMonitor::addMonitoredNode.");
-    if (!pMonitor->Contains(id))
-      throw LogicError("Node is not monitored, in NodeArrayMonitor::addMonitoredNode.");
-
-    NodeMonitor node_monitor(id, pMonitor);
+    Size len = range_.Length();
+    const MonitorArchive & particle_values = pMonitor->GetNodeValues(id);
 
     // iterate the elements of the subrange
     for (IndexRangeIterator it_sub_range(subRange); !it_sub_range.AtEnd(); it_sub_range.Next())
@@ -368,27 +426,29 @@ namespace Biips
       // compute the offset of the sub array
       Size sub_offset = subRange.GetOffset(it_sub_range);
 
-      // iterate all the particles
-      value_.Values()[offset]
-          = (*(node_monitor.GetNodeValues()[particleIndex]))[sub_offset];
+      // iterate the chosen particles
+      for (Size k = 0; k < particleIndices_.size(); ++k)
+        value_.Values()[k * len + offset]
+            = particle_values(particleIndices_[k], sub_offset);
     }
   }
 
-  NodeArrayValue::NodeArrayValue(const NodeArray & nodeArray,
-                                 const IndexRange & range,
-                                 const Monitor* pMonitor,
-                                 Size particleIndex,
-                                 const Graph & graph) :
-    range_(range)
+  void NodeArrayValue::setValue(const NodeArray & nodeArray,
+                                const Monitor* pMonitor,
+                                const Graph & graph,
+                                Size nThreads)
   {
     if (!nodeArray.Range().Contains(range_))
       throw LogicError(String("NodeArrayMonitor: range ") + print(range_)
           + " is not contained in variable " + nodeArray.Name());
+    if (!pMonitor)
+      throw LogicError("Monitor::Ptr is null, in NodeArrayValue::setValue.");
+    for (Size k = 0; k < particleIndices_.size(); ++k)
+      if (particleIndices_[k] >= pMonitor->NParticles())
+        throw LogicError("Particle index out of range, in NodeArrayValue::setValue.");
 
-    // allocate memory
-    ValArray::Ptr
-        p_values_val(new ValArray(range_.Dim().Length(), BIIPS_REALNA));
-    value_.SetPtr(range_.DimPtr(), p_values_val);
+    Types<NodeId>::Array monitored_ids;
+    Types<IndexRange>::Array monitored_ranges;
 
     boost::bimap<NodeId, IndexRange>::const_iterator it_bimap =
         nodeArray.NodeIdRangeBimap().begin();
@@ -404,8 +464,70 @@ namespace Biips
       if (graph.GetObserved()[id])
         addObservedNode<StorageOrder> (id, sub_range, graph);
       else
-        addMonitoredNode<StorageOrder> (id, sub_range, pMonitor, particleIndex);
+      {
+        if (!pMonitor->Contains(id))
+          throw LogicError("Node is not monitored, in NodeArrayValue::setValue.");
+        monitored_ids.push_back(id);
+        monitored_ranges.push_back(sub_range);
+      }
     }
+
+    if (nThreads == 0)
+      nThreads = std::max(1u, std::thread::hardware_concurrency());
+    nThreads = std::max(1u, std::min(nThreads, Size(monitored_ids.size())));
+
+    // each thread gathers a block of consecutive subnodes
+    auto add_monitored_nodes = [&](Size t)
+    {
+      Size begin = t * monitored_ids.size() / nThreads;
+      Size end = (t + 1) * monitored_ids.size() / nThreads;
+      for (Size j = begin; j < end; ++j)
+        addMonitoredNode<StorageOrder> (monitored_ids[j], monitored_ranges[j],
+                                        pMonitor);
+    };
+
+    Types<std::thread>::Array workers;
+    for (Size t = 1; t < nThreads; ++t)
+      workers.push_back(std::thread(add_monitored_nodes, t));
+    // the calling thread is one of the workers
+    add_monitored_nodes(0);
+    for (Size t = 0; t < workers.size(); ++t)
+      workers[t].join();
+  }
+
+  NodeArrayValue::NodeArrayValue(const NodeArray & nodeArray,
+                                 const IndexRange & range,
+                                 const Monitor* pMonitor,
+                                 Size particleIndex,
+                                 const Graph & graph) :
+    range_(range), particleIndices_(1, particleIndex)
+  {
+    // allocate memory
+    ValArray::Ptr
+        p_values_val(new ValArray(range_.Dim().Length(), BIIPS_REALNA));
+    value_.SetPtr(range_.DimPtr(), p_values_val);
+
+    setValue(nodeArray, pMonitor, graph, 1);
+  }
+
+  NodeArrayValue::NodeArrayValue(const NodeArray & nodeArray,
+                                 const IndexRange & range,
+                                 const Monitor* pMonitor,
+                                 const Types<Size>::Array & particleIndices,
+                                 const Graph & graph,
+                                 Size nThreads) :
+    range_(range), particleIndices_(particleIndices)
+  {
+    // dimensions
+    DimArray::Ptr p_dim_particles(new DimArray(range_.Dim()));
+    p_dim_particles->push_back(particleIndices_.size());
+
+    // allocate memory
+    ValArray::Ptr p_values_val(new ValArray(p_dim_particles->Length(),
+                                            BIIPS_REALNA));
+    value_.SetPtr(p_dim_particles, p_values_val);
+
+    setValue(nodeArray, pMonitor, graph, nThreads);
   }
 
 }
@@ -3,14 +3,14 @@
  */
 
 #include "model/SymbolTable.hpp"
-#include "model/Model.hpp"
+#include "graph/Graph.hpp"
 #include "model/DeparseVisitor.hpp"
 
 namespace Biips
 {
 
-  SymbolTable::SymbolTable(Model & model) :
-      model_(model)
+  SymbolTable::SymbolTable(Graph & graph) :
+      graph_(graph)
   {
   }
 
@@ -20,7 +20,7 @@ namespace Biips
       throw RuntimeError(String("Name ") + name
                          + " already in use in symbol table");
 
-    NodeArray::Ptr p_node_array(new NodeArray(name, model_.graph(), dim));
+    NodeArray::Ptr p_node_array(new NodeArray(name, graph_, dim));
     nodeArraysMap_[name] = p_node_array;
   }
 
@@ -99,13 +99,13 @@ namespace Biips
     DirectParentNodeIdIterator it_parents, it_parents_end;
 
     boost::tie(it_parents, it_parents_end) =
-        model_.graph().GetParents(nodeId);
+        graph_.GetParents(nodeId);
     Size n_par = std::distance(it_parents, it_parents_end);
     Types<String>::Array par_names(n_par);
     for (Size i = 0; it_parents != it_parents_end; ++it_parents, ++i)
       par_names[i] = GetName(*it_parents);
 
-    return deparse(nodeId, model_.graph(), par_names);
+    return deparse(nodeId, graph_, par_names);
   }
 
   void SymbolTable::WriteData(std::map<String, MultiArray> const & dataMap)
@@ -131,22 +131,22 @@ namespace Biips
         it != logicChildrenByRank.end(); ++it)
     {
       NodeId id = it->second;
-      model_.graph().SampleValue(id, NULL, true);
+      graph_.SampleValue(id, NULL, true);
       if (!mcmc)
-        model_.graph().UpdateDiscreteness(id, stoChildrenByRank);
+        graph_.UpdateDiscreteness(id, stoChildrenByRank);
     }
 
     if (mcmc)
       return;
 
     // update stochastic children discreteness
-    for (Size rank = 0; rank < model_.graph().GetRanks().back(); ++rank)
+    for (Size rank = 0; rank < graph_.GetRanks().back(); ++rank)
     {
       if (!stoChildrenByRank.count(rank))
         continue;
 
       NodeId id = stoChildrenByRank.at(rank);
-      model_.graph().UpdateDiscreteness(id, stoChildrenByRank);
+      graph_.UpdateDiscreteness(id, stoChildrenByRank);
     }
   }
 
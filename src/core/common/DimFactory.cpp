@@ -0,0 +1,40 @@
+#include "common/DimFactory.hpp"
+
+namespace Biips
+{
+
+  bool ltDimArray::operator()(const DimArray & dim1,
+                              const DimArray & dim2) const
+  {
+    if (dim1.size() != dim2.size())
+      return dim1.size() < dim2.size();
+    return std::lexicographical_compare(dim1.begin(), dim1.end(),
+                                        dim2.begin(), dim2.end());
+  }
+
+  DimFactory::DimFactory()
+  {
+    dimMap_[*P_SCALAR_DIM] = P_SCALAR_DIM;
+  }
+
+  const DimArray::Ptr & DimFactory::GetDim(const DimArray & dim)
+  {
+    std::map<DimArray, DimArray::Ptr, ltDimArray>::iterator it =
+        dimMap_.find(dim);
+    if (it == dimMap_.end())
+      it = dimMap_.insert(std::make_pair(dim, DimArray::Ptr(new DimArray(dim)))).first;
+    return it->second;
+  }
+
+  std::size_t DimFactory::MemoryUsage() const
+  {
+    // map node, key copy and shared copy of each dimension
+    std::size_t bytes = 0;
+    std::map<DimArray, DimArray::Ptr, ltDimArray>::const_iterator it;
+    for (it = dimMap_.begin(); it != dimMap_.end(); ++it)
+      bytes += 4 * sizeof(void *) + sizeof(*it) + sizeof(DimArray)
+               + 2 * it->first.capacity() * sizeof(Size);
+    return bytes;
+  }
+
+}
@@ -0,0 +1,160 @@
+#include "common/StateStream.hpp"
+#include "common/Error.hpp"
+
+#include <algorithm>
+#include <istream>
+#include <ostream>
+
+namespace Biips
+{
+
+  void StateWriter::writeBytes(const void * data, Size n)
+  {
+    os_.write(static_cast<const char *>(data), n);
+    if (!os_)
+      throw RuntimeError("Failed to write sampler state.");
+  }
+
+  void StateWriter::Write(const String & str)
+  {
+    Write(Size(str.size()));
+    writeBytes(str.data(), str.size());
+  }
+
+  void StateWriter::Write(const Types<Size>::Array & vec)
+  {
+    Write(Size(vec.size()));
+    if (!vec.empty())
+      writeBytes(&vec[0], vec.size() * sizeof(Size));
+  }
+
+  void StateWriter::Write(const Types<Int>::Array & vec)
+  {
+    Write(Size(vec.size()));
+    if (!vec.empty())
+      writeBytes(&vec[0], vec.size() * sizeof(Int));
+  }
+
+  void StateWriter::Write(const Flags & flags)
+  {
+    Write(Size(flags.size()));
+    String bytes(flags.begin(), flags.end());
+    writeBytes(bytes.data(), bytes.size());
+  }
+
+  void StateWriter::Write(const ValArray & vec)
+  {
+    Write(Size(vec.size()));
+    if (!vec.empty())
+      writeBytes(&vec[0], vec.size() * sizeof(Scalar));
+  }
+
+  void StateWriter::Write(const Types<ShortScalar>::Array & vec)
+  {
+    Write(Size(vec.size()));
+    if (!vec.empty())
+      writeBytes(&vec[0], vec.size() * sizeof(ShortScalar));
+  }
+
+  void StateWriter::Write(const ValArray::Ptr & pStorage)
+  {
+    // 0 is a null storage, k the k-th written storage
+    if (!pStorage)
+    {
+      Write(Size(0));
+      return;
+    }
+    std::map<const ValArray *, Size>::const_iterator it =
+        storageIndices_.find(pStorage.get());
+    if (it != storageIndices_.end())
+    {
+      Write(it->second);
+      return;
+    }
+    Size index = storageIndices_.size() + 1;
+    storageIndices_[pStorage.get()] = index;
+    Write(index);
+    Write(*pStorage);
+  }
+
+  void StateReader::readBytes(void * data, Size n)
+  {
+    is_.read(static_cast<char *>(data), n);
+    if (!is_)
+      throw RuntimeError("Failed to read sampler state: unexpected end of stream.");
+  }
+
+  void StateReader::Read(String & str)
+  {
+    Size n = Get<Size>();
+    str.resize(n);
+    if (n)
+      readBytes(&str[0], n);
+  }
+
+  void StateReader::Read(Types<Size>::Array & vec)
+  {
+    vec.resize(Get<Size>());
+    if (!vec.empty())
+      readBytes(&vec[0], vec.size() * sizeof(Size));
+  }
+
+  void StateReader::Read(Types<Int>::Array & vec)
+  {
+    vec.resize(Get<Size>());
+    if (!vec.empty())
+      readBytes(&vec[0], vec.size() * sizeof(Int));
+  }
+
+  void StateReader::Read(Flags & flags)
+  {
+    String bytes(Get<Size>(), '\0');
+    if (!bytes.empty())
+      readBytes(&bytes[0], bytes.size());
+    flags.assign(bytes.begin(), bytes.end());
+  }
+
+  void StateReader::Read(ValArray & vec)
+  {
+    vec.resize(Get<Size>());
+    if (!vec.empty())
+      readBytes(&vec[0], vec.size() * sizeof(Scalar));
+  }
+
+  void StateReader::Read(Types<ShortScalar>::Array & vec)
+  {
+    vec.resize(Get<Size>());
+    if (!vec.empty())
+      readBytes(&vec[0], vec.size() * sizeof(ShortScalar));
+  }
+
+  void StateReader::Read(ValArray::Ptr & pStorage)
+  {
+    Size index = Get<Size>();
+    if (index == 0)
+      pStorage.reset();
+    else if (index <= storages_.size())
+      pStorage = storages_[index - 1];
+    else if (index == storages_.size() + 1)
+    {
+      pStorage.reset(new ValArray());
+      Read(*pStorage);
+      storages_.push_back(pStorage);
+    }
+    else
+      throw RuntimeError("Failed to read sampler state: invalid storage index.");
+  }
+
+  void StateReader::ReadTag(const String & tag)
+  {
+    // a misplaced tag must not be read as a long string
+    Size n = Get<Size>();
+    String read_tag(std::min(n, Size(tag.size())), '\0');
+    if (!read_tag.empty())
+      readBytes(&read_tag[0], read_tag.size());
+    if (n != tag.size() || read_tag != tag)
+      throw RuntimeError(String("Failed to read sampler state: expected ")
+                         + tag + ", found " + read_tag + ".");
+  }
+
+}
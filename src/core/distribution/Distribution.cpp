@@ -1,6 +1,8 @@
 #include "distribution/Distribution.hpp"
 #include "iostream/std_ostream.hpp"
 
+#include <algorithm>
+
 namespace Biips
 {
 
@@ -19,6 +21,25 @@ namespace Biips
     return CheckParamValues(paramValues);
   }
 
+  Bool Distribution::CheckVaryingParamValues(const NumArray::Array & paramValues,
+                                             const Flags & varyingMask) const
+  {
+    if (std::find(varyingMask.begin(), varyingMask.end(), true) == varyingMask.end())
+      return true;
+    return CheckParamValues(paramValues);
+  }
+
+  Bool Distribution::CheckDensityVaryingParamValues(const NumArray & x,
+                                                    const NumArray::Array & paramValues,
+                                                    const Flags & varyingMask,
+                                                    Bool varyingX) const
+  {
+    if (!varyingX
+        && std::find(varyingMask.begin(), varyingMask.end(), true) == varyingMask.end())
+      return true;
+    return CheckDensityParamValues(x, paramValues);
+  }
+
   DimArray Distribution::Dim(const Types<DimArray::Ptr>::Array & paramDims) const
   {
     if (!CheckParamDims(paramDims))
@@ -31,24 +52,52 @@ namespace Biips
   void Distribution::Sample(ValArray & values,
                             const NumArray::Array & paramValues,
                             const NumArray::Pair & boundValues,
-                            Rng & rng) const
+                            Rng & rng,
+                            Bool checkParams) const
   {
-    if (!CheckParamValues(paramValues))
+    if (checkParams && !CheckParamValues(paramValues))
       throw RuntimeError(String("Invalid parameters values in Sample method for distribution ")
           + name_ + ": " + print(paramValues));
 
     sample(values, paramValues, boundValues, rng);
   }
 
+  void Distribution::SampleUniform(ValArray & values,
+                                   const NumArray::Array & paramValues,
+                                   const NumArray::Pair & boundValues,
+                                   const Scalar * uniforms,
+                                   Bool checkParams) const
+  {
+    if (checkParams && !CheckParamValues(paramValues))
+      throw RuntimeError(String("Invalid parameters values in SampleUniform method for distribution ")
+          + name_ + ": " + print(paramValues));
+
+    sampleUniform(values, paramValues, boundValues, uniforms);
+  }
+
+  void Distribution::sampleUniform(ValArray & values,
+                                   const NumArray::Array & paramValues,
+                                   const NumArray::Pair & boundValues,
+                                   const Scalar * uniforms) const
+  {
+    throw LogicError(String("Distribution ") + name_
+                     + " can not be sampled from uniforms.");
+  }
+
   Scalar Distribution::LogDensity(const NumArray & x,
                                   const NumArray::Array & paramValues,
-                                  const NumArray::Pair & boundValues) const
+                                  const NumArray::Pair & boundValues,
+                                  Bool checkParams,
+                                  PDFType type) const
   {
-    if (!CheckDensityParamValues(x, paramValues))
+    if (checkParams && !CheckDensityParamValues(x, paramValues))
       throw RuntimeError(String("Invalid parameters values in LogDensity method for distribution ")
           + name_ + ": " + print(paramValues));
 
-    return logDensity(x, paramValues, boundValues);
+    if (type == PDF_FULL)
+      return logDensity(x, paramValues, boundValues);
+
+    return partialLogDensity(x, paramValues, boundValues, type);
   }
 
   void Distribution::FixedUnboundedSupport(ValArray & lower,
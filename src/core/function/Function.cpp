@@ -23,9 +23,10 @@ namespace Biips
     return dim(paramDims).Drop();
   }
 
-  void Function::Eval(ValArray & values, const NumArray::Array & paramValues) const
+  void Function::Eval(ValArray & values, const NumArray::Array & paramValues,
+                      Bool checkParams) const
   {
-    if (!CheckParamValues(paramValues)) {
+    if (checkParams && !CheckParamValues(paramValues)) {
       throw RuntimeError(String("Invalid parameters values for function ")
           + name_ + ": " + print(paramValues));
     }
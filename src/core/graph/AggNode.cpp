@@ -7,19 +7,56 @@ namespace Biips
 
   AggNode::AggNode(const DimArray::Ptr pDim,
                    const Types<NodeId>::Array & parameters,
-                   const Types<Size>::Array & offsets) :
-    LogicalNode(pDim, parameters), offsets_(offsets)
+                   const Types<Size>::Array & offsets,
+                   NodeIdPool & parentsPool) :
+    LogicalNode(pDim, parameters, parentsPool), offsets_(offsets)
   {
     Size len = pDim->Length();
     if (len != parameters.size() || len != offsets.size())
       throw LogicError("Can not create aggregate node: dimensions mismatch.");
+
+    buildGatherPlan();
+  }
+
+  void AggNode::buildGatherPlan()
+  {
+    std::map<NodeId, Size> source_indices;
+    for (Size i = 0; i < parents_.size(); ++i)
+    {
+      // extend the last run if the element follows it in the same parameter
+      if (i > 0 && parents_[i] == parents_[i - 1]
+          && offsets_[i] == offsets_[i - 1] + 1)
+      {
+        ++runs_.back().length;
+        continue;
+      }
+
+      if (!source_indices.count(parents_[i]))
+      {
+        source_indices[parents_[i]] = sources_.size();
+        sources_.push_back(parents_[i]);
+      }
+
+      GatherRun run;
+      run.source = source_indices[parents_[i]];
+      run.srcOffset = offsets_[i];
+      run.dstOffset = i;
+      run.length = 1;
+      runs_.push_back(run);
+    }
   }
 
-  void AggNode::Eval(ValArray & values, const NumArray::Array & paramValues) const
+  void AggNode::Eval(ValArray & values, const NumArray::Array & paramValues,
+                     Bool checkParams) const
   // TODO checks
   {
-    for (Size i = 0; i < Dim().Length(); ++i)
-      values[i] = paramValues[i].Values()[offsets_[i]];
+    for (Size k = 0; k < runs_.size(); ++k)
+    {
+      const GatherRun & run = runs_[k];
+      const ValArray & src = paramValues[run.source].Values();
+      std::copy(&src[run.srcOffset], &src[run.srcOffset] + run.length,
+                &values[run.dstOffset]);
+    }
   }
 
 }
@@ -4,8 +4,8 @@ namespace Biips
 {
 
   FuncNode::FuncNode(const DimArray::Ptr pDim, const Function::Ptr & pFunc,
-      const Types<NodeId>::Array & parameters)
-    : LogicalNode(pDim, parameters), pFunc_(pFunc)
+      const Types<NodeId>::Array & parameters, NodeIdPool & parentsPool)
+    : LogicalNode(pDim, parameters, parentsPool), pFunc_(pFunc)
   {
     if (!pFunc_)
       throw LogicError("Can not create LogicalNode: Function::Ptr is NULL.");
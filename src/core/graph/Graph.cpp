@@ -1,6 +1,4 @@
-#include <boost/graph/topological_sort.hpp>
-#include <boost/graph/depth_first_search.hpp>
-#include <boost/graph/graph_utility.hpp>
+#include <boost/make_shared.hpp>
 
 #include "graph/Graph.hpp"
 #include "sampler/DataNodeSampler.hpp"
@@ -17,6 +15,8 @@ namespace Biips
   NodeId Graph::AddConstantNode(const DimArray::Ptr & pDim,
                                 const Types<StorageType>::Ptr & pValue)
   {
+    checkNotFrozen();
+
     if (!pDim)
       throw LogicError("Can not add constant node: DimArray::Ptr is NULL.");
 
@@ -26,11 +26,12 @@ namespace Biips
     if (pDim->Length() != pValue->size())
       throw LogicError("Can not add constant node: values size does not match dimension.");
 
-    Node::Ptr new_node(new ConstantNode(pDim));
-    NodeId node_id = boost::add_vertex(parentsGraph_);
-    boost::put(boost::vertex_node_ptr, parentsGraph_, node_id, new_node);
-    boost::put(boost::vertex_observed, parentsGraph_, node_id, true);
-    boost::put(boost::vertex_value, parentsGraph_, node_id, pValue);
+    // one allocation for the node and its shared count
+    Node::Ptr new_node =
+        boost::make_shared<ConstantNode>(dimFactory_.GetDim(*pDim));
+    NodeId node_id = addVertex(new_node);
+    observed_[node_id] = true;
+    values_[node_id] = pValue;
 
     // set dicreteness
     Bool discrete = true;
@@ -42,7 +43,7 @@ namespace Biips
         break;
       }
     }
-    boost::put(boost::vertex_discrete, parentsGraph_, node_id, discrete);
+    discrete_[node_id] = discrete;
 
     nodesSummaryMap_[CONSTANT] += 1;
     builtFlag_ = false; // TODO also set to false when SetParameter is called
@@ -53,15 +54,15 @@ namespace Biips
                            const Types<NodeId>::Array & parameters,
                            const Types<Size>::Array & offsets)
   {
-    Node::Ptr new_node(new AggNode(pDim, parameters, offsets));
-    NodeId node_id = boost::add_vertex(parentsGraph_);
+    checkNotFrozen();
 
-    boost::put(boost::vertex_node_ptr, parentsGraph_, node_id, new_node);
+    if (!pDim)
+      throw LogicError("Can not add aggregate node: DimArray::Ptr is NULL.");
 
-    for (Size i = 0; i < parameters.size(); ++i)
-    {
-      boost::add_edge(node_id, parameters[i], parentsGraph_); // TODO check parameters
-    }
+    Node::Ptr new_node =
+        boost::make_shared<AggNode>(dimFactory_.GetDim(*pDim), parameters,
+                                    offsets, parentsPool_);
+    NodeId node_id = addVertex(new_node);
 
     Bool observed = false;
     for (Size i = 0; i < parameters.size(); ++i)
@@ -75,7 +76,7 @@ namespace Biips
       }
     }
 
-    boost::put(boost::vertex_observed, parentsGraph_, node_id, observed);
+    observed_[node_id] = observed;
     if (observed)
       SampleValue(node_id, NULL, true);
 
@@ -89,7 +90,7 @@ namespace Biips
         break;
       }
     }
-    boost::put(boost::vertex_discrete, parentsGraph_, node_id, discrete);
+    discrete_[node_id] = discrete;
 
     nodesSummaryMap_[LOGICAL] += 1;
     if (!observed)
@@ -99,6 +100,67 @@ namespace Biips
     return node_id;
   }
 
+  NodeId Graph::addVertex(const Node::Ptr & pNode)
+  {
+    NodeId node_id = nodes_.size();
+
+    // parents are existing nodes, hence the graph is acyclic
+    const ParentIds & parents = pNode->Parents();
+    for (Size i = 0; i < parents.size(); ++i)
+    {
+      if (parents[i] >= node_id)
+      {
+        parentsPool_.Pop(parents);
+        throw LogicError("Can not add node: invalid parent node id.");
+      }
+    }
+
+    nodes_.push_back(pNode);
+    values_.push_back(ValArray::Ptr());
+    observed_.push_back(false);
+    discrete_.push_back(false);
+
+    // edges from the parents
+    childrenLists_.push_back(Types<NodeId>::Array());
+    for (Size i = 0; i < parents.size(); ++i)
+      childrenLists_[parents[i]].push_back(node_id);
+
+    return node_id;
+  }
+
+  void Graph::checkNotFrozen() const
+  {
+    if (frozen_)
+      throw LogicError("Can not modify a frozen graph.");
+  }
+
+  void Graph::Freeze()
+  {
+    if (!builtFlag_)
+      throw LogicError("Can not freeze graph: the graph is not built.");
+    if (frozen_)
+      return;
+
+    childrenOffsets_.assign(GetSize() + 1, 0);
+    for (NodeId id = 0; id < GetSize(); ++id)
+      childrenOffsets_[id + 1] = childrenOffsets_[id] + childrenLists_[id].size();
+
+    childrenIds_.clear();
+    childrenIds_.reserve(childrenOffsets_.back());
+    for (NodeId id = 0; id < GetSize(); ++id)
+      childrenIds_.insert(childrenIds_.end(), childrenLists_[id].begin(),
+                          childrenLists_[id].end());
+
+    // release the lists and the spare capacity
+    Types<Types<NodeId>::Array>::Array().swap(childrenLists_);
+    Types<Node::Ptr>::Array(nodes_).swap(nodes_);
+    NodeValues(values_).swap(values_);
+    Flags(observed_).swap(observed_);
+    Flags(discrete_).swap(discrete_);
+
+    frozen_ = true;
+  }
+
   // TODO: to be exposed like getParamValues
   Types<DimArray::Ptr>::Array Graph::getParamDims(const Types<NodeId>::Array parameters) const
   {
@@ -112,21 +174,19 @@ namespace Biips
   NodeId Graph::AddLogicalNode(const Function::Ptr & pFunc,
                                const Types<NodeId>::Array & parameters)
   {
+    checkNotFrozen();
+
     Types<DimArray::Ptr>::Array param_dims = getParamDims(parameters);
 
     if (!pFunc)
       throw LogicError("Can not add logical node: Function::Ptr is NULL.");
 
-    DimArray::Ptr pDim(new DimArray(pFunc->Dim(param_dims)));
+    const DimArray::Ptr & pDim = dimFactory_.GetDim(pFunc->Dim(param_dims));
 
-    Node::Ptr new_node(new FuncNode(pDim, pFunc, parameters));
-    NodeId node_id = boost::add_vertex(parentsGraph_);
-    boost::put(boost::vertex_node_ptr, parentsGraph_, node_id, new_node);
-
-    for (Size i = 0; i < parameters.size(); ++i)
-    {
-      boost::add_edge(node_id, parameters[i], parentsGraph_); // TODO check parameters
-    }
+    Node::Ptr new_node =
+        boost::make_shared<FuncNode>(pDim, pFunc, parameters,
+                                     parentsPool_);
+    NodeId node_id = addVertex(new_node);
 
     Bool observed = false;
     for (Size i = 0; i < parameters.size(); ++i)
@@ -140,7 +200,7 @@ namespace Biips
       }
     }
 
-    boost::put(boost::vertex_observed, parentsGraph_, node_id, observed);
+    observed_[node_id] = observed;
     if (observed)
       SampleValue(node_id, NULL, true);
 
@@ -149,10 +209,7 @@ namespace Biips
     for (Size i = 0; i < parameters.size(); ++i)
       mask[i] = GetDiscrete()[parameters[i]];
 
-    boost::put(boost::vertex_discrete,
-               parentsGraph_,
-               node_id,
-               pFunc->IsDiscreteValued(mask));
+    discrete_[node_id] = pFunc->IsDiscreteValued(mask);
 
     nodesSummaryMap_[LOGICAL] += 1;
     if (!observed)
@@ -168,26 +225,21 @@ namespace Biips
                                   NodeId lower,
                                   NodeId upper)
   {
+    checkNotFrozen();
+
     Types<DimArray::Ptr>::Array param_dims = getParamDims(parameters);
 
     if (!pDist)
       throw LogicError("Can not add stochastic node: Distribution::Ptr is NULL.");
 
-    DimArray::Ptr pDim(new DimArray(pDist->Dim(param_dims)));
-
-    Node::Ptr new_node(new StochasticNode(pDim,
-                                          pDist,
-                                          parameters,
-                                          lower,
-                                          upper));
-    NodeId node_id = boost::add_vertex(parentsGraph_);
-    boost::put(boost::vertex_node_ptr, parentsGraph_, node_id, new_node);
-    boost::put(boost::vertex_observed, parentsGraph_, node_id, observed);
+    const DimArray::Ptr & pDim = dimFactory_.GetDim(pDist->Dim(param_dims));
 
-    for (Size i = 0; i < parameters.size(); ++i)
-    {
-      boost::add_edge(node_id, parameters[i], parentsGraph_); // TODO check parameters (discreteness)
-    }
+    Node::Ptr new_node =
+        boost::make_shared<StochasticNode>(pDim, pDist, parameters,
+                                           parentsPool_, lower,
+                                           upper);
+    NodeId node_id = addVertex(new_node);
+    observed_[node_id] = observed;
 
     //check boundaries
     if (lower != NULL_NODEID)
@@ -196,8 +248,6 @@ namespace Biips
         throw DistError(pDist, "Distribution cannot be bounded");
       if (*(GetNode(lower).DimPtr()) != (*pDim))
         throw DistError(pDist, "Dimension mismatch when setting lower bounds");
-
-      boost::add_edge(node_id, lower, parentsGraph_);
     }
     if (upper != NULL_NODEID)
     {
@@ -205,8 +255,6 @@ namespace Biips
         throw DistError(pDist, "Distribution cannot be bounded");
       if (*(GetNode(lower).DimPtr()) != (*pDim))
         throw DistError(pDist, "Dimension mismatch when setting upper bounds");
-
-      boost::add_edge(node_id, upper, parentsGraph_);
     }
 
     //check discreteness of parents
@@ -217,10 +265,7 @@ namespace Biips
       throw DistError(pDist, "Failed check for discrete-valued parameters");
 
     //set discreteness
-    boost::put(boost::vertex_discrete,
-               parentsGraph_,
-               node_id,
-               pDist->IsDiscreteValued(mask));
+    discrete_[node_id] = pDist->IsDiscreteValued(mask);
 
     nodesSummaryMap_[STOCHASTIC] += 1;
     if (!observed)
@@ -256,6 +301,8 @@ namespace Biips
   void Graph::UpdateDiscreteness(NodeId nodeId,
                                  std::map<Size, NodeId> & stoChildrenByRank)
   {
+    checkNotFrozen();
+
     Bool discrete_changed = false;
     switch (GetNode(nodeId).GetType())
     {
@@ -268,7 +315,7 @@ namespace Biips
           {
             if (!checkInteger((*GetValues()[nodeId])[i]))
             {
-              boost::put(boost::vertex_discrete, parentsGraph_, nodeId, false);
+              discrete_[nodeId] = false;
               discrete_changed = true;
               break;
             }
@@ -286,7 +333,7 @@ namespace Biips
           Bool discrete = true;
           const LogicalNode & l_node =
               static_cast<const LogicalNode &>(GetNode(nodeId));
-          const Types<NodeId>::Array & parameters = l_node.Parents();
+          const ParentIds & parameters = l_node.Parents();
 
           if (l_node.IsFunction()) // FuncNode
           {
@@ -308,7 +355,7 @@ namespace Biips
             }
           }
 
-          boost::put(boost::vertex_discrete, parentsGraph_, nodeId, discrete);
+          discrete_[nodeId] = discrete;
           discrete_changed = !discrete;
         }
         break;
@@ -321,7 +368,7 @@ namespace Biips
         const StochasticNode & s_node =
             static_cast<const StochasticNode &>(GetNode(nodeId));
 
-        const Types<NodeId>::Array & parameters = s_node.Parents();
+        const ParentIds & parameters = s_node.Parents();
         Flags mask(parameters.size());
         for (Size i = 0; i < parameters.size(); ++i)
           mask[i] = GetDiscrete()[parameters[i]];
@@ -333,7 +380,7 @@ namespace Biips
         if (GetDiscrete()[nodeId])
         {
           Bool discrete = s_node.PriorPtr()->IsDiscreteValued(mask);
-          boost::put(boost::vertex_discrete, parentsGraph_, nodeId, discrete);
+          discrete_[nodeId] = discrete;
 
           if (discrete)
           {
@@ -392,6 +439,8 @@ namespace Biips
 
   void Graph::PopNode()
   {
+    checkNotFrozen();
+
     if (Empty())
       throw LogicError("Can not pop node: the graph is empty.");
 
@@ -402,8 +451,6 @@ namespace Biips
     if (it_children != it_children_end)
       throw LogicError("Last inserted node can not have children.");
 
-    boost::clear_vertex(last_node_id, parentsGraph_);
-
     switch (GetNode(last_node_id).GetType())
     {
       case CONSTANT:
@@ -424,7 +471,17 @@ namespace Biips
         break;
 
     }
-    boost::remove_vertex(last_node_id, parentsGraph_);
+    // the last node is at the end of the children lists of its parents
+    const ParentIds & parents = GetNode(last_node_id).Parents();
+    for (Size i = 0; i < parents.size(); ++i)
+      childrenLists_[parents[i]].pop_back();
+    parentsPool_.Pop(parents);
+
+    nodes_.pop_back();
+    values_.pop_back();
+    observed_.pop_back();
+    discrete_.pop_back();
+    childrenLists_.pop_back();
 
     builtFlag_ = false;
   }
@@ -561,77 +618,74 @@ namespace Biips
   {
     ParentIterator it_direct_parents, it_direct_parents_end;
 
-    stochasticParents_.clear();
-    stochasticParents_.resize(GetSize());
+    stochasticParents_.Reset(GetSize());
 
+    // the stochastic parents of a node are its direct stochastic parents
+    // merged with the stochastic parents of its other direct parents
+    Types<NodeId>::Array stoch_parents, merged_parents;
     for (Types<NodeId>::ConstIterator it_nodes = topoSort_.begin();
         it_nodes != topoSort_.end(); ++it_nodes)
     {
+      stoch_parents.clear();
+      merged_parents.clear();
       boost::tie(it_direct_parents, it_direct_parents_end) =
-          boost::adjacent_vertices(*it_nodes, parentsGraph_);
+          GetParents(*it_nodes);
       for (; it_direct_parents != it_direct_parents_end; ++it_direct_parents)
       {
         if (GetNode(*it_direct_parents).GetType() == STOCHASTIC)
-          stochasticParents_[*it_nodes].insert(*it_direct_parents);
+          stoch_parents.push_back(*it_direct_parents);
         else
-          stochasticParents_[*it_nodes].insert(stochasticParents_[*it_direct_parents].begin(),
-                                               stochasticParents_[*it_direct_parents].end());
+          merged_parents.push_back(*it_direct_parents);
       }
+      stochasticParents_.Merge(*it_nodes, stoch_parents, merged_parents);
     }
+    stochasticParents_.Shrink();
   }
 
   void Graph::buildStochasticChildren()
   {
     ChildIterator it_direct_children, it_direct_children_end;
 
-    stochasticChildren_.clear();
-    stochasticChildren_.resize(GetSize());
+    stochasticChildren_.Reset(GetSize());
 
+    Types<NodeId>::Array stoch_children, merged_children;
     for (Types<NodeId>::Array::const_reverse_iterator rit_nodes =
         topoSort_.rbegin(); rit_nodes != topoSort_.rend(); ++rit_nodes)
     {
+      stoch_children.clear();
+      merged_children.clear();
       boost::tie(it_direct_children, it_direct_children_end) =
-          boost::adjacent_vertices(*rit_nodes, childrenGraph_);
+          GetChildren(*rit_nodes);
       for (; it_direct_children != it_direct_children_end; ++it_direct_children)
       {
         if (GetNode(*it_direct_children).GetType() == STOCHASTIC)
-          stochasticChildren_[*rit_nodes].insert(*it_direct_children);
+          stoch_children.push_back(*it_direct_children);
         else
-          stochasticChildren_[*rit_nodes].insert(stochasticChildren_[*it_direct_children].begin(),
-                                                 stochasticChildren_[*it_direct_children].end());
+          merged_children.push_back(*it_direct_children);
       }
+      stochasticChildren_.Merge(*rit_nodes, stoch_children, merged_children);
     }
+    stochasticChildren_.Shrink();
   }
 
-  struct cycle_detector: public boost::dfs_visitor<>
+  Bool Graph::HasCycle() const
   {
-    cycle_detector(bool& has_cycle) :
-        m_has_cycle(has_cycle)
-    {
-    }
-
-    template<class Edge, class Graph>
-    void back_edge(Edge, Graph&)
+    // nodes are added after their parents, but check it anyway
+    for (NodeId id = 0; id < GetSize(); ++id)
     {
-      m_has_cycle = true;
+      const ParentIds & parents = GetNode(id).Parents();
+      for (Size i = 0; i < parents.size(); ++i)
+      {
+        if (parents[i] >= id)
+          return true;
+      }
     }
-  protected:
-    bool& m_has_cycle;
-  };
-
-  Bool Graph::HasCycle() const
-  {
-    // are there any cycles in the graph?
-    Bool has_cycle = false;
-    cycle_detector vis(has_cycle);
-    boost::depth_first_search(parentsGraph_, boost::visitor(vis));
-    return has_cycle;
+    return false;
   }
 
   void Graph::buildLikelihoodChildren()
   {
-    likelihoodChildren_.clear();
-    likelihoodChildren_.resize(GetSize());
+    likelihoodChildren_.Reset(GetSize());
 
     for (Types<NodeId>::ConstIterator it_nodes = topoSort_.begin();
         it_nodes != topoSort_.end(); ++it_nodes)
@@ -639,6 +693,8 @@ namespace Biips
       if (GetNode(*it_nodes).GetType() != STOCHASTIC)
         continue;
 
+      likelihoodChildren_.Open(*it_nodes);
+
       StochasticChildIterator it_offspring, it_offspring_end;
       boost::tie(it_offspring, it_offspring_end) =
           GetStochasticChildren(*it_nodes);
@@ -648,9 +704,81 @@ namespace Biips
           continue;
         if (anyUnknownParent(*it_offspring, *it_nodes, *this))
           continue;
-        likelihoodChildren_[*it_nodes].insert(*it_offspring);
+        likelihoodChildren_.PushBack(*it_nodes, *it_offspring);
       }
     }
+    likelihoodChildren_.Shrink();
+  }
+
+  void Graph::updateLatestUnobsRank(NodeId nodeId)
+  {
+    switch (GetNode(nodeId).GetType())
+    {
+      case STOCHASTIC:
+        latestUnobsRanks_[nodeId] =
+            GetObserved()[nodeId] ? BIIPS_SIZENA : ranks_[nodeId];
+        break;
+      case LOGICAL:
+      {
+        Size latest = BIIPS_SIZENA;
+        StochasticParentIterator it_parents, it_parents_end;
+        boost::tie(it_parents, it_parents_end) = GetStochasticParents(nodeId);
+        for (; it_parents != it_parents_end; ++it_parents)
+        {
+          if (GetObserved()[*it_parents])
+            continue;
+          if (latest == BIIPS_SIZENA || ranks_[*it_parents] > latest)
+            latest = ranks_[*it_parents];
+        }
+        latestUnobsRanks_[nodeId] = latest;
+        break;
+      }
+      default:
+        latestUnobsRanks_[nodeId] = BIIPS_SIZENA;
+        break;
+    }
+  }
+
+  void Graph::buildLatestUnobsRanks()
+  {
+    latestUnobsRanks_.assign(GetSize(), BIIPS_SIZENA);
+
+    for (Types<NodeId>::ConstIterator it_nodes = topoSort_.begin();
+        it_nodes != topoSort_.end(); ++it_nodes)
+      updateLatestUnobsRank(*it_nodes);
+  }
+
+  // collects the logical descendants of nodeId reachable through
+  // logical nodes only, i.e. the nodes having it as stochastic parent
+  static void getLogicalOffspringByRank(const Graph & graph, NodeId nodeId,
+                                        std::map<Size, NodeId> & offspringByRank)
+  {
+    GraphTypes::ChildIterator it_child, it_child_end;
+    boost::tie(it_child, it_child_end) = graph.GetChildren(nodeId);
+    for (; it_child != it_child_end; ++it_child)
+    {
+      if (graph.GetNode(*it_child).GetType() != LOGICAL)
+        continue;
+      Size rank = graph.GetRanks()[*it_child];
+      if (offspringByRank.count(rank))
+        continue;
+      offspringByRank[rank] = *it_child;
+      getLogicalOffspringByRank(graph, *it_child, offspringByRank);
+    }
+  }
+
+  void Graph::updateLatestUnobsRanks(NodeId stochId)
+  {
+    if (!builtFlag_ || dataGraph_)
+      return;
+
+    updateLatestUnobsRank(stochId);
+
+    std::map<Size, NodeId> offspring_by_rank;
+    getLogicalOffspringByRank(*this, stochId, offspring_by_rank);
+    for (std::map<Size, NodeId>::const_iterator it = offspring_by_rank.begin();
+        it != offspring_by_rank.end(); ++it)
+      updateLatestUnobsRank(it->second);
   }
 
   void Graph::Build()
@@ -673,17 +801,25 @@ namespace Biips
     builtFlag_ = true;
 
     if (!dataGraph_)
+    {
+      buildLatestUnobsRanks();
       buildLikelihoodChildren();
+    }
   }
 
   Types<Graph::ParentIterator>::Pair Graph::GetParents(NodeId nodeId) const
   {
-    return boost::adjacent_vertices(nodeId, parentsGraph_);
+    const ParentIds & parents = GetNode(nodeId).Parents();
+    return std::make_pair(parents.begin(), parents.end());
   }
 
   Types<Graph::ChildIterator>::Pair Graph::GetChildren(NodeId nodeId) const
   {
-    return boost::adjacent_vertices(nodeId, childrenGraph_);
+    if (frozen_)
+      return std::make_pair(childrenIds_.begin() + childrenOffsets_[nodeId],
+                            childrenIds_.begin() + childrenOffsets_[nodeId + 1]);
+
+    return iterRange(childrenLists_[nodeId]);
   }
 
   Types<Graph::StochasticParentIterator>::Pair Graph::GetStochasticParents(NodeId nodeId) const
@@ -691,8 +827,10 @@ namespace Biips
     if (!builtFlag_)
       throw LogicError("Can not access a graph that is not built.");
 
-    return std::make_pair(stochasticParents_.at(nodeId).begin(),
-                          stochasticParents_.at(nodeId).end());
+    if (nodeId >= stochasticParents_.NbNodes())
+      throw std::out_of_range("Graph: node id out of range.");
+
+    return stochasticParents_.Range(nodeId);
   }
 
   Types<Graph::StochasticChildIterator>::Pair Graph::GetStochasticChildren(NodeId nodeId) const
@@ -700,16 +838,20 @@ namespace Biips
     if (!builtFlag_)
       throw LogicError("Can not access a graph that is not built.");
 
-    return std::make_pair(stochasticChildren_.at(nodeId).begin(),
-                          stochasticChildren_.at(nodeId).end());
+    if (nodeId >= stochasticChildren_.NbNodes())
+      throw std::out_of_range("Graph: node id out of range.");
+
+    return stochasticChildren_.Range(nodeId);
   }
 
   Types<Graph::LikelihoodChildIterator>::Pair Graph::GetLikelihoodChildren(NodeId nodeId) const
   {
     if (!builtFlag_)
       throw LogicError("Can not access a graph that is not built.");
-    return std::make_pair(likelihoodChildren_.at(nodeId).begin(),
-                          likelihoodChildren_.at(nodeId).end());
+    if (nodeId >= likelihoodChildren_.NbNodes())
+      throw std::out_of_range("Graph: node id out of range.");
+
+    return likelihoodChildren_.Range(nodeId);
   }
 
   Types<NodeId>::ConstIteratorPair Graph::GetSortedNodes() const
@@ -722,8 +864,10 @@ namespace Biips
 
   void Graph::VisitNode(NodeId nodeId, NodeVisitor & vis)
   {
+    checkNotFrozen();
+
     vis.SetNodeId(nodeId);
-    Node & node = *boost::get(boost::vertex_node_ptr, parentsGraph_, nodeId);
+    Node & node = *nodes_[nodeId];
     switch (node.GetType())
     {
       case CONSTANT:
@@ -780,18 +924,8 @@ namespace Biips
 
   NodeValues Graph::SampleValues(Rng * pRng) const
   {
-    const ConstValuesPropertyMap & values_map = boost::get(boost::vertex_value,
-                                                           parentsGraph_);
-    const ConstObservedPropertyMap & observed_map =
-        boost::get(boost::vertex_observed, parentsGraph_);
-
-    NodeValues node_values(GetSize());
-    Flags sampled_flags(GetSize());
-    for (Size id=0; id<GetSize(); ++id)
-    {
-      node_values[id] = values_map[id];
-      sampled_flags[id] = observed_map[id];
-    }
+    NodeValues node_values(values_);
+    Flags sampled_flags(observed_);
 
     DataNodeSampler sample_node_vis(*this);
     sample_node_vis.SetMembers(node_values, sampled_flags, pRng);
@@ -804,18 +938,11 @@ namespace Biips
     if (GetNode(nodeId).GetType() == CONSTANT)
       throw LogicError("Can't sample value: node is constant.");
 
-    const ValuesPropertyMap & values_map = boost::get(boost::vertex_value,
-                                                      parentsGraph_);
-    const ObservedPropertyMap & observed_map =
-        boost::get(boost::vertex_observed, parentsGraph_);
+    if (setObsValue)
+      checkNotFrozen();
 
-    NodeValues node_values(GetSize());
-    Flags sampled_flags(GetSize());
-    for (Size id=0; id<GetSize(); ++id)
-    {
-      node_values[id] = values_map[id];
-      sampled_flags[id] = observed_map[id];
-    }
+    NodeValues node_values(values_);
+    Flags sampled_flags(observed_);
 
     // force the node evaluation by the NodeSampler
     sampled_flags[nodeId] = false;
@@ -835,12 +962,17 @@ namespace Biips
   // a stochastic node when doing Particle MCMC
   void Graph::SetObserved(NodeId nodeId)
   {
-    boost::put(boost::vertex_observed, parentsGraph_, nodeId, true);
+    checkNotFrozen();
+
+    observed_[nodeId] = true;
     // allocate memory: temporary NA value
     ValArray::Ptr p_val(new ValArray(GetNode(nodeId).Dim().Length(),
                                      BIIPS_REALNA));
     SetObsValue(nodeId, p_val, false);
 
+    if (GetNode(nodeId).GetType() == STOCHASTIC)
+      updateLatestUnobsRanks(nodeId);
+
     // set logical children observed
     ChildIterator it_child, it_child_end;
     boost::tie(it_child, it_child_end) = GetChildren(nodeId);
@@ -869,6 +1001,8 @@ namespace Biips
 
   void Graph::SetUnobserved(NodeId nodeId)
   {
+    checkNotFrozen();
+
     if (GetNode(nodeId).GetType() == CONSTANT)
       throw LogicError(String("Can't set node unobserved, node is constant. id: ")
                        + print(nodeId));
@@ -877,8 +1011,11 @@ namespace Biips
       return;
 
     ValArray::Ptr p_val; // null value pointer
-    boost::put(boost::vertex_value, parentsGraph_, nodeId, p_val);
-    boost::put(boost::vertex_observed, parentsGraph_, nodeId, false);
+    values_[nodeId] = p_val;
+    observed_[nodeId] = false;
+
+    if (GetNode(nodeId).GetType() == STOCHASTIC)
+      updateLatestUnobsRanks(nodeId);
 
     // set logical children unobserved
     ChildIterator it_child, it_child_end;
@@ -896,6 +1033,8 @@ namespace Biips
                           const ValArray::Ptr & pObsValue,
                           Bool stochOnly)
   {
+    checkNotFrozen();
+
     if (stochOnly)
       if (GetNode(nodeId).GetType() != STOCHASTIC)
         throw LogicError(String("Can't set value, node is not stochastic. node id: ")
@@ -916,7 +1055,61 @@ namespace Biips
           throw RuntimeError("Can not set observed value. value is not discrete:" + print((*pObsValue)[i]));
       }
     }
-    boost::put(boost::vertex_value, parentsGraph_, nodeId, pObsValue);
+    values_[nodeId] = pObsValue;
+  }
+
+  NodeValues Graph::OverrideObsValues(const std::map<NodeId, ValArray::Ptr> & obsValues) const
+  {
+    NodeValues node_values(values_);
+    if (obsValues.empty())
+      return node_values;
+
+    Flags changed(GetSize(), false);
+    std::map<NodeId, ValArray::Ptr>::const_iterator it_obs = obsValues.begin();
+    for (; it_obs != obsValues.end(); ++it_obs)
+    {
+      NodeId id = it_obs->first;
+      const ValArray::Ptr & p_value = it_obs->second;
+      if (id >= GetSize())
+        throw LogicError("Can not override observed value: invalid node id.");
+      if (GetNode(id).GetType() != STOCHASTIC || !observed_[id])
+        throw NodeError(id, "Can not override value: node is not observed stochastic.");
+      if (!p_value || p_value->size() != GetNode(id).Dim().Length())
+        throw NodeError(id, "Can not override observed value: dimension mismatch.");
+      for (Size i = 0; i < p_value->size(); ++i)
+      {
+        if (isNA((*p_value)[i]))
+          throw NodeError(id, "Can not override observed value: value is missing.");
+        if (discrete_[id] && !checkInteger((*p_value)[i]))
+          throw NodeError(id, "Can not override observed value: value is not discrete.");
+      }
+      node_values[id] = p_value;
+      changed[id] = true;
+    }
+
+    // the observed logical children are evaluated again, parents first
+    Flags sampled_flags(observed_);
+    DataNodeSampler sample_node_vis(*this);
+    sample_node_vis.SetMembers(node_values, sampled_flags, NULL);
+    sample_node_vis.SetObsValues(&node_values);
+    for (NodeId id = obsValues.begin()->first + 1; id < GetSize(); ++id)
+    {
+      if (!observed_[id] || GetNode(id).GetType() != LOGICAL)
+        continue;
+
+      const ParentIds & parents = GetNode(id).Parents();
+      for (Size i = 0; i < parents.size() && !changed[id]; ++i)
+        changed[id] = changed[parents[i]];
+      if (!changed[id])
+        continue;
+
+      // the value of the graph is shared: evaluate in a new array
+      node_values[id].reset();
+      sampled_flags[id] = false;
+      VisitNode(id, sample_node_vis);
+    }
+
+    return node_values;
   }
 
   class SetObsValuesVisitor: public NodeVisitor
@@ -955,11 +1148,18 @@ namespace Biips
 
   void Graph::PrintGraph(std::ostream & os) const
   {
-    boost::print_graph(parentsGraph_);
+    for (NodeId id = 0; id < GetSize(); ++id)
+    {
+      os << id << " -->";
+      const ParentIds & parents = GetNode(id).Parents();
+      for (Size i = 0; i < parents.size(); ++i)
+        os << " " << parents[i];
+      os << std::endl;
+    }
   }
 
   Graph::Graph(Bool dataGraph) :
-      childrenGraph_(parentsGraph_), builtFlag_(false), dataGraph_(dataGraph)
+      builtFlag_(false), dataGraph_(dataGraph), frozen_(false)
   {
     nodesSummaryMap_[CONSTANT] = 0;
     nodesSummaryMap_[STOCHASTIC] = 0;
@@ -1100,4 +1300,85 @@ namespace Biips
       throw LogicError("Can not access a graph that is not built.");
     return ranks_;
   }
+
+  const Types<Size>::Array & Graph::GetLatestUnobsRanks() const
+  {
+    if (!builtFlag_)
+      throw LogicError("Can not access a graph that is not built.");
+    return latestUnobsRanks_;
+  }
+
+  class MemoryUsageVisitor: public ConstNodeVisitor
+  {
+  protected:
+    std::size_t bytes_;
+
+    template<typename NodeType>
+    void add(const NodeType & node)
+    {
+      // object and shared pointer count
+      bytes_ += sizeof(NodeType) + 2 * sizeof(void *);
+    }
+
+    virtual void visit(const ConstantNode & node)
+    {
+      add(node);
+    }
+
+    virtual void visit(const StochasticNode & node)
+    {
+      add(node);
+    }
+
+    virtual void visit(const LogicalNode & node)
+    {
+      if (node.IsFunction())
+      {
+        add(static_cast<const FuncNode &>(node));
+        return;
+      }
+      const AggNode & agg_node = static_cast<const AggNode &>(node);
+      add(agg_node);
+      bytes_ += agg_node.Sources().capacity() * sizeof(NodeId)
+                + agg_node.Runs().capacity() * sizeof(AggNode::GatherRun)
+                + node.Parents().size() * sizeof(Size); // offsets
+    }
+
+  public:
+    MemoryUsageVisitor() :
+        bytes_(0)
+    {
+    }
+
+    std::size_t Bytes() const
+    {
+      return bytes_;
+    }
+  };
+
+  GraphMemoryUsage Graph::MemoryUsage() const
+  {
+    GraphMemoryUsage usage;
+
+    MemoryUsageVisitor mem_vis;
+    for (NodeId id = 0; id < GetSize(); ++id)
+      VisitNode(id, mem_vis);
+    usage.nodes = mem_vis.Bytes();
+    usage.dims = dimFactory_.MemoryUsage();
+    usage.parents = parentsPool_.Capacity() * sizeof(NodeId);
+    usage.children = childrenLists_.capacity() * sizeof(Types<NodeId>::Array)
+                     + (childrenOffsets_.capacity() + childrenIds_.capacity())
+                       * sizeof(Size);
+    for (Size i = 0; i < childrenLists_.size(); ++i)
+      usage.children += childrenLists_[i].capacity() * sizeof(NodeId);
+    usage.properties = nodes_.capacity() * sizeof(Node::Ptr)
+                       + values_.capacity() * sizeof(NodeValues::value_type)
+                       + (observed_.capacity() + discrete_.capacity()) / 8;
+    usage.lists = (topoSort_.capacity() + ranks_.capacity()
+                   + latestUnobsRanks_.capacity()) * sizeof(Size)
+                  + stochasticParents_.MemoryUsage()
+                  + stochasticChildren_.MemoryUsage()
+                  + likelihoodChildren_.MemoryUsage();
+    return usage;
+  }
 }
@@ -4,8 +4,24 @@
 namespace Biips
 {
 
+  ParentIds NodeIdPool::Append(const Types<NodeId>::Array & ids)
+  {
+    Size offset = ids_.size();
+    ids_.insert(ids_.end(), ids.begin(), ids.end());
+    return ParentIds(this, offset, ids.size());
+  }
+
+  void NodeIdPool::Pop(const ParentIds & span)
+  {
+    if (span.empty())
+      return;
+    if (span.Offset() + span.size() != ids_.size())
+      throw LogicError("NodeIdPool: can only pop the last span.");
+    ids_.resize(span.Offset());
+  }
+
   Node::Node(NodeType type, const DimArray::Ptr & pDim) :
-    nodeType_(type), pDim_(pDim)
+    pDim_(pDim), nodeType_(type)
   {
     if (!pDim)
       throw LogicError("Can not create node: DimArray::Ptr is NULL.");
@@ -13,8 +29,9 @@ namespace Biips
 
   Node::Node(NodeType type,
              const DimArray::Ptr & pDim,
-             const Types<NodeId>::Array & parents) :
-    nodeType_(type), pDim_(pDim), parents_(parents)
+             const Types<NodeId>::Array & parents,
+             NodeIdPool & parentsPool) :
+    pDim_(pDim), parents_(parentsPool.Append(parents)), nodeType_(type)
   {
     if (!pDim)
       throw LogicError("Can not create node: DimArray::Ptr is NULL.");
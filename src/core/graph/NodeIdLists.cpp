@@ -0,0 +1,91 @@
+#include "graph/NodeIdLists.hpp"
+#include "common/Error.hpp"
+
+#include <algorithm>
+
+namespace Biips
+{
+
+  void NodeIdLists::Reset(Size nbNodes)
+  {
+    ids_.clear();
+    begins_.assign(nbNodes, 0);
+    ends_.assign(nbNodes, 0);
+    scratch_.clear();
+    marks_.assign(nbNodes, NULL_NODEID);
+  }
+
+  void NodeIdLists::Merge(NodeId nodeId,
+                          const Types<NodeId>::Array & singles,
+                          const Types<NodeId>::Array & merged)
+  {
+    // collect the union, using the marks to discard duplicates
+    scratch_.clear();
+    for (Size i = 0; i < singles.size(); ++i)
+    {
+      if (marks_[singles[i]] == nodeId)
+        continue;
+      marks_[singles[i]] = nodeId;
+      scratch_.push_back(singles[i]);
+    }
+    for (Size i = 0; i < merged.size(); ++i)
+    {
+      for (Size k = begins_[merged[i]]; k < ends_[merged[i]]; ++k)
+      {
+        if (marks_[ids_[k]] == nodeId)
+          continue;
+        marks_[ids_[k]] = nodeId;
+        scratch_.push_back(ids_[k]);
+      }
+    }
+
+    // the union contains each merged list: if it has the same size
+    // as one of them, they are equal and the span can be shared
+    for (Size i = 0; i < merged.size(); ++i)
+    {
+      if (Count(merged[i]) == scratch_.size())
+      {
+        begins_[nodeId] = begins_[merged[i]];
+        ends_[nodeId] = ends_[merged[i]];
+        return;
+      }
+    }
+
+    std::sort(scratch_.begin(), scratch_.end());
+    begins_[nodeId] = ids_.size();
+    ids_.insert(ids_.end(), scratch_.begin(), scratch_.end());
+    ends_[nodeId] = ids_.size();
+  }
+
+  void NodeIdLists::Open(NodeId nodeId)
+  {
+    begins_[nodeId] = ids_.size();
+    ends_[nodeId] = ids_.size();
+  }
+
+  void NodeIdLists::PushBack(NodeId nodeId, NodeId id)
+  {
+    if (ends_[nodeId] != ids_.size())
+      throw LogicError("NodeIdLists: can only push back in the last opened list.");
+    if (Count(nodeId) && ids_.back() >= id)
+      throw LogicError("NodeIdLists: pushed back ids must be sorted.");
+
+    ids_.push_back(id);
+    ++ends_[nodeId];
+  }
+
+  Bool NodeIdLists::Contains(NodeId nodeId, NodeId id) const
+  {
+    return std::binary_search(ids_.begin() + begins_[nodeId],
+                              ids_.begin() + ends_[nodeId],
+                              id);
+  }
+
+  void NodeIdLists::Shrink()
+  {
+    Types<NodeId>::Array().swap(scratch_);
+    Types<NodeId>::Array().swap(marks_);
+    Types<NodeId>::Array(ids_).swap(ids_);
+  }
+
+}
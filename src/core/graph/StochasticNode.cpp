@@ -22,9 +22,11 @@ namespace Biips
   StochasticNode::StochasticNode(const DimArray::Ptr pDim,
                                  const Distribution::Ptr & pPrior,
                                  const Types<NodeId>::Array & parameters,
+                                 NodeIdPool & parentsPool,
                                  NodeId lowerNodeId,
                                  NodeId upperNodeId) :
-    Node(STOCHASTIC, pDim, mkParents(parameters, lowerNodeId, upperNodeId)),
+    Node(STOCHASTIC, pDim, mkParents(parameters, lowerNodeId, upperNodeId),
+         parentsPool),
         pPrior_(pPrior), lowerNodeId_(lowerNodeId), upperNodeId_(upperNodeId)
   {
     if (!pPrior_)
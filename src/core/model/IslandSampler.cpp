@@ -0,0 +1,653 @@
+#include "model/IslandSampler.hpp"
+#include "model/Model.hpp"
+#include "sampler/ForwardSampler.hpp"
+#include "common/Error.hpp"
+
+#include <boost/random/uniform_real.hpp>
+#include <atomic>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <sstream>
+#include <thread>
+
+#if defined(__linux__)
+#define BIIPS_HAVE_FORK
+#include <cerrno>
+#include <dirent.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace Biips
+{
+
+  IslandSampler::IslandSampler(Model & model, Size nIslands) :
+    model_(model), nIslands_(nIslands), logNormConst_(BIIPS_REALNA),
+        nMigrations_(0)
+  {
+    if (nIslands_ == 0)
+      throw LogicError("IslandSampler: the number of islands must be positive.");
+  }
+
+#ifdef BIIPS_HAVE_FORK
+
+  static const Size ERROR_LENGTH = 1024;
+  // alignment of the arrays of the segment
+  static const size_t SEGMENT_ALIGN = 64;
+  // period of the checks of the failures of the other islands
+  static const int POLL_PERIOD_MS = 10;
+
+  static size_t alignSegment(size_t bytes)
+  {
+    return (bytes + SEGMENT_ALIGN - 1) / SEGMENT_ALIGN * SEGMENT_ALIGN;
+  }
+
+  // thrown in the islands waiting for another one when it fails
+  struct IslandAborted
+  {
+  };
+
+  // beginning of the shared memory segment, followed by the arrays
+  struct IslandHeader
+  {
+    // barrier of the islands
+    std::atomic<Size> arrived;
+    std::atomic<Size> generation;
+    std::atomic<Bool> aborted;
+
+    // results, written by the island 0
+    Scalar logNormConst;
+    Size nMigrations;
+
+    // message of the first failure
+    Size errorIsland;
+    char error[ERROR_LENGTH];
+  };
+
+  //! View of the shared memory segment of the islands
+  /*!
+   * The log normalizing constants are double buffered by iteration
+   * parity: an island writes the slot of the next iteration while the
+   * others may still read the current one. A barrier separates two
+   * writes of the same slot.
+   */
+  class IslandSegment
+  {
+  protected:
+    char * data_;
+    Size nIslands_;
+
+    size_t logNormConstsOffset() const
+    {
+      return alignSegment(sizeof(IslandHeader));
+    }
+    size_t weightsOffset() const
+    {
+      return logNormConstsOffset()
+          + alignSegment(2 * nIslands_ * sizeof(Scalar));
+    }
+
+  public:
+    IslandSegment(void * data, Size nIslands) :
+      data_(static_cast<char *>(data)), nIslands_(nIslands)
+    {
+    }
+
+    static size_t Bytes(Size nIslands)
+    {
+      IslandSegment segment(NULL, nIslands);
+      return segment.weightsOffset() + nIslands * sizeof(Scalar);
+    }
+
+    IslandHeader & Header()
+    {
+      return *reinterpret_cast<IslandHeader *>(data_);
+    }
+    //! Log normalizing constants of the sub-filters at an iteration
+    Scalar * LogNormConsts(Size iter)
+    {
+      return reinterpret_cast<Scalar *>(data_ + logNormConstsOffset())
+          + (iter % 2) * nIslands_;
+    }
+    //! Island log weights at the last iteration
+    Scalar * Weights()
+    {
+      return reinterpret_cast<Scalar *>(data_ + weightsOffset());
+    }
+
+    //! Throws IslandAborted if an island has failed
+    void CheckAborted()
+    {
+      if (Header().aborted.load())
+        throw IslandAborted();
+    }
+
+    //! Waits for all the islands
+    /*!
+     * Throws IslandAborted if an island fails meanwhile.
+     */
+    void Wait()
+    {
+      IslandHeader & header = Header();
+      Size gen = header.generation.load();
+      if (header.arrived.fetch_add(1) + 1 == nIslands_)
+      {
+        header.arrived.store(0);
+        header.generation.fetch_add(1);
+        return;
+      }
+      while (header.generation.load() == gen)
+      {
+        CheckAborted();
+        std::this_thread::yield();
+      }
+    }
+
+    //! Records the first failure and aborts the other islands
+    void Abort(Size island, const String & msg)
+    {
+      IslandHeader & header = Header();
+      if (header.aborted.exchange(true))
+        return;
+      header.errorIsland = island;
+      std::strncpy(header.error, msg.c_str(), ERROR_LENGTH - 1);
+      header.error[ERROR_LENGTH - 1] = '\0';
+    }
+  };
+
+  //! Pipe between the processes of the islands
+  /*!
+   * Both ends are non-blocking: a process waiting for the other end
+   * polls it, and throws IslandAborted if an island fails meanwhile.
+   * The pipes are shared by all the processes, and closed by Close.
+   */
+  class IslandPipe
+  {
+  protected:
+    int fds_[2];
+
+    // waits until the end fd is ready for events
+    static void poll(int fd, short events, IslandSegment & segment)
+    {
+      struct pollfd poll_fd = { fd, events, 0 };
+      while (::poll(&poll_fd, 1, POLL_PERIOD_MS) <= 0)
+        segment.CheckAborted();
+    }
+
+    void readBytes(char * data, size_t n, IslandSegment & segment)
+    {
+      while (n > 0)
+      {
+        ssize_t n_read = ::read(fds_[0], data, n);
+        if (n_read == 0)
+          throw RuntimeError("Can not read island pipe: it is closed.");
+        if (n_read < 0)
+        {
+          if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            throw RuntimeError("Can not read island pipe.");
+          poll(fds_[0], POLLIN, segment);
+          continue;
+        }
+        data += n_read;
+        n -= n_read;
+      }
+    }
+
+  public:
+    IslandPipe()
+    {
+      fds_[0] = fds_[1] = -1;
+    }
+
+    void Open()
+    {
+      if (::pipe(fds_) != 0)
+        throw RuntimeError("Can not run IslandSampler: failed to open a pipe.");
+      for (Size k = 0; k < 2; ++k)
+        ::fcntl(fds_[k], F_SETFL, ::fcntl(fds_[k], F_GETFL) | O_NONBLOCK);
+    }
+    void CloseRead()
+    {
+      if (fds_[0] >= 0)
+        ::close(fds_[0]);
+      fds_[0] = -1;
+    }
+    void CloseWrite()
+    {
+      if (fds_[1] >= 0)
+        ::close(fds_[1]);
+      fds_[1] = -1;
+    }
+    void Close()
+    {
+      CloseRead();
+      CloseWrite();
+    }
+    Bool ReadOpen() const
+    {
+      return fds_[0] >= 0;
+    }
+    int ReadFd() const
+    {
+      return fds_[0];
+    }
+
+    void Write(const char * data, size_t n, IslandSegment & segment)
+    {
+      while (n > 0)
+      {
+        ssize_t n_written = ::write(fds_[1], data, n);
+        if (n_written < 0)
+        {
+          if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            throw RuntimeError("Can not write island pipe.");
+          poll(fds_[1], POLLOUT, segment);
+          continue;
+        }
+        data += n_written;
+        n -= n_written;
+      }
+    }
+    //! Writes a message, read by Receive
+    void Send(const String & msg, IslandSegment & segment)
+    {
+      size_t size = msg.size();
+      Write(reinterpret_cast<const char *>(&size), sizeof(size), segment);
+      Write(msg.data(), size, segment);
+    }
+    String Receive(IslandSegment & segment)
+    {
+      size_t size;
+      readBytes(reinterpret_cast<char *>(&size), sizeof(size), segment);
+      String msg(size, '\0');
+      readBytes(&msg[0], size, segment);
+      return msg;
+    }
+    //! Appends the available bytes to buffer
+    /*!
+     * Returns false when all the write ends are closed.
+     */
+    Bool ReadAvailable(String & buffer)
+    {
+      char chunk[4096];
+      for (;;)
+      {
+        ssize_t n_read = ::read(fds_[0], chunk, sizeof(chunk));
+        if (n_read == 0)
+          return false;
+        if (n_read < 0)
+        {
+          if (errno == EINTR)
+            continue;
+          if (errno == EAGAIN || errno == EWOULDBLOCK)
+            return true;
+          throw RuntimeError("Can not read island pipe.");
+        }
+        buffer.append(chunk, n_read);
+      }
+    }
+  };
+
+  // closes the pipes of the parent process when it leaves Run
+  struct IslandPipesCloser
+  {
+    Types<IslandPipe>::Array & migrationPipes;
+    Types<IslandPipe>::Array & resultPipes;
+
+    ~IslandPipesCloser()
+    {
+      for (Size k = 0; k < migrationPipes.size(); ++k)
+        migrationPipes[k].Close();
+      for (Size k = 0; k < resultPipes.size(); ++k)
+        resultPipes[k].Close();
+    }
+  };
+
+  // number of threads of the process, 0 if unknown
+  static Size nProcessThreads()
+  {
+    DIR * p_dir = ::opendir("/proc/self/task");
+    if (!p_dir)
+      return 0;
+    Size n_threads = 0;
+    while (struct dirent * p_entry = ::readdir(p_dir))
+      n_threads += p_entry->d_name[0] != '.';
+    ::closedir(p_dir);
+    return n_threads;
+  }
+
+  // log of the mean of the exponentials
+  static Scalar logMeanExp(const ValArray & logValues)
+  {
+    Scalar max_log = *std::max_element(logValues.begin(), logValues.end());
+    if (!isFinite(max_log))
+      return max_log;
+    Scalar sum = 0.0;
+    for (Size k = 0; k < logValues.size(); ++k)
+      sum += std::exp(logValues[k] - max_log);
+    return max_log + std::log(sum / logValues.size());
+  }
+
+  static Scalar islandEss(const ValArray & logWeights)
+  {
+    Scalar max_log = *std::max_element(logWeights.begin(), logWeights.end());
+    Scalar sum = 0.0, sum_sq = 0.0;
+    for (Size k = 0; k < logWeights.size(); ++k)
+    {
+      Scalar w = std::exp(logWeights[k] - max_log);
+      sum += w;
+      sum_sq += w * w;
+    }
+    return sum * sum / sum_sq;
+  }
+
+  void IslandSampler::runIsland(Size island, Size nParticles,
+                                Rng & islandRng,
+                                const Types<Size>::Array & seeds,
+                                const String & rsType, Scalar essThreshold,
+                                Scalar islandThreshold, Bool migrate,
+                                IslandSegment & segment,
+                                Types<IslandPipe>::Array & migrationPipes,
+                                IslandPipe & resultPipe)
+  {
+    // the islands take the same decisions from the same values and the
+    // same copy of islandRng
+    ValArray base(nIslands_, 0.0);
+    ValArray log_weights(nIslands_);
+    Scalar log_norm_const = 0.0;
+    Size n_migrations = 0;
+    Types<Size>::Array ancestors(nIslands_);
+    // weight of the island and log normalizing constant of the island
+    // filter at each iteration, given to the filter monitors
+    ValArray iter_log_weights;
+    ValArray iter_log_norm_consts;
+
+    Rng rng(seeds[island]);
+    model_.InitSampler(nParticles, &rng, rsType, essThreshold);
+
+    for (;;)
+    {
+      Size iter = model_.Sampler().Iteration();
+      Scalar * log_norm_consts = segment.LogNormConsts(iter);
+      log_norm_consts[island] = model_.Sampler().LogNormConst();
+      segment.Wait();
+
+      for (Size k = 0; k < nIslands_; ++k)
+        log_weights[k] = log_norm_consts[k] - base[k];
+      Scalar log_mean_weight = logMeanExp(log_weights);
+      iter_log_weights.push_back(log_weights[island] - log_mean_weight
+                                 - std::log(Scalar(nIslands_)));
+      iter_log_norm_consts.push_back(log_norm_const + log_mean_weight);
+
+      Bool at_end = model_.Sampler().AtEnd();
+      if (at_end || !migrate || islandEss(log_weights) >= islandThreshold)
+      {
+        if (at_end)
+          break;
+        model_.IterateSampler();
+        continue;
+      }
+
+      // island resampling: systematic, in the order of the islands
+      log_norm_const += log_mean_weight;
+      Scalar max_log = *std::max_element(log_weights.begin(), log_weights.end());
+      ValArray weights(nIslands_);
+      for (Size k = 0; k < nIslands_; ++k)
+        weights[k] = std::exp(log_weights[k] - max_log);
+      Scalar sum = weights.Sum();
+
+      boost::uniform_real<Scalar> unif_dist(0.0, 1.0);
+      Scalar u = unif_dist(islandRng.GetGen());
+      Scalar cum_weight = weights[0];
+      for (Size k = 0, j = 0; k < nIslands_; ++k)
+      {
+        Scalar v = (k + u) / nIslands_ * sum;
+        while (cum_weight < v && j + 1 < nIslands_)
+          cum_weight += weights[++j];
+        ancestors[k] = j;
+      }
+      // the islands receiving particles are seeded again
+      Types<Size>::Array new_seeds(nIslands_);
+      for (Size k = 0; k < nIslands_; ++k)
+        new_seeds[k] = islandRng.GetGen()();
+
+      // an ancestor sends its particles before receiving those of its own
+      // ancestor: as the ancestors are sorted, the transfers form no cycle
+      String particles;
+      for (Size k = 0; k < nIslands_; ++k)
+      {
+        if (ancestors[k] != island || k == island)
+          continue;
+        if (particles.empty())
+        {
+          std::ostringstream os(std::ios::binary);
+          model_.SaveSamplerParticles(os);
+          particles = os.str();
+        }
+        migrationPipes[k].Send(particles, segment);
+      }
+
+      Size ancestor = ancestors[island];
+      if (ancestor != island)
+      {
+        std::istringstream is(migrationPipes[island].Receive(segment),
+                              std::ios::binary);
+        model_.LoadSamplerParticles(is);
+        rng.Seed(new_seeds[island]);
+      }
+      for (Size k = 0; k < nIslands_; ++k)
+        base[k] = log_norm_consts[ancestors[k]];
+      ++n_migrations;
+
+      model_.IterateSampler();
+    }
+
+    if (island == 0)
+    {
+      IslandHeader & header = segment.Header();
+      header.logNormConst = log_norm_const + logMeanExp(log_weights);
+      header.nMigrations = n_migrations;
+      std::copy(log_weights.begin(), log_weights.end(), segment.Weights());
+    }
+
+    std::ostringstream os(std::ios::binary);
+    StateWriter writer(os);
+    writer.WriteTag("BiipsIsland");
+    writer.Write(iter_log_weights);
+    writer.Write(iter_log_norm_consts);
+    model_.SaveFilterMonitors(os);
+    const String & result = os.str();
+    resultPipe.Write(result.data(), result.size(), segment);
+  }
+
+  void IslandSampler::Run(Size nParticles, Size rngSeed,
+                          const String & rsType, Scalar essThreshold,
+                          Scalar islandThreshold, Bool migrate)
+  {
+    if (!model_.SamplerBuilt())
+      throw LogicError("Can not run IslandSampler: sampler not built.");
+    if (nParticles < nIslands_)
+      throw LogicError("Can not run IslandSampler: less particles than islands.");
+    if (migrate && nParticles % nIslands_ != 0)
+      throw LogicError("Can not run IslandSampler: the number of particles "
+                       "must be a multiple of the number of islands to migrate.");
+    if (model_.FixedLag() > 0)
+      throw LogicError("Can not run IslandSampler: the fixed-lag smoother "
+                       "needs the ancestry of the particles.");
+    // the workers run the sampler, which is only safe in the child of
+    // a single-threaded process
+    if (nProcessThreads() != 1)
+      throw LogicError("Can not run IslandSampler: other threads are running.");
+
+    if (islandThreshold <= 1.0)
+      islandThreshold *= nIslands_;
+
+    Rng island_rng(rngSeed);
+    Types<Size>::Array seeds(nIslands_);
+    for (Size k = 0; k < nIslands_; ++k)
+      seeds[k] = island_rng.GetGen()();
+
+    size_t bytes = IslandSegment::Bytes(nIslands_);
+    void * p_segment = ::mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+                              MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (p_segment == MAP_FAILED)
+      throw RuntimeError("Can not run IslandSampler: failed to map the shared memory segment.");
+    IslandSegment segment(p_segment, nIslands_);
+    IslandHeader & header = segment.Header();
+    new (&header.arrived) std::atomic<Size>(0);
+    new (&header.generation) std::atomic<Size>(0);
+    new (&header.aborted) std::atomic<Bool>(false);
+
+    // pipe k carries the particles migrating to island k, and its
+    // filter monitors to the parent at the end
+    Types<IslandPipe>::Array migration_pipes(nIslands_);
+    Types<IslandPipe>::Array result_pipes(nIslands_);
+    Types<String>::Array results(nIslands_);
+    String error;
+    try
+    {
+      IslandPipesCloser closer = { migration_pipes, result_pipes };
+      for (Size k = 0; k < nIslands_; ++k)
+      {
+        migration_pipes[k].Open();
+        result_pipes[k].Open();
+      }
+
+      Types<pid_t>::Array pids;
+      for (Size k = 0; k < nIslands_; ++k)
+      {
+        pid_t pid = ::fork();
+        if (pid < 0)
+        {
+          segment.Abort(k, "failed to fork the worker process.");
+          break;
+        }
+        if (pid == 0)
+        {
+          // the worker exits without returning to the caller
+          int status = 0;
+          try
+          {
+            for (Size j = 0; j < nIslands_; ++j)
+            {
+              result_pipes[j].CloseRead();
+              if (j != k)
+                result_pipes[j].CloseWrite();
+            }
+            Size n_particles = nParticles / nIslands_ + (k < nParticles % nIslands_);
+            runIsland(k, n_particles, island_rng, seeds, rsType, essThreshold,
+                      islandThreshold, migrate, segment, migration_pipes,
+                      result_pipes[k]);
+          }
+          catch (IslandAborted &)
+          {
+            status = 1;
+          }
+          catch (std::exception & except)
+          {
+            segment.Abort(k, except.what());
+            status = 1;
+          }
+          ::_exit(status);
+        }
+        pids.push_back(pid);
+      }
+
+      // the pipes are only read by the parent
+      for (Size k = 0; k < nIslands_; ++k)
+      {
+        migration_pipes[k].Close();
+        result_pipes[k].CloseWrite();
+      }
+
+      // read the results while the workers run, so that they do not
+      // block on a full pipe, until they all terminate
+      Types<pollfd>::Array poll_fds;
+      Size n_running = pids.size();
+      for (;;)
+      {
+        poll_fds.clear();
+        for (Size k = 0; k < nIslands_; ++k)
+        {
+          if (result_pipes[k].ReadOpen())
+          {
+            struct pollfd poll_fd = { result_pipes[k].ReadFd(), POLLIN, 0 };
+            poll_fds.push_back(poll_fd);
+          }
+        }
+        if (n_running == 0 && poll_fds.empty())
+          break;
+        ::poll(poll_fds.empty() ? NULL : &poll_fds[0], poll_fds.size(),
+               POLL_PERIOD_MS);
+        for (Size k = 0; k < nIslands_; ++k)
+        {
+          if (result_pipes[k].ReadOpen()
+              && !result_pipes[k].ReadAvailable(results[k]))
+            result_pipes[k].CloseRead();
+        }
+
+        // a worker which terminates abnormally aborts the others
+        for (Size k = 0; k < pids.size(); ++k)
+        {
+          int status;
+          if (pids[k] <= 0 || ::waitpid(pids[k], &status, WNOHANG) <= 0)
+            continue;
+          pids[k] = 0;
+          --n_running;
+          if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            segment.Abort(k, "the worker process terminated abnormally.");
+        }
+      }
+
+      if (header.aborted.load())
+        error = String("Failure in island ") + print(header.errorIsland) + ": "
+            + header.error;
+      else
+      {
+        logNormConst_ = header.logNormConst;
+        nMigrations_ = header.nMigrations;
+        islandLogWeights_.assign(segment.Weights(), segment.Weights() + nIslands_);
+      }
+    }
+    catch (...)
+    {
+      ::munmap(p_segment, bytes);
+      throw;
+    }
+    ::munmap(p_segment, bytes);
+
+    if (!error.empty())
+      throw RuntimeError(error);
+
+    // the monitors of a previous run of the model are released
+    model_.ClearFilterMonitors(true);
+    model_.ClearGenTreeSmoothMonitors(true);
+    model_.ClearBackwardSmoothMonitors(true);
+    model_.ClearFixedLagSmoothMonitors(true);
+    for (Size k = 0; k < nIslands_; ++k)
+    {
+      std::istringstream is(results[k], std::ios::binary);
+      StateReader reader(is);
+      reader.ReadTag("BiipsIsland");
+      ValArray iter_log_weights = reader.Get<ValArray>();
+      ValArray iter_log_norm_consts = reader.Get<ValArray>();
+      model_.MergeFilterMonitors(is, iter_log_weights, iter_log_norm_consts);
+    }
+  }
+
+#else
+
+  void IslandSampler::Run(Size nParticles, Size rngSeed,
+                          const String & rsType, Scalar essThreshold,
+                          Scalar islandThreshold, Bool migrate)
+  {
+    throw LogicError("IslandSampler is not available on this platform.");
+  }
+
+#endif
+
+}
@@ -5,6 +5,9 @@
 #include "sampler/GetNodeValueVisitor.hpp"
 #include "graph/StochasticNode.hpp"
 
+#include <algorithm>
+#include <cmath>
+
 namespace Biips
 {
 
@@ -70,6 +73,46 @@ namespace Biips
     return true;
   }
 
+  Bool Model::SetFixedLagSmoothMonitor(NodeId nodeId)
+  {
+    // FIXME: it is no use monitoring observed nodes
+    if (pGraph_->GetObserved()[nodeId])
+      return false;
+
+    fixedLagSmoothMonitorsMap_[nodeId];
+    return true;
+  }
+
+  void Model::ReleaseFixedLagSmoothMonitor(NodeId nodeId)
+  {
+    std::map<NodeId, Monitor*>::iterator it_monitor =
+        fixedLagSmoothMonitorsMap_.find(nodeId);
+    if (it_monitor == fixedLagSmoothMonitorsMap_.end() || !it_monitor->second)
+      return;
+
+    Monitor * p_monitor = it_monitor->second;
+    it_monitor->second = NULL;
+    p_monitor->ClearNode(nodeId);
+    if (!p_monitor->GetNodes().empty())
+      return;
+
+    for (Size k = 0; k < fixedLagSmoothMonitors_.size(); ++k)
+    {
+      if (fixedLagSmoothMonitors_[k].get() != p_monitor)
+        continue;
+      fixedLagSmoothMonitors_.erase(fixedLagSmoothMonitors_.begin() + k);
+      break;
+    }
+  }
+
+  void Model::SetFixedLag(Size lag)
+  {
+    if (pSampler_ && pSampler_->Initialized() && !pSampler_->AtEnd())
+      throw LogicError("Can not set fixed lag: the forward sampler is running.");
+
+    fixedLag_ = lag;
+  }
+
   void Model::ClearFilterMonitors(Bool release_only)
   {
     filterMonitors_.clear();
@@ -112,6 +155,22 @@ namespace Biips
     backwardSmoothMonitorsMap_.clear();
   }
 
+  void Model::ClearFixedLagSmoothMonitors(Bool release_only)
+  {
+    fixedLagSmoothMonitors_.clear();
+    if (release_only)
+    {
+      for (std::map<NodeId, Monitor*>::iterator it_monitors =
+          fixedLagSmoothMonitorsMap_.begin();
+          it_monitors != fixedLagSmoothMonitorsMap_.end(); ++it_monitors)
+      {
+        it_monitors->second = NULL;
+      }
+      return;
+    }
+    fixedLagSmoothMonitorsMap_.clear();
+  }
+
   const ForwardSampler & Model::Sampler() const
   {
     if (!pSampler_)
@@ -131,10 +190,385 @@ namespace Biips
   void Model::BuildSampler()
   {
     pSampler_.reset(new ForwardSampler(*pGraph_));
+    pSampler_->SetProfile(pProfile_);
+    pSampler_->SetLazyEvaluation(lazyEvaluation_);
+    pSampler_->SetUnchecked(unchecked_);
+    pSampler_->SetSqmc(sqmc_);
+    pSampler_->SetLikePDFType(likePDFType_);
+    pSampler_->SetSinglePrecisionArchives(singlePrecisionArchives_);
+    pSampler_->SetObsValues(pObsValues_.get());
 
     pSampler_->Build();
   }
 
+  void Model::SetObsValues(const std::map<NodeId, ValArray::Ptr> & obsValues)
+  {
+    if (obsValues.empty())
+      pObsValues_.reset();
+    else
+      pObsValues_.reset(new NodeValues(pGraph_->OverrideObsValues(obsValues)));
+
+    // the filter monitors of the previous run do not match the new values
+    pSmoother_.reset();
+    if (pSampler_)
+      pSampler_->SetObsValues(pObsValues_.get());
+  }
+
+  void Model::SetLazyEvaluation(Bool lazy)
+  {
+    lazyEvaluation_ = lazy;
+    if (pSampler_)
+      pSampler_->SetLazyEvaluation(lazyEvaluation_);
+  }
+
+  void Model::SetUnchecked(Bool unchecked)
+  {
+    unchecked_ = unchecked;
+    if (pSampler_)
+      pSampler_->SetUnchecked(unchecked_);
+  }
+
+  void Model::SetSqmc(Bool sqmc)
+  {
+    sqmc_ = sqmc;
+    if (pSampler_)
+      pSampler_->SetSqmc(sqmc_);
+  }
+
+  void Model::SetLikePDFType(PDFType type)
+  {
+    likePDFType_ = type;
+    if (pSampler_)
+      pSampler_->SetLikePDFType(likePDFType_);
+  }
+
+  void Model::SetSinglePrecisionArchives(Bool single)
+  {
+    singlePrecisionArchives_ = single;
+    if (pSampler_)
+      pSampler_->SetSinglePrecisionArchives(singlePrecisionArchives_);
+  }
+
+  void Model::requireMonitoredNodes()
+  {
+    pSampler_->ClearRequiredNodes();
+
+    std::map<NodeId, Monitor*>::const_iterator it_monitors;
+    for (it_monitors = filterMonitorsMap_.begin();
+        it_monitors != filterMonitorsMap_.end(); ++it_monitors)
+      pSampler_->RequireNode(it_monitors->first);
+    // backward smooth monitored nodes are also filter monitored
+    std::set<NodeId>::const_iterator it_nodes;
+    for (it_nodes = genTreeSmoothMonitoredNodeIds_.begin();
+        it_nodes != genTreeSmoothMonitoredNodeIds_.end(); ++it_nodes)
+      pSampler_->RequireNode(*it_nodes);
+    for (it_monitors = fixedLagSmoothMonitorsMap_.begin();
+        it_monitors != fixedLagSmoothMonitorsMap_.end(); ++it_monitors)
+      pSampler_->RequireNode(it_monitors->first);
+  }
+
+  void Model::monitorFixedLagSmoothNodes()
+  {
+    if (fixedLagSmoothMonitorsMap_.empty())
+      return;
+
+    Size t = pSampler_->Iteration();
+    if (t < fixedLag_ && !pSampler_->AtEnd())
+      return;
+
+    // the nodes sampled lag iterations ago,
+    // and at the last iteration all the nodes not monitored yet
+    Size iter_begin = t < fixedLag_ ? 0 : t - fixedLag_;
+    Size iter_end = pSampler_->AtEnd() ? t + 1 : iter_begin + 1;
+    Types<NodeId>::Array lagged_nodes;
+    for (Size iter = iter_begin; iter < iter_end; ++iter)
+    {
+      Types<NodeId>::Array sampled_nodes = pSampler_->GetSampledNodes(iter);
+      lagged_nodes.insert(lagged_nodes.end(), sampled_nodes.begin(),
+                          sampled_nodes.end());
+    }
+
+    const Types<Types<NodeId>::Array>::Ptr & p_cond_nodes = pSampler_->ConditionalNodesPtr();
+    FilterMonitor * p_monitor = new FilterMonitor(t, lagged_nodes, p_cond_nodes,
+                                                  p_cond_nodes->size());
+    fixedLagSmoothMonitors_.push_back(boost::shared_ptr<Monitor>(p_monitor));
+    pSampler_->InitMonitor(*p_monitor);
+    for (Size i = 0; i < lagged_nodes.size(); ++i)
+    {
+      NodeId node_id = lagged_nodes[i];
+      if (fixedLagSmoothMonitorsMap_.count(node_id))
+      {
+        pSampler_->MonitorNode(node_id, *p_monitor);
+        fixedLagSmoothMonitorsMap_[node_id] = p_monitor;
+        // the window of the node is over
+        pSampler_->UnlockNode(node_id);
+      }
+    }
+  }
+
+  void Model::releaseAncestry()
+  {
+    // the genealogical tree monitors need the whole ancestry
+    if (!genTreeSmoothMonitoredNodeIds_.empty())
+      return;
+
+    // the next fixed-lag monitors need the ancestry
+    // from the iteration following the lagged one
+    Size t = pSampler_->Iteration();
+    Size lag = fixedLagSmoothMonitorsMap_.empty() ? 0 : fixedLag_;
+    if (t + 1 > lag)
+      pSampler_->ReleaseAncestry(std::min(t + 1 - lag, t));
+  }
+
+  static const Size SAMPLER_STATE_VERSION = 3;
+
+  static void saveMonitor(StateWriter & writer, const Monitor & monitor)
+  {
+    writer.Write(monitor.GetIteration());
+    writer.Write(monitor.GetLastSampledNodes());
+    writer.Write(monitor.NConditionalNodes());
+    monitor.SaveState(writer);
+  }
+
+  static FilterMonitor * loadMonitor(
+      StateReader & reader,
+      const Types<Types<NodeId>::Array>::Ptr & pCondNodes)
+  {
+    Size iter = reader.Get<Size>();
+    Types<NodeId>::Array sampled_nodes = reader.Get<Types<Size>::Array>();
+    Size n_cond_nodes = reader.Get<Size>();
+    if (n_cond_nodes > pCondNodes->size())
+      throw RuntimeError("Can not load sampler state: invalid monitor.");
+    FilterMonitor * p_monitor = new FilterMonitor(iter, sampled_nodes,
+                                                  pCondNodes, n_cond_nodes);
+    try
+    {
+      p_monitor->LoadState(reader);
+    }
+    catch (...)
+    {
+      delete p_monitor;
+      throw;
+    }
+    return p_monitor;
+  }
+
+  static void saveMonitors(StateWriter & writer,
+                           const Types<boost::shared_ptr<Monitor> >::Array & monitors,
+                           const std::map<NodeId, Monitor *> & monitorsMap)
+  {
+    std::map<const Monitor *, Size> indices;
+    writer.Write(Size(monitors.size()));
+    for (Size k = 0; k < monitors.size(); ++k)
+    {
+      indices[monitors[k].get()] = k + 1;
+      saveMonitor(writer, *monitors[k]);
+    }
+    // the monitor of each node, 0 if not monitored yet
+    writer.Write(Size(monitorsMap.size()));
+    std::map<NodeId, Monitor *>::const_iterator it_monitors;
+    for (it_monitors = monitorsMap.begin(); it_monitors != monitorsMap.end();
+        ++it_monitors)
+    {
+      writer.Write(it_monitors->first);
+      writer.Write(it_monitors->second ? indices.at(it_monitors->second)
+                                       : Size(0));
+    }
+  }
+
+  static void loadMonitors(StateReader & reader,
+                           Types<boost::shared_ptr<Monitor> >::Array & monitors,
+                           std::map<NodeId, Monitor *> & monitorsMap,
+                           const Types<Types<NodeId>::Array>::Ptr & pCondNodes)
+  {
+    monitors.resize(reader.Get<Size>());
+    for (Size k = 0; k < monitors.size(); ++k)
+      monitors[k].reset(loadMonitor(reader, pCondNodes));
+    Size n_nodes = reader.Get<Size>();
+    if (n_nodes != monitorsMap.size())
+      throw RuntimeError("Can not load sampler state: the monitored nodes differ.");
+    for (Size k = 0; k < n_nodes; ++k)
+    {
+      NodeId id = reader.Get<Size>();
+      Size index = reader.Get<Size>();
+      if (!monitorsMap.count(id))
+        throw RuntimeError("Can not load sampler state: the monitored nodes differ.");
+      if (index > monitors.size())
+        throw RuntimeError("Can not load sampler state: invalid monitor index.");
+      monitorsMap[id] = index ? monitors[index - 1].get() : NULL;
+    }
+  }
+
+  void Model::SaveSamplerState(std::ostream & os) const
+  {
+    if (!pSampler_ || !pSampler_->Initialized())
+      throw LogicError("Can not save sampler state: sampler not initialized.");
+
+    StateWriter writer(os);
+    writer.WriteTag("BiipsSamplerState");
+    writer.Write(SAMPLER_STATE_VERSION);
+
+    writer.Write(lazyEvaluation_);
+    writer.Write(unchecked_);
+    writer.Write(sqmc_);
+    writer.Write(Size(likePDFType_));
+    writer.Write(singlePrecisionArchives_);
+    writer.Write(fixedLag_);
+    writer.Write(Types<Size>::Array(genTreeSmoothMonitoredNodeIds_.begin(),
+                                    genTreeSmoothMonitoredNodeIds_.end()));
+
+    pSampler_->SaveState(writer);
+
+    saveMonitors(writer, filterMonitors_, filterMonitorsMap_);
+    saveMonitors(writer, fixedLagSmoothMonitors_, fixedLagSmoothMonitorsMap_);
+    // the genealogical tree monitor is only set at the end
+    writer.Write(Bool(pGenTreeSmoothMonitor_));
+    if (pGenTreeSmoothMonitor_)
+      saveMonitor(writer, *pGenTreeSmoothMonitor_);
+    writer.WriteTag("End");
+  }
+
+  void Model::LoadSamplerState(std::istream & is, Rng * pRng)
+  {
+    if (!SamplerBuilt())
+      throw LogicError("Can not load sampler state: sampler not built.");
+
+    StateReader reader(is);
+    reader.ReadTag("BiipsSamplerState");
+    if (reader.Get<Size>() != SAMPLER_STATE_VERSION)
+      throw RuntimeError("Can not load sampler state: unsupported version.");
+
+    SetLazyEvaluation(reader.Get<Bool>());
+    SetUnchecked(reader.Get<Bool>());
+    SetSqmc(reader.Get<Bool>());
+    SetLikePDFType(PDFType(reader.Get<Size>()));
+    SetSinglePrecisionArchives(reader.Get<Bool>());
+    fixedLag_ = reader.Get<Size>();
+    if (reader.Get<Types<Size>::Array>()
+        != Types<Size>::Array(genTreeSmoothMonitoredNodeIds_.begin(),
+                              genTreeSmoothMonitoredNodeIds_.end()))
+      throw RuntimeError("Can not load sampler state: the monitored nodes differ.");
+
+    ClearFilterMonitors(true);
+    ClearGenTreeSmoothMonitors(true);
+    ClearBackwardSmoothMonitors(true);
+    ClearFixedLagSmoothMonitors(true);
+    pSmoother_.reset();
+
+    requireMonitoredNodes();
+    pSampler_->LoadState(reader, pRng);
+
+    const Types<Types<NodeId>::Array>::Ptr & p_cond_nodes = pSampler_->ConditionalNodesPtr();
+    loadMonitors(reader, filterMonitors_, filterMonitorsMap_, p_cond_nodes);
+    loadMonitors(reader, fixedLagSmoothMonitors_, fixedLagSmoothMonitorsMap_,
+                 p_cond_nodes);
+    if (reader.Get<Bool>())
+      pGenTreeSmoothMonitor_.reset(loadMonitor(reader, p_cond_nodes));
+    reader.ReadTag("End");
+  }
+
+  void Model::SaveSamplerParticles(std::ostream & os) const
+  {
+    if (!pSampler_)
+      throw LogicError("Can not save sampler particles: no ForwardSampler.");
+
+    StateWriter writer(os);
+    pSampler_->SaveParticles(writer);
+  }
+
+  void Model::LoadSamplerParticles(std::istream & is)
+  {
+    if (!pSampler_)
+      throw LogicError("Can not load sampler particles: no ForwardSampler.");
+
+    StateReader reader(is);
+    pSampler_->LoadParticles(reader);
+  }
+
+  void Model::SaveFilterMonitors(std::ostream & os) const
+  {
+    if (!pSampler_ || !pSampler_->Initialized())
+      throw LogicError("Can not save filter monitors: sampler not initialized.");
+
+    StateWriter writer(os);
+    writer.WriteTag("BiipsFilterMonitors");
+    writer.Write(*pSampler_->ConditionalNodesPtr());
+    saveMonitors(writer, filterMonitors_, filterMonitorsMap_);
+    writer.WriteTag("End");
+  }
+
+  void Model::MergeFilterMonitors(std::istream & is,
+                                  const ValArray & logWeights,
+                                  const ValArray & logNormConsts)
+  {
+    StateReader reader(is);
+    reader.ReadTag("BiipsFilterMonitors");
+    Types<Types<NodeId>::Array>::Ptr p_cond_nodes(
+        new Types<NodeId>::Array(reader.Get<Types<Size>::Array>()));
+    Types<boost::shared_ptr<Monitor> >::Array monitors;
+    std::map<NodeId, Monitor *> monitors_map = filterMonitorsMap_;
+    loadMonitors(reader, monitors, monitors_map, p_cond_nodes);
+    reader.ReadTag("End");
+
+    for (Size k = 0; k < monitors.size(); ++k)
+    {
+      Size t = monitors[k]->GetIteration();
+      if (t >= logWeights.size() || t >= logNormConsts.size())
+        throw LogicError("Can not merge filter monitors: missing weight of an iteration.");
+      monitors[k]->ScaleWeights(std::exp(logWeights[t]));
+    }
+
+    if (filterMonitors_.empty())
+    {
+      filterMonitors_.swap(monitors);
+      filterMonitorsMap_.swap(monitors_map);
+    }
+    else
+    {
+      if (monitors.size() != filterMonitors_.size())
+        throw RuntimeError("Can not merge filter monitors: the iterations differ.");
+      for (Size k = 0; k < monitors.size(); ++k)
+        filterMonitors_[k]->Append(*monitors[k]);
+    }
+
+    // the filter monitors are created by the model
+    for (Size k = 0; k < filterMonitors_.size(); ++k)
+    {
+      FilterMonitor & monitor = static_cast<FilterMonitor &>(*filterMonitors_[k]);
+      monitor.SetLogNormConst(logNormConsts[monitor.GetIteration()]);
+    }
+  }
+
+  void Model::SetProfile(SamplerProfile * pProfile)
+  {
+    pProfile_ = pProfile;
+    if (pSampler_)
+      pSampler_->SetProfile(pProfile_);
+    if (pSmoother_)
+      pSmoother_->SetProfile(pProfile_);
+  }
+
+  //! Adds the time spent in its scope to the monitoring time of the current iteration
+  class MonitoringTimer
+  {
+  protected:
+    SamplerProfile * pProfile_;
+    SamplerProfile::TimePoint start_;
+
+  public:
+    explicit MonitoringTimer(SamplerProfile * pProfile) :
+        pProfile_(pProfile)
+    {
+      if (pProfile_)
+        start_ = SamplerProfile::Now();
+    }
+    ~MonitoringTimer()
+    {
+      if (pProfile_ && !pProfile_->Iterations().empty())
+        pProfile_->Current().monitoringTime += SamplerProfile::Since(start_);
+    }
+  };
+
   void Model::InitSampler(Size nParticles,
                           Rng * pRng,
                           const String & rsType,
@@ -144,30 +578,41 @@ namespace Biips
     ClearFilterMonitors(true);
     ClearGenTreeSmoothMonitors(true);
     ClearBackwardSmoothMonitors(true);
+    ClearFixedLagSmoothMonitors(true);
 
+    requireMonitoredNodes();
     pSampler_->Initialize(nParticles, pRng, rsType, threshold);
 
     if (pSampler_->NIterations() == 0)
       return;
 
+    MonitoringTimer monitoring_timer(pProfile_);
+
     // lock GenTreeSmooth monitored nodes
     for (std::set<NodeId>::const_iterator it_nodes =
         genTreeSmoothMonitoredNodeIds_.begin();
         it_nodes != genTreeSmoothMonitoredNodeIds_.end(); ++it_nodes)
       pSampler_->LockNode(*it_nodes);
+    // lock FixedLagSmooth monitored nodes until their lagged iteration
+    for (std::map<NodeId, Monitor*>::const_iterator it_monitors =
+        fixedLagSmoothMonitorsMap_.begin();
+        it_monitors != fixedLagSmoothMonitorsMap_.end(); ++it_monitors)
+      pSampler_->LockNode(it_monitors->first);
 
     Size t = pSampler_->Iteration();
 
     // nodes sampled at the current iteration
     Types<NodeId>::Array sampled_nodes = pSampler_->LastSampledNodes();
     // conditional nodes (observed stochastic parents and children) at the current iteration
-    Types<NodeId>::Array cond_nodes = pSampler_->ConditionalNodes();
+    // the monitors share the sequence of the sampler and only keep its length
+    const Types<Types<NodeId>::Array>::Ptr & p_cond_nodes = pSampler_->ConditionalNodesPtr();
+    Size n_cond_nodes = p_cond_nodes->size();
 
     // Filter Monitors
     NodeId node_id = NULL_NODEID;
     // We create a monitor object even if no nodes are monitored
     // used to get the filtering conditionals
-    FilterMonitor * p_monitor = new FilterMonitor(t, sampled_nodes, cond_nodes);
+    FilterMonitor * p_monitor = new FilterMonitor(t, sampled_nodes, p_cond_nodes, n_cond_nodes);
     filterMonitors_.push_back(boost::shared_ptr<Monitor>(p_monitor));
     pSampler_->InitMonitor(*p_monitor);
     for (Size i = 0; i < sampled_nodes.size(); ++i)
@@ -180,15 +625,18 @@ namespace Biips
       }
     }
 
+    monitorFixedLagSmoothNodes();
+
     if (!pSampler_->AtEnd())
     {
       // release memory
       pSampler_->ReleaseNodes();
+      releaseAncestry();
       return;
     }
 
     // Smooth tree Monitors
-    p_monitor = new FilterMonitor(t, sampled_nodes, cond_nodes);
+    p_monitor = new FilterMonitor(t, sampled_nodes, p_cond_nodes, n_cond_nodes);
     pGenTreeSmoothMonitor_.reset(p_monitor);
     pSampler_->InitMonitor(*p_monitor);
     for (std::set<NodeId>::const_iterator it_ids =
@@ -211,18 +659,22 @@ namespace Biips
 
     pSampler_->Iterate();
 
+    MonitoringTimer monitoring_timer(pProfile_);
+
     Size t = pSampler_->Iteration();
 
     // nodes sampled at the current iteration
     Types<NodeId>::Array sampled_nodes = pSampler_->LastSampledNodes();
     // conditional nodes (observed stochastic parents and children) at the current iteration
-    Types<NodeId>::Array cond_nodes = pSampler_->ConditionalNodes();
+    // the monitors share the sequence of the sampler and only keep its length
+    const Types<Types<NodeId>::Array>::Ptr & p_cond_nodes = pSampler_->ConditionalNodesPtr();
+    Size n_cond_nodes = p_cond_nodes->size();
 
     // Filter Monitors
     NodeId node_id = NULL_NODEID;
     // We create a monitor object even if no nodes are monitored
     // used to get the filtering conditionals
-    FilterMonitor * p_monitor = new FilterMonitor(t, sampled_nodes, cond_nodes);
+    FilterMonitor * p_monitor = new FilterMonitor(t, sampled_nodes, p_cond_nodes, n_cond_nodes);
     filterMonitors_.push_back(boost::shared_ptr<Monitor>(p_monitor));
     pSampler_->InitMonitor(*p_monitor);
     for (Size i = 0; i < sampled_nodes.size(); ++i)
@@ -235,15 +687,18 @@ namespace Biips
       }
     }
 
+    monitorFixedLagSmoothNodes();
+
     if (!pSampler_->AtEnd())
     {
       // release memory
       pSampler_->ReleaseNodes();
+      releaseAncestry();
       return;
     }
 
     // Smooth tree Monitors
-    p_monitor = new FilterMonitor(t, sampled_nodes, cond_nodes);
+    p_monitor = new FilterMonitor(t, sampled_nodes, p_cond_nodes, n_cond_nodes);
     pGenTreeSmoothMonitor_.reset(p_monitor);
     pSampler_->InitMonitor(*p_monitor);
     for (std::set<NodeId>::const_iterator it_ids =
@@ -276,9 +731,13 @@ namespace Biips
     pSmoother_.reset(new BackwardSmoother(*pGraph_,
                                           f_monitors,
                                           pSampler_->GetNodeSamplingIterations()));
+    pSmoother_->SetProfile(pProfile_);
+    pSmoother_->SetObsValues(pObsValues_.get());
 
     pSmoother_->Initialize();
 
+    MonitoringTimer monitoring_timer(pProfile_);
+
     Types<NodeId>::Array updated_nodes = pSmoother_->LastUpdatedNodes();
     Size t = pSmoother_->Iteration();
 
@@ -307,6 +766,8 @@ namespace Biips
 
     pSmoother_->IterateBack();
 
+    MonitoringTimer monitoring_timer(pProfile_);
+
     Types<NodeId>::Array updated_nodes = pSmoother_->LastUpdatedNodes();
     Size t = pSmoother_->Iteration();
 
@@ -393,6 +854,14 @@ namespace Biips
     return extractMonitorStat(nodeId, statFeature, backwardSmoothMonitorsMap_);
   }
 
+  MultiArray Model::ExtractFixedLagSmoothStat(NodeId nodeId, StatTag statFeature) const
+  {
+    if (!pSampler_)
+      throw LogicError("Can not extract fixed-lag smoother statistic: no ForwardSampler.");
+
+    return extractMonitorStat(nodeId, statFeature, fixedLagSmoothMonitorsMap_);
+  }
+
   // TODO manage discrete variable cases
   Histogram Model::extractMonitorPdf(NodeId nodeId,
                                      Size numBins,
@@ -439,78 +908,51 @@ namespace Biips
     return extractMonitorPdf(nodeId, numBins, cacheFraction, backwardSmoothMonitorsMap_);
   }
 
-  // FIXME Still valid after optimization ?
+  // TODO manage discrete variable cases
+  Histogram Model::ExtractFixedLagSmoothPdf(NodeId nodeId,
+                                            Size numBins,
+                                            Scalar cacheFraction) const
+  {
+    if (!pSampler_)
+      throw LogicError("Can not extract fixed-lag smooth pdf: no ForwardSampler.");
+
+    return extractMonitorPdf(nodeId, numBins, cacheFraction, fixedLagSmoothMonitorsMap_);
+  }
+
   MultiArray Model::ExtractGenTreeSmoothStat(NodeId nodeId,
                                           StatTag statFeature) const
   {
     if (!pSampler_)
       throw LogicError("Can not extract smooth statistic: no ForwardSampler.");
+    if (!pGenTreeSmoothMonitor_)
+      throw LogicError("Can not extract smooth statistic: no smooth monitor.");
 
-    ArrayAccumulator elem_acc;
-    elem_acc.AddFeature(statFeature);
-
-    pSampler_->Accumulate(nodeId, elem_acc);
-
-    MultiArray stat_marray;
-
-    switch (statFeature)
-    {
-      case SUM:
-        stat_marray = elem_acc.Sum();
-        break;
-      case MEAN:
-        stat_marray = elem_acc.Mean();
-        break;
-      case VARIANCE:
-        stat_marray = elem_acc.Variance();
-        break;
-      case MOMENT2:
-        stat_marray = elem_acc.Moment<2>();
-        break;
-      case MOMENT3:
-        stat_marray = elem_acc.Moment<3>();
-        break;
-      case MOMENT4:
-        stat_marray = elem_acc.Moment<4>();
-        break;
-      case SKEWNESS:
-        stat_marray = elem_acc.Skewness();
-        break;
-      case KURTOSIS:
-        stat_marray = elem_acc.Kurtosis();
-        break;
-      default:
-        break;
-    }
-
-    return stat_marray;
+    // the values of the particles of the sampler may have been released
+    std::map<NodeId, Monitor*> monitors_map;
+    monitors_map[nodeId] = pGenTreeSmoothMonitor_.get();
+    return extractMonitorStat(nodeId, statFeature, monitors_map);
   }
 
   // TODO manage dicrete variable cases
-  // FIXME Still valid after optimization ?
   Histogram Model::ExtractGenTreeSmoothPdf(NodeId nodeId,
                                         Size numBins,
                                         Scalar cacheFraction) const
   {
     if (!pSampler_)
       throw LogicError("Can not extract smooth pdf: no ForwardSampler.");
+    if (!pGenTreeSmoothMonitor_)
+      throw LogicError("Can not extract smooth pdf: no smooth monitor.");
 
-    if (!pGraph_->GetNode(nodeId).Dim().IsScalar())
-      throw LogicError("Can not extract smooth pdf: node is not scalar.");
-
-    DensityAccumulator dens_acc(roundSize(pSampler_->NParticles()
-                                          * cacheFraction),
-                                numBins);
-
-    pSampler_->Accumulate(nodeId, dens_acc);
-
-    return dens_acc.Density();
+    std::map<NodeId, Monitor*> monitors_map;
+    monitors_map[nodeId] = pGenTreeSmoothMonitor_.get();
+    return extractMonitorPdf(nodeId, numBins, cacheFraction, monitors_map);
   }
 
   class LogPriorDensityVisitor: public ConstNodeVisitor
   {
   protected:
     const Graph & graph_;
+    const NodeValues & values_;
     Scalar prior_;
   public:
     virtual void visit(const ConstantNode & node)
@@ -525,24 +967,24 @@ namespace Biips
 
     virtual void visit(const StochasticNode & node)
     {
-      NumArray x(node.DimPtr().get(), graph_.GetValues()[nodeId_].get());
+      NumArray x(node.DimPtr().get(), values_[nodeId_].get());
       NumArray::Array parents(node.Parents().size());
       for (Size i = 0; i < node.Parents().size(); ++i)
       {
         NodeId par_id = node.Parents()[i];
         parents[i].SetPtr(graph_.GetNode(par_id).DimPtr().get(),
-                          graph_.GetValues()[par_id].get());
+                          values_[par_id].get());
       }
       NumArray::Pair bounds;
       if (node.PriorPtr()->CanBound())
       {
         if (node.IsLowerBounded())
           bounds.first.SetPtr(graph_.GetNode(node.Lower()).DimPtr().get(),
-                              graph_.GetValues()[node.Lower()].get());
+                              values_[node.Lower()].get());
 
         if (node.IsUpperBounded())
           bounds.second.SetPtr(graph_.GetNode(node.Upper()).DimPtr().get(),
-                               graph_.GetValues()[node.Upper()].get());
+                               values_[node.Upper()].get());
       }
 
       try {
@@ -558,8 +1000,8 @@ namespace Biips
       return prior_;
     }
 
-    explicit LogPriorDensityVisitor(const Graph & graph) :
-        graph_(graph), prior_(BIIPS_REALNA)
+    LogPriorDensityVisitor(const Graph & graph, const NodeValues & values) :
+        graph_(graph), values_(values), prior_(BIIPS_REALNA)
     {
     }
   };
@@ -584,7 +1026,7 @@ namespace Biips
       }
     }
 
-    LogPriorDensityVisitor log_prior_vis(*pGraph_);
+    LogPriorDensityVisitor log_prior_vis(*pGraph_, ObsValues());
     pGraph_->VisitNode(nodeId, log_prior_vis);
 
     return log_prior_vis.GetPrior();
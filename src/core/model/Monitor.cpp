@@ -4,9 +4,102 @@
 #include "common/Accumulator.hpp"
 #include "common/ArrayAccumulator.hpp"
 
+#include <algorithm>
+
 namespace Biips
 {
 
+  void MonitorArchive::Set(const Types<Particle>::Array & particles,
+                           NodeId nodeId, Bool singlePrecision)
+  {
+    nParticles_ = particles.size();
+    singlePrecision_ = singlePrecision;
+    values_.clear();
+    shortValues_.clear();
+    length_ = 0;
+
+    if (!singlePrecision_)
+    {
+      values_.resize(nParticles_);
+      for (Size i = 0; i < nParticles_; ++i)
+        values_[i] = particles[i].GetValue()[nodeId];
+      return;
+    }
+
+    if (nParticles_ > 0)
+      length_ = particles[0].GetValue()[nodeId]->size();
+    shortValues_.resize(nParticles_ * length_);
+    for (Size i = 0; i < nParticles_; ++i)
+    {
+      const ValArray & value = *particles[i].GetValue()[nodeId];
+      std::copy(value.begin(), value.end(), shortValues_.begin() + i * length_);
+    }
+  }
+
+  const ValArray & MonitorArchive::Value(Size i, ValArray & buffer) const
+  {
+    if (!singlePrecision_)
+      return *values_[i];
+
+    buffer.assign(shortValues_.begin() + i * length_,
+                  shortValues_.begin() + (i + 1) * length_);
+    return buffer;
+  }
+
+  void MonitorArchive::Append(const MonitorArchive & other)
+  {
+    if (other.singlePrecision_ != singlePrecision_
+        || (singlePrecision_ && nParticles_ > 0 && other.nParticles_ > 0
+            && other.length_ != length_))
+      throw LogicError("Can not append particle values: their storages differ.");
+
+    if (nParticles_ == 0)
+      length_ = other.length_;
+    values_.insert(values_.end(), other.values_.begin(), other.values_.end());
+    shortValues_.insert(shortValues_.end(), other.shortValues_.begin(),
+                        other.shortValues_.end());
+    nParticles_ += other.nParticles_;
+  }
+
+  void MonitorArchive::SaveState(StateWriter & writer) const
+  {
+    writer.Write(singlePrecision_);
+    writer.Write(nParticles_);
+    if (singlePrecision_)
+    {
+      writer.Write(length_);
+      writer.Write(shortValues_);
+    }
+    else
+    {
+      for (Size i = 0; i < nParticles_; ++i)
+        writer.Write(values_[i]);
+    }
+  }
+
+  void MonitorArchive::LoadState(StateReader & reader)
+  {
+    values_.clear();
+    shortValues_.clear();
+    length_ = 0;
+
+    reader.Read(singlePrecision_);
+    reader.Read(nParticles_);
+    if (singlePrecision_)
+    {
+      reader.Read(length_);
+      reader.Read(shortValues_);
+      if (shortValues_.size() != nParticles_ * length_)
+        throw RuntimeError("Invalid monitor values in sampler state.");
+    }
+    else
+    {
+      values_.resize(nParticles_);
+      for (Size i = 0; i < nParticles_; ++i)
+        reader.Read(values_[i]);
+    }
+  }
+
   void Monitor::checkWeightsSet() const
   {
     if (!weightsSet_)
@@ -64,6 +157,28 @@ namespace Biips
     iterationEssMap_[iter] = ess;
   }
 
+  Bool Monitor::HasIterationOrigins(Size iter) const
+  {
+    return iterationOriginsMap_.find(iter) != iterationOriginsMap_.end();
+  }
+
+  void Monitor::SetIterationOrigins(Size iter,
+                                    const Types<Size>::Array & origins)
+  {
+    if (HasIterationOrigins(iter))
+      throw LogicError("Can not set iteration origins: already set.");
+
+    iterationOriginsMap_[iter] = origins;
+  }
+
+  const Types<Size>::Array & Monitor::GetIterationOrigins(Size iter) const
+  {
+    if (!HasIterationOrigins(iter))
+      throw LogicError("Can not get iteration origins: not set for this iteration.");
+
+    return iterationOriginsMap_.at(iter);
+  }
+
   Bool Monitor::GetNodeDiscrete(NodeId id) const
   {
     if (!Contains(id))
@@ -75,7 +190,7 @@ namespace Biips
   Types<NodeId>::Array Monitor::GetNodes() const
   {
     Types<NodeId>::Array nodes(particleValuesMap_.size());
-    std::map<NodeId, Types<ValArray::Ptr>::Array>::const_iterator it =
+    std::map<NodeId, MonitorArchive::Ptr>::const_iterator it =
         particleValuesMap_.begin();
     for (Size i = 0; it != particleValuesMap_.end(); ++it)
     {
@@ -95,8 +210,9 @@ namespace Biips
 
     featuresAcc.Init();
 
-    for (Size i = 0; i < particleValuesMap_.at(nodeId).size(); ++i)
-      featuresAcc.Push((*(particleValuesMap_.at(nodeId))[i])[n], weights_[i]);
+    const MonitorArchive & values = *particleValuesMap_.at(nodeId);
+    for (Size i = 0; i < values.size(); ++i)
+      featuresAcc.Push(values(i, n), weights_[i]);
   }
 
   void Monitor::Accumulate(NodeId nodeId, DensityAccumulator & densAcc, Size n) const
@@ -109,8 +225,9 @@ namespace Biips
 
     densAcc.Init();
 
-    for (Size i = 0; i < particleValuesMap_.at(nodeId).size(); ++i)
-      densAcc.Push((*(particleValuesMap_.at(nodeId))[i])[n], weights_[i]);
+    const MonitorArchive & values = *particleValuesMap_.at(nodeId);
+    for (Size i = 0; i < values.size(); ++i)
+      densAcc.Push(values(i, n), weights_[i]);
   }
 
   void Monitor::Accumulate(NodeId nodeId,
@@ -125,8 +242,9 @@ namespace Biips
 
     quantAcc.Init();
 
-    for (Size i = 0; i < particleValuesMap_.at(nodeId).size(); ++i)
-      quantAcc.Push((*(particleValuesMap_.at(nodeId))[i])[n], weights_[i]);
+    const MonitorArchive & values = *particleValuesMap_.at(nodeId);
+    for (Size i = 0; i < values.size(); ++i)
+      quantAcc.Push(values(i, n), weights_[i]);
   }
 
   void Monitor::Accumulate(NodeId nodeId,
@@ -141,8 +259,9 @@ namespace Biips
 
     featuresAcc.Init();
 
-    for (Size i = 0; i < particleValuesMap_.at(nodeId).size(); ++i)
-      featuresAcc.Push((*(particleValuesMap_.at(nodeId))[i])[n], weights_[i]);
+    const MonitorArchive & values = *particleValuesMap_.at(nodeId);
+    for (Size i = 0; i < values.size(); ++i)
+      featuresAcc.Push(values(i, n), weights_[i]);
   }
 
   void Monitor::Accumulate(NodeId nodeId,
@@ -157,8 +276,175 @@ namespace Biips
 
     featuresAcc.Init(pDim);
 
-    for (Size i = 0; i < particleValuesMap_.at(nodeId).size(); ++i)
-      featuresAcc.Push(*(particleValuesMap_.at(nodeId)[i]), weights_[i]);
+    const MonitorArchive & values = *particleValuesMap_.at(nodeId);
+    ValArray buffer;
+    for (Size i = 0; i < values.size(); ++i)
+      featuresAcc.Push(values.Value(i, buffer), weights_[i]);
+  }
+
+  void Monitor::ScaleWeights(Scalar sumOfWeights)
+  {
+    checkWeightsSet();
+    checkWeightsSwapped();
+
+    Scalar scale = sumOfWeights / sumOfWeights_;
+    for (Size i = 0; i < weights_.size(); ++i)
+      weights_[i] *= scale;
+    sumOfWeights_ = sumOfWeights;
+  }
+
+  // whether the particles of the monitor are their own origins
+  static Bool ownOrigins(const std::map<Size, Types<Size>::Array> & originsMap,
+                         Size iter)
+  {
+    std::map<Size, Types<Size>::Array>::const_iterator it_origins;
+    for (it_origins = originsMap.begin(); it_origins != originsMap.end();
+        ++it_origins)
+    {
+      if (it_origins->first != iter || !it_origins->second.empty())
+        return false;
+    }
+    return true;
+  }
+
+  void Monitor::Append(const Monitor & other)
+  {
+    checkWeightsSet();
+    checkWeightsSwapped();
+    other.checkWeightsSet();
+    other.checkWeightsSwapped();
+
+    if (other.iter_ != iter_ || other.GetNodes() != GetNodes())
+      throw LogicError("Can not append monitor: it monitors other nodes or another iteration.");
+    if (!ownOrigins(iterationOriginsMap_, iter_)
+        || !ownOrigins(other.iterationOriginsMap_, iter_))
+      throw LogicError("Can not append monitor: the particles have an ancestry.");
+
+    // the values may be shared with smooth monitors
+    std::map<NodeId, MonitorArchive::Ptr>::iterator it_values;
+    for (it_values = particleValuesMap_.begin();
+        it_values != particleValuesMap_.end(); ++it_values)
+    {
+      MonitorArchive::Ptr p_values(new MonitorArchive(*it_values->second));
+      p_values->Append(other.GetNodeValues(it_values->first));
+      it_values->second = p_values;
+    }
+
+    weights_.insert(weights_.end(), other.weights_.begin(), other.weights_.end());
+    sumOfWeights_ += other.sumOfWeights_;
+    Scalar sum_sq = 0.0;
+    for (Size i = 0; i < weights_.size(); ++i)
+      sum_sq += weights_[i] * weights_[i];
+    ess_ = sumOfWeights_ * sumOfWeights_ / sum_sq;
+
+    if (HasIterationESS(iter_) || other.HasIterationESS(iter_))
+    {
+      iterationEssMap_[iter_] = ess_;
+      iterationOriginsMap_[iter_].clear();
+    }
+  }
+
+  void Monitor::SaveState(StateWriter & writer) const
+  {
+    checkWeightsSwapped();
+
+    writer.Write(weightsSet_);
+    writer.Write(weights_);
+    writer.Write(ess_);
+    writer.Write(sumOfWeights_);
+
+    writer.Write(Size(particleValuesMap_.size()));
+    std::map<NodeId, MonitorArchive::Ptr>::const_iterator it_values;
+    for (it_values = particleValuesMap_.begin();
+        it_values != particleValuesMap_.end(); ++it_values)
+    {
+      NodeId id = it_values->first;
+      writer.Write(id);
+      writer.Write(nodeIterationMap_.at(id));
+      writer.Write(nodeDiscreteMap_.at(id));
+      it_values->second->SaveState(writer);
+    }
+
+    writer.Write(Size(iterationEssMap_.size()));
+    std::map<Size, Scalar>::const_iterator it_ess;
+    for (it_ess = iterationEssMap_.begin(); it_ess != iterationEssMap_.end();
+        ++it_ess)
+    {
+      writer.Write(it_ess->first);
+      writer.Write(it_ess->second);
+    }
+
+    writer.Write(Size(iterationOriginsMap_.size()));
+    std::map<Size, Types<Size>::Array>::const_iterator it_origins;
+    for (it_origins = iterationOriginsMap_.begin();
+        it_origins != iterationOriginsMap_.end(); ++it_origins)
+    {
+      writer.Write(it_origins->first);
+      writer.Write(it_origins->second);
+    }
+  }
+
+  void Monitor::LoadState(StateReader & reader)
+  {
+    reader.Read(weightsSet_);
+    reader.Read(weights_);
+    weightsSwapped_ = false;
+    reader.Read(ess_);
+    reader.Read(sumOfWeights_);
+
+    particleValuesMap_.clear();
+    nodeIterationMap_.clear();
+    nodeDiscreteMap_.clear();
+    Size n_nodes = reader.Get<Size>();
+    for (Size k = 0; k < n_nodes; ++k)
+    {
+      NodeId id = reader.Get<Size>();
+      reader.Read(nodeIterationMap_[id]);
+      reader.Read(nodeDiscreteMap_[id]);
+      MonitorArchive::Ptr p_values(new MonitorArchive());
+      p_values->LoadState(reader);
+      particleValuesMap_[id] = p_values;
+    }
+
+    iterationEssMap_.clear();
+    Size n_ess = reader.Get<Size>();
+    for (Size k = 0; k < n_ess; ++k)
+    {
+      Size iter = reader.Get<Size>();
+      reader.Read(iterationEssMap_[iter]);
+    }
+
+    iterationOriginsMap_.clear();
+    Size n_origins = reader.Get<Size>();
+    for (Size k = 0; k < n_origins; ++k)
+    {
+      Size iter = reader.Get<Size>();
+      reader.Read(iterationOriginsMap_[iter]);
+    }
+  }
+
+  void FilterMonitor::SaveState(StateWriter & writer) const
+  {
+    BaseType::SaveState(writer);
+    writer.Write(resampled_);
+    writer.Write(logNormConst_);
+  }
+
+  void FilterMonitor::LoadState(StateReader & reader)
+  {
+    BaseType::LoadState(reader);
+    reader.Read(resampled_);
+    reader.Read(logNormConst_);
+  }
+
+  void FilterMonitor::Append(const Monitor & other)
+  {
+    const FilterMonitor * p_other = dynamic_cast<const FilterMonitor *>(&other);
+    if (!p_other)
+      throw LogicError("Can not append monitor: it is not a filter monitor.");
+
+    BaseType::Append(other);
+    resampled_ = resampled_ || p_other->resampled_;
   }
 
   void FilterMonitor::Init(const Types<Particle>::Array & particles,
@@ -189,14 +475,15 @@ namespace Biips
   void FilterMonitor::AddNode(NodeId nodeId,
                               const Types<Particle>::Array & particles,
                               Size iter,
-                              Bool discrete)
+                              Bool discrete,
+                              Bool singlePrecision)
   {
     if (Contains(nodeId))
       throw LogicError("Can not add node: it has already been added in the Monitor.");
 
-    particleValuesMap_[nodeId].resize(particles.size());
-    for (Size i = 0; i < particles.size(); ++i)
-      particleValuesMap_[nodeId][i] = particles[i].GetValue()[nodeId];
+    MonitorArchive::Ptr p_values(new MonitorArchive());
+    p_values->Set(particles, nodeId, singlePrecision);
+    particleValuesMap_[nodeId] = p_values;
 
     nodeIterationMap_[nodeId] = iter;
     nodeDiscreteMap_[nodeId] = discrete;
@@ -220,8 +507,8 @@ namespace Biips
 
   void SmoothMonitor::AddNode(NodeId nodeId, const Monitor & filterMonitor)
   {
-    particleValuesMap_[nodeId].assign(filterMonitor.GetNodeValues(nodeId).begin(),
-                                      filterMonitor.GetNodeValues(nodeId).end());
+    // the values are not modified: they are shared with the filter monitor
+    particleValuesMap_[nodeId] = filterMonitor.GetNodeValuesPtr(nodeId);
 
     nodeIterationMap_[nodeId] = filterMonitor.GetNodeSamplingIteration(nodeId);
     nodeDiscreteMap_[nodeId] = filterMonitor.GetNodeDiscrete(nodeId);
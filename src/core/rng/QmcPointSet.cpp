@@ -0,0 +1,147 @@
+/*! \file QmcPointSet.cpp
+ * Direction numbers from S. Joe and F. Y. Kuo, new-joe-kuo-6.21201.
+ * Scrambling from B. Burley, Practical hash-based Owen scrambling.
+ */
+
+#include "rng/QmcPointSet.hpp"
+#include "rng/Rng.hpp"
+#include <boost/cstdint.hpp>
+#include <algorithm>
+
+namespace Biips
+{
+
+  typedef boost::uint32_t UInt32;
+
+  const Size QmcPointSet::MAX_SOBOL_DIM;
+
+  static const Size N_BITS = 32;
+  // 2^-32
+  static const Scalar INV_TWO_POW_32 = 1.0 / 4294967296.0;
+
+  // Joe-Kuo parameters of the dimensions 2 to MAX_SOBOL_DIM:
+  // degree s, coefficients a and initial direction numbers m
+  struct SobolParams
+  {
+    Size s;
+    UInt32 a;
+    UInt32 m[6];
+  };
+
+  static const SobolParams SOBOL_PARAMS[QmcPointSet::MAX_SOBOL_DIM - 1] =
+  {
+    { 1, 0, { 1 } },
+    { 2, 1, { 1, 3 } },
+    { 3, 1, { 1, 3, 1 } },
+    { 3, 2, { 1, 1, 1 } },
+    { 4, 1, { 1, 1, 3, 3 } },
+    { 4, 4, { 1, 3, 5, 13 } },
+    { 5, 2, { 1, 1, 5, 5, 17 } },
+    { 5, 4, { 1, 1, 5, 5, 5 } },
+    { 5, 7, { 1, 1, 7, 11, 19 } },
+    { 5, 11, { 1, 1, 5, 1, 1 } },
+    { 5, 13, { 1, 1, 1, 3, 11 } },
+    { 5, 14, { 1, 3, 5, 5, 31 } },
+    { 6, 1, { 1, 3, 3, 9, 7, 49 } },
+    { 6, 13, { 1, 1, 1, 15, 21, 21 } },
+    { 6, 16, { 1, 3, 1, 13, 27, 49 } }
+  };
+
+  // direction numbers of the dimension j, starting at 0
+  static void directionNumbers(UInt32 * v, Size j)
+  {
+    if (j == 0)
+    {
+      for (Size k = 0; k < N_BITS; ++k)
+        v[k] = UInt32(1) << (N_BITS - 1 - k);
+      return;
+    }
+
+    const SobolParams & params = SOBOL_PARAMS[j - 1];
+    Size s = params.s;
+    for (Size k = 0; k < s; ++k)
+      v[k] = params.m[k] << (N_BITS - 1 - k);
+    for (Size k = s; k < N_BITS; ++k)
+    {
+      v[k] = v[k - s] ^ (v[k - s] >> s);
+      for (Size l = 1; l < s; ++l)
+        if ((params.a >> (s - 1 - l)) & 1)
+          v[k] ^= v[k - l];
+    }
+  }
+
+  static UInt32 reverseBits(UInt32 x)
+  {
+    x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+    x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+    x = ((x >> 4) & 0x0f0f0f0fu) | ((x & 0x0f0f0f0fu) << 4);
+    x = ((x >> 8) & 0x00ff00ffu) | ((x & 0x00ff00ffu) << 8);
+    return (x >> 16) | (x << 16);
+  }
+
+  // nested uniform scrambling of the bits of x, from the most
+  // significant one
+  static UInt32 scramble(UInt32 x, UInt32 seed)
+  {
+    x = reverseBits(x);
+    x += seed;
+    x ^= x * 0x6c50b47cu;
+    x ^= x * 0xb82f1e52u;
+    x ^= x * 0xc7afe638u;
+    x ^= x * 0x8d22f6e6u;
+    return reverseBits(x);
+  }
+
+  static Scalar toUnit(UInt32 x)
+  {
+    return (Scalar(x) + 0.5) * INV_TWO_POW_32;
+  }
+
+  void QmcPointSet::Generate(Size nPoints, Size dim, Rng & rng)
+  {
+    nPoints_ = nPoints;
+    dim_ = dim;
+    coords_.resize(nPoints_ * dim_);
+
+    Size sobol_dim = std::min(dim_, MAX_SOBOL_DIM);
+    UInt32 v[N_BITS];
+    for (Size j = 0; j < sobol_dim; ++j)
+    {
+      directionNumbers(v, j);
+      UInt32 seed = UInt32(rng.GetGen()());
+      // points in the natural order: the first 2^m points are a net
+      for (Size n = 0; n < nPoints_; ++n)
+      {
+        UInt32 x = 0;
+        Size k = 0;
+        for (Size bits = n; bits > 0; bits >>= 1, ++k)
+          if (bits & 1)
+            x ^= v[k];
+        coords_[n * dim_ + j] = toUnit(scramble(x, seed));
+      }
+    }
+
+    for (Size n = 0; n < nPoints_; ++n)
+      for (Size j = sobol_dim; j < dim_; ++j)
+        coords_[n * dim_ + j] = toUnit(UInt32(rng.GetGen()()));
+  }
+
+  void QmcPointSet::SortByFirstCoordinate()
+  {
+    if (dim_ == 0)
+      return;
+
+    Types<std::pair<Scalar, Size> >::Array order(nPoints_);
+    for (Size n = 0; n < nPoints_; ++n)
+      order[n] = std::make_pair(coords_[n * dim_], n);
+    std::sort(order.begin(), order.end());
+
+    ValArray sorted(coords_.size());
+    for (Size n = 0; n < nPoints_; ++n)
+      std::copy(coords_.begin() + order[n].second * dim_,
+                coords_.begin() + (order[n].second + 1) * dim_,
+                sorted.begin() + n * dim_);
+    coords_.swap(sorted);
+  }
+
+}
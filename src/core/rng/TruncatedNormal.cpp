@@ -9,6 +9,8 @@
 #include <boost/random/uniform_01.hpp>
 #include <boost/random/exponential_distribution.hpp>
 #include <boost/random/variate_generator.hpp>
+#include <algorithm>
+#include <cmath>
 
 using std::sqrt;
 using std::exp;
@@ -24,27 +26,118 @@ namespace Biips
   typedef boost::uniform_01<Scalar> UnifDistType;
   typedef boost::exponential_distribution<Scalar> ExpDistType;
 
-  static NormDistType norm_dist;
-  static UnifDistType unif_dist;
-  static ExpDistType exp_dist;
-
+  // the distributions are created by each call: no state is shared
+  // between the calls, which may be concurrent
   typedef boost::variate_generator<Rng::GenType&, NormDistType> NormGenType;
   typedef boost::variate_generator<Rng::GenType&, UnifDistType> UnifGenType;
   typedef boost::variate_generator<Rng::GenType&, ExpDistType> ExpGenType;
 
   static inline NormGenType normGen(Rng & rng)
   {
-    return NormGenType(rng.GetGen(), norm_dist);
+    return NormGenType(rng.GetGen(), NormDistType());
   }
 
   static inline UnifGenType unifGen(Rng & rng)
   {
-    return UnifGenType(rng.GetGen(), unif_dist);
+    return UnifGenType(rng.GetGen(), UnifDistType());
   }
 
   static inline ExpGenType expGen(Rng & rng)
   {
-    return ExpGenType(rng.GetGen(), exp_dist);
+    return ExpGenType(rng.GetGen(), ExpDistType());
+  }
+
+  /*
+    Piecewise constant envelope of the standard normal density on
+    [-XMAX, XMAX], adapted from Chopin (2011), Fast simulation of
+    truncated Gaussian distributions.
+
+    The cells are symmetric around 0. On the positive side, the height
+    of cell [x_i, x_i+1] is the density at x_i, its maximum, and its
+    width is CELL_AREA over this height, so that all the cells have the
+    same area. A cell can then be chosen uniformly among the cells
+    overlapping an interval, and a point uniformly under its envelope.
+    The density at the outer end of the cell is a lower bound that
+    accepts most points without computing the density.
+
+    The table is built once, at the first use, and only read afterwards.
+   */
+  class NormalCells
+  {
+  public:
+    static const Scalar XMAX;
+    static const Scalar CELL_AREA;
+
+    //! Boundaries of the cells, from -x_K to x_K
+    Types<Scalar>::Array bounds;
+    //! Heights of the cells, unnormalized density
+    Types<Scalar>::Array upper;
+    //! Lower bound of the unnormalized density in the cells
+    Types<Scalar>::Array lower;
+    //! Cell containing Min() + j * CELL_AREA, cells are wider than CELL_AREA
+    Types<Size>::Array index;
+
+    NormalCells()
+    {
+      Types<Scalar>::Array pos_bounds(1, 0.0);
+      while (pos_bounds.back() < XMAX)
+      {
+        Scalar x = pos_bounds.back();
+        pos_bounds.push_back(x + CELL_AREA / exp(-x * x / 2));
+      }
+
+      Size n_pos = pos_bounds.size() - 1;
+      bounds.reserve(2 * n_pos + 1);
+      for (Size i = n_pos; i > 0; --i)
+        bounds.push_back(-pos_bounds[i]);
+      bounds.insert(bounds.end(), pos_bounds.begin(), pos_bounds.end());
+
+      for (Size k = 0; k + 1 < bounds.size(); ++k)
+      {
+        Scalar inner = std::min(std::fabs(bounds[k]), std::fabs(bounds[k + 1]));
+        Scalar outer = std::max(std::fabs(bounds[k]), std::fabs(bounds[k + 1]));
+        upper.push_back(exp(-inner * inner / 2));
+        lower.push_back(exp(-outer * outer / 2));
+      }
+
+      Size k = 0;
+      for (Scalar x = Min(); x < Max(); x = Min() + index.size() * CELL_AREA)
+      {
+        while (bounds[k + 1] <= x)
+          ++k;
+        index.push_back(k);
+      }
+    }
+
+    Scalar Min() const
+    {
+      return bounds.front();
+    }
+    Scalar Max() const
+    {
+      return bounds.back();
+    }
+    //! Index of the cell containing x, in [Min(), Max()]
+    Size Cell(Scalar x) const
+    {
+      Size j = std::min(Size((x - Min()) / CELL_AREA), Size(index.size() - 1));
+      Size k = index[j];
+      while (k + 2 < bounds.size() && bounds[k + 1] <= x)
+        ++k;
+      return k;
+    }
+  };
+
+  // beyond 3, the exponential rejection sampling of the tails
+  // accepts more than 90% of the proposals
+  const Scalar NormalCells::XMAX = 3.0;
+  const Scalar NormalCells::CELL_AREA = 1.0 / 1024;
+
+  static const NormalCells & normalCells()
+  {
+    // thread-safe initialization
+    static const NormalCells cells;
+    return cells;
   }
 
   //Calculates optimal scale parameter for exponential envelope
@@ -167,15 +260,70 @@ namespace Biips
   }
 
 
-  static Scalar inorm(Scalar left, Scalar right, Rng & rng)
+  /*
+    Sample an interval-truncated standard normal distribution with the
+    envelope of NormalCells, when the interval overlaps the cells first
+    to last.
+   */
+  static Scalar inorm_cells(Scalar left, Scalar right, Size first, Size last,
+                            Rng & rng)
+  {
+    const NormalCells & cells = normalCells();
+    Size n_cells = last - first + 1;
+
+    UnifGenType unif_gen = unifGen(rng);
+    while (true)
+    {
+      Size k = std::min(first + Size(unif_gen() * n_cells), last);
+      Scalar z = cells.bounds[k]
+                 + (cells.bounds[k + 1] - cells.bounds[k]) * unif_gen();
+      // the first and last cells can overlap the interval partially
+      if ((k == first && z < left) || (k == last && z > right))
+        continue;
+      Scalar y = cells.upper[k] * unif_gen();
+      if (y <= cells.lower[k] || y <= exp(-z * z / 2))
+        return z;
+    }
+  }
+
+  static void checkLimits(Scalar left, Scalar right)
   {
     if (!isFinite(left) || !isFinite(right))
       throw LogicError("Non-finite boundary in truncated normal");
 
     if (right < left)
       throw LogicError("Invalid limits in inorm");
+  }
 
-    if (left > 0)
+  // minimum number of cell boundaries crossed by an interval
+  // sampled with NormalCells
+  static const Size MIN_CELLS = 4;
+
+  //! Overlapped cells of NormalCells, if they are used for [left, right]
+  static Bool normalCellsRange(Scalar left, Scalar right, Size & first,
+                               Size & last)
+  {
+    const NormalCells & cells = normalCells();
+    if (left < cells.Min() || right > cells.Max())
+      return false;
+    first = cells.Cell(left);
+    last = cells.Cell(right);
+    // the proposals fall in the overlapped cells, but only those in
+    // [left, right] are kept: a short interval, even across a cell
+    // boundary, is better sampled with a uniform envelope
+    Scalar span = cells.bounds[last + 1] - cells.bounds[first];
+    return last - first >= MIN_CELLS && right - left >= span / 2;
+  }
+
+  static Scalar inorm(Scalar left, Scalar right, Rng & rng)
+  {
+    checkLimits(left, right);
+
+    Size first, last;
+    if (normalCellsRange(left, right, first, last))
+      return inorm_cells(left, right, first, last, rng);
+
+    else if (left > 0)
       return inorm_right_tail(left, right, rng);
 
     else if (right < 0)
@@ -205,4 +353,42 @@ namespace Biips
     return mu + sigma * inorm((left - mu)/sigma, (right - mu)/sigma, rng);
   }
 
+  void lnormal(Scalar * values, Size n, Scalar left, Rng & rng, Scalar mu,
+               Scalar sigma)
+  {
+    Scalar std_left = (left - mu)/sigma;
+    for (Size i = 0; i < n; ++i)
+      values[i] = mu + sigma * lnorm(std_left, rng);
+  }
+
+  void rnormal(Scalar * values, Size n, Scalar right, Rng & rng, Scalar mu,
+               Scalar sigma)
+  {
+    Scalar std_right = (right - mu)/sigma;
+    for (Size i = 0; i < n; ++i)
+      values[i] = mu + sigma * rnorm(std_right, rng);
+  }
+
+  void inormal(Scalar * values, Size n, Scalar left, Scalar right, Rng & rng,
+               Scalar mu, Scalar sigma)
+  {
+    Scalar std_left = (left - mu)/sigma;
+    Scalar std_right = (right - mu)/sigma;
+    checkLimits(std_left, std_right);
+
+    // the choice of the method is shared by the batch
+    Size first, last;
+    if (normalCellsRange(std_left, std_right, first, last))
+    {
+      for (Size i = 0; i < n; ++i)
+        values[i] = mu + sigma * inorm_cells(std_left, std_right, first, last,
+                                             rng);
+    }
+    else
+    {
+      for (Size i = 0; i < n; ++i)
+        values[i] = mu + sigma * inorm(std_left, std_right, rng);
+    }
+  }
+
 }
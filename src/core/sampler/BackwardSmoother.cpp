@@ -12,11 +12,23 @@ namespace Biips
   BackwardSmoother::BackwardSmoother(const Graph & graph,
                                      const Types<Monitor*>::Array & filterMonitors,
                                      const Types<Size>::Array & nodeIterations) :
-    graph_(graph), filterMonitors_(filterMonitors), sumOfWeights_(0.0),
+    graph_(graph), filterMonitors_(filterMonitors),
+        nodeFilterMonitors_(graph.GetSize(), NULL), sumOfWeights_(0.0),
         ess_(0.0), iter_(0), initialized_(false),
-        nodeIterations_(nodeIterations),
-        condNodes_(filterMonitors.back()->GetConditionalNodes())
+        nodeIterations_(nodeIterations), pProfile_(NULL), pObsValues_(NULL)
   {
+    Types<NodeId>::ConstIterator it_cond, it_cond_end;
+    boost::tie(it_cond, it_cond_end) =
+        filterMonitors.back()->GetConditionalNodes();
+    condNodes_.assign(it_cond, it_cond_end);
+
+    // index the monitors by node, the last monitor containing a node wins
+    for (Size i = 0; i < filterMonitors_.size(); ++i)
+    {
+      Types<NodeId>::Array nodes = filterMonitors_[i]->GetNodes();
+      for (Size k = 0; k < nodes.size(); ++k)
+        nodeFilterMonitors_[nodes[k]] = filterMonitors_[i];
+    }
   }
 
   void BackwardSmoother::sumOfWeightsAndEss()
@@ -46,6 +58,12 @@ namespace Biips
     sumOfWeights_ = last_monitor.GetSumOfWeights();
     ess_ = last_monitor.GetESS();
 
+    if (pProfile_)
+    {
+      pProfile_->BeginIteration(iter_, true);
+      pProfile_->Current().ess = ess_;
+    }
+
     initialized_ = true;
   }
 
@@ -68,16 +86,13 @@ namespace Biips
     }
     else
     {
-      Types<Monitor*>::Array::const_reverse_iterator rit =
-          filterMonitors_.rbegin();
-      while (!(*rit)->Contains(id) && (rit != filterMonitors_.rend()))
-      {
-        ++rit;
-      }
-      if (rit == filterMonitors_.rend())
+      // the monitors of the iterations after iter_ have been popped
+      Monitor * p_monitor = nodeFilterMonitors_[id];
+      if (!p_monitor || p_monitor->GetIteration() > iter_
+          || !p_monitor->Contains(id))
         throw LogicError("getParentFilterMonitor: there is one parent unmonitored parent.");
 
-      return *rit;
+      return p_monitor;
     }
   }
 
@@ -97,6 +112,13 @@ namespace Biips
     if (filterMonitors_.empty())
       throw LogicError("Can not iterate BackwardSmoother: there is no remaining iteration of filtering Monitor object.");
 
+    SamplerProfile::TimePoint start;
+    if (pProfile_)
+    {
+      pProfile_->BeginIteration(iter_, true);
+      start = SamplerProfile::Now();
+    }
+
     Monitor & new_monitor = *(filterMonitors_.back());
 
     if (new_monitor.GetIteration() != iter_)
@@ -112,15 +134,17 @@ namespace Biips
     const StochasticNode & last_node =
         dynamic_cast<const StochasticNode &> (graph_.GetNode(last_node_id));
 
-    // fill parameters monitors vector
+    // fill parameters monitors vector, the bounds are the last parents
+    Size n_params = last_node.Parents().size() - last_node.IsLowerBounded()
+                    - last_node.IsUpperBounded();
     Types<Monitor*>::Array param_monitors;
-    for (Size p = 0; p < last_node.Parents().size(); ++p)
+    for (Size p = 0; p < n_params; ++p)
       param_monitors.push_back(getParentFilterMonitor(last_node.Parents()[p]));
 
     // fill bounds monitors pair
     Types<Monitor*>::Pair bound_monitors;
     if (last_node.IsLowerBounded())
-      bound_monitors.second = getParentFilterMonitor(last_node.Lower());
+      bound_monitors.first = getParentFilterMonitor(last_node.Lower());
     if (last_node.IsUpperBounded())
       bound_monitors.second = getParentFilterMonitor(last_node.Upper());
 
@@ -130,21 +154,29 @@ namespace Biips
     NumArray::Array param_values_i;
     NumArray last_particle_value_j;
     NumArray::Pair bound_values_i;
+    // the values read in the monitors are copied in these buffers
+    Types<ValArray>::Array param_buffers;
+    Types<ValArray>::Pair bound_buffers;
+    ValArray last_value_buffer;
 
     // Computing matrix P
     for (Size i = 0; i < n_particles; ++i)
     {
+      param_values_i
+          = getParamValues(last_node_id, graph_, ObsValues(),
+                           param_monitors, i, param_buffers);
+      bound_values_i
+          = getBoundValues(last_node_id, graph_, ObsValues(),
+                           bound_monitors, i, bound_buffers);
+
       for (Size j = 0; j < n_particles; ++j)
       {
-        param_values_i
-            = getParamValues(last_node_id, graph_, param_monitors, i);
-        bound_values_i
-            = getBoundValues(last_node_id, graph_, bound_monitors, i);
-
         last_particle_value_j = getNodeValue(last_node_id,
                                              graph_,
+                                             ObsValues(),
                                              *p_last_monitor,
-                                             j);
+                                             j,
+                                             last_value_buffer);
         Scalar d;
         try {
           d = std::exp(last_node.LogPriorDensity(last_particle_value_j,
@@ -231,6 +263,12 @@ namespace Biips
     new_monitor.SwapWeights(weights_filter_vec.data());
 
     sumOfWeightsAndEss();
+
+    if (pProfile_)
+    {
+      pProfile_->Current().weightingTime = SamplerProfile::Since(start);
+      pProfile_->Current().ess = ess_;
+    }
   }
 
   Scalar BackwardSmoother::GetNodeESS(NodeId nodeId) const
@@ -238,7 +276,8 @@ namespace Biips
     if (!Initialized())
       throw LogicError("Can not GetNodeESS: smoother not initialized.");
 
-    if (GetNodeSamplingIteration(nodeId) > iter_)
+    Size iter = GetNodeSamplingIteration(nodeId);
+    if (iter > iter_)
       throw LogicError("Can not get node ess: node was sampled at greater iteration.");
 
     Monitor & monitor = *(filterMonitors_.back());
@@ -253,22 +292,19 @@ namespace Biips
         != LastUpdatedNodes().end())
       return ess_;
 
-    std::map<ValArray*, Types<Size>::Array> indices_table;
-    for (Size i = 0; i < monitor.GetNodeValues(nodeId).size(); ++i)
-      indices_table[monitor.GetNodeValues(nodeId)[i].get()].push_back(i);
+    // the particles of a same origin at the sampling iteration
+    // share the node value: sum their weights
+    const Types<Size>::Array & origins = monitor.GetIterationOrigins(iter);
+    Size n_particles = weights_.size();
 
     typedef long double LongScalar;
-    LongScalar sum_sq = 0.0;
-    LongScalar sum_temp;
-    for (std::map<ValArray*, Types<Size>::Array>::const_iterator it =
-        indices_table.begin(); it != indices_table.end(); ++it)
-    {
-      sum_temp = 0.0;
-      for (Size i = 0; i < it->second.size(); ++i)
-        sum_temp += weights_[it->second[i]];
+    Types<LongScalar>::Array origin_weights(n_particles, 0.0);
+    for (Size i = 0; i < n_particles; ++i)
+      origin_weights[origins.empty() ? i : origins[i]] += weights_[i];
 
-      sum_sq += std::pow(sum_temp, 2);
-    }
+    LongScalar sum_sq = 0.0;
+    for (Size i = 0; i < n_particles; ++i)
+      sum_sq += origin_weights[i] * origin_weights[i];
     if (sum_sq == 0.0)
       throw NumericalError("Failure to calculate node ESS: sum of squared weights is null.");
 
@@ -286,8 +322,7 @@ namespace Biips
 
     featuresAcc.Init();
     for (Size i = 0; i < last_monitor.NParticles(); i++)
-      featuresAcc.Push((*(last_monitor.GetNodeValues(nodeId)[i]))[n],
-                       weights_[i]);
+      featuresAcc.Push(last_monitor.GetNodeValues(nodeId)(i, n), weights_[i]);
   }
 
   void BackwardSmoother::Accumulate(NodeId nodeId,
@@ -301,8 +336,7 @@ namespace Biips
 
     featuresAcc.Init();
     for (Size i = 0; i < last_monitor.NParticles(); i++)
-      featuresAcc.Push((*(last_monitor.GetNodeValues(nodeId)[i]))[n],
-                       weights_[i]);
+      featuresAcc.Push(last_monitor.GetNodeValues(nodeId)(i, n), weights_[i]);
   }
 
   void BackwardSmoother::Accumulate(NodeId nodeId,
@@ -314,8 +348,10 @@ namespace Biips
           + print(nodeId) + " is not monitored at the current iteration."));
 
     featuresAcc.Init(graph_.GetNode(nodeId).DimPtr());
+    ValArray buffer;
     for (Size i = 0; i < last_monitor.NParticles(); i++)
-      featuresAcc.Push(*(last_monitor.GetNodeValues(nodeId)[i]), weights_[i]);
+      featuresAcc.Push(last_monitor.GetNodeValues(nodeId).Value(i, buffer),
+                       weights_[i]);
   }
 
   Size BackwardSmoother::GetNodeSamplingIteration(NodeId nodeId) const
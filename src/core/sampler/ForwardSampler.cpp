@@ -12,6 +12,11 @@
 #include "common/ArrayAccumulator.hpp"
 #include "model/Monitor.hpp"
 
+#include <boost/cstdint.hpp>
+#include <algorithm>
+#include <sstream>
+#include <typeinfo>
+
 namespace Biips
 {
 
@@ -25,52 +30,60 @@ namespace Biips
   {
     // list of node sampler factories
     std::list<std::pair<NodeSamplerFactory::Ptr, Bool> >::const_iterator
-    it_sampler_factory = NodeSamplerFactories().begin();
+    it_sampler_factory;
 
     Types<SMCIteration>::Iterator it_smc_iter;
 
-    // loop over node sampler factories
-    // in priority order
-    for (; it_sampler_factory != NodeSamplerFactories().end(); ++it_sampler_factory)
-    {
-      if (!it_sampler_factory->second)
-        continue;
-
-      // loop over iterations
-      for (Size i=0; i<smcIterations_.size(); ++i)
-      {
-        // loop over nodes in iteration i
-        it_smc_iter = smcIterations_.at(i).begin();
-        for (; it_smc_iter != smcIterations_.at(i).end(); ++it_smc_iter)
-        {
-          // if null, i.e not already assigned a sampler
-          if (!it_smc_iter->NodeSamplerPtr())
-            it_sampler_factory->first->Create(graph_,
-                                              it_smc_iter->StoUnobs(),
-                                              it_smc_iter->NodeSamplerPtr());
-          // if the current node sampler factory conditions are met
-          // Create method assigns the node sampler to it_smc_iter->NodeSamplerPtr()
-          // otherwise does not change it (null)
-        }
-      }
-    }
-
-    // assign default prior NodeSampler to all non assigned nodes
     // loop over iterations
+    // the sampler assigned to a node only depends on the graph and the node,
+    // so that each node is assigned independently of the others
     for (Size i=0; i<smcIterations_.size(); ++i)
     {
+      // loop over nodes in iteration i
       it_smc_iter = smcIterations_.at(i).begin();
       for (; it_smc_iter != smcIterations_.at(i).end(); ++it_smc_iter)
       {
-        // if null, i.e not already assigned a sampler
+        // loop over node sampler factories
+        // in priority order, until one of them meets its conditions
+        // Create method assigns the node sampler to it_smc_iter->NodeSamplerPtr()
+        // otherwise does not change it (null)
+        it_sampler_factory = NodeSamplerFactories().begin();
+        for (; it_sampler_factory != NodeSamplerFactories().end()
+            && !it_smc_iter->NodeSamplerPtr(); ++it_sampler_factory)
+        {
+          if (!it_sampler_factory->second)
+            continue;
+
+          it_sampler_factory->first->Create(graph_,
+                                            it_smc_iter->StoUnobs(),
+                                            it_smc_iter->NodeSamplerPtr());
+        }
+
+        // assign default prior NodeSampler if not already assigned a sampler
         if (!it_smc_iter->NodeSamplerPtr())
           NodeSamplerFactory::Instance()->Create(graph_,
                                                  it_smc_iter->StoUnobs(),
                                                  it_smc_iter->NodeSamplerPtr());
+
+        it_smc_iter->NodeSamplerPtr()->SetParamChecker(&paramChecker_);
+        it_smc_iter->NodeSamplerPtr()->SetLikeTerms(&likeTerms_);
+        it_smc_iter->NodeSamplerPtr()->SetObsValues(pObsValues_);
       }
     }
   }
 
+  void ForwardSampler::SetObsValues(const NodeValues * pObsValues)
+  {
+    if (pObsValues && pObsValues->size() != graph_.GetSize())
+      throw LogicError("Can not set observed values: size mismatch.");
+
+    pObsValues_ = pObsValues;
+    for (Size i = 0; i < smcIterations_.size(); ++i)
+      for (Size k = 0; k < smcIterations_[i].size(); ++k)
+        if (smcIterations_[i][k].NodeSamplerPtr())
+          smcIterations_[i][k].NodeSamplerPtr()->SetObsValues(pObsValues_);
+  }
+
   void ForwardSampler::initLocks()
   {
     std::fill(nodeLocks_.begin(), nodeLocks_.end(), 0);
@@ -114,17 +127,80 @@ namespace Biips
     }
   }
 
+  void ForwardSampler::buildReleaseSchedule()
+  {
+    // replay the unlocks of each iteration on a copy of the initial locks
+    Types<Int>::Array locks(nodeLocks_);
+    releaseSchedule_.assign(NIterations(), Types<NodeId>::Array());
+    deferredReleases_.clear();
+
+    for (Size t = 0; t < NIterations(); ++t)
+    {
+      Types<NodeId>::Array & released = releaseSchedule_[t];
+      for (Size i = 0; i < smcIterations_[t].size(); ++i)
+      {
+        const Types<NodeId>::Array & sampled_nodes =
+            smcIterations_[t][i].SampledNodes();
+        for (Size k = 0; k < sampled_nodes.size(); ++k)
+        {
+          GraphTypes::ParentIterator it_parents, it_parents_end;
+          boost::tie(it_parents, it_parents_end) =
+              graph_.GetParents(sampled_nodes[k]);
+          for (; it_parents != it_parents_end; ++it_parents)
+          {
+            // nodes that are free before the first release are collected below
+            if (--locks[*it_parents] == 0 && t > 0)
+            {
+              released.push_back(*it_parents);
+              locks[*it_parents] = -1;
+            }
+          }
+        }
+      }
+
+      if (t > 0)
+        continue;
+
+      for (NodeId id = 0; id < locks.size(); ++id)
+      {
+        if (locks[id] != 0)
+          continue;
+        released.push_back(id);
+        locks[id] = -1;
+      }
+    }
+  }
+
+  void ForwardSampler::releaseNode(NodeId id)
+  {
+    for (Size i = 0; i < nParticles_; ++i)
+      particles_[i].Value()[id].reset();
+    nodeLocks_[id] = -1;
+  }
+
   ForwardSampler::ForwardSampler(const Graph & graph) :
         graph_(graph), nParticles_(1), resampleThreshold_(BIIPS_POSINF),
+        pConditionalNodes_(new Types<NodeId>::Array()),
         sampledFlagsBefore_(graph.GetSize()), sampledFlagsAfter_(graph.GetSize()),
         nodeIterations_(graph.GetSize(), BIIPS_SIZENA),
-        nodeLocks_(graph.GetSize(), 0), built_(false), initialized_(false)
+        lazyEvaluation_(false), requiredNodes_(graph.GetSize(), false),
+        singlePrecisionArchives_(false),
+        eagerNodes_(graph.GetSize(), true),
+        lazyFlags_(graph.GetObserved()), lazyVisits_(graph.GetSize(), 0),
+        lazyVisitCount_(0),
+        paramChecker_(graph), likeTerms_(graph), pObsValues_(NULL),
+        sqmc_(false),
+        nodeLocks_(graph.GetSize(), 0), ancestryBegin_(0), originsBegin_(0),
+        built_(false), initialized_(false),
+        pProfile_(NULL)
   {
     if (!resamplerTable().Contains("stratified"))
       throw LogicError("StratifiedResampler not found in the ResamplerTable.");
-    pResampler_ = resamplerTable()["stratified"];
-    if (!pResampler_)
+    Resampler::Ptr p_resampler = resamplerTable()["stratified"];
+    if (!p_resampler)
       throw LogicError("Resampler::Ptr is Null.");
+    // the resamplers of the table are shared by all the samplers
+    pResampler_ = p_resampler->Clone();
   }
 
   Scalar ForwardSampler::GetNodeESS(NodeId nodeId) const
@@ -139,47 +215,110 @@ namespace Biips
 
     if (iter > iter_)
       throw LogicError("Can not get node ess: node has not been sampled.");
+    // the particles of the current iteration are their own origins
+    if (iter == iter_)
+      return ess_;
 
-    // TODO check this
-    if (iter==iter_)
+    const Types<Size>::Array & origins = GetIterationOrigins(iter);
+    // the values are distinct if the particles were not resampled since
+    if (origins.empty())
       return ess_;
-//    for (Size i=0; i<smcIterations_.at(iter_).size(); ++i)
-//    {
-//      if (smcIterations_.at(iter_).at(i).SamplesNode(nodeId))
-//        return ess_;
-//    }
 
-    // We store the particle indices of unique values
-    // in a map indexed by the value pointers
-    std::map<ValArray*, Types<Size>::Array> indices_table;
-    for (Size i = 0; i < nParticles_; ++i)
-      indices_table[particles_[i].GetValue()[nodeId].get()].push_back(i);
+    if (!isNan(iterationESS_[iter]))
+      return iterationESS_[iter];
 
+    // sum the weights of the particles of a same origin
     typedef long double LongScalar;
+    Types<LongScalar>::Array origin_weights(nParticles_, 0.0);
+    for (Size i = 0; i < nParticles_; ++i)
+      origin_weights[origins[i]] += particles_[i].Weight();
+
     LongScalar sum_sq = 0.0;
-    LongScalar sum_temp;
-    for (std::map<ValArray*, Types<Size>::Array>::const_iterator it =
-        indices_table.begin(); it != indices_table.end(); ++it)
+    for (Size i = 0; i < nParticles_; ++i)
+      sum_sq += origin_weights[i] * origin_weights[i];
+    if (sum_sq == 0.0)
+      throw NumericalError("Failure to calculate node ESS: sum of squared weights is null.");
+
+    iterationESS_[iter] = std::exp(-std::log(sum_sq) + 2.0
+                                   * std::log(LongScalar(sumOfWeights_)));
+    return iterationESS_[iter];
+  }
+
+  const Types<Size>::Array & ForwardSampler::GetIterationOrigins(Size iter) const
+  {
+    if (!Initialized())
+      throw LogicError("Can not get iteration origins: sampler not initialized.");
+    if (iter > iter_)
+      throw LogicError("Can not get iteration origins: iteration has not been reached.");
+    if (iter < ancestryBegin_)
+      throw LogicError("Can not get iteration origins: ancestry has been released.");
+
+    computeOrigins(iter);
+    return origins_[iter];
+  }
+
+  void ForwardSampler::computeOrigins(Size iter) const
+  {
+    // compose the ancestors backwards from the last computed iteration
+    for (Size k = originsBegin_; k > iter; --k)
     {
-      sum_temp = 0.0;
-      for (Size i = 0; i < it->second.size(); ++i)
-        sum_temp += particles_[it->second[i]].Weight();
+      const Types<Size>::Array & ancestors = ancestors_[k];
+      const Types<Size>::Array & next_origins = origins_[k];
+      Types<Size>::Array & origins = origins_[k - 1];
+      if (ancestors.empty())
+        origins = next_origins;
+      else if (next_origins.empty())
+        origins = ancestors;
+      else
+      {
+        origins.resize(nParticles_);
+        for (Size i = 0; i < nParticles_; ++i)
+          origins[i] = ancestors[next_origins[i]];
+      }
+    }
+    originsBegin_ = std::min(originsBegin_, iter);
+  }
 
-      sum_sq += std::pow(sum_temp, 2);
+  void ForwardSampler::clearOrigins()
+  {
+    for (Size k = originsBegin_; k < origins_.size(); ++k)
+    {
+      Types<Size>::Array().swap(origins_[k]);
+      iterationESS_[k] = BIIPS_REALNAN;
     }
-    if (sum_sq == 0.0)
-      throw NumericalError("Failure to calculate node ESS: sum of squared weights is null.");
+    origins_.resize(iter_ + 1);
+    iterationESS_.resize(iter_ + 1, BIIPS_REALNAN);
+    // each particle is its own origin at the current iteration
+    originsBegin_ = iter_;
+  }
+
+  void ForwardSampler::ReleaseAncestry(Size iter)
+  {
+    if (!Initialized())
+      throw LogicError("Can not release ancestry: sampler not initialized.");
+    if (iter > iter_)
+      throw LogicError("Can not release ancestry: iteration has not been reached.");
 
-    return std::exp(-std::log(sum_sq) + 2.0
-                    * std::log(LongScalar(sumOfWeights_)));
+    // the origins at an iteration only need the ancestors after it
+    for (; ancestryBegin_ < iter; ++ancestryBegin_)
+    {
+      Types<Size>::Array().swap(ancestors_[ancestryBegin_ + 1]);
+      Types<Size>::Array().swap(origins_[ancestryBegin_]);
+    }
+    originsBegin_ = std::max(originsBegin_, ancestryBegin_);
   }
 
   Types<NodeId>::Array ForwardSampler::LastSampledNodes()
+  {
+    return GetSampledNodes(iter_);
+  }
+
+  Types<NodeId>::Array ForwardSampler::GetSampledNodes(Size iter) const
   {
     Types<NodeId>::Array ans;
-    for (Size i=0; i<smcIterations_.at(iter_).size(); ++i)
+    for (Size i=0; i<smcIterations_.at(iter).size(); ++i)
     {
-      const Types<NodeId>::Array & sampled = smcIterations_.at(iter_).at(i).SampledNodes();
+      const Types<NodeId>::Array & sampled = smcIterations_.at(iter).at(i).SampledNodes();
       ans.insert(ans.end(), sampled.begin(), sampled.end());
     }
     return ans;
@@ -199,20 +338,16 @@ namespace Biips
     return ans;
   }
 
-  Types<NodeId>::Array ForwardSampler::ConditionalNodes()
+  void ForwardSampler::appendConditionalNodes()
   {
-    Types<NodeId>::Array ans;
-    for (Size iter=0; iter<=iter_; ++iter) // iter=0,...,iter_
+    Types<NodeId>::Array & ans = *pConditionalNodes_;
+    for (Size i=0; i<smcIterations_.at(iter_).size(); ++i)
     {
-      for (Size i=0; i<smcIterations_.at(iter).size(); ++i)
-      {
-        const Types<NodeId>::Array & top = smcIterations_.at(iter).at(i).TopConditionalNodes();
-        ans.insert(ans.end(), top.begin(), top.end());
-        const Types<NodeId>::Array & like = smcIterations_.at(iter).at(i).LikelihoodNodes();
-        ans.insert(ans.end(), like.begin(), like.end());
-      }
+      const Types<NodeId>::Array & top = smcIterations_.at(iter_).at(i).TopConditionalNodes();
+      ans.insert(ans.end(), top.begin(), top.end());
+      const Types<NodeId>::Array & like = smcIterations_.at(iter_).at(i).LikelihoodNodes();
+      ans.insert(ans.end(), like.begin(), like.end());
     }
-    return ans;
   }
 
   class BuildIterationsVisitor: public ConstNodeVisitor
@@ -355,10 +490,99 @@ namespace Biips
     return nodeIterations_;
   }
 
+  void ForwardSampler::markEagerNodes()
+  {
+    eagerNodes_.assign(graph_.GetSize(), true);
+    if (!lazyEvaluation_)
+      return;
+
+    // children are sampled after their parents: visit the logical nodes
+    // backwards so that the children are marked first
+    for (Size t = NIterations(); t > 0; --t)
+    {
+      const Types<SMCIteration>::Array & smc_iter = smcIterations_[t-1];
+      for (Size i = smc_iter.size(); i > 0; --i)
+      {
+        const Types<NodeId>::Array & sampled_nodes = smc_iter[i-1].SampledNodes();
+        for (Size k = sampled_nodes.size(); k > 1; --k)
+        {
+          NodeId id = sampled_nodes[k-1];
+          Bool eager = requiredNodes_[id];
+          GraphTypes::ChildIterator it_child, it_child_end;
+          boost::tie(it_child, it_child_end) = graph_.GetChildren(id);
+          for (; !eager && it_child != it_child_end; ++it_child)
+            eager = graph_.GetNode(*it_child).GetType() == STOCHASTIC
+                    || eagerNodes_[*it_child];
+          eagerNodes_[id] = eager;
+        }
+      }
+    }
+  }
+
+  void ForwardSampler::evaluateLazyNode(NodeId id)
+  {
+    NodeSampler evaluator(graph_);
+    evaluator.SetParamChecker(&paramChecker_);
+    evaluator.SetObsValues(pObsValues_);
+    evaluator.SetValueMemory(pProfile_ ? pProfile_->ValueMemoryPtr()
+                                       : SamplerProfile::ValueMemory::Ptr());
+
+    // the evaluation only reads the flags of the ancestors of the node
+    // down to the values the particle holds: only those are set
+    Types<NodeId>::Array to_visit;
+    for (Size i = 0; i < nParticles_; ++i)
+    {
+      NodeValues & values = particles_[i].Value();
+      if (values[id])
+        continue;
+
+      // the ancestors that the particle has not memoized are evaluated
+      // from their parents, down to stochastic parents that it must hold
+      if (++lazyVisitCount_ == 0)
+      {
+        lazyVisits_.assign(lazyVisits_.size(), 0);
+        lazyVisitCount_ = 1;
+      }
+      lazyFlags_[id] = false;
+      to_visit.assign(1, id);
+      while (!to_visit.empty())
+      {
+        NodeId node_id = to_visit.back();
+        to_visit.pop_back();
+        GraphTypes::ParentIterator it_parents, it_parents_end;
+        boost::tie(it_parents, it_parents_end) = graph_.GetParents(node_id);
+        for (; it_parents != it_parents_end; ++it_parents)
+        {
+          NodeId parent_id = *it_parents;
+          if (graph_.GetObserved()[parent_id]
+              || lazyVisits_[parent_id] == lazyVisitCount_)
+            continue;
+          lazyVisits_[parent_id] = lazyVisitCount_;
+          lazyFlags_[parent_id] = Bool(values[parent_id]);
+          if (values[parent_id])
+            continue;
+          if (graph_.GetNode(parent_id).GetType() == STOCHASTIC)
+            throw NodeError(id, "Can not evaluate lazy node: the values of its "
+                                "parents have been released.");
+          to_visit.push_back(parent_id);
+        }
+      }
+
+      evaluator.SetMembers(values, lazyFlags_, pRng_);
+      evaluator.Sample(id);
+    }
+  }
+
+  const NodeValues & ForwardSampler::obsValues() const
+  {
+    return pObsValues_ ? *pObsValues_ : graph_.GetValues();
+  }
+
   void ForwardSampler::Build()
   {
     buildNodeIdSequence();
     buildNodeSamplers();
+    paramChecker_.Build(obsValues());
     built_ = true;
   }
 
@@ -373,7 +597,8 @@ namespace Biips
   //    initialized_ = false;
   //  }
 
-  void ForwardSampler::mutateParticle(Particle & lastParticle)
+  void ForwardSampler::mutateParticle(Particle & lastParticle,
+                                      const Scalar * uniforms)
   {
     // sample current stochastic node
     std::copy(sampledFlagsBefore_.begin(), sampledFlagsBefore_.end(),
@@ -383,20 +608,35 @@ namespace Biips
 
     for (Size i=0; i<smc_iter.size(); ++i)
     {
+      SamplerProfile::TimePoint start;
+      if (pProfile_)
+        start = SamplerProfile::Now();
+
       smc_iter.at(i).NodeSamplerPtr()->SetMembers(lastParticle.Value(),
                                       sampledFlagsAfter_,
                                       pRng_);
+      smc_iter.at(i).NodeSamplerPtr()->SetUniforms(uniforms);
+      smc_iter.at(i).NodeSamplerPtr()->SetValueMemory(
+          pProfile_ ? pProfile_->ValueMemoryPtr()
+                    : SamplerProfile::ValueMemory::Ptr());
       smc_iter.at(i).NodeSamplerPtr()->Sample(smc_iter.at(i).StoUnobs());
+      if (uniforms)
+        uniforms += graph_.GetNode(smc_iter.at(i).StoUnobs()).Dim().Length();
 
-      // compute all children that are logical
-      // TODO only update nodes which have a monitored child
+      // compute the children that are logical
+      // in lazy evaluation, only those which are needed downstream
       // TODO update also children that are stochastic with no children
       Types<NodeId>::ConstIterator it_children = smc_iter.at(i).SampledNodes().begin()+1;
       while (it_children != smc_iter.at(i).SampledNodes().end())
       {
-        smc_iter.at(i).NodeSamplerPtr()->Sample(*it_children);
+        if (eagerNodes_[*it_children])
+          smc_iter.at(i).NodeSamplerPtr()->Sample(*it_children);
         ++it_children;
       }
+
+      if (pProfile_)
+        pProfile_->AddNodeSamplerCall(smc_iter.at(i).NodeSamplerPtr()->Name(),
+                                      SamplerProfile::Since(start));
     }
     // update particle log weight
     // only at the last smc_iter which has observed likelihood children
@@ -404,6 +644,194 @@ namespace Biips
     lastParticle.AddToLogWeight(log_incr_weight);
   }
 
+  void ForwardSampler::checkSqmcSamplers() const
+  {
+    for (Size k = 0; k < NIterations(); ++k)
+    {
+      for (Size i = 0; i < smcIterations_[k].size(); ++i)
+      {
+        const NodeSampler & sampler = *smcIterations_[k][i].NodeSamplerPtr();
+        NodeId id = smcIterations_[k][i].StoUnobs();
+        // the derived samplers do not use the uniforms
+        if (typeid(sampler) != typeid(NodeSampler))
+          throw NodeError(id, String("Can not sample in SQMC mode with the ")
+                              + sampler.Name() + " sampler: use the prior mutation.");
+        const StochasticNode & node =
+            static_cast<const StochasticNode &>(graph_.GetNode(id));
+        if (!node.PriorPtr()->CanSampleUniform())
+          throw NodeError(id, String("Can not sample in SQMC mode: distribution ")
+                              + node.PriorName() + " can not be sampled from uniforms.");
+      }
+    }
+  }
+
+  Size ForwardSampler::uniformDim(Size iter) const
+  {
+    Size dim = 0;
+    for (Size i = 0; i < smcIterations_[iter].size(); ++i)
+      dim += graph_.GetNode(smcIterations_[iter][i].StoUnobs()).Dim().Length();
+    return dim;
+  }
+
+  typedef boost::uint32_t UInt32;
+  typedef boost::uint64_t UInt64;
+
+  // Hilbert index of the point of coordinates x, with nBits bits each.
+  // Cf. J. Skilling, Programming the Hilbert curve, 2004: x is
+  // transformed into the transposed index, whose bits are interleaved.
+  static UInt64 hilbertIndex(Types<UInt32>::Array & x, Size nBits)
+  {
+    Size n = x.size();
+    UInt32 m = UInt32(1) << (nBits - 1);
+
+    // inverse undo
+    for (UInt32 q = m; q > 1; q >>= 1)
+    {
+      UInt32 p = q - 1;
+      for (Size i = 0; i < n; ++i)
+      {
+        if (x[i] & q)
+          x[0] ^= p;
+        else
+        {
+          UInt32 t = (x[0] ^ x[i]) & p;
+          x[0] ^= t;
+          x[i] ^= t;
+        }
+      }
+    }
+
+    // Gray encode
+    for (Size i = 1; i < n; ++i)
+      x[i] ^= x[i - 1];
+    UInt32 t = 0;
+    for (UInt32 q = m; q > 1; q >>= 1)
+      if (x[n - 1] & q)
+        t ^= q - 1;
+    for (Size i = 0; i < n; ++i)
+      x[i] ^= t;
+
+    UInt64 index = 0;
+    for (Size b = nBits; b-- > 0;)
+      for (Size i = 0; i < n; ++i)
+        index = (index << 1) | ((x[i] >> b) & 1);
+    return index;
+  }
+
+  // indices of the sorted keys
+  template<typename KeyType>
+  static void sortedOrder(std::vector<std::pair<KeyType, Size> > & keys,
+                          Types<Size>::Array & order)
+  {
+    std::sort(keys.begin(), keys.end());
+    order.resize(keys.size());
+    for (Size n = 0; n < keys.size(); ++n)
+      order[n] = keys[n].second;
+  }
+
+  void ForwardSampler::hilbertOrder(Types<Size>::Array & order) const
+  {
+    // values of the nodes sampled at the previous iteration,
+    // zero when released
+    const Types<SMCIteration>::Array & smc_iter = smcIterations_[iter_ - 1];
+    Size dim = uniformDim(iter_ - 1);
+    ValArray coords(nParticles_ * dim, 0.0);
+    for (Size n = 0; n < nParticles_; ++n)
+    {
+      Size offset = n * dim;
+      for (Size i = 0; i < smc_iter.size(); ++i)
+      {
+        NodeId id = smc_iter[i].StoUnobs();
+        const ValArray::Ptr & p_value = particles_[n].GetValue()[id];
+        if (p_value)
+          std::copy(p_value->begin(), p_value->end(), coords.begin() + offset);
+        offset += graph_.GetNode(id).Dim().Length();
+      }
+    }
+
+    if (dim == 1)
+    {
+      Types<std::pair<Scalar, Size> >::Array keys(nParticles_);
+      for (Size n = 0; n < nParticles_; ++n)
+        keys[n] = std::make_pair(coords[n], n);
+      sortedOrder(keys, order);
+    }
+    else
+    {
+      // the index has 64 bits: the components beyond are ignored
+      Size n_coords = std::min(dim, Size(64));
+      Size n_bits = std::min(Size(32), 64 / n_coords);
+
+      // map each component to (0,1) with a logistic transform
+      // of its standardized values
+      for (Size j = 0; j < n_coords; ++j)
+      {
+        Scalar mean = 0.0, sq_mean = 0.0;
+        for (Size n = 0; n < nParticles_; ++n)
+        {
+          mean += coords[n * dim + j];
+          sq_mean += coords[n * dim + j] * coords[n * dim + j];
+        }
+        mean /= nParticles_;
+        sq_mean /= nParticles_;
+        Scalar sd = std::sqrt(std::max(sq_mean - mean * mean, Scalar(0.0)));
+        if (sd == 0.0 || !isFinite(sd))
+          sd = 1.0;
+        for (Size n = 0; n < nParticles_; ++n)
+        {
+          Scalar & c = coords[n * dim + j];
+          c = 1.0 / (1.0 + std::exp(-(c - mean) / sd));
+        }
+      }
+
+      Scalar scale = std::ldexp(1.0, n_bits);
+      UInt32 max_int = UInt32(scale - 1.0);
+      Types<UInt32>::Array x(n_coords);
+      Types<std::pair<UInt64, Size> >::Array keys(nParticles_);
+      for (Size n = 0; n < nParticles_; ++n)
+      {
+        for (Size j = 0; j < n_coords; ++j)
+          x[j] = UInt32(std::min(coords[n * dim + j] * scale, Scalar(max_int)));
+        keys[n] = std::make_pair(hilbertIndex(x, n_bits), n);
+      }
+      sortedOrder(keys, order);
+    }
+  }
+
+  void ForwardSampler::resampleSqmc()
+  {
+    // first coordinate of the points for the resampling,
+    // the others for the mutation
+    qmcPoints_.Generate(nParticles_, 1 + uniformDim(iter_), *pRng_);
+    qmcPoints_.SortByFirstCoordinate();
+
+    Types<Size>::Array order;
+    hilbertOrder(order);
+
+    // inverse of the distribution function of the weights in the
+    // Hilbert order, at the sorted first coordinates
+    Types<Size>::Array ancestors(nParticles_);
+    Scalar cum_weight = particles_[order[0]].Weight();
+    for (Size n = 0, j = 0; n < nParticles_; ++n)
+    {
+      Scalar u = qmcPoints_.Point(n)[0] * sumOfWeights_;
+      while (cum_weight < u && j + 1 < nParticles_)
+        cum_weight += particles_[order[++j]].Weight();
+      ancestors[n] = order[j];
+    }
+
+    Types<Particle>::Array resampled(nParticles_);
+    for (Size n = 0; n < nParticles_; ++n)
+    {
+      resampled[n].Value() = particles_[ancestors[n]].GetValue();
+      resampled[n].ResetWeight();
+    }
+    particles_.swap(resampled);
+
+    ancestors_[iter_].swap(ancestors);
+    sumOfWeights_ = nParticles_;
+  }
+
   Scalar ForwardSampler::rescaleWeights()
   {
     //Rescale the weights to sensible values...
@@ -449,9 +877,12 @@ namespace Biips
   {
     if (!resamplerTable().Contains(rsType))
       throw LogicError(rsType + " Resampler not found in the ResamplerTable.");
-    pResampler_ = resamplerTable()[rsType];
-    if (!pResampler_)
+    Resampler::Ptr p_resampler = resamplerTable()[rsType];
+    if (!p_resampler)
       throw LogicError("Resampler::Ptr is Null.");
+    // the resamplers of the table are shared by all the samplers
+    pResampler_ = p_resampler->Clone();
+    resampleType_ = rsType;
 
     resampleThreshold_ = threshold <= 1.0 ? threshold * nParticles_ : threshold;
   }
@@ -467,25 +898,64 @@ namespace Biips
     if (NIterations() == 0)
       throw LogicError("Can not initialize ForwardSampler: no iterations.");
 
+    if (sqmc_)
+      checkSqmcSamplers();
+
     nParticles_ = nbParticles;
     pRng_ = pRng;
     setResampleParams(rsType, threshold);
 
     //locks
     initLocks();
+    buildReleaseSchedule();
+    markEagerNodes();
+    paramChecker_.Reset(obsValues());
+    likeTerms_.Reset();
 
     iter_ = 0;
+    ancestors_.assign(NIterations(), Types<Size>::Array());
+    ancestryBegin_ = 0;
+    origins_.clear();
+    iterationESS_.clear();
+    originsBegin_ = 0;
+    clearOrigins();
+
+    // monitors of a previous run keep their own sequence
+    pConditionalNodes_.reset(new Types<NodeId>::Array());
+    appendConditionalNodes();
 
     for (Size i=0; i<sampledFlagsBefore_.size(); ++i)
       sampledFlagsBefore_.at(i) = graph_.GetObserved()[i];
 
+    SamplerProfile::TimePoint start;
+    if (pProfile_)
+    {
+      pProfile_->BeginIteration(iter_);
+      start = SamplerProfile::Now();
+    }
+
     //Initialize the particle set.
     NodeValues init_node_values(graph_.GetSize());
     particles_.assign(nParticles_, Particle(init_node_values, 0.0));
 
     //Move the particle set.
-    for (Size i = 0; i < nParticles_; ++i)
-      mutateParticle(particles_[i]);
+    if (sqmc_)
+    {
+      qmcPoints_.Generate(nParticles_, uniformDim(iter_), *pRng_);
+      for (Size i = 0; i < nParticles_; ++i)
+        mutateParticle(particles_[i], qmcPoints_.Point(i));
+    }
+    else
+    {
+      for (Size i = 0; i < nParticles_; ++i)
+        mutateParticle(particles_[i]);
+    }
+
+    if (pProfile_)
+    {
+      pProfile_->Current().mutationTime = SamplerProfile::Since(start);
+      start = SamplerProfile::Now();
+    }
 
     //Rescale the weights to sensible values....
     Scalar max_weight = rescaleWeights();
@@ -496,14 +966,23 @@ namespace Biips
 
     //Check if the ESS is below some reasonable threshold.
     //A mechanism for setting this threshold is required.
-    resampled_ = ess_ < resampleThreshold_;
+    //SQMC resamples at each iteration.
+    resampled_ = sqmc_ || ess_ < resampleThreshold_;
 
     // increment the normalizing constant
+    // with the likelihood terms dropped from the weights
     logNormConst_ = std::log(sumOfWeights_) - std::log(nParticles_)
-    + max_weight;
+    + max_weight + likeTerms_.DroppedSum(smcIterations_[iter_].back().StoUnobs());
     if (isNan(logNormConst_))
       throw NumericalError(String("Failure to calculate log normalizing constant."));
 
+    if (pProfile_)
+    {
+      pProfile_->Current().weightingTime = SamplerProfile::Since(start);
+      pProfile_->Current().ess = ess_;
+      pProfile_->RecordValueMemory();
+    }
+
     initialized_ = true;
 
     unlockSampledParents();
@@ -519,15 +998,52 @@ namespace Biips
 
     ++iter_;
 
+    appendConditionalNodes();
+
     sampledFlagsBefore_.swap(sampledFlagsAfter_);
 
+    SamplerProfile::TimePoint start;
+    if (pProfile_)
+    {
+      pProfile_->BeginIteration(iter_);
+      pProfile_->Current().resampled = resampled_;
+      start = SamplerProfile::Now();
+    }
+
+    clearOrigins();
+
     // Resample if necessary.
-    if (resampled_)
+    if (sqmc_)
+      resampleSqmc();
+    else if (resampled_)
+    {
       pResampler_->Resample(particles_, sumOfWeights_, *pRng_);
+      ancestors_[iter_] = pResampler_->Ancestors();
+    }
+
+    if (pProfile_)
+    {
+      pProfile_->Current().resamplingTime = SamplerProfile::Since(start);
+      start = SamplerProfile::Now();
+    }
 
     // Move the particle set.
-    for (Size i = 0; i < nParticles_; ++i)
-      mutateParticle(particles_[i]);
+    if (sqmc_)
+    {
+      for (Size i = 0; i < nParticles_; ++i)
+        mutateParticle(particles_[i], qmcPoints_.Point(i) + 1);
+    }
+    else
+    {
+      for (Size i = 0; i < nParticles_; ++i)
+        mutateParticle(particles_[i]);
+    }
+
+    if (pProfile_)
+    {
+      pProfile_->Current().mutationTime = SamplerProfile::Since(start);
+      start = SamplerProfile::Now();
+    }
 
     // Rescale the weights to sensible values....
     Scalar max_weight = rescaleWeights();
@@ -538,18 +1054,218 @@ namespace Biips
 
     // Check if the ESS is below some reasonable threshold.
     // A mechanism for setting this threshold is required.
-    resampled_ = ess_ < resampleThreshold_;
+    // SQMC resamples at each iteration.
+    resampled_ = sqmc_ || ess_ < resampleThreshold_;
 
     // Increment the normalizing constant
-    logNormConst_ += std::log(sum) - std::log(sumOfWeights_) + max_weight;
+    logNormConst_ += std::log(sum) - std::log(sumOfWeights_) + max_weight
+        + likeTerms_.DroppedSum(smcIterations_[iter_].back().StoUnobs());
     if (isNan(logNormConst_))
       throw NumericalError("Failure to calculate log normalizing constant.");
 
     sumOfWeights_ = sum;
 
+    if (pProfile_)
+    {
+      pProfile_->Current().weightingTime = SamplerProfile::Since(start);
+      pProfile_->Current().ess = ess_;
+      pProfile_->RecordValueMemory();
+    }
+
     unlockSampledParents();
   }
 
+  void ForwardSampler::SaveState(StateWriter & writer) const
+  {
+    if (!initialized_)
+      throw LogicError("Can not save ForwardSampler state: not initialized.");
+
+    writer.WriteTag("ForwardSampler");
+
+    // sequence of the sampled nodes and of their samplers, checked when
+    // loaded
+    writer.Write(graph_.GetSize());
+    writer.Write(NIterations());
+    for (Size k = 0; k < NIterations(); ++k)
+    {
+      writer.Write(GetSampledNodes(k));
+      for (Size i = 0; i < smcIterations_[k].size(); ++i)
+        writer.Write(smcIterations_[k][i].NodeSamplerPtr()->Name());
+    }
+
+    writer.Write(nParticles_);
+    writer.Write(iter_);
+    writer.Write(resampleType_);
+    writer.Write(resampleThreshold_);
+    std::ostringstream rng_state;
+    rng_state << pRng_->GetGen();
+    writer.Write(rng_state.str());
+
+    writer.Write(*pConditionalNodes_);
+    writer.Write(sampledFlagsAfter_);
+    writer.Write(nodeLocks_);
+    writer.Write(deferredReleases_);
+
+    writer.Write(resampled_);
+    for (Size k = 0; k < NIterations(); ++k)
+      writer.Write(ancestors_[k]);
+    writer.Write(ancestryBegin_);
+
+    writer.Write(sumOfWeights_);
+    writer.Write(ess_);
+    writer.Write(logNormConst_);
+
+    for (Size i = 0; i < nParticles_; ++i)
+    {
+      const NodeValues & values = particles_[i].GetValue();
+      writer.Write(particles_[i].LogWeight());
+      for (NodeId id = 0; id < values.size(); ++id)
+        writer.Write(values[id]);
+    }
+  }
+
+  void ForwardSampler::LoadState(StateReader & reader, Rng * pRng)
+  {
+    if (!built_)
+      throw LogicError("Can not load ForwardSampler state: not built.");
+
+    reader.ReadTag("ForwardSampler");
+
+    Bool match = reader.Get<Size>() == graph_.GetSize()
+        && reader.Get<Size>() == NIterations();
+    for (Size k = 0; match && k < NIterations(); ++k)
+    {
+      match = reader.Get<Types<Size>::Array>() == GetSampledNodes(k);
+      // the weights of the particles depend on their samplers
+      for (Size i = 0; match && i < smcIterations_[k].size(); ++i)
+      {
+        const String & name = smcIterations_[k][i].NodeSamplerPtr()->Name();
+        String saved_name = reader.Get<String>();
+        if (saved_name != name)
+          throw RuntimeError("Can not load ForwardSampler state: it has been "
+                             "saved with the " + saved_name + " sampler "
+                             "instead of the " + name + " sampler.");
+      }
+    }
+    if (!match)
+      throw RuntimeError("Can not load ForwardSampler state: "
+                         "it has been saved with a different model.");
+
+    initialized_ = false;
+
+    reader.Read(nParticles_);
+    reader.Read(iter_);
+    if (iter_ >= NIterations())
+      throw RuntimeError("Can not load ForwardSampler state: invalid iteration.");
+    setResampleParams(reader.Get<String>(), 0.0);
+    reader.Read(resampleThreshold_);
+    pRng_ = pRng;
+    // the generator reads trailing white spaces after its last value
+    std::istringstream rng_state(reader.Get<String>() + ' ');
+    rng_state >> pRng_->GetGen();
+    if (!rng_state)
+      throw RuntimeError("Can not load ForwardSampler state: invalid generator state.");
+
+    // the schedules only depend on the graph and the monitored nodes,
+    // the locks have evolved with the iterations
+    initLocks();
+    buildReleaseSchedule();
+    markEagerNodes();
+    paramChecker_.Reset(obsValues());
+    likeTerms_.Reset();
+
+    pConditionalNodes_.reset(new Types<NodeId>::Array(reader.Get<Types<Size>::Array>()));
+    reader.Read(sampledFlagsAfter_);
+    sampledFlagsBefore_ = sampledFlagsAfter_;
+    reader.Read(nodeLocks_);
+    reader.Read(deferredReleases_);
+    if (sampledFlagsAfter_.size() != graph_.GetSize()
+        || nodeLocks_.size() != graph_.GetSize())
+      throw RuntimeError("Can not load ForwardSampler state: invalid node flags.");
+
+    reader.Read(resampled_);
+    ancestors_.resize(NIterations());
+    for (Size k = 0; k < NIterations(); ++k)
+      reader.Read(ancestors_[k]);
+    reader.Read(ancestryBegin_);
+
+    // the origins are computed again on demand
+    origins_.clear();
+    iterationESS_.clear();
+    originsBegin_ = iter_;
+    clearOrigins();
+
+    reader.Read(sumOfWeights_);
+    reader.Read(ess_);
+    reader.Read(logNormConst_);
+
+    particles_.assign(nParticles_, Particle());
+    for (Size i = 0; i < nParticles_; ++i)
+    {
+      Scalar log_weight = reader.Get<Scalar>();
+      NodeValues values(graph_.GetSize());
+      for (NodeId id = 0; id < values.size(); ++id)
+        reader.Read(values[id]);
+      particles_[i] = Particle(values, log_weight);
+    }
+
+    initialized_ = true;
+  }
+
+  void ForwardSampler::SaveParticles(StateWriter & writer) const
+  {
+    if (!initialized_)
+      throw LogicError("Can not save particles: ForwardSampler not initialized.");
+
+    writer.WriteTag("Particles");
+    writer.Write(iter_);
+    writer.Write(nParticles_);
+    writer.Write(sumOfWeights_);
+    writer.Write(ess_);
+    writer.Write(logNormConst_);
+
+    for (Size i = 0; i < nParticles_; ++i)
+    {
+      const NodeValues & values = particles_[i].GetValue();
+      writer.Write(particles_[i].LogWeight());
+      for (NodeId id = 0; id < values.size(); ++id)
+        writer.Write(values[id]);
+    }
+  }
+
+  void ForwardSampler::LoadParticles(StateReader & reader)
+  {
+    if (!initialized_)
+      throw LogicError("Can not load particles: ForwardSampler not initialized.");
+
+    reader.ReadTag("Particles");
+    if (reader.Get<Size>() != iter_ || reader.Get<Size>() != nParticles_)
+      throw RuntimeError("Can not load particles: they have been saved at "
+                         "another iteration or with another number of particles.");
+
+    reader.Read(sumOfWeights_);
+    reader.Read(ess_);
+    reader.Read(logNormConst_);
+    resampled_ = sqmc_ || ess_ < resampleThreshold_;
+
+    for (Size i = 0; i < nParticles_; ++i)
+    {
+      Scalar log_weight = reader.Get<Scalar>();
+      NodeValues values(graph_.GetSize());
+      for (NodeId id = 0; id < values.size(); ++id)
+        reader.Read(values[id]);
+      particles_[i] = Particle(values, log_weight);
+    }
+
+    for (Size k = ancestryBegin_; k <= iter_; ++k)
+      Types<Size>::Array().swap(ancestors_[k]);
+    ancestryBegin_ = iter_;
+    origins_.clear();
+    iterationESS_.clear();
+    originsBegin_ = iter_;
+    clearOrigins();
+  }
+
   void ForwardSampler::Accumulate(NodeId nodeId,
                                   Accumulator & featuresAcc,
                                   Size n) const
@@ -623,16 +1339,22 @@ namespace Biips
     monitor.Init(particles_, ess_, sumOfWeights_, resampled_, logNormConst_);
   }
 
-  void ForwardSampler::MonitorNode(NodeId nodeId, FilterMonitor & monitor) const
+  void ForwardSampler::MonitorNode(NodeId nodeId, FilterMonitor & monitor)
   {
     Size iter = GetNodeSamplingIteration(nodeId);
     if (iter > Iteration())
       throw LogicError("Can't SetMonitorNodeValues: node has not been sampled yet!");
+    if (!Evaluated(nodeId))
+      evaluateLazyNode(nodeId);
 
-    monitor.AddNode(nodeId, particles_, iter, graph_.GetDiscrete()[nodeId]);
+    monitor.AddNode(nodeId, particles_, iter, graph_.GetDiscrete()[nodeId],
+                    singlePrecisionArchives_);
 
     if (!monitor.HasIterationESS(iter))
+    {
       monitor.SetIterationESS(iter, GetNodeESS(nodeId));
+      monitor.SetIterationOrigins(iter, GetIterationOrigins(iter));
+    }
   }
 
   // TODO
@@ -672,17 +1394,37 @@ namespace Biips
 
   void ForwardSampler::ReleaseNodes()
   {
-    Types<NodeId>::ConstIterator it_nodes, it_nodes_end;
-    boost::tie(it_nodes, it_nodes_end) = graph_.GetSortedNodes();
-    for (; it_nodes != it_nodes_end; ++it_nodes)
+    // at the end, the locks may have been reset by UnlockAllNodes
+    if (AtEnd())
     {
-      NodeId id = *it_nodes;
-      if (nodeLocks_[id] != 0)
-        continue;
-      for (Size i = 0; i < nParticles_; ++i)
-        particles_[i].Value()[id].reset();
-      nodeLocks_[id] = -1;
+      Types<NodeId>::ConstIterator it_nodes, it_nodes_end;
+      boost::tie(it_nodes, it_nodes_end) = graph_.GetSortedNodes();
+      for (; it_nodes != it_nodes_end; ++it_nodes)
+      {
+        if (nodeLocks_[*it_nodes] == 0)
+          releaseNode(*it_nodes);
+      }
+      deferredReleases_.clear();
+      return;
+    }
+
+    // scheduled nodes that are still locked by a monitor
+    // are retried at the next releases
+    Types<NodeId>::Array deferred;
+    const Types<NodeId>::Array * release_lists[] =
+        { &deferredReleases_, &releaseSchedule_.at(iter_) };
+    for (Size l = 0; l < 2; ++l)
+    {
+      const Types<NodeId>::Array & ids = *release_lists[l];
+      for (Size k = 0; k < ids.size(); ++k)
+      {
+        if (nodeLocks_[ids[k]] == 0)
+          releaseNode(ids[k]);
+        else if (nodeLocks_[ids[k]] > 0)
+          deferred.push_back(ids[k]);
+      }
     }
+    deferredReleases_.swap(deferred);
   }
 
 } /* namespace Biips */
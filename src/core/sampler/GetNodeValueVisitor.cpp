@@ -4,6 +4,7 @@
 #include "sampler/NodeSampler.hpp"
 #include "graph/ConstantNode.hpp"
 #include "graph/LogicalNode.hpp"
+#include "graph/AggNode.hpp"
 #include "graph/StochasticNode.hpp"
 #include "model/Monitor.hpp"
 
@@ -39,7 +40,8 @@ namespace Biips
 
   void GetNodeValueVisitor::visit(const ConstantNode & node)
   {
-    value_ = NumArray(node.DimPtr().get(), graph_.GetValues()[nodeId_].get());
+    value_ = NumArray(node.DimPtr().get(),
+                      nodeSampler_.ObsValues()[nodeId_].get());
   }
 
   void GetNodeValueVisitor::visit(const StochasticNode & node)
@@ -48,7 +50,8 @@ namespace Biips
       throw LogicError("GetNodeValueVisitor can not visit StochasticNode: node has not been sampled.");
 
     if (graph_.GetObserved()[nodeId_])
-      value_ = NumArray(node.DimPtr().get(), graph_.GetValues()[nodeId_].get());
+      value_ = NumArray(node.DimPtr().get(),
+                        nodeSampler_.ObsValues()[nodeId_].get());
     else
       value_ = NumArray(node.DimPtr().get(),
                         nodeSampler_.nodeValuesMap()[nodeId_].get());
@@ -65,7 +68,8 @@ namespace Biips
     }
 
     if (graph_.GetObserved()[nodeId_])
-      value_ = NumArray(node.DimPtr().get(), graph_.GetValues()[nodeId_].get());
+      value_ = NumArray(node.DimPtr().get(),
+                        nodeSampler_.ObsValues()[nodeId_].get());
     else
       value_ = NumArray(node.DimPtr().get(),
                         nodeSampler_.nodeValuesMap()[nodeId_].get());
@@ -82,15 +86,20 @@ namespace Biips
 
   NumArray getNodeValue(NodeId nodeId,
                         const Graph & graph,
+                        const NodeValues & obsValues,
                         const Monitor & monitor,
-                        Size particleIndex)
+                        Size particleIndex,
+                        ValArray & buffer)
   {
     if (graph.GetObserved()[nodeId])
       return NumArray(graph.GetNode(nodeId).DimPtr().get(),
-                      graph.GetValues()[nodeId].get());
-    else
-      return NumArray(graph.GetNode(nodeId).DimPtr().get(),
-                      monitor.GetNodeValues(nodeId)[particleIndex].get());
+                      obsValues[nodeId].get());
+
+    const ValArray & value =
+        monitor.GetNodeValues(nodeId).Value(particleIndex, buffer);
+    if (&value != &buffer)
+      buffer.assign(value.begin(), value.end());
+    return NumArray(graph.GetNode(nodeId).DimPtr().get(), &buffer);
   }
 
   // -----------------------------------------------------------------
@@ -195,6 +204,18 @@ namespace Biips
 
   void GetParamValuesVisitor::visit(const LogicalNode & node)
   {
+    // aggregate nodes only need the values of their distinct sources
+    if (!node.IsFunction())
+    {
+      const Types<NodeId>::Array & sources =
+          static_cast<const AggNode &>(node).Sources();
+      NumArray::Array param_values(sources.size());
+      for (Size i = 0; i < sources.size(); ++i)
+        param_values[i] = getNodeValue(sources[i], graph_, nodeSampler_);
+      values_ = param_values;
+      return;
+    }
+
     GraphTypes::ParentIterator it_param, it_param_end;
     boost::tie(it_param, it_param_end) = graph_.GetParents(nodeId_);
 
@@ -220,8 +241,10 @@ namespace Biips
 
   NumArray::Array getParamValues(NodeId nodeId,
                                  const Graph & graph,
+                                 const NodeValues & obsValues,
                                  const Types<Monitor*>::Array & monitors,
-                                 Size particleIndex)
+                                 Size particleIndex,
+                                 Types<ValArray>::Array & buffers)
   {
     GraphTypes::ParentIterator it_param, it_param_end;
     boost::tie(it_param, it_param_end) = graph.GetParents(nodeId);
@@ -238,6 +261,7 @@ namespace Biips
     if (monitors.size() != n_par)
       throw LogicError("getParamValues: incorrect monitors size.");
 
+    buffers.resize(n_par);
     NumArray::Array param_values(n_par);
     for (Size i = 0; it_param != it_param_end; ++it_param, ++i)
     {
@@ -246,8 +270,10 @@ namespace Biips
 
       param_values[i] = getNodeValue(*it_param,
                                      graph,
+                                     obsValues,
                                      *monitors[i],
-                                     particleIndex);
+                                     particleIndex,
+                                     buffers[i]);
     }
     return param_values;
   }
@@ -307,8 +333,10 @@ namespace Biips
 
   NumArray::Pair getBoundValues(NodeId nodeId,
                                 const Graph & graph,
+                                const NodeValues & obsValues,
                                 const Types<Monitor*>::Pair & monitors,
-                                Size particleIndex)
+                                Size particleIndex,
+                                Types<ValArray>::Pair & buffers)
   {
     GraphTypes::ParentIterator it_param, it_param_end;
     boost::tie(it_param, it_param_end) = graph.GetParents(nodeId);
@@ -326,8 +354,10 @@ namespace Biips
       --it_param_end;
       bound_values.second = getNodeValue(*it_param_end,
                                          graph,
+                                         obsValues,
                                          *monitors.second,
-                                         particleIndex);
+                                         particleIndex,
+                                         buffers.second);
     }
     if (is_bounded_vis.IsLowerBounded())
     {
@@ -337,8 +367,10 @@ namespace Biips
       --it_param_end;
       bound_values.first = getNodeValue(*it_param_end,
                                         graph,
+                                        obsValues,
                                         *monitors.first,
-                                        particleIndex);
+                                        particleIndex,
+                                        buffers.first);
     }
 
     return bound_values;
@@ -396,7 +428,7 @@ namespace Biips
   void GetFixedSupportValuesVisitor::visit(const StochasticNode & node)
   {
     // get observed parents values
-    Types<NodeId>::Array par = node.Parents();
+    Types<NodeId>::Array par = node.Parents().ToArray();
     NumArray::Array par_values(par.size());
     for (Size i=0; i<par.size(); ++i)
     {
@@ -0,0 +1,59 @@
+#include "sampler/LikeTerms.hpp"
+#include "graph/Graph.hpp"
+#include "graph/StochasticNode.hpp"
+
+namespace Biips
+{
+
+  LikeTerms::LikeTerms(const Graph & graph) :
+    graph_(graph), type_(PDF_FULL), computed_(graph.GetSize(), false),
+        dropped_(graph.GetSize(), 0.0)
+  {
+  }
+
+  void LikeTerms::SetType(PDFType type)
+  {
+    type_ = type;
+  }
+
+  void LikeTerms::Reset()
+  {
+    computed_.assign(graph_.GetSize(), false);
+    dropped_.assign(graph_.GetSize(), 0.0);
+  }
+
+  Scalar LikeTerms::LogLikelihood(NodeId nodeId, const StochasticNode & node,
+                                  const NumArray & x,
+                                  const NumArray::Array & paramValues,
+                                  const NumArray::Pair & boundValues,
+                                  Bool checkParams)
+  {
+    Scalar log_like = node.LogPriorDensity(x, paramValues, boundValues,
+                                           checkParams, type_);
+    if (type_ == PDF_FULL || computed_[nodeId])
+      return log_like;
+
+    // the dropped terms are not defined where the density vanishes:
+    // wait for a particle where it does not
+    Scalar full_log_like = node.LogPriorDensity(x, paramValues, boundValues,
+                                                false, PDF_FULL);
+    if (isFinite(log_like) && isFinite(full_log_like))
+    {
+      dropped_[nodeId] = full_log_like - log_like;
+      computed_[nodeId] = true;
+    }
+    return log_like;
+  }
+
+  Scalar LikeTerms::DroppedSum(NodeId nodeId) const
+  {
+    Scalar sum = 0.0;
+    GraphTypes::LikelihoodChildIterator it_offspring, it_offspring_end;
+    boost::tie(it_offspring, it_offspring_end) =
+        graph_.GetLikelihoodChildren(nodeId);
+    for (; it_offspring != it_offspring_end; ++it_offspring)
+      sum += dropped_[*it_offspring];
+    return sum;
+  }
+
+}
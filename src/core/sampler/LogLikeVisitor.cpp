@@ -33,16 +33,30 @@ namespace Biips
 
   void LogLikeVisitor::visit(const StochasticNode & node)
   {
-    NumArray x_value(node.DimPtr().get(), graph_.GetValues()[nodeId_].get());
+    NumArray x_value(node.DimPtr().get(),
+                     nodeSampler_.ObsValues()[nodeId_].get());
     NumArray::Array param_values = getParamValues(nodeId_,
                                                     graph_,
                                                     nodeSampler_);
     NumArray::Pair bound_values = getBoundValues(nodeId_,
                                                    graph_,
                                                    nodeSampler_);
+    // the checker replaces the checks of the distribution
+    ParamChecker * p_checker = nodeSampler_.ParamCheckerPtr();
+    if (p_checker)
+      p_checker->CheckDensity(nodeId_, x_value, param_values);
+
+    LikeTerms * p_like_terms = nodeSampler_.LikeTermsPtr();
+
     Scalar log_like;
     try {
-      log_like = node.LogPriorDensity(x_value, param_values, bound_values);
+      if (p_like_terms)
+        log_like = p_like_terms->LogLikelihood(nodeId_, node, x_value,
+                                               param_values, bound_values,
+                                               !p_checker);
+      else
+        log_like = node.LogPriorDensity(x_value, param_values, bound_values,
+                                        !p_checker);
     }
     catch (RuntimeError & except) {
       throw NodeError(nodeId_, String(except.what()));
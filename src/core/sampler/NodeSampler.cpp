@@ -11,6 +11,42 @@ namespace Biips
 
   const String NodeSampler::NAME_ = "Prior";
 
+  // removes the value from the count when its last owner frees it
+  struct CountedValueDeleter
+  {
+    SamplerProfile::ValueMemory::Ptr pMemory;
+    Size bytes;
+
+    void operator()(ValArray * pValue) const
+    {
+      pMemory->bytes -= bytes;
+      delete pValue;
+    }
+  };
+
+  ValArray & NodeSampler::allocValue(Size length)
+  {
+    ValArray * p_value = new ValArray(length);
+    if (!pValueMemory_)
+    {
+      nodeValuesMap()[nodeId_].reset(p_value);
+      return *p_value;
+    }
+
+    CountedValueDeleter deleter;
+    deleter.pMemory = pValueMemory_;
+    deleter.bytes = sizeof(ValArray) + p_value->capacity() * sizeof(Scalar);
+    nodeValuesMap()[nodeId_].reset(p_value, deleter);
+    ++pValueMemory_->allocations;
+    pValueMemory_->bytes += deleter.bytes;
+    return *p_value;
+  }
+
+  const NodeValues & NodeSampler::ObsValues() const
+  {
+    return pObsValues_ ? *pObsValues_ : graph_.GetValues();
+  }
+
   void NodeSampler::visit(const LogicalNode & node)
   {
     if (!membersSet_)
@@ -24,13 +60,14 @@ namespace Biips
 
     // allocate memory
     if (!nodeValuesMap()[nodeId_])
-      nodeValuesMap()[nodeId_].reset(new ValArray(node.Dim().Length()));
+      allocValue(node.Dim().Length());
 
     // FIXME
     // evaluate
     try
     {
-      node.Eval(*nodeValuesMap()[nodeId_], params);
+      node.Eval(*nodeValuesMap()[nodeId_], params,
+                !pParamChecker_ || !pParamChecker_->Unchecked());
     }
     catch (RuntimeError & err)
     {
@@ -63,18 +100,30 @@ namespace Biips
 
     // allocate memory
     if (!nodeValuesMap()[nodeId_])
-      nodeValuesMap()[nodeId_].reset(new ValArray(node.Dim().Length()));
+      allocValue(node.Dim().Length());
 
-    if (!pRng_)
+    if (!pRng_ && !pUniforms_)
       throw LogicError("NodeSampler can not sample StochasticNode: Rng pointer is null.");
 
+    // the checker replaces the checks of the distribution
+    if (pParamChecker_)
+      pParamChecker_->CheckSample(nodeId_, param_values);
+
     // sample
     try
     {
-      node.Sample(*nodeValuesMap()[nodeId_],
-                  param_values,
-                  bound_values,
-                  *pRng_);
+      if (pUniforms_)
+        node.SampleUniform(*nodeValuesMap()[nodeId_],
+                           param_values,
+                           bound_values,
+                           pUniforms_,
+                           !pParamChecker_);
+      else
+        node.Sample(*nodeValuesMap()[nodeId_],
+                    param_values,
+                    bound_values,
+                    *pRng_,
+                    !pParamChecker_);
     }
     catch (RuntimeError & err)
     {
@@ -102,6 +102,21 @@ namespace Biips
     // nodeB is expected to be a StochasticNode from the nodeSequence
     if (graph.GetNode(nodeB).GetType() != STOCHASTIC)
       throw LogicError("nodesRelation: nodeB must be stochastic.");
+
+    // constant time answer from the ranks when nodeB is unobserved:
+    // nodeA is UNKNOWN iff it depends on an unobserved stochastic node
+    // sampled after nodeB, and DEPENDING iff the latest one is nodeB
+    if (nodeA != nodeB && !graph.GetObserved()[nodeB])
+    {
+      Size latest_rank = graph.GetLatestUnobsRanks()[nodeA];
+      Size rank_b = graph.GetRanks()[nodeB];
+      if (latest_rank == BIIPS_SIZENA || latest_rank < rank_b)
+        return KNOWN;
+      if (latest_rank == rank_b)
+        return DEPENDING;
+      return UNKNOWN;
+    }
+
     NodesRelationVisitor vis(graph, nodeB);
     graph.VisitNode(nodeA, vis);
     return vis.GetRelation();
@@ -0,0 +1,116 @@
+#include "sampler/ParamChecker.hpp"
+#include "graph/Graph.hpp"
+#include "graph/StochasticNode.hpp"
+#include "iostream/std_ostream.hpp"
+
+#include <algorithm>
+
+namespace Biips
+{
+
+  ParamChecker::ParamChecker(const Graph & graph) :
+    graph_(graph), unchecked_(false), varyingParams_(graph.GetSize()),
+        allChecked_(graph.GetSize(), false)
+  {
+  }
+
+  void ParamChecker::Build(const NodeValues & obsValues)
+  {
+    for (NodeId id = 0; id < graph_.GetSize(); ++id)
+    {
+      varyingParams_[id].clear();
+      if (graph_.GetNode(id).GetType() != STOCHASTIC)
+        continue;
+
+      const StochasticNode & node =
+          static_cast<const StochasticNode &>(graph_.GetNode(id));
+      // the bounds follow the parameters in the parents
+      Size n_param = node.PriorPtr()->NParam();
+      for (Size i = 0; i < n_param; ++i)
+        varyingParams_[id].push_back(!graph_.GetObserved()[node.Parents()[i]]);
+    }
+    Reset(obsValues);
+  }
+
+  void ParamChecker::Reset(const NodeValues & obsValues)
+  {
+    allChecked_.assign(graph_.GetSize(), false);
+    if (unchecked_)
+      return;
+
+    for (NodeId id = 0; id < graph_.GetSize(); ++id)
+    {
+      const Flags & varying = varyingParams_[id];
+      if (varying.empty()
+          || std::find(varying.begin(), varying.end(), true) != varying.end())
+        continue;
+
+      const StochasticNode & node =
+          static_cast<const StochasticNode &>(graph_.GetNode(id));
+      const Distribution & prior = *node.PriorPtr();
+      NumArray::Array param_values(varying.size());
+      for (Size i = 0; i < varying.size(); ++i)
+      {
+        NodeId par_id = node.Parents()[i];
+        param_values[i] = NumArray(graph_.GetNode(par_id).DimPtr().get(),
+                                   obsValues[par_id].get());
+      }
+
+      // the value of an observed node is constant too
+      Bool valid;
+      if (graph_.GetObserved()[id])
+        valid = prior.CheckDensityParamValues(
+            NumArray(node.DimPtr().get(), obsValues[id].get()), param_values);
+      else
+        valid = prior.CheckParamValues(param_values);
+
+      if (!valid)
+        throw NodeError(id, String("Invalid parameters values for distribution ")
+            + prior.Name() + ": " + print(param_values));
+      allChecked_[id] = true;
+    }
+  }
+
+  void ParamChecker::CheckSample(NodeId nodeId,
+                                 const NumArray::Array & paramValues)
+  {
+    if (unchecked_)
+      return;
+
+    const Distribution & prior =
+        *static_cast<const StochasticNode &>(graph_.GetNode(nodeId)).PriorPtr();
+    Bool valid;
+    if (allChecked_[nodeId])
+      valid = prior.CheckVaryingParamValues(paramValues, varyingParams_[nodeId]);
+    else
+      valid = prior.CheckParamValues(paramValues);
+
+    if (!valid)
+      throw NodeError(nodeId, String("Invalid parameters values in Sample method for distribution ")
+          + prior.Name() + ": " + print(paramValues));
+    allChecked_[nodeId] = true;
+  }
+
+  void ParamChecker::CheckDensity(NodeId nodeId, const NumArray & x,
+                                  const NumArray::Array & paramValues)
+  {
+    if (unchecked_)
+      return;
+
+    const Distribution & prior =
+        *static_cast<const StochasticNode &>(graph_.GetNode(nodeId)).PriorPtr();
+    Bool valid;
+    if (allChecked_[nodeId])
+      valid = prior.CheckDensityVaryingParamValues(x, paramValues,
+                                                   varyingParams_[nodeId],
+                                                   !graph_.GetObserved()[nodeId]);
+    else
+      valid = prior.CheckDensityParamValues(x, paramValues);
+
+    if (!valid)
+      throw NodeError(nodeId, String("Invalid parameters values in LogDensity method for distribution ")
+          + prior.Name() + ": " + print(paramValues));
+    allChecked_[nodeId] = true;
+  }
+
+}
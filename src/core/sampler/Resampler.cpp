@@ -73,6 +73,10 @@ namespace Biips
       static BaseType::Ptr p_instance(new SelfType());
       return p_instance;
     }
+    virtual BaseType::Ptr Clone() const
+    {
+      return BaseType::Ptr(new SelfType());
+    }
   };
 
   class ResidualResampler: public Resampler
@@ -96,6 +100,10 @@ namespace Biips
       static BaseType::Ptr p_instance(new SelfType());
       return p_instance;
     }
+    virtual BaseType::Ptr Clone() const
+    {
+      return BaseType::Ptr(new SelfType());
+    }
   };
 
   class StratifiedResampler: public Resampler
@@ -119,6 +127,10 @@ namespace Biips
       static BaseType::Ptr p_instance(new SelfType());
       return p_instance;
     }
+    virtual BaseType::Ptr Clone() const
+    {
+      return BaseType::Ptr(new SelfType());
+    }
   };
 
   class SystematicResampler: public Resampler
@@ -142,6 +154,10 @@ namespace Biips
       static BaseType::Ptr p_instance(new SelfType());
       return p_instance;
     }
+    virtual BaseType::Ptr Clone() const
+    {
+      return BaseType::Ptr(new SelfType());
+    }
   };
 
   void MultinomialResampler::resample(Scalar sumOfWeights, Rng & rng)
@@ -0,0 +1,130 @@
+#include "sampler/SamplerProfile.hpp"
+#include "common/Error.hpp"
+
+#include <algorithm>
+#include <ostream>
+
+namespace Biips
+{
+
+  void SamplerProfile::Clear()
+  {
+    origin_ = Now();
+    iterations_.clear();
+    nodeSamplers_.clear();
+    peakParticleBytes_ = 0;
+    pValueMemory_.reset(new ValueMemory());
+  }
+
+  void SamplerProfile::BeginIteration(Size iter, Bool backward)
+  {
+    IterationRecord rec;
+    rec.iteration = iter;
+    rec.backward = backward;
+    rec.start = Since(origin_);
+    rec.mutationTime = 0.0;
+    rec.weightingTime = 0.0;
+    rec.resamplingTime = 0.0;
+    rec.monitoringTime = 0.0;
+    rec.ess = BIIPS_REALNAN;
+    rec.resampled = false;
+    rec.valueAllocations = 0;
+    rec.particleBytes = 0;
+    iterations_.push_back(rec);
+    pValueMemory_->allocations = 0;
+  }
+
+  SamplerProfile::IterationRecord & SamplerProfile::Current()
+  {
+    if (iterations_.empty())
+      throw LogicError("SamplerProfile: no iteration has begun.");
+    return iterations_.back();
+  }
+
+  void SamplerProfile::RecordValueMemory()
+  {
+    IterationRecord & rec = Current();
+    rec.valueAllocations = pValueMemory_->allocations;
+    rec.particleBytes = pValueMemory_->bytes;
+    peakParticleBytes_ = std::max(peakParticleBytes_, rec.particleBytes);
+  }
+
+  static void printJsonNumber(std::ostream & os, Scalar val)
+  {
+    if (isFinite(val))
+      os << val;
+    else
+      os << "null";
+  }
+
+  void SamplerProfile::PrintJson(std::ostream & os) const
+  {
+    os << "{\n  \"iterations\": [";
+    for (Size i = 0; i < iterations_.size(); ++i)
+    {
+      const IterationRecord & rec = iterations_[i];
+      os << (i ? ",\n" : "\n") << "    {\"iteration\": " << rec.iteration
+         << ", \"pass\": \"" << (rec.backward ? "backward" : "forward")
+         << "\", \"start\": " << rec.start
+         << ", \"mutation\": " << rec.mutationTime
+         << ", \"weighting\": " << rec.weightingTime
+         << ", \"resampling\": " << rec.resamplingTime
+         << ", \"monitoring\": " << rec.monitoringTime
+         << ", \"ess\": ";
+      printJsonNumber(os, rec.ess);
+      os << ", \"resampled\": " << (rec.resampled ? "true" : "false")
+         << ", \"value_allocations\": " << rec.valueAllocations
+         << ", \"particle_bytes\": " << rec.particleBytes << "}";
+    }
+    os << "\n  ],\n  \"node_samplers\": {";
+    std::map<String, NodeSamplerRecord>::const_iterator it_samplers;
+    for (it_samplers = nodeSamplers_.begin();
+        it_samplers != nodeSamplers_.end(); ++it_samplers)
+    {
+      os << (it_samplers == nodeSamplers_.begin() ? "\n" : ",\n")
+         << "    \"" << it_samplers->first << "\": {\"time\": "
+         << it_samplers->second.time << ", \"calls\": "
+         << it_samplers->second.calls << "}";
+    }
+    os << "\n  },\n  \"peak_particle_bytes\": " << peakParticleBytes_
+       << "\n}\n";
+  }
+
+  static void printTraceEvent(std::ostream & os, Bool & first,
+                              const String & name, const String & category,
+                              Scalar start, Scalar duration)
+  {
+    // trace event times are in microseconds
+    os << (first ? "\n" : ",\n") << "  {\"name\": \"" << name
+       << "\", \"cat\": \"" << category << "\", \"ph\": \"X\", \"ts\": "
+       << start * 1e6 << ", \"dur\": " << duration * 1e6
+       << ", \"pid\": 0, \"tid\": 0}";
+    first = false;
+  }
+
+  void SamplerProfile::PrintTraceEvents(std::ostream & os) const
+  {
+    Bool first = true;
+    os << "[";
+    for (Size i = 0; i < iterations_.size(); ++i)
+    {
+      const IterationRecord & rec = iterations_[i];
+      String category = rec.backward ? "backward" : "forward";
+      // phases are laid out in their order of execution
+      Scalar t = rec.start;
+      if (rec.resamplingTime > 0.0)
+        printTraceEvent(os, first, "resampling", category, t, rec.resamplingTime);
+      t += rec.resamplingTime;
+      if (rec.mutationTime > 0.0)
+        printTraceEvent(os, first, "mutation", category, t, rec.mutationTime);
+      t += rec.mutationTime;
+      if (rec.weightingTime > 0.0)
+        printTraceEvent(os, first, "weighting", category, t, rec.weightingTime);
+      t += rec.weightingTime;
+      if (rec.monitoringTime > 0.0)
+        printTraceEvent(os, first, "monitoring", category, t, rec.monitoringTime);
+    }
+    os << "\n]\n";
+  }
+
+}
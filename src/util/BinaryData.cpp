@@ -0,0 +1,234 @@
+#include "BinaryData.hpp"
+#include "MappedFile.hpp"
+#include "common/Error.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+namespace Biips
+{
+
+  static const char BINARY_DATA_MAGIC[8] =
+  { 'B', 'I', 'I', 'P', 'S', 'D', 'A', 'T' };
+  static const unsigned int BINARY_DATA_VERSION = 1;
+  static const unsigned int BINARY_DATA_BYTE_ORDER = 0x01020304;
+
+  enum BinaryDataType
+  {
+    BINARY_FLOAT64 = 0, BINARY_INT32 = 1
+  };
+
+  typedef unsigned int UInt32;
+  typedef unsigned long long UInt64;
+  typedef int Int32;
+
+  template<typename T>
+  static void writeRaw(std::ostream & os, const T & value)
+  {
+    os.write(reinterpret_cast<const char *>(&value), sizeof(T));
+  }
+
+  static Bool isInt32(Scalar x)
+  {
+    return x == std::floor(x) && x > std::numeric_limits<Int32>::min()
+        && x <= std::numeric_limits<Int32>::max();
+  }
+
+  void writeBinaryData(const String & fileName,
+                       const std::map<String, MultiArray> & dataMap)
+  {
+    std::ofstream ofs(fileName.c_str(), std::ios::binary | std::ios::trunc);
+    if (!ofs)
+      throw RuntimeError(String("Failed to open file ") + fileName);
+
+    ofs.write(BINARY_DATA_MAGIC, sizeof(BINARY_DATA_MAGIC));
+    writeRaw(ofs, BINARY_DATA_VERSION);
+    writeRaw(ofs, BINARY_DATA_BYTE_ORDER);
+    writeRaw(ofs, UInt64(dataMap.size()));
+
+    std::map<String, MultiArray>::const_iterator it_var;
+    for (it_var = dataMap.begin(); it_var != dataMap.end(); ++it_var)
+    {
+      const String & name = it_var->first;
+      const DimArray & dim = it_var->second.Dim();
+      const ValArray & values = it_var->second.Values();
+
+      writeRaw(ofs, UInt32(name.size()));
+      ofs.write(name.data(), name.size());
+      writeRaw(ofs, UInt32(dim.size()));
+      for (Size i = 0; i < dim.size(); ++i)
+        writeRaw(ofs, UInt64(dim[i]));
+
+      Bool has_na = false;
+      Bool integral = true;
+      for (Size j = 0; j < values.size(); ++j)
+      {
+        if (isNA(values[j]))
+          has_na = true;
+        else if (!isInt32(values[j]))
+          integral = false;
+      }
+      writeRaw(ofs, char(integral ? BINARY_INT32 : BINARY_FLOAT64));
+      writeRaw(ofs, char(has_na));
+      writeRaw(ofs, UInt64(values.size()));
+
+      if (has_na)
+      {
+        std::vector<unsigned char> mask((values.size() + 7) / 8, 0);
+        for (Size j = 0; j < values.size(); ++j)
+          if (isNA(values[j]))
+            mask[j / 8] |= (unsigned char)(1 << (j % 8));
+        ofs.write(reinterpret_cast<const char *>(&mask[0]), mask.size());
+      }
+
+      if (values.empty())
+        continue;
+      if (integral)
+      {
+        std::vector<Int32> int_values(values.size(), 0);
+        for (Size j = 0; j < values.size(); ++j)
+          if (!isNA(values[j]))
+            int_values[j] = Int32(values[j]);
+        ofs.write(reinterpret_cast<const char *>(&int_values[0]),
+                  int_values.size() * sizeof(Int32));
+      }
+      else
+        ofs.write(reinterpret_cast<const char *>(&values[0]),
+                  values.size() * sizeof(Scalar));
+    }
+
+    if (!ofs)
+      throw RuntimeError(String("Failed to write file ") + fileName);
+  }
+
+  Bool isBinaryDataFile(const String & fileName)
+  {
+    std::ifstream ifs(fileName.c_str(), std::ios::binary);
+    char magic[sizeof(BINARY_DATA_MAGIC)];
+    if (!ifs.read(magic, sizeof(magic)))
+      return false;
+    return std::memcmp(magic, BINARY_DATA_MAGIC, sizeof(magic)) == 0;
+  }
+
+  //! Bounds checked cursor over the mapped file
+  class BinaryDataCursor
+  {
+  protected:
+    const char * p_;
+    const char * end_;
+    const String & fileName_;
+
+  public:
+    BinaryDataCursor(const MappedFile & file, const String & fileName) :
+      p_(file.begin()), end_(file.end()), fileName_(fileName)
+    {
+    }
+
+    const char * Take(UInt64 nBytes)
+    {
+      if (UInt64(end_ - p_) < nBytes)
+        throw RuntimeError(String("Truncated binary data file ") + fileName_);
+      const char * data = p_;
+      p_ += nBytes;
+      return data;
+    }
+
+    //! Takes nValues values of valueSize bytes, checked before the
+    //! size is computed so that it can not overflow
+    const char * TakeArray(UInt64 nValues, UInt64 valueSize)
+    {
+      if (nValues > UInt64(end_ - p_) / valueSize)
+        throw RuntimeError(String("Truncated binary data file ") + fileName_);
+      return Take(nValues * valueSize);
+    }
+
+    template<typename T>
+    T Get()
+    {
+      T value;
+      std::memcpy(&value, Take(sizeof(T)), sizeof(T));
+      return value;
+    }
+  };
+
+  void readBinaryData(const String & fileName,
+                      std::map<String, MultiArray> & dataMap)
+  {
+    MappedFile file(fileName);
+    BinaryDataCursor cursor(file, fileName);
+
+    if (std::memcmp(cursor.Take(sizeof(BINARY_DATA_MAGIC)), BINARY_DATA_MAGIC,
+                    sizeof(BINARY_DATA_MAGIC)) != 0)
+      throw RuntimeError(String("Not a binary data file: ") + fileName);
+    if (cursor.Get<UInt32>() != BINARY_DATA_VERSION)
+      throw RuntimeError(String("Unsupported binary data version in file ")
+                         + fileName);
+    if (cursor.Get<UInt32>() != BINARY_DATA_BYTE_ORDER)
+      throw RuntimeError(String("Unsupported byte order in binary data file ")
+                         + fileName);
+
+    UInt64 n_vars = cursor.Get<UInt64>();
+    for (UInt64 i = 0; i < n_vars; ++i)
+    {
+      UInt32 name_size = cursor.Get<UInt32>();
+      String name(cursor.Take(name_size), name_size);
+
+      UInt32 n_dim = cursor.Get<UInt32>();
+      DimArray::Ptr p_dim(new DimArray(n_dim));
+      for (Size k = 0; k < n_dim; ++k)
+        (*p_dim)[k] = Size(cursor.Get<UInt64>());
+
+      char type = cursor.Get<char>();
+      Bool has_na = cursor.Get<char>();
+      UInt64 n_values = cursor.Get<UInt64>();
+      if (p_dim->Length() != n_values)
+        throw RuntimeError(String("Dimensions of variable ") + name
+                           + " do not match the number of values in file "
+                           + fileName);
+
+      const unsigned char * mask = NULL;
+      if (has_na)
+        mask = reinterpret_cast<const unsigned char *>(cursor.Take(n_values
+            / 8 + (n_values % 8 != 0)));
+
+      // the values are in the file before they are allocated
+      const char * data;
+      switch (type)
+      {
+        case BINARY_FLOAT64:
+          data = cursor.TakeArray(n_values, sizeof(Scalar));
+          break;
+        case BINARY_INT32:
+          data = cursor.TakeArray(n_values, sizeof(Int32));
+          break;
+        default:
+          throw RuntimeError(String("Unknown type of variable ") + name
+                             + " in file " + fileName);
+      }
+
+      ValArray::Ptr p_values(new ValArray(n_values));
+      if (type == BINARY_FLOAT64)
+      {
+        if (n_values)
+          std::memcpy(&(*p_values)[0], data, n_values * sizeof(Scalar));
+      }
+      else
+        for (UInt64 j = 0; j < n_values; ++j)
+        {
+          Int32 x;
+          std::memcpy(&x, data + j * sizeof(Int32), sizeof(Int32));
+          (*p_values)[j] = Scalar(x);
+        }
+
+      if (mask)
+        for (UInt64 j = 0; j < n_values; ++j)
+          if (mask[j / 8] & (1 << (j % 8)))
+            (*p_values)[j] = BIIPS_REALNA;
+
+      dataMap[name] = MultiArray(p_dim, p_values);
+    }
+  }
+
+}
@@ -0,0 +1,306 @@
+#include "DumpParser.hpp"
+#include "MappedFile.hpp"
+#include "common/Error.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <sstream>
+
+namespace Biips
+{
+
+  static Bool isDigit(char c)
+  {
+    return c >= '0' && c <= '9';
+  }
+
+  static Bool isNameChar(char c)
+  {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || isDigit(c)
+        || c == '_' || c == '.';
+  }
+
+  // powers of ten exactly represented by a double
+  static const Scalar EXACT_POWERS_OF_TEN[] =
+  { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12,
+    1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+  void DumpParser::error(const String & msg) const
+  {
+    std::ostringstream oss;
+    oss << "Error parsing data at line "
+        << std::count(begin_, p_, '\n') + 1 << ": " << msg;
+    throw RuntimeError(oss.str());
+  }
+
+  void DumpParser::skipSpaces()
+  {
+    while (p_ != end_)
+    {
+      if (*p_ == '#')
+        p_ = std::find(p_, end_, '\n');
+      else if (*p_ == ' ' || *p_ == '\t' || *p_ == '\n' || *p_ == '\r')
+        ++p_;
+      else
+        break;
+    }
+  }
+
+  Bool DumpParser::scanChar(char c)
+  {
+    skipSpaces();
+    if (p_ == end_ || *p_ != c)
+      return false;
+    ++p_;
+    return true;
+  }
+
+  Bool DumpParser::scanWord(const String & word)
+  {
+    skipSpaces();
+    if (Size(end_ - p_) < word.size()
+        || !std::equal(word.begin(), word.end(), p_))
+      return false;
+    const char * next = p_ + word.size();
+    // a longer name is not the word
+    if (next != end_ && isNameChar(*next) && isNameChar(word[word.size() - 1]))
+      return false;
+    p_ = next;
+    return true;
+  }
+
+  String DumpParser::scanName()
+  {
+    skipSpaces();
+    if (p_ == end_)
+      error("expected a variable name");
+    if (*p_ == '"' || *p_ == '\'' || *p_ == '`')
+    {
+      const char * close = std::find(p_ + 1, end_, *p_);
+      if (close == end_)
+        error("unterminated variable name");
+      String name(p_ + 1, close);
+      p_ = close + 1;
+      return name;
+    }
+    const char * start = p_;
+    while (p_ != end_ && isNameChar(*p_))
+      ++p_;
+    if (p_ == start || isDigit(*start))
+      error("expected a variable name");
+    return String(start, p_);
+  }
+
+  Scalar DumpParser::scanNumber()
+  {
+    skipSpaces();
+    const char * start = p_;
+    Bool negative = false;
+    if (p_ != end_ && (*p_ == '-' || *p_ == '+'))
+    {
+      negative = *p_ == '-';
+      ++p_;
+    }
+    if (scanWord("Inf"))
+      return negative ? BIIPS_NEGINF : BIIPS_POSINF;
+
+    // decimal mantissa of at most 19 significant digits
+    unsigned long long mantissa = 0;
+    Int n_digits = 0;
+    Int exponent = 0;
+    Bool any_digit = false;
+    Bool truncated = false;
+    for (; p_ != end_ && isDigit(*p_); ++p_)
+    {
+      any_digit = true;
+      Int d = *p_ - '0';
+      if (n_digits < 19)
+      {
+        mantissa = mantissa * 10 + d;
+        if (mantissa)
+          ++n_digits;
+      }
+      else
+      {
+        ++exponent;
+        truncated = truncated || d;
+      }
+    }
+    if (p_ != end_ && *p_ == '.')
+    {
+      for (++p_; p_ != end_ && isDigit(*p_); ++p_)
+      {
+        any_digit = true;
+        Int d = *p_ - '0';
+        if (n_digits < 19)
+        {
+          mantissa = mantissa * 10 + d;
+          if (mantissa)
+            ++n_digits;
+          --exponent;
+        }
+        else
+          truncated = truncated || d;
+      }
+    }
+    if (!any_digit)
+    {
+      p_ = start;
+      error("expected a number");
+    }
+    if (p_ != end_ && (*p_ == 'e' || *p_ == 'E'))
+    {
+      ++p_;
+      Bool negative_exp = false;
+      if (p_ != end_ && (*p_ == '-' || *p_ == '+'))
+      {
+        negative_exp = *p_ == '-';
+        ++p_;
+      }
+      if (p_ == end_ || !isDigit(*p_))
+        error("invalid number exponent");
+      Int exp_value = 0;
+      for (; p_ != end_ && isDigit(*p_); ++p_)
+        exp_value = std::min(exp_value * 10 + (*p_ - '0'), 100000);
+      exponent += negative_exp ? -exp_value : exp_value;
+    }
+    const char * stop = p_;
+    // integer suffix
+    if (p_ != end_ && (*p_ == 'L' || *p_ == 'l'))
+      ++p_;
+
+    Scalar x;
+    if (mantissa == 0 && !truncated)
+      x = 0.0;
+    else if (!truncated && mantissa <= (1ULL << 53) && exponent >= -22
+        && exponent <= 22)
+    {
+      // both operands are exact: the result is correctly rounded
+      x = Scalar(mantissa);
+      if (exponent >= 0)
+        x *= EXACT_POWERS_OF_TEN[exponent];
+      else
+        x /= EXACT_POWERS_OF_TEN[-exponent];
+    }
+    else
+    {
+      String token(start, stop);
+      x = std::strtod(token.c_str(), NULL);
+      return x;
+    }
+    return negative ? -x : x;
+  }
+
+  void DumpParser::scanNumbers(ValArray & values)
+  {
+    if (scanWord("NA"))
+    {
+      values.push_back(BIIPS_REALNA);
+      return;
+    }
+    Scalar from = scanNumber();
+    if (!scanChar(':'))
+    {
+      values.push_back(from);
+      return;
+    }
+    Scalar to = scanNumber();
+    if (from != std::floor(from) || to != std::floor(to))
+      error("non integer range bounds");
+    Scalar step = from <= to ? 1.0 : -1.0;
+    for (Scalar x = from; x * step <= to * step; x += step)
+      values.push_back(x);
+  }
+
+  void DumpParser::scanSeq(ValArray & values)
+  {
+    if (!scanChar('('))
+      error("expected (");
+    if (scanChar(')'))
+      return;
+    do
+      scanNumbers(values);
+    while (scanChar(','));
+    if (!scanChar(')'))
+      error("expected , or )");
+  }
+
+  void DumpParser::scanDims(DimArray & dim)
+  {
+    ValArray values;
+    if (scanWord("c"))
+      scanSeq(values);
+    else
+      scanNumbers(values);
+    for (Size i = 0; i < values.size(); ++i)
+    {
+      if (isNA(values[i]) || values[i] < 1.0 || values[i] != std::floor(values[i]))
+        error("invalid dimension");
+      dim.push_back(Size(values[i]));
+    }
+  }
+
+  Bool DumpParser::Next(String & name, MultiArray & value)
+  {
+    skipSpaces();
+    if (p_ == end_)
+      return false;
+
+    name = scanName();
+    if (scanChar('<'))
+    {
+      if (p_ == end_ || *p_ != '-')
+        error("expected <-");
+      ++p_;
+    }
+    else if (!scanChar('='))
+      error("expected <- or =");
+
+    // the values are parsed in the storage of the MultiArray
+    DimArray::Ptr p_dim(new DimArray());
+    ValArray::Ptr p_values(new ValArray());
+    if (scanWord("structure"))
+    {
+      if (!scanChar('('))
+        error("expected (");
+      if (scanWord("c"))
+        scanSeq(*p_values);
+      else
+        scanNumbers(*p_values);
+      if (!scanChar(',') || !scanWord(".Dim") || !scanChar('='))
+        error("expected , .Dim =");
+      scanDims(*p_dim);
+      if (!scanChar(')'))
+        error("expected )");
+    }
+    else if (scanWord("c"))
+      scanSeq(*p_values);
+    else
+      scanNumbers(*p_values);
+    scanChar(';');
+
+    if (p_values->empty())
+      error(String("variable ") + name + " has no values");
+    if (p_dim->empty())
+      p_dim->push_back(p_values->size());
+    else if (p_dim->Length() != p_values->size())
+      error(String("dimensions of variable ") + name
+            + " do not match the number of values");
+
+    value = MultiArray(p_dim, p_values);
+    return true;
+  }
+
+  void readDumpFile(const String & fileName,
+                    std::map<String, MultiArray> & dataMap)
+  {
+    MappedFile file(fileName);
+    DumpParser parser(file.begin(), file.end());
+    String name;
+    MultiArray value;
+    while (parser.Next(name, value))
+      dataMap[name] = value;
+  }
+
+}
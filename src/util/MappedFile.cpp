@@ -0,0 +1,67 @@
+#include "MappedFile.hpp"
+#include "common/Error.hpp"
+
+#include <fstream>
+#include <iterator>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define BIIPS_HAVE_MMAP
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace Biips
+{
+
+  MappedFile::MappedFile(const String & fileName) :
+    data_(NULL), size_(0), mapped_(false)
+  {
+#ifdef BIIPS_HAVE_MMAP
+    int fd = ::open(fileName.c_str(), O_RDONLY);
+    if (fd < 0)
+      throw RuntimeError(String("Failed to open file ") + fileName);
+    struct stat st;
+    if (::fstat(fd, &st) != 0)
+    {
+      ::close(fd);
+      throw RuntimeError(String("Failed to read file ") + fileName);
+    }
+    size_ = st.st_size;
+    // empty files can not be mapped
+    if (size_ > 0)
+    {
+      void * p = ::mmap(NULL, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (p != MAP_FAILED)
+      {
+        ::madvise(p, size_, MADV_SEQUENTIAL);
+        data_ = static_cast<const char *>(p);
+        mapped_ = true;
+      }
+    }
+    ::close(fd);
+    if (mapped_)
+      return;
+#endif
+    // read the file in the buffer
+    std::ifstream ifs(fileName.c_str(), std::ios::binary);
+    if (!ifs)
+      throw RuntimeError(String("Failed to open file ") + fileName);
+    buffer_.assign(std::istreambuf_iterator<char>(ifs),
+                   std::istreambuf_iterator<char>());
+    if (ifs.bad())
+      throw RuntimeError(String("Failed to read file ") + fileName);
+    data_ = buffer_.data();
+    size_ = buffer_.size();
+  }
+
+  MappedFile::~MappedFile()
+  {
+#ifdef BIIPS_HAVE_MMAP
+    if (mapped_)
+      ::munmap(const_cast<char *>(data_), size_);
+#endif
+  }
+
+}
@@ -0,0 +1,359 @@
+#include <boost/test/unit_test.hpp>
+
+#include "Console.hpp"
+#include "model/NodeArrayMonitor.hpp"
+#include "model/BUGSModel.hpp"
+
+#include <sstream>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace Biips
+{
+
+  //! Console giving access to its model
+  class ModelConsole: public Console
+  {
+  public:
+    ModelConsole(std::ostream & out, std::ostream & err) :
+      Console(out, err)
+    {
+    }
+
+    const BUGSModel & Model() const
+    {
+      return *pModel_;
+    }
+  };
+
+  static const Size HMM_T_MAX = 20;
+
+  //! Data of the HMM of model/hmm_1d_lin.bug
+  static std::map<String, MultiArray> hmmData()
+  {
+    std::map<String, MultiArray> data_map;
+    data_map["t_max"] = MultiArray(Scalar(HMM_T_MAX));
+    data_map["mean_x0"] = MultiArray(0.0);
+    data_map["var_x0"] = MultiArray(1.0);
+    data_map["var_x"] = MultiArray(1.0);
+    data_map["var_y"] = MultiArray(0.5);
+    DimArray::Ptr p_dim(new DimArray(2));
+    (*p_dim)[0] = 1;
+    (*p_dim)[1] = HMM_T_MAX;
+    ValArray::Ptr p_y(new ValArray(HMM_T_MAX));
+    for (Size t = 0; t < HMM_T_MAX; ++t)
+      (*p_y)[t] = 0.2 * t - 2.0 + std::sin(Scalar(t));
+    data_map["y"] = MultiArray(p_dim, p_y);
+    return data_map;
+  }
+
+  //! Compiles model/hmm_1d_lin.bug with the data
+  static void compileHmm(Console & console, const std::ostringstream & err,
+                         std::map<String, MultiArray> dataMap)
+  {
+    BOOST_REQUIRE_MESSAGE(console.CheckModel("model/hmm_1d_lin.bug", 0),
+                          err.str());
+    BOOST_REQUIRE_MESSAGE(console.LoadBaseModule(0), err.str());
+    BOOST_REQUIRE_MESSAGE(console.Compile(dataMap, false, 0, 0), err.str());
+  }
+
+  //! Console running the forward sampler on the HMM of model/hmm_1d_lin.bug
+  struct HmmConsoleFixture
+  {
+    static const Size T_MAX = HMM_T_MAX;
+    static const Size N_PARTICLES = 100;
+    static const Size SMC_RNG_SEED = 42;
+
+    std::ostringstream out;
+    std::ostringstream err;
+    ModelConsole console;
+
+    HmmConsoleFixture() :
+      console(out, err)
+    {
+      compileHmm(console, err, hmmData());
+      BOOST_REQUIRE(console.SetFilterMonitor("x"));
+      BOOST_REQUIRE(console.SetGenTreeSmoothMonitor("x"));
+      BOOST_REQUIRE_MESSAGE(console.BuildSampler(false, 0), err.str());
+      BOOST_REQUIRE_MESSAGE(console.RunForwardSampler(N_PARTICLES, SMC_RNG_SEED,
+                                                      "stratified", 0.5, 0, false),
+                            err.str());
+    }
+  };
+
+  const Size HmmConsoleFixture::T_MAX;
+  const Size HmmConsoleFixture::N_PARTICLES;
+  const Size HmmConsoleFixture::SMC_RNG_SEED;
+
+  // Checks the weighted means of the exported buffers against the means
+  // extracted from the monitors
+  static void checkExportedMeans(const NodeArrayMonitorExport & monitorExport,
+                                 const std::map<IndexRange, MultiArray> & meanMap)
+  {
+    const IndexRange & range = monitorExport.GetRange();
+    Size len = range.Length();
+    Size n_part = monitorExport.NParticles();
+    Size n_iter = monitorExport.NIterations();
+
+    ValArray values(len * n_part);
+    ValArray weights(n_part * n_iter);
+    ValArray weight_iters(n_iter);
+    ValArray iterations(len);
+    NodeArrayMonitorBuffers buffers;
+    buffers.values = &values[0];
+    buffers.weights = &weights[0];
+    buffers.weightIterations = &weight_iters[0];
+    buffers.iterations = &iterations[0];
+    monitorExport.Export(buffers);
+
+    BOOST_REQUIRE_EQUAL(meanMap.size(), len);
+    std::map<IndexRange, MultiArray>::const_iterator it_mean = meanMap.begin();
+    for (; it_mean != meanMap.end(); ++it_mean)
+    {
+      Size offset = range.GetOffset(it_mean->first.Lower());
+      Size col = std::find(weight_iters.begin(), weight_iters.end(),
+                           iterations[offset]) - weight_iters.begin();
+      BOOST_REQUIRE_LT(col, n_iter);
+
+      Scalar mean = 0.0;
+      Scalar sum_of_weights = 0.0;
+      for (Size i = 0; i < n_part; ++i)
+      {
+        Scalar w = weights[col * n_part + i];
+        mean += w * values[i * len + offset];
+        sum_of_weights += w;
+      }
+      BOOST_CHECK_CLOSE(sum_of_weights, 1.0, 1e-8);
+      BOOST_CHECK_CLOSE(mean, it_mean->second.ScalarView(), 1e-8);
+    }
+  }
+
+}
+
+
+BOOST_AUTO_TEST_SUITE( console )
+
+BOOST_FIXTURE_TEST_CASE( export_monitors, Biips::HmmConsoleFixture )
+{
+  using namespace Biips;
+
+  // filter monitors: one sampling iteration per element
+  std::map<String, NodeArrayMonitorExport> filter_exports;
+  BOOST_REQUIRE(console.DumpFilterMonitors(filter_exports));
+  BOOST_REQUIRE(filter_exports.count("x"));
+  BOOST_CHECK_EQUAL(filter_exports.at("x").NIterations(), T_MAX);
+  std::map<IndexRange, MultiArray> filter_means;
+  BOOST_REQUIRE(console.ExtractFilterStat("x", MEAN, filter_means));
+  checkExportedMeans(filter_exports.at("x"), filter_means);
+
+  // the copies of NodeArrayMonitor hold the same values and weights
+  std::map<String, NodeArrayMonitor> filter_copies;
+  BOOST_REQUIRE(console.DumpFilterMonitors(filter_copies));
+  const NodeArrayMonitor & copy = filter_copies.at("x");
+  Size len = copy.GetRange().Length();
+  ValArray values(len * N_PARTICLES);
+  ValArray weights(N_PARTICLES * T_MAX);
+  NodeArrayMonitorBuffers buffers;
+  buffers.values = &values[0];
+  buffers.weights = &weights[0];
+  filter_exports.at("x").Export(buffers);
+  BOOST_CHECK_EQUAL_COLLECTIONS(values.begin(), values.end(),
+                                copy.GetValues().Values().begin(),
+                                copy.GetValues().Values().end());
+  for (Size i = 0; i < N_PARTICLES; ++i)
+    for (Size t = 0; t < T_MAX; ++t)
+      BOOST_CHECK_EQUAL(weights[t * N_PARTICLES + i],
+                        copy.GetWeights().Values()[i * len + t]);
+
+  // genealogical tree smoother monitor: one iteration for all the elements
+  std::map<String, NodeArrayMonitorExport> smooth_exports;
+  BOOST_REQUIRE(console.DumpGenTreeSmoothMonitors(smooth_exports));
+  BOOST_REQUIRE(smooth_exports.count("x"));
+  BOOST_CHECK_EQUAL(smooth_exports.at("x").NIterations(), 1);
+  std::map<IndexRange, MultiArray> smooth_means;
+  BOOST_REQUIRE_MESSAGE(console.ExtractGenTreeSmoothStat("x", MEAN, smooth_means),
+                        err.str());
+  checkExportedMeans(smooth_exports.at("x"), smooth_means);
+}
+
+BOOST_FIXTURE_TEST_CASE( sample_gen_tree_trajectories, Biips::HmmConsoleFixture )
+{
+  using namespace Biips;
+
+  const Size n_traj = 50;
+  const Size rng_seed = 7;
+
+  // batched trajectories, gathered by several threads
+  Rng batch_rng(rng_seed);
+  std::map<String, MultiArray> batch_map;
+  BOOST_REQUIRE(console.Model().SampleGenTreeSmoothParticles(&batch_rng, n_traj,
+                                                             batch_map, 4));
+  const MultiArray & batch = batch_map.at("x");
+  BOOST_REQUIRE_EQUAL(batch.Dim().back(), n_traj);
+  Size len = batch.Length() / n_traj;
+  BOOST_REQUIRE_EQUAL(len, T_MAX);
+
+  // successive trajectories of the per-trajectory sampler, same rng
+  Rng rng(rng_seed);
+  for (Size k = 0; k < n_traj; ++k)
+  {
+    std::map<String, MultiArray> value_map;
+    BOOST_REQUIRE(console.Model().SampleGenTreeSmoothParticle(&rng, value_map));
+    const ValArray & value = value_map.at("x").Values();
+    BOOST_CHECK_EQUAL_COLLECTIONS(value.begin(), value.end(),
+                                  batch.Values().begin() + k * len,
+                                  batch.Values().begin() + (k + 1) * len);
+  }
+
+  // the console seeds both samplers alike
+  std::map<String, MultiArray> value_map;
+  BOOST_REQUIRE(console.SampleGenTreeSmoothParticle(rng_seed, value_map));
+  std::map<String, MultiArray> console_batch_map;
+  BOOST_REQUIRE(console.SampleGenTreeSmoothParticles(n_traj, rng_seed,
+                                                     console_batch_map));
+  const ValArray & value = value_map.at("x").Values();
+  const ValArray & console_batch = console_batch_map.at("x").Values();
+  BOOST_CHECK_EQUAL_COLLECTIONS(value.begin(), value.end(),
+                                console_batch.begin(),
+                                console_batch.begin() + len);
+  BOOST_CHECK_EQUAL_COLLECTIONS(console_batch.begin(), console_batch.end(),
+                                batch.Values().begin(), batch.Values().end());
+}
+
+BOOST_AUTO_TEST_CASE( resume_checkpoint )
+{
+  using namespace Biips;
+
+  const Size n_part = 100;
+  const Size rng_seed = 42;
+  const String file_name = "console_test_checkpoint.bin";
+
+  // uninterrupted run, checkpointed every 7 iterations
+  std::ostringstream out, err;
+  Console console(out, err);
+  compileHmm(console, err, hmmData());
+  BOOST_REQUIRE_MESSAGE(console.BuildSampler(false, 0), err.str());
+  console.SetCheckpoint(file_name, 7);
+  BOOST_REQUIRE_MESSAGE(console.RunForwardSampler(n_part, rng_seed, "stratified",
+                                                  0.5, 0, false),
+                        err.str());
+  Scalar log_norm_const;
+  BOOST_REQUIRE(console.GetLogNormConst(log_norm_const));
+
+  // resumed from the last checkpoint, at iteration 14
+  std::ostringstream resumed_out, resumed_err;
+  Console resumed(resumed_out, resumed_err);
+  compileHmm(resumed, resumed_err, hmmData());
+  BOOST_REQUIRE_MESSAGE(resumed.BuildSampler(false, 0), resumed_err.str());
+  BOOST_REQUIRE_MESSAGE(resumed.LoadCheckpoint(file_name), resumed_err.str());
+  BOOST_REQUIRE_MESSAGE(resumed.ResumeForwardSampler(0, false),
+                        resumed_err.str());
+  Scalar resumed_log_norm_const;
+  BOOST_REQUIRE(resumed.GetLogNormConst(resumed_log_norm_const));
+  BOOST_CHECK_EQUAL(resumed_log_norm_const, log_norm_const);
+
+  // the checkpoint of the optimal samplers is rejected by the prior ones
+  std::ostringstream prior_out, prior_err;
+  Console prior(prior_out, prior_err);
+  compileHmm(prior, prior_err, hmmData());
+  BOOST_REQUIRE_MESSAGE(prior.BuildSampler(true, 0), prior_err.str());
+  BOOST_CHECK(!prior.LoadCheckpoint(file_name));
+  BOOST_CHECK_MESSAGE(prior_err.str().find("sampler instead of") != String::npos,
+                      prior_err.str());
+
+  std::remove(file_name.c_str());
+}
+
+BOOST_AUTO_TEST_CASE( session_data )
+{
+  using namespace Biips;
+
+  const Size n_part = 100;
+  const Size rng_seed = 42;
+
+  std::map<String, MultiArray> session_data;
+  DimArray::Ptr p_dim(new DimArray(2));
+  (*p_dim)[0] = 1;
+  (*p_dim)[1] = HMM_T_MAX;
+  ValArray::Ptr p_y(new ValArray(HMM_T_MAX));
+  for (Size t = 0; t < HMM_T_MAX; ++t)
+    (*p_y)[t] = 1.0 - 0.1 * t + std::cos(Scalar(t));
+  session_data["y"] = MultiArray(p_dim, p_y);
+
+  // session on the frozen graph, with other observations
+  std::ostringstream out, err;
+  Console compiled(out, err);
+  compileHmm(compiled, err, hmmData());
+  BOOST_REQUIRE_MESSAGE(compiled.FreezeGraph(), err.str());
+
+  std::ostringstream session_out, session_err;
+  Console session(session_out, session_err);
+  BOOST_REQUIRE_MESSAGE(session.OpenSession(compiled, session_data, 0),
+                        session_err.str());
+  BOOST_REQUIRE_MESSAGE(session.BuildSampler(false, 0), session_err.str());
+  BOOST_REQUIRE_MESSAGE(session.RunForwardSampler(n_part, rng_seed, "stratified",
+                                                  0.5, 0, false),
+                        session_err.str());
+  Scalar session_log_norm_const;
+  BOOST_REQUIRE(session.GetLogNormConst(session_log_norm_const));
+
+  // model compiled with these observations
+  std::ostringstream fresh_out, fresh_err;
+  Console fresh(fresh_out, fresh_err);
+  std::map<String, MultiArray> fresh_data = hmmData();
+  fresh_data["y"] = session_data["y"];
+  compileHmm(fresh, fresh_err, fresh_data);
+  BOOST_REQUIRE_MESSAGE(fresh.BuildSampler(false, 0), fresh_err.str());
+  BOOST_REQUIRE_MESSAGE(fresh.RunForwardSampler(n_part, rng_seed, "stratified",
+                                                0.5, 0, false),
+                        fresh_err.str());
+  Scalar fresh_log_norm_const;
+  BOOST_REQUIRE(fresh.GetLogNormConst(fresh_log_norm_const));
+
+  BOOST_CHECK_CLOSE(session_log_norm_const, fresh_log_norm_const, 1e-10);
+
+  // the compiled model keeps its observations
+  Scalar log_norm_const;
+  BOOST_REQUIRE_MESSAGE(compiled.BuildSampler(false, 0), err.str());
+  BOOST_REQUIRE_MESSAGE(compiled.RunForwardSampler(n_part, rng_seed, "stratified",
+                                                   0.5, 0, false),
+                        err.str());
+  BOOST_REQUIRE(compiled.GetLogNormConst(log_norm_const));
+  BOOST_CHECK_NE(log_norm_const, session_log_norm_const);
+}
+
+BOOST_AUTO_TEST_CASE( backward_smooth_lower_bound )
+{
+  using namespace Biips;
+
+  const Scalar x_min = -1.0;
+
+  // the backward smoother reads the lower bounds of the truncated nodes
+  std::ostringstream out, err;
+  Console console(out, err);
+  std::map<String, MultiArray> data_map = hmmData();
+  data_map["x_min"] = MultiArray(x_min);
+  BOOST_REQUIRE_MESSAGE(console.CheckModel("model/hmm_1d_lin_trunc.bug", 0),
+                        err.str());
+  BOOST_REQUIRE_MESSAGE(console.LoadBaseModule(0), err.str());
+  BOOST_REQUIRE_MESSAGE(console.Compile(data_map, false, 0, 0), err.str());
+  BOOST_REQUIRE_MESSAGE(console.SetDefaultFilterMonitors(), err.str());
+  BOOST_REQUIRE(console.SetBackwardSmoothMonitor("x"));
+  BOOST_REQUIRE_MESSAGE(console.BuildSampler(true, 0), err.str());
+  BOOST_REQUIRE_MESSAGE(console.RunForwardSampler(100, 42, "stratified", 0.5, 0,
+                                                  false),
+                        err.str());
+  BOOST_REQUIRE_MESSAGE(console.RunBackwardSmoother(0, false), err.str());
+
+  std::map<IndexRange, MultiArray> smooth_means;
+  BOOST_REQUIRE_MESSAGE(console.ExtractBackwardSmoothStat("x", MEAN,
+                                                          smooth_means),
+                        err.str());
+  BOOST_CHECK_EQUAL(smooth_means.size(), HMM_T_MAX);
+  std::map<IndexRange, MultiArray>::const_iterator it_mean = smooth_means.begin();
+  for (; it_mean != smooth_means.end(); ++it_mean)
+    BOOST_CHECK_GE(it_mean->second.ScalarView(), x_min);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -3,6 +3,7 @@
 #include "TestIO.hpp"
 #include "common/cholesky.hpp"
 #include <boost/progress.hpp>
+#include <boost/scoped_ptr.hpp>
 
 namespace Biips
 {
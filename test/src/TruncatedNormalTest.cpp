@@ -0,0 +1,123 @@
+#include <boost/test/unit_test.hpp>
+
+#include "rng/TruncatedNormal.hpp"
+#include "rng/Rng.hpp"
+#include "common/ValArray.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Biips
+{
+
+  static const Size N_SAMPLES = 10000;
+  // Kolmogorov-Smirnov critical value at level 0.001, times sqrt(n)
+  static const Scalar KS_CRITICAL = 1.95;
+
+  //! Upper tail of the standard normal distribution
+  static Scalar normalQ(Scalar x)
+  {
+    return 0.5 * std::erfc(x / std::sqrt(2.0));
+  }
+
+  //! Cumulative distribution of the standard normal truncated to [left, right]
+  static Scalar truncatedCdf(Scalar x, Scalar left, Scalar right)
+  {
+    if (x <= left)
+      return 0.0;
+    if (x >= right)
+      return 1.0;
+    // the upper tails keep their precision on the right, the lower
+    // tails on the left
+    if (left > 0)
+      return (normalQ(left) - normalQ(x)) / (normalQ(left) - normalQ(right));
+    return (normalQ(-x) - normalQ(-left)) / (normalQ(-right) - normalQ(-left));
+  }
+
+  //! Checks the samples against the truncated standard normal
+  //! with the Kolmogorov-Smirnov statistic
+  static void checkKS(ValArray & values, Scalar left, Scalar right)
+  {
+    std::sort(values.begin(), values.end());
+    BOOST_REQUIRE_GE(values.front(), left);
+    BOOST_REQUIRE_LE(values.back(), right);
+
+    Size n = values.size();
+    Scalar dist = 0.0;
+    for (Size i = 0; i < n; ++i)
+    {
+      Scalar cdf = truncatedCdf(values[i], left, right);
+      dist = std::max(dist, std::max(cdf - Scalar(i) / n,
+                                     Scalar(i + 1) / n - cdf));
+    }
+    BOOST_CHECK_MESSAGE(dist * std::sqrt(Scalar(n)) < KS_CRITICAL,
+                        "[" << left << ", " << right << "]: K-S statistic "
+                        << dist * std::sqrt(Scalar(n)));
+  }
+
+  //! Samples the interval with both interfaces and checks the samples
+  static void checkInterval(Scalar left, Scalar right, Size seed)
+  {
+    Rng rng(seed);
+    ValArray values(N_SAMPLES);
+    for (Size i = 0; i < N_SAMPLES; ++i)
+      values[i] = inormal(left, right, rng);
+    checkKS(values, left, right);
+
+    // batched, with a scale that keeps the values exact
+    const Scalar sigma = 2.0;
+    inormal(&values[0], N_SAMPLES, sigma * left, sigma * right, rng, 0.0,
+            sigma);
+    for (Size i = 0; i < N_SAMPLES; ++i)
+      values[i] /= sigma;
+    checkKS(values, left, right);
+  }
+
+}
+
+
+BOOST_AUTO_TEST_SUITE( truncated_normal )
+
+BOOST_AUTO_TEST_CASE( cells )
+{
+  using namespace Biips;
+
+  // wide intervals inside [-3, 3], sampled with the cells
+  checkInterval(-1.0, 2.0, 1);
+  checkInterval(0.5, 2.5, 2);
+  checkInterval(-2.9, -0.1, 3);
+}
+
+BOOST_AUTO_TEST_CASE( short_intervals )
+{
+  using namespace Biips;
+
+  // short intervals across cell boundaries, near 0 where the cells
+  // are narrow and near 3 where they are wide
+  checkInterval(-1e-9, 1e-9, 4);
+  checkInterval(-1e-4, 1e-3, 5);
+  checkInterval(2.99, 3.0 - 1e-9, 6);
+  checkInterval(-2.0 - 1e-9, -2.0 + 1e-9, 7);
+}
+
+BOOST_AUTO_TEST_CASE( tails )
+{
+  using namespace Biips;
+
+  // intervals beyond the cells, or overlapping their ends
+  checkInterval(3.5, 4.0, 8);
+  checkInterval(2.5, 10.0, 9);
+  checkInterval(-12.0, -4.0, 10);
+  checkInterval(-4.0, 5.0, 11);
+
+  // one-sided truncations
+  Rng rng(12);
+  ValArray values(N_SAMPLES);
+  for (Size i = 0; i < N_SAMPLES; ++i)
+    values[i] = lnormal(4.0, rng);
+  checkKS(values, 4.0, 100.0);
+  rnormal(&values[0], N_SAMPLES, -0.5, rng);
+  checkKS(values, -100.0, -0.5);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -9,16 +9,23 @@
 #include "kolmogorov.hpp"
 #include "common/cholesky.hpp"
 #include "iostream/ProgressBar.hpp"
-#include "DumpReader.hpp"
+#include "DumpParser.hpp"
+#include "BinaryData.hpp"
 
 #include <fstream>
+#include <sstream>
 #include <ctime>
+#include <csignal>
+#include <thread>
+#include <atomic>
+#include <algorithm>
 
 #include <boost/accumulators/accumulators.hpp>
 #include <boost/accumulators/statistics/mean.hpp>
 #include <boost/accumulators/statistics/variance.hpp>
 #include <boost/accumulators/statistics/p_square_quantile.hpp>
 #include <boost/math/distributions/students_t.hpp>
+#include <boost/math/distributions/fisher_f.hpp>
 
 namespace Biips
 {
@@ -42,6 +49,15 @@ using std::cerr;
 using std::endl;
 using std::ifstream;
 
+// console interrupted by SIGINT and SIGTERM
+static Biips::Console * p_signaled_console = NULL;
+
+extern "C" void cancelOnSignal(int)
+{
+  if (p_signaled_console)
+    p_signaled_console->CancelForwardSampler();
+}
+
 BOOST_AUTO_TEST_CASE( my_test )
 {
   int argc = boost::unit_test::framework::master_test_suite().argc;
@@ -57,6 +73,11 @@ BOOST_AUTO_TEST_CASE( my_test )
   String do_smooth_str;
   Size check_mode;
   Size data_rng_seed;
+  Size data_batch_size;
+  Size data_threads;
+  Size n_sessions;
+  Size n_islands;
+  Scalar island_ess_threshold;
   Size smc_rng_seed;
   vector<Size> n_particles;
   Scalar ess_threshold;
@@ -64,11 +85,17 @@ BOOST_AUTO_TEST_CASE( my_test )
   Size n_smc;
   Scalar reject_level;
   String dot_file_name;
+  String profile_file_name;
+  String trace_file_name;
   String config_file_name;
   vector<String> mutations;
   Size verbosity;
   Size num_bins;
+  Size fixed_lag;
+  String checkpoint_file_name;
+  Size checkpoint_period;
   String data_file_name;
+  String data_binary_out_file_name;
 
   // Declare a group of options that will be
   // allowed only on command line
@@ -102,7 +129,25 @@ BOOST_AUTO_TEST_CASE( my_test )
       "values:\n"
       " 0: \tchecks normalizing-constant mean.\n"
       " 1: \t0 + checks filtering errors goodness of fit.\n"
-      " 2: \t1 + checks smoothing errors goodness of fit.")
+      " 2: \t1 + checks smoothing errors goodness of fit.")(
+      "lazy-eval", "only evaluates the logical nodes needed by a stochastic node or a monitor.")(
+      "unchecked", "does not check the parameter values of the nodes in the SMC runs.")(
+      "sqmc", "runs the SMC with randomized quasi-Monte Carlo points.\n"
+      "only runs the prior mutation. with repeat-smc > 1, checks the errors against the quantile of the reference errors and the log-norm-const variance against Monte Carlo runs.")(
+      "partial-likelihood", "drops the terms of the likelihoods that only depend on the observed values.")(
+      "single-precision-archives", "archives the values of the monitored nodes in single precision. the particles stay in double precision.")(
+      "freeze-graph", "freezes the graph after compilation.")(
+      "fixed-lag", po::value<Size>(&fixed_lag),
+      "runs the fixed-lag smoother with this lag and computes its errors to the smoothing reference.")(
+      "checkpoint-file", po::value<String>(&checkpoint_file_name),
+      "writes the state of the SMC sampler to this file when interrupted by SIGINT or SIGTERM.\n"
+      "with several mutations or numbers of particles, each pass suffixes the file name with them.")(
+      "checkpoint-period", po::value<Size>(&checkpoint_period)->default_value(0),
+      "also writes the checkpoint file every this number of iterations.")(
+      "resume", "resumes the SMC sampler from the checkpoint file instead of running it from the start.\n"
+      "applies when repeat-smc=1.")(
+      "async", "runs the SMC sampler in a background worker, printing its iterations and reading the filter means while it runs.\n"
+      "applies when repeat-smc=1.")
       ;
 
   // Declare a group of options that will be
@@ -112,9 +157,24 @@ BOOST_AUTO_TEST_CASE( my_test )
   config.add_options()("model-file", po::value<String>(&model_file_name),
                        "BUGS model file name.")(
       "data-file", po::value<String>(&data_file_name), "data file name.\n"
-      "ASCII text containing data in the S-plus dump format.")(
+      "ASCII text containing data in the S-plus dump format, or binary data written by data-binary-out.")(
+      "data-binary-out", po::value<String>(&data_binary_out_file_name),
+      "writes the data read to this file in binary format.")(
       "data-rng-seed", po::value<Size>(&data_rng_seed),
       "data sampler rng seed. default=time().")(
+      "data-batch", po::value<Size>(&data_batch_size),
+      "samples this number of datasets in parallel and compiles the model with the first one.")(
+      "data-threads", po::value<Size>(&data_threads)->default_value(0),
+      "number of threads sampling the data batch. 0 uses all the hardware threads.")(
+      "sessions", po::value<Size>(&n_sessions)->default_value(0),
+      "runs this number of SMC samplers concurrently on the frozen compiled model. "
+      "session k uses dataset k of the data batch and smc-rng-seed + k.")(
+      "islands", po::value<Size>(&n_islands)->default_value(0),
+      "runs an island particle filter with this number of worker processes, "
+      "sharing the particles.")(
+      "island-ess-threshold", po::value<Scalar>(&island_ess_threshold)->default_value(0.5),
+      "ESS threshold of the island weights, a fraction of the number of islands if <= 1.")(
+      "migrate", "resamples the islands when the ESS of their weights is below island-ess-threshold.")(
       "particles",
       po::value<vector<Size> >(&n_particles)->default_value(
           vector<Size>(1, 1000)),
@@ -147,6 +207,12 @@ BOOST_AUTO_TEST_CASE( my_test )
   //        ("plot-file", po::value<String>(&plot_file_name), "plots pdf file name.\n"
   //            "applies when repeat-smc=1.")
   ("dot-file", po::value<String>(&dot_file_name), "dot file name.\n"
+   "The file will be created or overwritten.")
+  ("profile-file", po::value<String>(&profile_file_name),
+   "JSON profile file name of the last SMC run.\n"
+   "The file will be created or overwritten.")
+  ("trace-file", po::value<String>(&trace_file_name),
+   "trace event file name of the last SMC run.\n"
    "The file will be created or overwritten.");
 
   // Hidden options, will be allowed both on command line and
@@ -287,6 +353,13 @@ BOOST_AUTO_TEST_CASE( my_test )
         po::validation_error(po::validation_error::invalid_bool_value,
                              do_smooth_str, "smooth"));
 
+  // only the prior mutation samples the quasi-Monte Carlo points
+  if (vm.count("sqmc") && (mutations.size() != 1 || mutations[0] != "prior"))
+  {
+    cerr << "Warning: sqmc only runs the prior mutation." << endl;
+    mutations.assign(1, "prior");
+  }
+
   // Read data
   // ---------------------------------
   map<String, MultiArray> data_map;
@@ -299,54 +372,10 @@ BOOST_AUTO_TEST_CASE( my_test )
       cout << INDENT_STRING << "data-file = " << data_file_name << endl;
     }
 
-    ifstream ifs_dump(data_file_name.c_str());
-    if (ifs_dump.fail())
-      throw RuntimeError(String("Failed to open file ") + data_file_name);
-
-    DumpReader dump_reader(ifs_dump);
-    while (ifs_dump.good())
-    {
-      if (!dump_reader.next())
-        throw RuntimeError(String("Error parsing file: ") + data_file_name);
-
-      DimArray::Ptr dim_ptr(
-          new DimArray(dump_reader.dims().begin(), dump_reader.dims().end()));
-      ValArray::Ptr val_ptr(new ValArray());
-      if (dump_reader.is_int())
-      {
-        if (dump_reader.has_na())
-        {
-          val_ptr->resize(dump_reader.int_values().size());
-          std::replace_copy(dump_reader.int_values().begin(),
-                            dump_reader.int_values().end(), val_ptr->begin(),
-                            Scalar(BIIPS_INTNA), BIIPS_REALNA);
-        }
-        else
-        {
-          val_ptr->assign(dump_reader.int_values().begin(),
-                          dump_reader.int_values().end());
-        }
-      }
-      else
-      {
-        val_ptr->assign(dump_reader.double_values().begin(),
-                        dump_reader.double_values().end());
-      }
-      if (val_ptr->empty())
-        throw RuntimeError(
-            String("Error reading data: variable ") + dump_reader.name()
-            + " has no values.");
-      if (dim_ptr->empty())
-        dim_ptr->push_back(val_ptr->size());
-      else if (dim_ptr->Length() != val_ptr->size())
-        throw RuntimeError(
-            String("Error reading data: dimensions of variable ")
-            + dump_reader.name() + " do not match the number of values.");
-
-      data_map.insert(
-          std::make_pair(dump_reader.name(), MultiArray(dim_ptr, val_ptr)));
-    }
-
+    if (isBinaryDataFile(data_file_name))
+      readBinaryData(data_file_name, data_map);
+    else
+      readDumpFile(data_file_name, data_map);
   }
   else // read from cfg file
   {
@@ -358,6 +387,16 @@ BOOST_AUTO_TEST_CASE( my_test )
     data_map = transformStoredDataMap(data_map_stored);
 
   }
+
+  if (vm.count("data-binary-out"))
+  {
+    if (verbosity > 0)
+    {
+      cout << PROMPT_STRING << "Writing data in:" << endl;
+      cout << INDENT_STRING << "data-binary-out = " << data_binary_out_file_name << endl;
+    }
+    writeBinaryData(data_binary_out_file_name, data_map);
+  }
 #ifdef BIIPS_DEBUG
   cout << "Parsed data variables: ";
   for (map<String, MultiArray>::const_iterator it = data_map.begin();
@@ -372,6 +411,21 @@ BOOST_AUTO_TEST_CASE( my_test )
   // Make a console
   // ------------------
   Console console(cout, cerr);
+  // the signals must not reach the console once destroyed
+  struct SignaledConsoleGuard
+  {
+    ~SignaledConsoleGuard()
+    {
+      p_signaled_console = NULL;
+    }
+  } signaled_console_guard;
+  if (vm.count("checkpoint-file"))
+  {
+    console.SetCheckpoint(checkpoint_file_name, checkpoint_period);
+    p_signaled_console = &console;
+    std::signal(SIGINT, cancelOnSignal);
+    std::signal(SIGTERM, cancelOnSignal);
+  }
 
 // Check model syntax
 // ------------------
@@ -397,9 +451,25 @@ BOOST_AUTO_TEST_CASE( my_test )
   if (verbosity > 0)
     cout << INDENT_STRING << "data-rng-seed = " << data_rng_seed << endl;
 
-  if (!console.Compile(data_map, true, data_rng_seed, verbosity))
+  Bool gen_data = true;
+  DataBatch::Ptr p_batch;
+  if (vm.count("data-batch"))
+  {
+    if (!console.SampleDataBatch(p_batch, data_map, data_batch_size,
+                                 data_rng_seed, data_threads, verbosity))
+      throw RuntimeError("Failed to sample data batch.");
+    if (data_batch_size == 0)
+      throw RuntimeError("Empty data batch.");
+    p_batch->GetDataMap(0, data_map);
+    gen_data = false;
+  }
+
+  if (!console.Compile(data_map, gen_data, data_rng_seed, verbosity))
     throw RuntimeError("Failed to compile model.");
 
+  if (vm.count("freeze-graph") && !console.FreezeGraph())
+    throw RuntimeError("Failed to freeze graph.");
+
   if (verbosity > 0 && interactive)
     pressEnterToContinue();
 
@@ -429,6 +499,163 @@ BOOST_AUTO_TEST_CASE( my_test )
   if (exec_step < 1)
     return;
 
+  // Run concurrent sessions
+  //----------------------
+  if (n_sessions > 0)
+  {
+    if (!console.FreezeGraph())
+      throw RuntimeError("Failed to freeze graph.");
+
+    Size session_seed = vm.count("smc-rng-seed") ? smc_rng_seed : time(0);
+    if (verbosity > 0)
+    {
+      cout << PROMPT_STRING << "Running " << n_sessions
+           << " concurrent sessions" << endl;
+      cout << INDENT_STRING << "mutation = " << mutations[0] << endl;
+      cout << INDENT_STRING << "particles = " << n_particles[0] << endl;
+      cout << INDENT_STRING << "smc-rng-seed = " << session_seed << endl;
+    }
+
+    vector<Scalar> session_log_norm_const(n_sessions, BIIPS_REALNA);
+    vector<String> session_errors(n_sessions);
+    auto run_session = [&](Size k)
+    {
+      std::ostringstream out, err;
+      Console session(out, err);
+      std::map<String, MultiArray> session_data;
+      if (p_batch)
+        p_batch->GetDataMap(k % p_batch->NDatasets(), session_data);
+
+      Bool ok = session.OpenSession(console, session_data, 0);
+      for (Size i = 0; ok && i < monitored_var.size(); ++i)
+        ok = session.SetFilterMonitor(monitored_var[i]);
+      ok = ok && session.BuildSampler(mutations[0] == "prior", 0)
+          && session.RunForwardSampler(n_particles[0], session_seed + k,
+                                       resample_type, ess_threshold, 0, false)
+          && session.GetLogNormConst(session_log_norm_const[k]);
+      if (!ok)
+        session_errors[k] = err.str();
+    };
+
+    Types<std::thread>::Array workers;
+    for (Size k = 0; k < n_sessions; ++k)
+      workers.push_back(std::thread(run_session, k));
+    for (Size k = 0; k < n_sessions; ++k)
+      workers[k].join();
+
+    for (Size k = 0; k < n_sessions; ++k)
+    {
+      if (!session_errors[k].empty())
+        throw RuntimeError(String("Failed to run session ") + print(k) + ": "
+                           + session_errors[k]);
+      if (verbosity > 0)
+        cout << INDENT_STRING << "session " << k
+             << ": log-normalizing constant = "
+             << session_log_norm_const[k] << endl;
+    }
+
+    if (verbosity > 0 && interactive)
+      pressEnterToContinue();
+  }
+
+  // Run island particle filter
+  //----------------------
+  vector<Scalar> log_norm_const_islands;
+  if (n_islands > 0)
+  {
+    console.SetLazyEvaluation(vm.count("lazy-eval"));
+    console.SetUnchecked(vm.count("unchecked"));
+    console.SetSqmc(vm.count("sqmc"));
+    console.SetPartialLikelihood(vm.count("partial-likelihood"));
+    console.SetSinglePrecisionArchives(vm.count("single-precision-archives"));
+
+    // the filter monitors receive the particles of the islands
+    for (Size i = 0; i < monitored_var.size(); ++i)
+      if (!console.SetFilterMonitor(monitored_var[i]))
+        throw RuntimeError(String("Failed to monitor variable ")
+                           + monitored_var[i]);
+
+    if (!console.BuildSampler(mutations[0] == "prior", verbosity))
+      throw RuntimeError("Failed to build sampler.");
+
+    for (Size i_smc = 0; i_smc < n_smc; ++i_smc)
+    {
+      // the seeds differ from those of the SMC runs compared below
+      Size island_seed = (n_smc == 1 && vm.count("smc-rng-seed")) ?
+          smc_rng_seed : time(0) + n_smc + i_smc + 1;
+
+      Scalar log_norm_const;
+      if (!console.RunIslandSampler(n_particles[0], n_islands, island_seed,
+                                    resample_type, ess_threshold,
+                                    island_ess_threshold, vm.count("migrate"),
+                                    log_norm_const, verbosity * (n_smc == 1)))
+        throw RuntimeError("Failed to run island sampler.");
+
+      log_norm_const_islands.push_back(log_norm_const);
+
+      if (verbosity > 0 && n_smc == 1)
+        cout << INDENT_STRING << "log-normalizing constant = "
+             << log_norm_const << endl;
+
+      if (exec_step < 2 || n_smc > 1)
+        continue;
+
+      std::map<String, std::map<IndexRange, MultiArray> > filter_mean_map =
+          extractStat(console, MEAN, monitored_var, "mean", verbosity > 0,
+                      false);
+
+      Scalar error_filter = 0.0;
+      for (Size i = 0; i < monitored_var.size(); ++i)
+      {
+        if (!computeError(error_filter, monitored_var[i], filter_mean_map,
+                          bench_filter_map_stored))
+          throw RuntimeError(
+              String("Failed to compute island filtering error of variable ")
+              + monitored_var[i]);
+      }
+      error_filter *= n_particles[0];
+
+      if (verbosity > 0)
+        cout << INDENT_STRING << "island filtering error = " << error_filter
+             << endl;
+    }
+
+    if (verbosity > 0 && interactive)
+      pressEnterToContinue();
+  }
+
+  // Run Monte Carlo reference of the SQMC sampler
+  //----------------------
+  vector<Scalar> log_norm_const_mc;
+  if (vm.count("sqmc") && n_smc > 1)
+  {
+    if (verbosity > 0)
+      cout << PROMPT_STRING << "Running " << n_smc
+           << " Monte Carlo SMC algorithms as reference" << endl;
+
+    console.SetLazyEvaluation(vm.count("lazy-eval"));
+    console.SetUnchecked(vm.count("unchecked"));
+    console.SetSqmc(false);
+    console.SetPartialLikelihood(vm.count("partial-likelihood"));
+
+    if (!console.BuildSampler(true, 0))
+      throw RuntimeError("Failed to build sampler.");
+
+    for (Size i_smc = 0; i_smc < n_smc; ++i_smc)
+    {
+      // the seeds differ from those of the SQMC runs compared below
+      Size mc_seed = time(0) + n_smc + i_smc + 1;
+
+      Scalar log_norm_const;
+      if (!console.RunForwardSampler(n_particles[0], mc_seed, resample_type,
+                                     ess_threshold, 0, false)
+          || !console.GetLogNormConst(log_norm_const))
+        throw RuntimeError("Failed to run SMC sampler.");
+
+      log_norm_const_mc.push_back(log_norm_const);
+    }
+  }
+
   // Monitor variables
   if (verbosity > 0)
     cout << PROMPT_STRING << "Setting user filter monitors" << endl;
@@ -447,6 +674,25 @@ BOOST_AUTO_TEST_CASE( my_test )
   if (verbosity > 0 && interactive && !monitored_var.empty())
     pressEnterToContinue();
 
+  if (vm.count("fixed-lag"))
+  {
+    if (verbosity > 0)
+      cout << PROMPT_STRING << "Setting user fixed-lag smoother monitors (lag = "
+           << fixed_lag << ")" << endl;
+
+    console.SetFixedLag(fixed_lag);
+    for (Size i = 0; i < monitored_var.size(); ++i)
+    {
+      const String & name = monitored_var[i];
+
+      if (!console.SetFixedLagSmoothMonitor(name))
+        throw RuntimeError(String("Failed to monitor variable ") + name);
+
+      if (verbosity > 0)
+        cout << INDENT_STRING << "monitoring variable " << name << endl;
+    }
+  }
+
   if (do_smooth)
   {
     if (verbosity > 0)
@@ -487,6 +733,16 @@ BOOST_AUTO_TEST_CASE( my_test )
     {
       string mut = mutations[i_mut];
 
+      // each pass has its own checkpoint: the states of different
+      // samplers can not be resumed by each other
+      String pass_checkpoint_file_name = checkpoint_file_name;
+      if (n_particles.size() > 1)
+        pass_checkpoint_file_name += "." + print(n_part);
+      if (mutations.size() > 1)
+        pass_checkpoint_file_name += "." + mut;
+      if (vm.count("checkpoint-file"))
+        console.SetCheckpoint(pass_checkpoint_file_name, checkpoint_period);
+
       if (verbosity > 0)
       {
         cout << PROMPT_STRING << "Running " << n_smc << " SMC algorithms";
@@ -511,6 +767,13 @@ BOOST_AUTO_TEST_CASE( my_test )
       vector<Scalar> errors_smooth_new;
       vector<Scalar> log_norm_const_smc;
 
+      console.SetProfiling(vm.count("profile-file") || vm.count("trace-file"));
+      console.SetLazyEvaluation(vm.count("lazy-eval"));
+      console.SetUnchecked(vm.count("unchecked"));
+      console.SetSqmc(vm.count("sqmc"));
+      console.SetPartialLikelihood(vm.count("partial-likelihood"));
+      console.SetSinglePrecisionArchives(vm.count("single-precision-archives"));
+
       if (!console.BuildSampler(mut == "prior",
                                 verbosity * (n_smc == 1 || verbosity > 1)))
         throw RuntimeError("Failed to build sampler.");
@@ -530,14 +793,94 @@ BOOST_AUTO_TEST_CASE( my_test )
         if (verbosity > 0 && interactive && n_smc == 1)
           pressEnterToContinue();
 
+        // the fixed-lag estimates are released as soon as they are read
+        std::map<String, std::map<IndexRange, MultiArray> > fixed_lag_mean_map;
+        std::atomic<bool> drain_failed(false);
+        auto drain_fixed_lag = [&]()
+        {
+          if (!vm.count("fixed-lag"))
+            return;
+          for (Size i = 0; i < monitored_var.size(); ++i)
+          {
+            std::map<IndexRange, MultiArray> stat_map;
+            if (!console.DrainFixedLagSmoothStat(monitored_var[i], MEAN,
+                                                 stat_map))
+              drain_failed = true;
+            fixed_lag_mean_map[monitored_var[i]].insert(stat_map.begin(),
+                                                        stat_map.end());
+          }
+        };
+        console.SetIterationCallback([&](const SMCIterationInfo &)
+        {
+          drain_fixed_lag();
+        });
+
         // Run sampler
         //----------------------
         Bool verbose_run_smc = verbosity > 1 || (verbosity > 0 && n_smc == 1);
-        if (!console.RunForwardSampler(n_part, smc_rng_seed, resample_type,
-                                       ess_threshold, verbose_run_smc,
-                                       verbose_run_smc))
+        if (vm.count("resume") && n_smc == 1)
+        {
+          if (!vm.count("checkpoint-file"))
+            throw RuntimeError("Can not resume SMC sampler: no checkpoint file.");
+          if (!console.LoadCheckpoint(pass_checkpoint_file_name))
+            throw RuntimeError("Failed to load SMC sampler checkpoint.");
+          if (!console.ResumeForwardSampler(verbose_run_smc, verbose_run_smc))
+            throw RuntimeError("Failed to resume SMC sampler.");
+        }
+        else if (vm.count("async") && n_smc == 1)
+        {
+          if (verbosity > 0)
+            cout << PROMPT_STRING << "Running SMC forward sampler asynchronously with "
+                 << n_part << " particles" << endl;
+          // the filter statistics exist once the sampler is initialized
+          std::atomic<bool> initialized(false);
+          console.SetIterationCallback([&](const SMCIterationInfo & info)
+          {
+            initialized = true;
+            drain_fixed_lag();
+            if (verbosity > 1)
+              cout << INDENT_STRING << "iteration " << info.iteration + 1
+                   << "/" << info.nIterations << ": ESS = " << info.ess
+                   << ", log-normalizing constant increment = "
+                   << info.logNormConstIncrement << ", time = " << info.time
+                   << "s" << endl;
+          });
+          AsyncRun::Ptr p_run = console.RunForwardSamplerAsync(n_part,
+                                                               smc_rng_seed,
+                                                               resample_type,
+                                                               ess_threshold);
+          // the statistics of the sampled components while the run continues
+          Size n_reads = 0;
+          while (!p_run->WaitFor(0.01))
+          {
+            if (!initialized)
+              continue;
+            for (Size i = 0; i < monitored_var.size(); ++i)
+            {
+              std::map<IndexRange, MultiArray> stat_map;
+              if (!console.ExtractSampledFilterStat(monitored_var[i], MEAN,
+                                                    stat_map))
+                throw RuntimeError("Failed to extract sampled filter statistic.");
+            }
+            ++n_reads;
+          }
+          if (!p_run->Wait())
+            throw RuntimeError("Failed to run SMC sampler.");
+          if (verbosity > 0)
+            cout << INDENT_STRING << "filter means read " << n_reads
+                 << " times during the run" << endl;
+        }
+        else if (!console.RunForwardSampler(n_part, smc_rng_seed, resample_type,
+                                            ess_threshold, verbose_run_smc,
+                                            verbose_run_smc))
           throw RuntimeError("Failed to run SMC sampler.");
 
+        console.SetIterationCallback(Console::IterationCallback());
+        // the estimates of a checkpoint are not notified
+        drain_fixed_lag();
+        if (drain_failed)
+          throw RuntimeError("Failed to drain fixed-lag smoothing stats.");
+
         Scalar log_norm_const;
         if (!console.GetLogNormConst(log_norm_const))
           throw RuntimeError("Failed to get log normalizing constant.");
@@ -592,6 +935,30 @@ BOOST_AUTO_TEST_CASE( my_test )
         if (verbosity > 0 && interactive && n_smc == 1)
           pressEnterToContinue();
 
+        // Compute fixed-lag smooth mean error of monitored values
+        //--------------------------------------------------------
+        if (vm.count("fixed-lag"))
+        {
+          Scalar error_fixed_lag = 0.0;
+
+          for (Size i = 0; i < monitored_var.size(); ++i)
+          {
+            const String & name = monitored_var[i];
+
+            if (!computeError(error_fixed_lag, name, fixed_lag_mean_map,
+                              bench_smooth_map_stored))
+              throw RuntimeError(
+                  String("Failed to compute fixed-lag smoothing error of variable ")
+                  + name);
+          }
+
+          error_fixed_lag *= n_part;
+
+          if (verbosity > 0 && n_smc == 1)
+            cout << INDENT_STRING << "fixed-lag smoothing error = "
+                 << error_fixed_lag << endl;
+        }
+
         // Run backward smoother
         //-------------------------------------------------
         if (do_smooth)
@@ -648,6 +1015,25 @@ BOOST_AUTO_TEST_CASE( my_test )
         }
       }
 
+      // Write profile files
+      //-------------------------------
+      if (vm.count("profile-file"))
+      {
+        std::ofstream ofs(profile_file_name.c_str());
+        if (ofs.fail())
+          throw RuntimeError(String("Failed to open file ") + profile_file_name);
+        if (!console.DumpProfile(ofs))
+          throw RuntimeError("Failed to print profile file.");
+      }
+      if (vm.count("trace-file"))
+      {
+        std::ofstream ofs(trace_file_name.c_str());
+        if (ofs.fail())
+          throw RuntimeError(String("Failed to open file ") + trace_file_name);
+        if (!console.DumpProfile(ofs, true))
+          throw RuntimeError("Failed to print trace file.");
+      }
+
       if (exec_step < 3)
         continue;
 
@@ -704,6 +1090,85 @@ BOOST_AUTO_TEST_CASE( my_test )
           pressEnterToContinue();
       }
 
+      // Check island normalizing constant mean against the SMC one
+      if (!log_norm_const_islands.empty() && i_n_part == 0 && i_mut == 0
+          && n_smc > 1)
+      {
+        cout << PROMPT_STRING
+             << "Checking island normalizing constant mean with reject level alpha = "
+             << reject_level << endl;
+
+        using namespace boost::accumulators;
+        typedef accumulator_set<long double, features<tag::mean, tag::variance> > acc_ref_type;
+
+        acc_ref_type norm_const_smc_acc;
+        acc_ref_type norm_const_islands_acc;
+        for (Size i = 0; i < n_smc; ++i)
+        {
+          norm_const_smc_acc(expl(log_norm_const_smc[i]));
+          norm_const_islands_acc(expl(log_norm_const_islands[i]));
+        }
+
+        cout << INDENT_STRING << "island sample log-norm-const mean = "
+             << log(mean(norm_const_islands_acc)) << endl;
+
+        // Welch t-test of the difference of the means
+        Scalar var_smc = variance(norm_const_smc_acc) / n_smc;
+        Scalar var_islands = variance(norm_const_islands_acc) / n_smc;
+        Scalar welch_stat = (mean(norm_const_islands_acc)
+                             - mean(norm_const_smc_acc))
+                            / sqrt(var_smc + var_islands);
+        Scalar welch_dof = (var_smc + var_islands) * (var_smc + var_islands)
+                           * (n_smc - 1)
+                           / (var_smc * var_smc + var_islands * var_islands);
+        boost::math::students_t welch_dist(welch_dof);
+
+        Scalar welch_p_value = 2
+                               * cdf(complement(welch_dist, fabs(welch_stat)));
+
+        cout << INDENT_STRING << "Welch t-test: t = " << welch_stat
+             << ", p-value = " << welch_p_value << endl;
+
+        BOOST_CHECK_GT(welch_p_value, reject_level);
+      }
+
+      // Check the variance of the SQMC log normalizing constant against
+      // the Monte Carlo one
+      if (!log_norm_const_mc.empty() && i_n_part == 0 && i_mut == 0)
+      {
+        cout << PROMPT_STRING
+             << "Checking SQMC log-norm-const variance reduction with reject level alpha = "
+             << reject_level << endl;
+
+        using namespace boost::accumulators;
+        typedef accumulator_set<Scalar, features<tag::variance> > acc_ref_type;
+
+        acc_ref_type log_norm_const_sqmc_acc;
+        acc_ref_type log_norm_const_mc_acc;
+        for (Size i = 0; i < n_smc; ++i)
+        {
+          log_norm_const_sqmc_acc(log_norm_const_smc[i]);
+          log_norm_const_mc_acc(log_norm_const_mc[i]);
+        }
+
+        cout << INDENT_STRING << "SQMC log-norm-const variance = "
+             << variance(log_norm_const_sqmc_acc) << endl;
+        cout << INDENT_STRING << "Monte Carlo log-norm-const variance = "
+             << variance(log_norm_const_mc_acc) << endl;
+
+        // one-sided F-test of the variances ratio
+        Scalar f_stat = variance(log_norm_const_mc_acc)
+                        / variance(log_norm_const_sqmc_acc);
+        boost::math::fisher_f f_dist(n_smc - 1, n_smc - 1);
+
+        Scalar f_p_value = cdf(complement(f_dist, f_stat));
+
+        cout << INDENT_STRING << "F-test: F = " << f_stat << ", p-value = "
+             << f_p_value << endl;
+
+        BOOST_CHECK_LT(f_p_value, reject_level);
+      }
+
       // Check errors
       //-------------
 
@@ -751,7 +1216,9 @@ BOOST_AUTO_TEST_CASE( my_test )
         }
       }
 
-      if (n_smc == 1)
+      // the SQMC errors are smaller than the Monte Carlo reference errors:
+      // they are checked against its quantile instead of their distribution
+      if (n_smc == 1 || vm.count("sqmc"))
       {
         // compute 1-alpha quantile of reference errors distribution
         Scalar error_filter_threshold;
@@ -783,7 +1250,9 @@ BOOST_AUTO_TEST_CASE( my_test )
             cout << INDENT_STRING << "filtering errors quantile = "
                  << error_filter_threshold << endl;
 
-          BOOST_CHECK_LT(errors_filter_new.front(), error_filter_threshold);
+          BOOST_CHECK_LT(*std::max_element(errors_filter_new.begin(),
+                                            errors_filter_new.end()),
+                         error_filter_threshold);
         }
 
         if (check_smooth)
@@ -801,7 +1270,9 @@ BOOST_AUTO_TEST_CASE( my_test )
             cout << INDENT_STRING << "smoothing errors quantile = "
                  << error_smooth_threshold << endl;
 
-          BOOST_CHECK_LT(errors_smooth_new.front(), error_smooth_threshold);
+          BOOST_CHECK_LT(*std::max_element(errors_smooth_new.begin(),
+                                            errors_smooth_new.end()),
+                         error_smooth_threshold);
         }
 
         if (verbosity > 0 && interactive)